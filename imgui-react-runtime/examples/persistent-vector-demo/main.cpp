@@ -20,6 +20,10 @@
 
 #include "PersistentVector.h"
 #include "PersistentMap.h"
+#include "PersistentSet.h"
+#include "PersistentSortedMap.h"
+#include "PersistentTable.h"
+#include "PersistentText.h"
 
 #include <chrono>
 #include <climits>
@@ -41,13 +45,13 @@ console.log("=== PersistentVector Demo ===\n");
 // 1. Create an empty vector
 console.log("1. Creating an empty vector:");
 const empty = PersistentVector.empty();
-console.log("   empty.count() =", empty.count());
-console.log("   empty.empty() =", empty.empty());
+console.log("   empty.count =", empty.count);
+console.log("   empty.isEmpty() =", empty.isEmpty());
 
 // 2. Create a vector from an array
 console.log("\n2. Creating a vector from [1, 2, 3]:");
 const v1 = PersistentVector.from([1, 2, 3]);
-console.log("   v1.count() =", v1.count());
+console.log("   v1.count =", v1.count);
 console.log("   v1.toArray() =", JSON.stringify(v1.toArray()));
 console.log("   v1.first() =", v1.first());
 console.log("   v1.last() =", v1.last());
@@ -282,6 +286,10 @@ int main(int argc, char *argv[])
   // Install PersistentVector
   cljs::installPersistentVector(*runtime);
   cljs::installPersistentMap(*runtime);
+  cljs::installPersistentSet(*runtime);
+  cljs::installPersistentSortedMap(*runtime);
+  cljs::installPersistentTable(*runtime);
+  cljs::installPersistentText(*runtime);
 
   try
   {
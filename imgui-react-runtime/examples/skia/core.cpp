@@ -10,6 +10,11 @@
 #include "WebSocketSupport.h"
 #include "PersistentVector.h"
 #include "PersistentMap.h"
+#include "PersistentSet.h"
+#include "PersistentSortedMap.h"
+#include "PersistentTable.h"
+#include "PersistentText.h"
+#include "ThreadPool.h"
 #include "MappedFileBuffer.h"
 
 #include "include/gpu/ganesh/GrDirectContext.h"
@@ -375,6 +380,10 @@ int main(void)
     // Install ClojureScript native data structures
     cljs::installPersistentVector(*s_hermesApp->hermes);
     cljs::installPersistentMap(*s_hermesApp->hermes);
+    cljs::installPersistentSet(*s_hermesApp->hermes);
+    cljs::installPersistentSortedMap(*s_hermesApp->hermes);
+    cljs::installPersistentTable(*s_hermesApp->hermes);
+    cljs::installPersistentText(*s_hermesApp->hermes);
 
     // Initialize jslib's current time
     double curTimeMs = glfwGetTime() * 1000.0;
@@ -439,6 +448,10 @@ int main(void)
 
         pumpWebSocketSupport();
 
+        // Resolve the Promises of finished native parallel operations
+        cljs::pumpNativeTasks(*s_hermesApp->hermes);
+        s_hermesApp->hermes->drainMicrotasks();
+
         // Run all ready macrotasks before rendering frame
         double nextTimeMs;
         while ((nextTimeMs = s_hermesApp->peekMacroTask.call(*s_hermesApp->hermes)
@@ -6,6 +6,11 @@
 #include "WebSocketSupport.h"
 #include "PersistentVector.h"
 #include "PersistentMap.h"
+#include "PersistentSet.h"
+#include "PersistentSortedMap.h"
+#include "PersistentTable.h"
+#include "PersistentText.h"
+#include "ThreadPool.h"
 
 #include "sokol_app.h"
 #include "sokol_gfx.h"
@@ -268,6 +273,10 @@ static void app_frame()
 
   try
   {
+    // Resolve the Promises of finished native parallel operations
+    cljs::pumpNativeTasks(*s_hermesApp->hermes);
+    s_hermesApp->hermes->drainMicrotasks();
+
     // Run all ready macrotasks before rendering frame
     double nextTimeMs;
     while ((nextTimeMs = s_hermesApp->peekMacroTask.call(*s_hermesApp->hermes)
@@ -448,6 +457,10 @@ sapp_desc sokol_main(int argc, char *argv[])
     // Install ClojureScript native data structures
     cljs::installPersistentVector(*s_hermesApp->hermes);
     cljs::installPersistentMap(*s_hermesApp->hermes);
+    cljs::installPersistentSet(*s_hermesApp->hermes);
+    cljs::installPersistentSortedMap(*s_hermesApp->hermes);
+    cljs::installPersistentTable(*s_hermesApp->hermes);
+    cljs::installPersistentText(*s_hermesApp->hermes);
 
     // Initialize jslib's current time
     double curTimeMs = stm_ms(stm_now());
@@ -0,0 +1,149 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+namespace cljs
+{
+
+    /**
+     * Native ports of the cljs.core hashing functions, bit-for-bit compatible
+     * with ClojureScript so native collections hash equal to their cljs
+     * counterparts. All arithmetic is on uint32_t, which wraps exactly like
+     * JS imul / `| 0`.
+     */
+    namespace hash
+    {
+        constexpr uint32_t kSeed = 0;
+        constexpr uint32_t kC1 = 0xcc9e2d51u;
+        constexpr uint32_t kC2 = 0x1b873593u;
+
+        inline uint32_t rotl(uint32_t x, int n)
+        {
+            return (x << n) | (x >> (32 - n));
+        }
+
+        inline uint32_t mixK1(uint32_t k1)
+        {
+            return rotl(k1 * kC1, 15) * kC2;
+        }
+
+        inline uint32_t mixH1(uint32_t h1, uint32_t k1)
+        {
+            return rotl(h1 ^ k1, 13) * 5 + 0xe6546b64u;
+        }
+
+        inline uint32_t fmix(uint32_t h1, uint32_t len)
+        {
+            h1 ^= len;
+            h1 ^= h1 >> 16;
+            h1 *= 0x85ebca6bu;
+            h1 ^= h1 >> 13;
+            h1 *= 0xc2b2ae35u;
+            h1 ^= h1 >> 16;
+            return h1;
+        }
+
+        // cljs.core/m3-hash-int
+        inline int32_t hashInt(uint32_t in)
+        {
+            if (in == 0)
+                return 0;
+            return static_cast<int32_t>(fmix(mixH1(kSeed, mixK1(in)), 4));
+        }
+
+        // cljs.core/mix-collection-hash
+        inline int32_t mixCollectionHash(uint32_t hashBasis, uint32_t count)
+        {
+            return static_cast<int32_t>(fmix(mixH1(kSeed, mixK1(hashBasis)), count));
+        }
+
+        // cljs.core/hash of a UTF-8 string: hash-string* over its UTF-16 code
+        // units, then m3-hash-int
+        inline int32_t hashString(const std::string &s)
+        {
+            uint32_t h = 0;
+            const auto *p = reinterpret_cast<const unsigned char *>(s.data());
+            const auto *end = p + s.size();
+            while (p < end)
+            {
+                uint32_t cp;
+                int extra;
+                if (*p < 0x80)
+                {
+                    cp = *p;
+                    extra = 0;
+                }
+                else if ((*p & 0xE0) == 0xC0)
+                {
+                    cp = *p & 0x1F;
+                    extra = 1;
+                }
+                else if ((*p & 0xF0) == 0xE0)
+                {
+                    cp = *p & 0x0F;
+                    extra = 2;
+                }
+                else
+                {
+                    cp = *p & 0x07;
+                    extra = 3;
+                }
+                ++p;
+                for (; extra > 0 && p < end; --extra, ++p)
+                {
+                    cp = (cp << 6) | (*p & 0x3F);
+                }
+
+                if (cp >= 0x10000)
+                {
+                    cp -= 0x10000;
+                    h = h * 31 + (0xD800 + (cp >> 10));
+                    h = h * 31 + (0xDC00 + (cp & 0x3FF));
+                }
+                else
+                {
+                    h = h * 31 + cp;
+                }
+            }
+            return hashInt(h);
+        }
+
+        // cljs.core/hash of a number
+        inline int32_t hashNumber(double d)
+        {
+            if (std::isfinite(d))
+            {
+                // js-mod keeps the sign of the dividend, like fmod
+                return static_cast<int32_t>(std::fmod(std::floor(d), 2147483647.0));
+            }
+            if (std::isnan(d))
+                return 2146959360;
+            return d > 0 ? 2146435072 : -1048576;
+        }
+
+        // Per-element steps of hash-ordered-coll / hash-unordered-coll; start
+        // from 1 and 0 respectively and finish with mixCollectionHash
+        inline uint32_t orderedStep(uint32_t acc, int32_t h)
+        {
+            return acc * 31 + static_cast<uint32_t>(h);
+        }
+
+        inline uint32_t unorderedStep(uint32_t acc, int32_t h)
+        {
+            return acc + static_cast<uint32_t>(h);
+        }
+
+        // Hash of a [k v] MapEntry, which cljs hashes as an ordered pair
+        inline int32_t mapEntry(int32_t keyHash, int32_t valHash)
+        {
+            return mixCollectionHash(orderedStep(orderedStep(1, keyHash), valHash), 2);
+        }
+    } // namespace hash
+
+} // namespace cljs
@@ -0,0 +1,62 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+
+namespace cljs
+{
+
+    /**
+     * Checked access to JS arguments shared by the native collections.
+     *
+     * jsi::Object::getHostObject<T> is an unchecked static_pointer_cast, so
+     * handing a set, a typed vector or a plain object to a function expecting
+     * a PersistentVector would be undefined behavior. Casts of arguments go
+     * through hostAs, which checks isHostObject<T> first and returns nullptr
+     * for anything else.
+     */
+
+    template <typename T>
+    std::shared_ptr<T> hostAs(facebook::jsi::Runtime &rt, const facebook::jsi::Object &obj)
+    {
+        return obj.isHostObject<T>(rt) ? obj.getHostObject<T>(rt) : nullptr;
+    }
+
+    template <typename T>
+    std::shared_ptr<T> hostAs(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value)
+    {
+        return value.isObject() ? hostAs<T>(rt, value.getObject(rt)) : nullptr;
+    }
+
+    // args[i] as a T, or nullptr if it is missing or something else
+    template <typename T>
+    std::shared_ptr<T> hostAs(facebook::jsi::Runtime &rt, const facebook::jsi::Value *args,
+                              size_t count, size_t i)
+    {
+        return i < count ? hostAs<T>(rt, args[i]) : nullptr;
+    }
+
+    // args[i] as an index or length. Throws unless it is a finite,
+    // non-negative number that fits in size_t; fn names the caller
+    inline size_t indexArg(facebook::jsi::Runtime &rt, const facebook::jsi::Value *args,
+                           size_t count, size_t i, const char *fn)
+    {
+        constexpr double kLimit = static_cast<double>(std::numeric_limits<size_t>::max());
+        if (i >= count || !args[i].isNumber() || !std::isfinite(args[i].getNumber()) ||
+            args[i].getNumber() < 0 || args[i].getNumber() >= kLimit)
+        {
+            throw facebook::jsi::JSError(
+                rt, std::string(fn) + " requires a non-negative numeric index argument");
+        }
+        return static_cast<size_t>(args[i].getNumber());
+    }
+
+} // namespace cljs
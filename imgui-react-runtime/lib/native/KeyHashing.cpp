@@ -0,0 +1,247 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "KeyHashing.h"
+#include "CljsHash.h"
+#include "StringTable.h"
+#include "TypedVector.h"
+
+#include <unordered_map>
+
+namespace cljs
+{
+
+    namespace
+    {
+        // Hashes from cljs are plain numbers; NaN, infinities and values
+        // past int32 are wrapped like ToInt32 rather than cast directly
+        int32_t toHash(double number)
+        {
+            return toInt32(number);
+        }
+    } // namespace
+
+    thread_local facebook::jsi::Runtime *KeyEquivScope::current_ = nullptr;
+
+    KeyHandlers &KeyHandlers::forRuntime(facebook::jsi::Runtime &rt)
+    {
+        // Intentionally leaked: the functions must not be released after the
+        // runtime is gone
+        static auto *registry =
+            new std::unordered_map<facebook::jsi::Runtime *, KeyHandlers>();
+        static facebook::jsi::Runtime *lastRuntime = nullptr;
+        static KeyHandlers *lastHandlers = nullptr;
+
+        if (lastRuntime != &rt)
+        {
+            lastRuntime = &rt;
+            lastHandlers = &(*registry)[&rt];
+        }
+        return *lastHandlers;
+    }
+
+    void KeyHandlers::install(facebook::jsi::Runtime &rt, facebook::jsi::Function keyInfo,
+                              facebook::jsi::Function equiv)
+    {
+        keyInfo_ = std::make_unique<facebook::jsi::Function>(std::move(keyInfo));
+        equiv_ = std::make_unique<facebook::jsi::Function>(std::move(equiv));
+    }
+
+    void KeyHandlers::installHash(facebook::jsi::Runtime &rt, facebook::jsi::Function hash)
+    {
+        hash_ = std::make_unique<facebook::jsi::Function>(std::move(hash));
+    }
+
+    void KeyHandlers::installReducedType(facebook::jsi::Runtime &rt, facebook::jsi::Function reducedType)
+    {
+        reducedType_ = std::make_unique<facebook::jsi::Function>(std::move(reducedType));
+    }
+
+    bool KeyHandlers::isReduced(facebook::jsi::Runtime &rt, const facebook::jsi::Value &v) const
+    {
+        // Primitive accumulators (the common case) never need the instanceof
+        return reducedType_ && v.isObject() && v.getObject(rt).instanceOf(rt, *reducedType_);
+    }
+
+    int32_t KeyHandlers::hashValue(facebook::jsi::Runtime &rt, const StoredValue &v) const
+    {
+        switch (v.type())
+        {
+        case StoredValue::NIL:
+            return 0;
+        case StoredValue::BOOL:
+            return v.asBool() ? 1231 : 1237;
+        case StoredValue::NUMBER:
+            return hash::hashNumber(v.asNumber());
+        case StoredValue::STRING:
+            return hash::hashString(v.asString());
+        case StoredValue::INTERNED_KEY:
+        case StoredValue::HASHED_REF:
+            return v.keyHash();
+        case StoredValue::OBJECT_REF:
+            break;
+        }
+
+        if (!hash_)
+        {
+            throw facebook::jsi::JSError(rt, "No hash function registered for object elements");
+        }
+        return toHash(hash_->call(rt, v.objectValue(rt)).asNumber());
+    }
+
+    std::shared_ptr<ObjectState> KeyHandlers::keyState(facebook::jsi::Runtime &rt,
+                                                       const facebook::jsi::Object &obj)
+    {
+        // Objects carrying someone else's native state, or frozen ones, are
+        // simply classified every time
+        auto state = objectState(rt, obj);
+        if (state && state->classified)
+        {
+            return state;
+        }
+        if (!state)
+        {
+            state = std::make_shared<ObjectState>();
+        }
+
+        auto info = keyInfo_->call(rt, facebook::jsi::Value(rt, obj));
+        if (info.isNumber())
+        {
+            state->keyType = StoredValue::HASHED_REF;
+            state->keyHash = toHash(info.getNumber());
+        }
+        else if (info.isObject() && info.getObject(rt).isArray(rt))
+        {
+            auto pair = info.getObject(rt).getArray(rt);
+            state->keyType = StoredValue::INTERNED_KEY;
+            state->keyHash = toHash(pair.getValueAtIndex(rt, 0).asNumber());
+            state->canonical = internString(pair.getValueAtIndex(rt, 1).asString(rt).utf8(rt));
+        }
+        state->classified = true;
+        return state;
+    }
+
+    StoredValue KeyHandlers::convertObjectKey(facebook::jsi::Runtime &rt,
+                                              facebook::jsi::Object obj)
+    {
+        if (!keyInfo_)
+        {
+            return StoredValue(rt, obj);
+        }
+
+        auto state = keyState(rt, obj);
+        switch (state->keyType)
+        {
+        case StoredValue::INTERNED_KEY:
+            return StoredValue::internedKey(rt, state->canonical, state->keyHash, obj);
+        case StoredValue::HASHED_REF:
+            return StoredValue::hashedRef(rt, state->keyHash, obj);
+        default:
+            return StoredValue(rt, obj);
+        }
+    }
+
+    KeyProbe::KeyProbe(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key)
+    {
+        if (key.isBool())
+        {
+            key_ = StoredValue(key.getBool());
+        }
+        else if (key.isNumber())
+        {
+            key_ = StoredValue(key.asNumber());
+        }
+        else if (key.isString())
+        {
+            // Equal to the interned key by content, without touching the table
+            stringCell_.emplace(key.asString(rt).utf8(rt));
+            detail::retain(&*stringCell_);
+            key_ = StoredValue::adoptString(&*stringCell_);
+        }
+        else if (key.isObject())
+        {
+            object_.emplace(key.getObject(rt));
+            objectCell_.emplace(*object_);
+            auto &handlers = KeyHandlers::forRuntime(rt);
+            StoredValue::Type type = StoredValue::OBJECT_REF;
+            if (handlers.isInstalled())
+            {
+                auto state = handlers.keyState(rt, *object_);
+                type = state->keyType;
+                objectCell_->hash = state->keyHash;
+                if (type == StoredValue::INTERNED_KEY)
+                {
+                    canonical_ = state->canonical;
+                    objectCell_->canonical = canonical_.stringCell();
+                }
+            }
+            key_ = StoredValue::fromObjectCell(type, &*objectCell_);
+        }
+    }
+
+    bool KeyHandlers::equiv(facebook::jsi::Runtime &rt, const StoredValue &a,
+                            const StoredValue &b) const
+    {
+        if (!equiv_ || !a.isObject() || !b.isObject())
+        {
+            return false;
+        }
+        auto result = equiv_->call(rt, a.objectValue(rt),
+                                   b.objectValue(rt));
+        return result.isBool() && result.getBool();
+    }
+
+    bool KeyHandlers::valuesEqual(facebook::jsi::Runtime &rt, const StoredValue &a,
+                                  const StoredValue &b) const
+    {
+        if (a == b)
+        {
+            return true;
+        }
+        // Interned and hashed keys of the same kind were decided by ==
+        if (!a.isObject() || !b.isObject() ||
+            (a.type() == b.type() && a.type() != StoredValue::OBJECT_REF))
+        {
+            return false;
+        }
+        if (equiv_)
+        {
+            return equiv(rt, a, b);
+        }
+
+        if (!equivName_)
+        {
+            equivName_ = std::make_unique<facebook::jsi::PropNameID>(
+                facebook::jsi::PropNameID::forAscii(rt, "equiv"));
+        }
+        facebook::jsi::Object obj = a.asObject(rt);
+        auto method = obj.getProperty(rt, *equivName_);
+        if (!method.isObject() || !method.getObject(rt).isFunction(rt))
+        {
+            return false;
+        }
+        auto result = method.getObject(rt).getFunction(rt).callWithThis(
+            rt, obj, b.objectValue(rt));
+        return result.isBool() && result.getBool();
+    }
+
+    bool hashedKeyEquiv(const StoredValue &a, const StoredValue &b)
+    {
+        auto *rt = KeyEquivScope::current();
+        if (!rt)
+        {
+            return false;
+        }
+        try
+        {
+            return KeyHandlers::forRuntime(*rt).equiv(*rt, a, b);
+        }
+        catch (const std::exception &)
+        {
+            // immer probes keys from inside the HAMT; never unwind through it
+            return false;
+        }
+    }
+
+} // namespace cljs
@@ -0,0 +1,139 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include "ObjectState.h"
+#include "StoredValue.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace cljs
+{
+
+    /**
+     * Per-runtime ClojureScript hooks used to hash object keys natively.
+     *
+     * hermes.persistent-map registers them via PersistentMap.setKeyHandlers:
+     * - keyInfo(k) returns null for identity keys, a number (the key's cljs
+     *   hash) for IHash/IEquiv values, or [hash, canonical] for value-like
+     *   keys whose equality is equality of the canonical string. Canonical
+     *   strings go through the shared string table, so INTERNED_KEY equality
+     *   is a pointer compare.
+     * - equiv(a, b) is cljs.core/=, called only when two hashed keys collide.
+     * - hash(x) is cljs.core/hash, used by hashValue for object elements
+     *   (also registered by hermes.persistent-vector via setHashFunction).
+     * - reducedType is cljs.core/Reduced, registered via setReducedType so
+     *   native reduce and kvReduce can stop at (reduced x).
+     *
+     * The classification is cached on the JS object in its ObjectState, so
+     * a keyword constant calls back into JS once, not on every lookup.
+     */
+    class KeyHandlers
+    {
+    public:
+        static KeyHandlers &forRuntime(facebook::jsi::Runtime &rt);
+
+        void install(facebook::jsi::Runtime &rt, facebook::jsi::Function keyInfo,
+                     facebook::jsi::Function equiv);
+        bool isInstalled() const { return keyInfo_ != nullptr; }
+        void installHash(facebook::jsi::Runtime &rt, facebook::jsi::Function hash);
+        void installReducedType(facebook::jsi::Runtime &rt, facebook::jsi::Function reducedType);
+
+        // True if a reduce step returned an instance of the registered
+        // Reduced type. Always false when none is registered.
+        bool isReduced(facebook::jsi::Runtime &rt, const facebook::jsi::Value &v) const;
+
+        // Converts an object key to OBJECT_REF, INTERNED_KEY or HASHED_REF
+        StoredValue convertObjectKey(facebook::jsi::Runtime &rt, facebook::jsi::Object obj);
+
+        // Calls the registered cljs equiv on two stored object keys
+        bool equiv(facebook::jsi::Runtime &rt, const StoredValue &a, const StoredValue &b) const;
+
+        // cljs = on two stored elements or map values. Primitives, interned
+        // and hashed keys compare natively; two distinct objects call the
+        // registered equiv, or the object's own equiv method when none is
+        // registered (plain JS callers). Callers hold a KeyEquivScope.
+        bool valuesEqual(facebook::jsi::Runtime &rt, const StoredValue &a,
+                         const StoredValue &b) const;
+
+        // cljs.core/hash of any stored value. Primitives and hashed keys are
+        // hashed natively; plain object references call the registered hash.
+        int32_t hashValue(facebook::jsi::Runtime &rt, const StoredValue &v) const;
+
+    private:
+        friend class KeyProbe;
+
+        // Classifies obj through keyInfo, or returns the classification
+        // cached on it. Requires installed handlers
+        std::shared_ptr<ObjectState> keyState(facebook::jsi::Runtime &rt,
+                                              const facebook::jsi::Object &obj);
+
+        std::unique_ptr<facebook::jsi::Function> keyInfo_;
+        std::unique_ptr<facebook::jsi::Function> equiv_;
+        std::unique_ptr<facebook::jsi::Function> hash_;
+        std::unique_ptr<facebook::jsi::Function> reducedType_;
+        // "equiv", created on first use by valuesEqual
+        mutable std::unique_ptr<facebook::jsi::PropNameID> equivName_;
+    };
+
+    /**
+     * A map or set key for lookups that owns nothing.
+     *
+     * Converting a key to store it interns strings and gives object keys an
+     * ObjectCell with an ObjectSlots slot. A get, has or dissoc throws the
+     * key away right after, so the probe keeps its cell inline instead and
+     * borrows the JS object: object keys are classified (and hashed) like
+     * convertObjectKey, but nothing is allocated or rooted. key() is only
+     * valid while the probe lives and must not be stored in a collection.
+     */
+    class KeyProbe
+    {
+    public:
+        KeyProbe(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key);
+
+        KeyProbe(const KeyProbe &) = delete;
+        KeyProbe &operator=(const KeyProbe &) = delete;
+
+        const StoredValue &key() const { return key_; }
+
+    private:
+        std::optional<facebook::jsi::Object> object_;
+        std::optional<detail::ProbeCell> objectCell_;
+        std::optional<detail::StringCell> stringCell_;
+        StoredValue canonical_;
+        // Declared last so it releases its reference before the cells go
+        StoredValue key_;
+    };
+
+    /**
+     * Makes the runtime available to StoredValue equality for HASHED_REF keys
+     * while immer probes a map. Every map operation that looks up, inserts or
+     * erases keys must hold one.
+     */
+    class KeyEquivScope
+    {
+    public:
+        explicit KeyEquivScope(facebook::jsi::Runtime &rt) : previous_(current_)
+        {
+            current_ = &rt;
+        }
+        ~KeyEquivScope() { current_ = previous_; }
+
+        KeyEquivScope(const KeyEquivScope &) = delete;
+        KeyEquivScope &operator=(const KeyEquivScope &) = delete;
+
+        static facebook::jsi::Runtime *current() { return current_; }
+
+    private:
+        static thread_local facebook::jsi::Runtime *current_;
+        facebook::jsi::Runtime *previous_;
+    };
+
+} // namespace cljs
@@ -0,0 +1,424 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "MemoryPolicy.h"
+
+namespace cljs
+{
+
+    /**
+     * Persistent sequence of line lengths with path copying, the line index
+     * of PersistentText.
+     *
+     * Same layout as PersistentBTree, but positional: leaves hold up to
+     * kMaxWidth line lengths in bytes, and every node records the lines and
+     * bytes below it. The byte offset of a line, and the line holding a
+     * byte offset, are found in one descent, without summing the lines
+     * before them. Updates copy O(log n) nodes and share the rest, so each
+     * text version keeps its own index cheaply.
+     */
+    class LineIndex
+    {
+    public:
+        static constexpr size_t kMaxWidth = 32;
+        static constexpr size_t kMinWidth = kMaxWidth / 2;
+
+        struct Node
+        {
+            detail::CountedVector<uint32_t> lengths;                     // leaves only
+            detail::CountedVector<std::shared_ptr<const Node>> children; // internal only
+            size_t lines = 0;                                            // lines in subtree
+            size_t bytes = 0;                                            // their total length
+
+            bool isLeaf() const { return children.empty(); }
+            size_t width() const { return isLeaf() ? lengths.size() : children.size(); }
+        };
+        using NodePtr = std::shared_ptr<const Node>;
+
+        // Counted like PersistentBTree nodes
+        template <typename... Args>
+        static std::shared_ptr<Node> newNode(Args &&...args)
+        {
+            return std::allocate_shared<Node>(detail::CountingAllocator<Node>(),
+                                              std::forward<Args>(args)...);
+        }
+
+        LineIndex() = default;
+
+        size_t lines() const { return root_ ? root_->lines : 0; }
+        size_t bytes() const { return root_ ? root_->bytes : 0; }
+
+        static LineIndex fromLengths(const std::vector<uint32_t> &lengths)
+        {
+            size_t n = lengths.size();
+            if (n == 0)
+                return LineIndex();
+
+            // Spread entries evenly so every node is at least half full
+            std::vector<std::shared_ptr<Node>> level;
+            size_t groups = (n + kMaxWidth - 1) / kMaxWidth;
+            for (size_t g = 0, pos = 0; g < groups; ++g)
+            {
+                size_t end = n * (g + 1) / groups;
+                auto leaf = newNode();
+                leaf->lengths.assign(lengths.begin() + pos, lengths.begin() + end);
+                leaf->lines = end - pos;
+                for (uint32_t length : leaf->lengths)
+                    leaf->bytes += length;
+                level.push_back(std::move(leaf));
+                pos = end;
+            }
+
+            while (level.size() > 1)
+            {
+                std::vector<std::shared_ptr<Node>> parents;
+                size_t m = level.size();
+                size_t parentGroups = (m + kMaxWidth - 1) / kMaxWidth;
+                for (size_t g = 0, pos = 0; g < parentGroups; ++g)
+                {
+                    size_t end = m * (g + 1) / parentGroups;
+                    auto node = newNode();
+                    for (size_t i = pos; i < end; ++i)
+                    {
+                        node->lines += level[i]->lines;
+                        node->bytes += level[i]->bytes;
+                        node->children.push_back(std::move(level[i]));
+                    }
+                    parents.push_back(std::move(node));
+                    pos = end;
+                }
+                level = std::move(parents);
+            }
+            return LineIndex(std::move(level.front()));
+        }
+
+        // Byte offset of the start of line (line <= lines())
+        size_t lineStart(size_t line) const
+        {
+            if (line >= lines())
+                return bytes();
+            size_t offset = 0;
+            const Node *node = root_.get();
+            while (!node->isLeaf())
+            {
+                for (const auto &child : node->children)
+                {
+                    if (line < child->lines)
+                    {
+                        node = child.get();
+                        break;
+                    }
+                    line -= child->lines;
+                    offset += child->bytes;
+                }
+            }
+            for (size_t i = 0; i < line; ++i)
+                offset += node->lengths[i];
+            return offset;
+        }
+
+        // Length in bytes of line (line < lines())
+        uint32_t length(size_t line) const
+        {
+            const Node *node = root_.get();
+            while (!node->isLeaf())
+            {
+                for (const auto &child : node->children)
+                {
+                    if (line < child->lines)
+                    {
+                        node = child.get();
+                        break;
+                    }
+                    line -= child->lines;
+                }
+            }
+            return node->lengths[line];
+        }
+
+        // The line holding byte offset; offsets at or past the end belong to
+        // the last line
+        size_t lineAt(size_t offset) const
+        {
+            if (offset >= bytes())
+                return lines() > 0 ? lines() - 1 : 0;
+            size_t line = 0;
+            const Node *node = root_.get();
+            while (!node->isLeaf())
+            {
+                for (const auto &child : node->children)
+                {
+                    if (offset < child->bytes)
+                    {
+                        node = child.get();
+                        break;
+                    }
+                    offset -= child->bytes;
+                    line += child->lines;
+                }
+            }
+            for (uint32_t length : node->lengths)
+            {
+                if (offset < length)
+                    break;
+                offset -= length;
+                ++line;
+            }
+            return line;
+        }
+
+        LineIndex set(size_t line, uint32_t length) const
+        {
+            return LineIndex(setIn(*root_, line, length));
+        }
+
+        // Inserts a line of length before line (line == lines() appends)
+        LineIndex insert(size_t line, uint32_t length) const
+        {
+            if (!root_)
+            {
+                auto leaf = newNode();
+                leaf->lengths.push_back(length);
+                leaf->lines = 1;
+                leaf->bytes = length;
+                return LineIndex(std::move(leaf));
+            }
+
+            auto result = insertInto(*root_, line, length);
+            if (!result.second)
+                return LineIndex(std::move(result.first));
+
+            auto newRoot = newNode();
+            newRoot->lines = result.first->lines + result.second->lines;
+            newRoot->bytes = result.first->bytes + result.second->bytes;
+            newRoot->children.push_back(std::move(result.first));
+            newRoot->children.push_back(std::move(result.second));
+            return LineIndex(std::move(newRoot));
+        }
+
+        LineIndex erase(size_t line) const
+        {
+            auto newRoot = eraseFrom(*root_, line);
+            if (newRoot->lines == 0)
+                return LineIndex();
+            if (!newRoot->isLeaf() && newRoot->children.size() == 1)
+                return LineIndex(newRoot->children.front());
+            return LineIndex(std::move(newRoot));
+        }
+
+        // Replaces lines [first, first + removed) with lines of the given
+        // lengths. Small edits update in place; edits touching a sizeable
+        // share of the index rebuild it, which is cheaper than one descent
+        // per line
+        LineIndex splice(size_t first, size_t removed, const std::vector<uint32_t> &inserted) const
+        {
+            size_t changed = removed + inserted.size();
+            if (changed > kMaxWidth && changed * 16 > lines())
+            {
+                std::vector<uint32_t> lengths;
+                lengths.reserve(lines() - removed + inserted.size());
+                size_t i = 0;
+                forEach([&](uint32_t length)
+                        {
+                    if (i == first)
+                        lengths.insert(lengths.end(), inserted.begin(), inserted.end());
+                    if (i < first || i >= first + removed)
+                        lengths.push_back(length);
+                    ++i; });
+                if (first == lines())
+                    lengths.insert(lengths.end(), inserted.begin(), inserted.end());
+                return fromLengths(lengths);
+            }
+
+            LineIndex result = *this;
+            size_t common = std::min(removed, inserted.size());
+            for (size_t i = 0; i < common; ++i)
+                result = result.set(first + i, inserted[i]);
+            for (size_t i = common; i < removed; ++i)
+                result = result.erase(first + common);
+            for (size_t i = common; i < inserted.size(); ++i)
+                result = result.insert(first + i, inserted[i]);
+            return result;
+        }
+
+        // Calls fn(length) for every line in order
+        template <typename Fn>
+        void forEach(Fn &&fn) const
+        {
+            if (root_)
+                forEachIn(*root_, fn);
+        }
+
+    private:
+        explicit LineIndex(NodePtr root) : root_(std::move(root)) {}
+
+        // Index of the child holding line, with line made relative to it.
+        // line == the node's line count selects the end of the last child
+        static size_t childFor(const Node &node, size_t &line)
+        {
+            size_t last = node.children.size() - 1;
+            for (size_t i = 0; i < last; ++i)
+            {
+                if (line < node.children[i]->lines)
+                    return i;
+                line -= node.children[i]->lines;
+            }
+            return last;
+        }
+
+        static NodePtr setIn(const Node &node, size_t line, uint32_t length)
+        {
+            auto copy = newNode(node);
+            if (node.isLeaf())
+            {
+                copy->bytes = copy->bytes - copy->lengths[line] + length;
+                copy->lengths[line] = length;
+                return copy;
+            }
+            size_t idx = childFor(node, line);
+            auto child = setIn(*node.children[idx], line, length);
+            copy->bytes = copy->bytes - node.children[idx]->bytes + child->bytes;
+            copy->children[idx] = std::move(child);
+            return copy;
+        }
+
+        // The new node, and its right half if it split
+        static std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>>
+        insertInto(const Node &node, size_t line, uint32_t length)
+        {
+            auto copy = newNode(node);
+            if (node.isLeaf())
+            {
+                copy->lengths.insert(copy->lengths.begin() + line, length);
+            }
+            else
+            {
+                size_t idx = childFor(node, line);
+                auto child = insertInto(*node.children[idx], line, length);
+                copy->children[idx] = std::move(child.first);
+                if (child.second)
+                    copy->children.insert(copy->children.begin() + idx + 1, std::move(child.second));
+            }
+            copy->lines++;
+            copy->bytes += length;
+
+            if (copy->width() <= kMaxWidth)
+                return {std::move(copy), nullptr};
+            return split(std::move(copy));
+        }
+
+        // Splits an overfull node into two halves
+        static std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>>
+        split(std::shared_ptr<Node> node)
+        {
+            auto right = newNode();
+            size_t half = node->width() / 2;
+            if (node->isLeaf())
+            {
+                right->lengths.assign(node->lengths.begin() + half, node->lengths.end());
+                node->lengths.erase(node->lengths.begin() + half, node->lengths.end());
+                right->lines = right->lengths.size();
+                for (uint32_t length : right->lengths)
+                    right->bytes += length;
+            }
+            else
+            {
+                right->children.assign(std::make_move_iterator(node->children.begin() + half),
+                                       std::make_move_iterator(node->children.end()));
+                node->children.erase(node->children.begin() + half, node->children.end());
+                for (const auto &child : right->children)
+                {
+                    right->lines += child->lines;
+                    right->bytes += child->bytes;
+                }
+            }
+            node->lines -= right->lines;
+            node->bytes -= right->bytes;
+            return {std::move(node), std::move(right)};
+        }
+
+        static std::shared_ptr<Node> eraseFrom(const Node &node, size_t line)
+        {
+            auto copy = newNode(node);
+            if (node.isLeaf())
+            {
+                copy->bytes -= copy->lengths[line];
+                copy->lengths.erase(copy->lengths.begin() + line);
+                copy->lines--;
+                return copy;
+            }
+
+            size_t idx = childFor(node, line);
+            auto child = eraseFrom(*node.children[idx], line);
+            copy->lines--;
+            copy->bytes = copy->bytes - node.children[idx]->bytes + child->bytes;
+            bool underflow = child->width() < kMinWidth;
+            copy->children[idx] = std::move(child);
+            if (underflow && copy->children.size() > 1)
+                rebalance(*copy, idx);
+            return copy;
+        }
+
+        // Merges children[idx] with a neighbour, or splits the pair evenly if
+        // they don't fit in one node
+        static void rebalance(Node &parent, size_t idx)
+        {
+            size_t i = idx + 1 < parent.children.size() ? idx : idx - 1;
+            const Node &left = *parent.children[i];
+            const Node &right = *parent.children[i + 1];
+
+            auto merged = newNode();
+            if (left.isLeaf())
+            {
+                merged->lengths = left.lengths;
+                merged->lengths.insert(merged->lengths.end(), right.lengths.begin(),
+                                       right.lengths.end());
+            }
+            else
+            {
+                merged->children = left.children;
+                merged->children.insert(merged->children.end(), right.children.begin(),
+                                        right.children.end());
+            }
+            merged->lines = left.lines + right.lines;
+            merged->bytes = left.bytes + right.bytes;
+
+            if (merged->width() <= kMaxWidth)
+            {
+                parent.children.erase(parent.children.begin() + i + 1);
+                parent.children[i] = std::move(merged);
+                return;
+            }
+
+            auto halves = split(std::move(merged));
+            parent.children[i] = std::move(halves.first);
+            parent.children[i + 1] = std::move(halves.second);
+        }
+
+        template <typename Fn>
+        static void forEachIn(const Node &node, Fn &fn)
+        {
+            if (node.isLeaf())
+            {
+                for (uint32_t length : node.lengths)
+                    fn(length);
+                return;
+            }
+            for (const auto &child : node.children)
+                forEachIn(*child, fn);
+        }
+
+        NodePtr root_;
+    };
+
+} // namespace cljs
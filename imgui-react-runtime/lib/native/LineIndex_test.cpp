@@ -0,0 +1,171 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "LineIndex.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace cljs;
+
+/**
+ * Checks PersistentText's line index against a plain vector of line
+ * lengths, with enough lines that edits split and merge nodes.
+ */
+class LineIndexTest
+{
+public:
+    static void testInsertEraseAcrossNodes()
+    {
+        std::cout << "Testing insert/erase across node boundaries..." << std::endl;
+
+        std::mt19937 rng(1);
+        std::vector<uint32_t> expected;
+        LineIndex index;
+        for (int i = 0; i < 3000; ++i)
+        {
+            size_t line = rng() % (expected.size() + 1);
+            uint32_t length = rng() % 80 + 1;
+            expected.insert(expected.begin() + line, length);
+            index = index.insert(line, length);
+        }
+        assertSame(index, expected);
+
+        LineIndex grown = index;
+        std::vector<uint32_t> grownExpected = expected;
+        while (expected.size() > 10)
+        {
+            size_t line = rng() % expected.size();
+            if (rng() % 4 == 0)
+            {
+                uint32_t length = rng() % 80 + 1;
+                expected[line] = length;
+                index = index.set(line, length);
+            }
+            else
+            {
+                expected.erase(expected.begin() + line);
+                index = index.erase(line);
+            }
+            if (expected.size() % 200 == 0)
+                assertSame(index, expected);
+        }
+        assertSame(index, expected);
+        while (!expected.empty())
+        {
+            expected.pop_back();
+            index = index.erase(expected.size());
+        }
+        assert(index.lines() == 0 && index.bytes() == 0);
+
+        // Earlier versions are untouched
+        assertSame(grown, grownExpected);
+
+        std::cout << "✓ Insert/erase across nodes passed" << std::endl;
+    }
+
+    static void testOffsetsAtLineEdges()
+    {
+        std::cout << "Testing line <-> offset at line edges..." << std::endl;
+
+        std::vector<uint32_t> lengths;
+        for (uint32_t i = 0; i < 2000; ++i)
+            lengths.push_back(i % 7 + 1);
+        LineIndex index = LineIndex::fromLengths(lengths);
+
+        size_t offset = 0;
+        for (size_t line = 0; line < lengths.size(); ++line)
+        {
+            assert(index.lineStart(line) == offset);
+            assert(index.lineAt(offset) == line);
+            assert(index.lineAt(offset + lengths[line] - 1) == line);
+            offset += lengths[line];
+        }
+        assert(index.lineStart(lengths.size()) == offset);
+        assert(index.lineAt(offset) == lengths.size() - 1);
+        assert(index.lineAt(offset + 100) == lengths.size() - 1);
+
+        std::cout << "✓ Offsets at line edges passed" << std::endl;
+    }
+
+    static void testSplice()
+    {
+        std::cout << "Testing splice of small and large ranges..." << std::endl;
+
+        std::mt19937 rng(5);
+        std::vector<uint32_t> expected(5000);
+        for (auto &length : expected)
+            length = rng() % 40 + 1;
+        LineIndex index = LineIndex::fromLengths(expected);
+
+        for (int i = 0; i < 400; ++i)
+        {
+            // Mostly small edits (updated in place), sometimes large ones
+            // (rebuilt), at any position including the end
+            bool large = i % 5 == 0;
+            size_t first = rng() % (expected.size() + 1);
+            size_t removed = std::min<size_t>(rng() % (large ? 600 : 4), expected.size() - first);
+            std::vector<uint32_t> inserted(rng() % (large ? 600 : 4));
+            for (auto &length : inserted)
+                length = rng() % 40 + 1;
+
+            expected.erase(expected.begin() + first, expected.begin() + first + removed);
+            expected.insert(expected.begin() + first, inserted.begin(), inserted.end());
+            index = index.splice(first, removed, inserted);
+            if (i % 20 == 0)
+                assertSame(index, expected);
+        }
+        assertSame(index, expected);
+
+        // Replacing everything, and removing everything
+        std::vector<uint32_t> one{3};
+        assertSame(index.splice(0, expected.size(), one), one);
+        assert(index.splice(0, expected.size(), {}).lines() == 0);
+
+        std::cout << "✓ Splice passed" << std::endl;
+    }
+
+private:
+    static void assertSame(const LineIndex &index, const std::vector<uint32_t> &expected)
+    {
+        assert(index.lines() == expected.size());
+        size_t offset = 0;
+        for (size_t line = 0; line < expected.size(); ++line)
+        {
+            assert(index.length(line) == expected[line]);
+            assert(index.lineStart(line) == offset);
+            offset += expected[line];
+        }
+        assert(index.bytes() == offset);
+
+        std::vector<uint32_t> lengths;
+        index.forEach([&](uint32_t length)
+                      { lengths.push_back(length); });
+        assert(lengths == expected);
+    }
+};
+
+int main()
+{
+    try
+    {
+        std::cout << "=== LineIndex Tests ===" << std::endl
+                  << std::endl;
+
+        LineIndexTest::testInsertEraseAcrossNodes();
+        LineIndexTest::testOffsetsAtLineEdges();
+        LineIndexTest::testSplice();
+
+        std::cout << "\n=== All Tests Passed ===" << std::endl;
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
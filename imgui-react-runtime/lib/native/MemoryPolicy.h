@@ -0,0 +1,173 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <immer/heap/cpp_heap.hpp>
+#include <immer/heap/heap_policy.hpp>
+#include <immer/lock/no_lock_policy.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/refcount/unsafe_refcount_policy.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace cljs
+{
+
+    namespace detail
+    {
+        // Bytes of collection nodes and value cells taken from and returned
+        // to the system heap (see NativeMemory.h)
+        struct ByteCounter
+        {
+#if CLJS_NATIVE_SINGLE_THREADED
+            size_t allocated = 0;
+            size_t freed = 0;
+
+            void allocate(size_t n) { allocated += n; }
+            void free(size_t n) { freed += n; }
+            size_t live() const { return allocated - freed; }
+            size_t total() const { return allocated; }
+#else
+            std::atomic<size_t> allocated{0};
+            std::atomic<size_t> freed{0};
+
+            void allocate(size_t n) { allocated.fetch_add(n, std::memory_order_relaxed); }
+            void free(size_t n) { freed.fetch_add(n, std::memory_order_relaxed); }
+            size_t live() const
+            {
+                return allocated.load(std::memory_order_relaxed) - freed.load(std::memory_order_relaxed);
+            }
+            size_t total() const { return allocated.load(std::memory_order_relaxed); }
+#endif
+        };
+
+        inline ByteCounter &nativeBytes()
+        {
+            static ByteCounter counter;
+            return counter;
+        }
+
+        // immer::cpp_heap that counts what it hands out. Free lists sit on
+        // top of it, so cached free nodes still count as live.
+        struct CountingHeap
+        {
+            template <typename... Tags>
+            static void *allocate(std::size_t size, Tags...)
+            {
+                void *data = ::operator new(size);
+                nativeBytes().allocate(size);
+                return data;
+            }
+
+            static void deallocate(std::size_t size, void *data)
+            {
+                nativeBytes().free(size);
+                ::operator delete(data);
+            }
+        };
+
+        // Standard allocator over CountingHeap, for native trees built from
+        // std::vector and shared_ptr nodes rather than immer nodes
+        template <typename T>
+        struct CountingAllocator
+        {
+            using value_type = T;
+
+            CountingAllocator() = default;
+            template <typename U>
+            CountingAllocator(const CountingAllocator<U> &) noexcept {}
+
+            T *allocate(std::size_t n)
+            {
+                return static_cast<T *>(CountingHeap::allocate(n * sizeof(T)));
+            }
+            void deallocate(T *p, std::size_t n) noexcept
+            {
+                CountingHeap::deallocate(n * sizeof(T), p);
+            }
+
+            template <typename U>
+            bool operator==(const CountingAllocator<U> &) const noexcept { return true; }
+            template <typename U>
+            bool operator!=(const CountingAllocator<U> &) const noexcept { return false; }
+        };
+
+        template <typename T>
+        using CountedVector = std::vector<T, CountingAllocator<T>>;
+    } // namespace detail
+
+    /**
+     * Memory policy shared by every native collection.
+     *
+     * All collection access happens on the Hermes thread, so builds
+     * configured with NATIVE_CLJS_SINGLE_THREADED=ON (which defines
+     * CLJS_NATIVE_SINGLE_THREADED) use non-atomic node refcounts, no
+     * locking and a single unsynchronised free list per node size. The same
+     * switch makes StoredValue's string/object cell refcounts non-atomic.
+     *
+     * Collections from such a build must never be touched from another
+     * thread, including copies handed to worker threads.
+     *
+     * Nodes come from detail::CountingHeap, so the bytes behind native
+     * collections can be reported to the GC (see NativeMemory.h).
+     */
+#if CLJS_NATIVE_SINGLE_THREADED
+    using NativeMemoryPolicy =
+        immer::memory_policy<immer::unsafe_free_list_heap_policy<detail::CountingHeap>,
+                             immer::unsafe_refcount_policy,
+                             immer::no_lock_policy>;
+#else
+    using NativeMemoryPolicy =
+        immer::memory_policy<immer::free_list_heap_policy<detail::CountingHeap>,
+                             immer::default_refcount_policy,
+                             immer::default_lock_policy>;
+#endif
+
+    namespace detail
+    {
+        // Intrusive refcount for StoredValue cells
+        struct RefCount
+        {
+#if CLJS_NATIVE_SINGLE_THREADED
+            uint32_t count = 1;
+
+            void increment() { ++count; }
+            // Takes a reference unless the count already reached zero
+            bool tryIncrement()
+            {
+                if (count == 0)
+                    return false;
+                ++count;
+                return true;
+            }
+            // Returns true when the last reference was dropped
+            bool decrement() { return --count == 0; }
+#else
+            std::atomic<uint32_t> count{1};
+
+            void increment() { count.fetch_add(1, std::memory_order_relaxed); }
+            // Takes a reference unless the count already reached zero, i.e.
+            // the cell is being freed by another thread
+            bool tryIncrement()
+            {
+                uint32_t current = count.load(std::memory_order_relaxed);
+                while (current != 0)
+                {
+                    if (count.compare_exchange_weak(current, current + 1, std::memory_order_relaxed))
+                        return true;
+                }
+                return false;
+            }
+            // Returns true when the last reference was dropped
+            bool decrement() { return count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+#endif
+        };
+    } // namespace detail
+
+} // namespace cljs
@@ -0,0 +1,175 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cljs
+{
+
+    /**
+     * Per-runtime property table of a native collection host object type,
+     * so collections can be used directly from JavaScript (v.nth(i),
+     * m.assoc(k, x)) without going through the global factory.
+     *
+     * HostObject::get walks the table with PropNameID::compare, which
+     * Hermes answers by comparing interned symbol ids, instead of converting
+     * every name to a std::string. Each method is created once per runtime
+     * as a jsi::Function that finds its host object through `this`; getters
+     * (count, length) compute a value from the host object directly.
+     *
+     * Entries are matched in definition order, so define the hottest names
+     * first. install* functions fill the table when they create the
+     * factory; redefining a name replaces it. Mutators edit a transient in
+     * place and return `this`.
+     */
+    template <typename Host>
+    class MethodTable
+    {
+    public:
+        using Method = facebook::jsi::Value (*)(facebook::jsi::Runtime &rt, Host &self,
+                                                const facebook::jsi::Value *args,
+                                                size_t count);
+        using Mutator = void (*)(facebook::jsi::Runtime &rt, Host &self,
+                                 const facebook::jsi::Value *args, size_t count);
+        using Getter = facebook::jsi::Value (*)(facebook::jsi::Runtime &rt, Host &self);
+
+        static MethodTable &forRuntime(facebook::jsi::Runtime &rt)
+        {
+            // Intentionally leaked: the functions must not be released after
+            // the runtime is gone
+            static auto *registry =
+                new std::unordered_map<facebook::jsi::Runtime *, MethodTable>();
+            static facebook::jsi::Runtime *lastRuntime = nullptr;
+            static MethodTable *lastTable = nullptr;
+
+            if (lastRuntime != &rt)
+            {
+                lastRuntime = &rt;
+                lastTable = &(*registry)[&rt];
+            }
+            return *lastTable;
+        }
+
+        // Names the host type in receiver errors ("PersistentVector")
+        void setTypeName(std::string typeName) { typeName_ = std::move(typeName); }
+
+        void getter(facebook::jsi::Runtime &rt, const char *name, Getter getter)
+        {
+            entryFor(rt, name) = Entry{facebook::jsi::PropNameID::forAscii(rt, name), getter, nullptr};
+        }
+
+        void method(facebook::jsi::Runtime &rt, const char *name, unsigned int arity, Method method)
+        {
+            define(rt, name, arity,
+                   [method](facebook::jsi::Runtime &runtime, Host &self,
+                            const facebook::jsi::Value &,
+                            const facebook::jsi::Value *args, size_t count)
+                   { return method(runtime, self, args, count); });
+        }
+
+        // In-place edit (transients) that returns this, so calls chain
+        void mutator(facebook::jsi::Runtime &rt, const char *name, unsigned int arity, Mutator mutator)
+        {
+            define(rt, name, arity,
+                   [mutator](facebook::jsi::Runtime &runtime, Host &self,
+                             const facebook::jsi::Value &thisVal,
+                             const facebook::jsi::Value *args, size_t count)
+                   {
+                       mutator(runtime, self, args, count);
+                       return facebook::jsi::Value(runtime, thisVal);
+                   });
+        }
+
+        // HostObject::get: the getter's value, the cached method or undefined
+        facebook::jsi::Value get(facebook::jsi::Runtime &rt, Host &self,
+                                 const facebook::jsi::PropNameID &name) const
+        {
+            for (const auto &entry : entries_)
+            {
+                if (facebook::jsi::PropNameID::compare(rt, entry.name, name))
+                {
+                    if (entry.getter)
+                    {
+                        return entry.getter(rt, self);
+                    }
+                    return facebook::jsi::Value(rt, *entry.function);
+                }
+            }
+            return facebook::jsi::Value::undefined();
+        }
+
+        // HostObject::getPropertyNames
+        std::vector<facebook::jsi::PropNameID> names(facebook::jsi::Runtime &rt) const
+        {
+            std::vector<facebook::jsi::PropNameID> result;
+            result.reserve(entries_.size());
+            for (const auto &entry : entries_)
+            {
+                result.emplace_back(rt, entry.name);
+            }
+            return result;
+        }
+
+    private:
+        struct Entry
+        {
+            facebook::jsi::PropNameID name;
+            Getter getter;
+            std::unique_ptr<facebook::jsi::Function> function;
+        };
+
+        template <typename Call>
+        void define(facebook::jsi::Runtime &rt, const char *name, unsigned int arity, Call call)
+        {
+            std::string typeName = typeName_;
+            std::string methodName = name;
+            auto fn = facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, name), arity,
+                [call, typeName, methodName](facebook::jsi::Runtime &runtime,
+                                             const facebook::jsi::Value &thisVal,
+                                             const facebook::jsi::Value *args,
+                                             size_t count) -> facebook::jsi::Value
+                {
+                    if (thisVal.isObject())
+                    {
+                        auto obj = thisVal.getObject(runtime);
+                        if (obj.isHostObject<Host>(runtime))
+                        {
+                            return call(runtime, *obj.getHostObject<Host>(runtime), thisVal, args, count);
+                        }
+                    }
+                    throw facebook::jsi::JSError(
+                        runtime, methodName + " must be called on a " + typeName);
+                });
+            entryFor(rt, name) = Entry{facebook::jsi::PropNameID::forAscii(rt, name), nullptr,
+                                       std::make_unique<facebook::jsi::Function>(std::move(fn))};
+        }
+
+        Entry &entryFor(facebook::jsi::Runtime &rt, const char *name)
+        {
+            auto id = facebook::jsi::PropNameID::forAscii(rt, name);
+            for (auto &entry : entries_)
+            {
+                if (facebook::jsi::PropNameID::compare(rt, entry.name, id))
+                {
+                    return entry;
+                }
+            }
+            entries_.push_back(Entry{std::move(id), nullptr, nullptr});
+            return entries_.back();
+        }
+
+        std::vector<Entry> entries_;
+        std::string typeName_ = "native collection";
+    };
+
+} // namespace cljs
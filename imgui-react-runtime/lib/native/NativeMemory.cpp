@@ -0,0 +1,68 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "NativeMemory.h"
+#include "MemoryPolicy.h"
+#include "ObjectSlots.h"
+#include "StringTable.h"
+
+namespace cljs
+{
+
+    namespace
+    {
+        constexpr size_t kMinCharge = 16 * 1024;
+
+        // Live native bytes already charged to some host object. Only the JS
+        // thread creates host objects.
+        size_t chargedLive = 0;
+    } // namespace
+
+    facebook::jsi::Object createHostObject(facebook::jsi::Runtime &rt,
+                                           std::shared_ptr<facebook::jsi::HostObject> host)
+    {
+        // Host objects are created steadily on the JS thread, so this also
+        // clears slots released by freed collections
+        ObjectSlots::sweepRuntime(rt);
+        auto obj = facebook::jsi::Object::createFromHostObject(rt, std::move(host));
+
+        size_t live = detail::nativeBytes().live();
+        if (live < chargedLive)
+        {
+            // Memory was freed since the last charge; only charge new growth
+            chargedLive = live;
+        }
+        else if (live - chargedLive >= kMinCharge)
+        {
+            obj.setExternalMemoryPressure(rt, live - chargedLive);
+            chargedLive = live;
+        }
+        return obj;
+    }
+
+    void installMemoryFunctions(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory)
+    {
+        // memoryStats() - Native bytes behind all collections
+        factory.setProperty(
+            rt, "memoryStats",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "memoryStats"), 0,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *, size_t) -> facebook::jsi::Value
+                {
+                    const auto &bytes = detail::nativeBytes();
+                    auto &slots = ObjectSlots::forRuntime(runtime);
+                    facebook::jsi::Object stats(runtime);
+                    stats.setProperty(runtime, "liveBytes", static_cast<double>(bytes.live()));
+                    stats.setProperty(runtime, "allocatedBytes", static_cast<double>(bytes.total()));
+                    stats.setProperty(runtime, "objectSlots", static_cast<double>(slots.liveCount()));
+                    stats.setProperty(runtime, "objectSlotCapacity", static_cast<double>(slots.capacity()));
+                    stats.setProperty(runtime, "internedStrings", static_cast<double>(internedStringCount()));
+                    stats.setProperty(runtime, "stringSlots",
+                                      static_cast<double>(ObjectSlots::stringsForRuntime(runtime).liveCount()));
+                    return stats;
+                }));
+    }
+
+} // namespace cljs
@@ -0,0 +1,43 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <memory>
+
+namespace cljs
+{
+
+    /**
+     * Reports the native memory behind collection host objects to the GC.
+     *
+     * A host object is a few bytes on the JS heap, but it can hold megabytes
+     * of immer nodes. Hermes sees only the small object, so it let discarded
+     * versions pile up between collections. Every node and value cell is
+     * now counted (detail::CountingHeap in MemoryPolicy.h). Each host object
+     * is charged, as external memory pressure, with the live native bytes
+     * added since the previous charge. In practice that is the nodes its own
+     * operation allocated. Hermes drops the charge when it finalizes the
+     * object, so GC pressure follows the native footprint.
+     *
+     * Growth below kMinCharge is carried over to the next host object, which
+     * keeps small updates from paying for a JSI call each.
+     */
+
+    // createFromHostObject plus the external memory charge; used for every
+    // native collection, transient and iterator handed to JS
+    facebook::jsi::Object createHostObject(facebook::jsi::Runtime &rt,
+                                           std::shared_ptr<facebook::jsi::HostObject> host);
+
+    /**
+     * Install memoryStats() on a PersistentVector or PersistentMap factory.
+     * It returns the process-wide totals:
+     * { liveBytes, allocatedBytes, objectSlots, objectSlotCapacity,
+     *   internedStrings }
+     */
+    void installMemoryFunctions(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory);
+
+} // namespace cljs
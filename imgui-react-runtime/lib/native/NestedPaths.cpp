@@ -0,0 +1,434 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "NestedPaths.h"
+#include "NativeMemory.h"
+#include "ObjectState.h"
+#include "PersistentMap.h"
+#include "PersistentVector.h"
+
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+namespace cljs
+{
+
+    namespace
+    {
+        using facebook::jsi::Function;
+        using facebook::jsi::Object;
+        using facebook::jsi::Runtime;
+        using facebook::jsi::Value;
+
+        struct PathHandlers
+        {
+            // Indexed by WrappedKind
+            std::unique_ptr<Function> unwrap[2];
+            std::unique_ptr<Function> wrap[2];
+
+            // cljs.core/get, assoc and dissoc for non-native levels
+            std::unique_ptr<Function> get;
+            std::unique_ptr<Function> assoc;
+            std::unique_ptr<Function> dissoc;
+
+            static PathHandlers &forRuntime(Runtime &rt)
+            {
+                // Intentionally leaked: the functions must not be released
+                // after the runtime is gone
+                static auto *registry = new std::unordered_map<Runtime *, PathHandlers>();
+                static Runtime *lastRuntime = nullptr;
+                static PathHandlers *lastHandlers = nullptr;
+
+                if (lastRuntime != &rt)
+                {
+                    lastRuntime = &rt;
+                    lastHandlers = &(*registry)[&rt];
+                }
+                return *lastHandlers;
+            }
+        };
+
+        // One collection on the path: native (possibly wrapped) or not
+        struct Level
+        {
+            std::shared_ptr<PersistentMapHostObject> map;
+            std::shared_ptr<PersistentVectorHostObject> vector;
+            bool wrapped = false;
+        };
+
+        bool unwrapHost(Runtime &rt, const Object &host, Level &level)
+        {
+            if (host.isHostObject<PersistentMapHostObject>(rt))
+            {
+                level.map = host.getHostObject<PersistentMapHostObject>(rt);
+                return true;
+            }
+            if (host.isHostObject<PersistentVectorHostObject>(rt))
+            {
+                level.vector = host.getHostObject<PersistentVectorHostObject>(rt);
+                return true;
+            }
+            return false;
+        }
+
+        void cacheWrapped(Runtime &rt, const Object &wrapper, const Level &level)
+        {
+            // Wrappers that are frozen or carry other native state are
+            // unwrapped every time
+            auto state = objectState(rt, wrapper);
+            if (!state)
+            {
+                return;
+            }
+            state->unwrapped = true;
+            state->map = level.map;
+            state->vector = level.vector;
+        }
+
+        Level resolve(Runtime &rt, const Value &coll)
+        {
+            Level level;
+            if (!coll.isObject())
+            {
+                return level;
+            }
+            auto obj = coll.getObject(rt);
+            if (unwrapHost(rt, obj, level))
+            {
+                return level;
+            }
+            auto state = obj.hasNativeState<ObjectState>(rt) ? obj.getNativeState<ObjectState>(rt) : nullptr;
+            if (state && state->unwrapped)
+            {
+                level.map = state->map;
+                level.vector = state->vector;
+                level.wrapped = true;
+                return level;
+            }
+
+            auto &handlers = PathHandlers::forRuntime(rt);
+            for (const auto &unwrap : handlers.unwrap)
+            {
+                if (!unwrap)
+                {
+                    continue;
+                }
+                auto inner = unwrap->call(rt, coll);
+                if (inner.isObject() && unwrapHost(rt, inner.getObject(rt), level))
+                {
+                    level.wrapped = true;
+                    cacheWrapped(rt, obj, level);
+                    return level;
+                }
+            }
+            return level;
+        }
+
+        // Wrapped when the level it replaces was, or (for new levels) when
+        // the root was
+        Value rewrap(Runtime &rt, std::shared_ptr<facebook::jsi::HostObject> host, WrappedKind kind,
+                     const Value &old, bool wrapped)
+        {
+            Value hostValue(rt, createHostObject(rt, std::move(host)));
+            auto &wrap = PathHandlers::forRuntime(rt).wrap[static_cast<int>(kind)];
+            if (!wrapped || !wrap)
+            {
+                return hostValue;
+            }
+            auto result = wrap->call(rt, hostValue, old);
+            if (result.isObject())
+            {
+                Level level;
+                unwrapHost(rt, hostValue.getObject(rt), level);
+                cacheWrapped(rt, result.getObject(rt), level);
+            }
+            return result;
+        }
+
+        Function &fallback(Runtime &rt, std::unique_ptr<Function> &fn, const char *op)
+        {
+            if (!fn)
+            {
+                throw facebook::jsi::JSError(
+                    rt, std::string(op) + " reached a non-native collection and no path handlers are registered");
+            }
+            return *fn;
+        }
+
+        bool vectorIndex(const Value &key, size_t limit, size_t &index)
+        {
+            if (!key.isNumber())
+            {
+                return false;
+            }
+            double d = key.getNumber();
+            if (d < 0 || d != std::floor(d) || d > static_cast<double>(limit))
+            {
+                return false;
+            }
+            index = static_cast<size_t>(d);
+            return true;
+        }
+
+        // The value under key, or undefined (found = false) when absent
+        Value lookup(Runtime &rt, const Level &level, const Value &coll, const Value &key, bool &found)
+        {
+            found = false;
+            if (level.map)
+            {
+                auto value = level.map->get(rt, key);
+                found = !value.isUndefined();
+                return value;
+            }
+            if (level.vector)
+            {
+                size_t index;
+                if (vectorIndex(key, level.vector->count(), index) && index < level.vector->count())
+                {
+                    found = true;
+                    return level.vector->nth(rt, index);
+                }
+                return Value::undefined();
+            }
+            if (coll.isNull() || coll.isUndefined())
+            {
+                return Value::undefined();
+            }
+
+            Object sentinel(rt);
+            auto value = fallback(rt, PathHandlers::forRuntime(rt).get, "getIn")
+                             .call(rt, coll, key, Value(rt, sentinel));
+            if (value.isObject() && Object::strictEquals(rt, value.getObject(rt), sentinel))
+            {
+                return Value::undefined();
+            }
+            found = true;
+            return value;
+        }
+
+        Value assocLevel(Runtime &rt, const Level &level, const Value &coll, const Value &key,
+                         const Value &value, bool rootWrapped)
+        {
+            if (level.map)
+            {
+                return rewrap(rt, level.map->assoc(rt, key, value), WrappedKind::Map, coll, level.wrapped);
+            }
+            if (level.vector)
+            {
+                size_t count = level.vector->count();
+                size_t index;
+                if (!vectorIndex(key, count, index))
+                {
+                    throw facebook::jsi::JSError(rt, "assocIn: vector index out of bounds");
+                }
+                auto updated = index == count ? level.vector->conj(rt, value)
+                                              : level.vector->assoc(rt, index, value);
+                return rewrap(rt, std::move(updated), WrappedKind::Vector, coll, level.wrapped);
+            }
+            if (coll.isNull() || coll.isUndefined())
+            {
+                return rewrap(rt, PersistentMapHostObject::empty()->assoc(rt, key, value), WrappedKind::Map,
+                              Value::null(), rootWrapped);
+            }
+            return fallback(rt, PathHandlers::forRuntime(rt).assoc, "assocIn").call(rt, coll, key, value);
+        }
+
+        using LeafUpdate = std::function<Value(Runtime &, const Value &old, bool found)>;
+
+        // Rebuilds the spine from path[depth] down; leaf gives the new value
+        Value updatePath(Runtime &rt, const Value &coll, const facebook::jsi::Array &path, size_t depth,
+                         size_t length, const LeafUpdate &leaf, bool rootWrapped = false)
+        {
+            Level level = resolve(rt, coll);
+            if (depth == 0)
+            {
+                rootWrapped = level.wrapped;
+            }
+            auto key = path.getValueAtIndex(rt, depth);
+            bool found;
+            auto child = lookup(rt, level, coll, key, found);
+            auto updated = depth + 1 == length
+                               ? leaf(rt, child, found)
+                               : updatePath(rt, child, path, depth + 1, length, leaf, rootWrapped);
+            return assocLevel(rt, level, coll, key, updated, rootWrapped);
+        }
+
+        Value dissocPath(Runtime &rt, const Value &coll, const facebook::jsi::Array &path, size_t depth,
+                         size_t length, bool rootWrapped = false)
+        {
+            Level level = resolve(rt, coll);
+            if (depth == 0)
+            {
+                rootWrapped = level.wrapped;
+            }
+            auto key = path.getValueAtIndex(rt, depth);
+            if (depth + 1 == length)
+            {
+                if (level.map)
+                {
+                    if (!level.map->has(rt, key))
+                    {
+                        return Value(rt, coll);
+                    }
+                    return rewrap(rt, level.map->dissoc(rt, key), WrappedKind::Map, coll, level.wrapped);
+                }
+                if (level.vector)
+                {
+                    throw facebook::jsi::JSError(rt, "dissocIn: can't dissoc from a vector");
+                }
+                if (coll.isNull() || coll.isUndefined())
+                {
+                    return Value(rt, coll);
+                }
+                return fallback(rt, PathHandlers::forRuntime(rt).dissoc, "dissocIn").call(rt, coll, key);
+            }
+
+            bool found;
+            auto child = lookup(rt, level, coll, key, found);
+            if (!found)
+            {
+                return Value(rt, coll);
+            }
+            return assocLevel(rt, level, coll, key,
+                              dissocPath(rt, child, path, depth + 1, length, rootWrapped), rootWrapped);
+        }
+
+        facebook::jsi::Array pathArg(Runtime &rt, const Value *args, size_t count, size_t index,
+                                     const char *message)
+        {
+            if (count <= index || !args[index].isObject() || !args[index].getObject(rt).isArray(rt))
+            {
+                throw facebook::jsi::JSError(rt, message);
+            }
+            return args[index].getObject(rt).getArray(rt);
+        }
+
+        void setFunction(Runtime &rt, Object &factory, const char *name, unsigned int arity,
+                         facebook::jsi::HostFunctionType fn)
+        {
+            factory.setProperty(
+                rt, name,
+                Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, name), arity,
+                                                 std::move(fn)));
+        }
+
+        std::unique_ptr<Function> optionalFunction(Runtime &rt, const Value *args, size_t count, size_t index)
+        {
+            if (count > index && args[index].isObject() && args[index].getObject(rt).isFunction(rt))
+            {
+                return std::make_unique<Function>(args[index].getObject(rt).getFunction(rt));
+            }
+            return nullptr;
+        }
+    } // namespace
+
+    void installWrapHandlers(Runtime &rt, Object &factory, WrappedKind kind)
+    {
+        setFunction(rt, factory, "setWrapHandlers", 2,
+                    [kind](Runtime &runtime, const Value &, const Value *args, size_t count) -> Value
+                    {
+                        auto unwrap = optionalFunction(runtime, args, count, 0);
+                        auto wrap = optionalFunction(runtime, args, count, 1);
+                        if (!unwrap || !wrap)
+                        {
+                            throw facebook::jsi::JSError(runtime,
+                                                         "setWrapHandlers requires unwrap and wrap functions");
+                        }
+                        auto &handlers = PathHandlers::forRuntime(runtime);
+                        handlers.unwrap[static_cast<int>(kind)] = std::move(unwrap);
+                        handlers.wrap[static_cast<int>(kind)] = std::move(wrap);
+                        return Value::undefined();
+                    });
+    }
+
+    void installNestedPaths(Runtime &rt, Object &factory)
+    {
+        // PersistentMap.getIn(root, path, notFound?)
+        setFunction(rt, factory, "getIn", 3,
+                    [](Runtime &runtime, const Value &, const Value *args, size_t count) -> Value
+                    {
+                        auto path = pathArg(runtime, args, count, 1, "getIn requires a root and a path array");
+                        Value notFound = count > 2 ? Value(runtime, args[2]) : Value::undefined();
+                        Value coll(runtime, args[0]);
+                        size_t length = path.size(runtime);
+                        for (size_t i = 0; i < length; ++i)
+                        {
+                            bool found;
+                            Level level = resolve(runtime, coll);
+                            coll = lookup(runtime, level, coll, path.getValueAtIndex(runtime, i), found);
+                            if (!found)
+                            {
+                                return notFound;
+                            }
+                        }
+                        return coll;
+                    });
+
+        // PersistentMap.assocIn(root, path, value)
+        setFunction(rt, factory, "assocIn", 3,
+                    [](Runtime &runtime, const Value &, const Value *args, size_t count) -> Value
+                    {
+                        auto path = pathArg(runtime, args, count, 1, "assocIn requires a root, a path array and a value");
+                        size_t length = path.size(runtime);
+                        if (count < 3 || length == 0)
+                        {
+                            throw facebook::jsi::JSError(runtime, "assocIn requires a root, a non-empty path and a value");
+                        }
+                        const Value &value = args[2];
+                        return updatePath(
+                            runtime, args[0], path, 0, length,
+                            [&value](Runtime &rt, const Value &, bool)
+                            { return Value(rt, value); });
+                    });
+
+        // PersistentMap.updateIn(root, path, fn) - fn(old) gives the new value
+        setFunction(rt, factory, "updateIn", 3,
+                    [](Runtime &runtime, const Value &, const Value *args, size_t count) -> Value
+                    {
+                        auto path = pathArg(runtime, args, count, 1, "updateIn requires a root, a path array and a function");
+                        size_t length = path.size(runtime);
+                        auto fn = optionalFunction(runtime, args, count, 2);
+                        if (!fn || length == 0)
+                        {
+                            throw facebook::jsi::JSError(runtime, "updateIn requires a root, a non-empty path and a function");
+                        }
+                        return updatePath(
+                            runtime, args[0], path, 0, length,
+                            [&fn](Runtime &rt, const Value &old, bool found)
+                            { return fn->call(rt, found ? Value(rt, old) : Value::null()); });
+                    });
+
+        // PersistentMap.dissocIn(root, path)
+        setFunction(rt, factory, "dissocIn", 2,
+                    [](Runtime &runtime, const Value &, const Value *args, size_t count) -> Value
+                    {
+                        auto path = pathArg(runtime, args, count, 1, "dissocIn requires a root and a path array");
+                        size_t length = path.size(runtime);
+                        if (length == 0)
+                        {
+                            return Value(runtime, args[0]);
+                        }
+                        return dissocPath(runtime, args[0], path, 0, length);
+                    });
+
+        // PersistentMap.setPathHandlers(get, assoc, dissoc)
+        setFunction(rt, factory, "setPathHandlers", 3,
+                    [](Runtime &runtime, const Value &, const Value *args, size_t count) -> Value
+                    {
+                        auto &handlers = PathHandlers::forRuntime(runtime);
+                        handlers.get = optionalFunction(runtime, args, count, 0);
+                        handlers.assoc = optionalFunction(runtime, args, count, 1);
+                        handlers.dissoc = optionalFunction(runtime, args, count, 2);
+                        if (!handlers.get || !handlers.assoc || !handlers.dissoc)
+                        {
+                            throw facebook::jsi::JSError(runtime,
+                                                         "setPathHandlers requires get, assoc and dissoc functions");
+                        }
+                        return Value::undefined();
+                    });
+    }
+
+} // namespace cljs
@@ -0,0 +1,57 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <jsi/jsi.h>
+
+namespace cljs
+{
+
+    /**
+     * getIn, assocIn, updateIn and dissocIn over nested native maps and
+     * vectors, walked entirely in C++ so a deep update crosses JSI once.
+     * Only the spine is rebuilt; every level off the path is shared.
+     *
+     * Levels can be native host objects or ClojureScript wrappers around
+     * them. Each wrapper type registers two handlers via setWrapHandlers on
+     * its factory:
+     * - unwrap(x) returns the host object inside x, or null if x is not
+     *   that type. The answer is cached on the wrapper in its ObjectState,
+     *   so each wrapper is asked once.
+     * - wrap(host, old) returns a wrapper for a rebuilt level. old is the
+     *   wrapper it replaces (for its metadata), or nil for a level that
+     *   assocIn created.
+     * Levels that are neither (e.g. cljs.core maps) go through the get,
+     * assoc and dissoc functions registered via
+     * PersistentMap.setPathHandlers.
+     *
+     * Missing levels are created as native maps, wrapped when the root was
+     * a wrapper. Vector levels take integer indices; index == count
+     * appends, like assoc on a vector.
+     */
+
+    enum class WrappedKind
+    {
+        Map,
+        Vector
+    };
+
+    // setWrapHandlers(unwrap, wrap) on a factory
+    void installWrapHandlers(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory,
+                             WrappedKind kind);
+
+    /**
+     * Install on the PersistentMap factory:
+     * - getIn(root, path, notFound?)
+     * - assocIn(root, path, value)
+     * - updateIn(root, path, fn) - fn(old) gives the new value
+     * - dissocIn(root, path) - dissoc of the last key; returns root
+     *   unchanged when a level on the way is missing
+     * - setPathHandlers(get, assoc, dissoc) - cljs.core fallbacks for
+     *   non-native levels
+     */
+    void installNestedPaths(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory);
+
+} // namespace cljs
@@ -0,0 +1,521 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CLJS_KERNELS_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CLJS_KERNELS_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CLJS_KERNELS_NEON 1
+#endif
+
+namespace cljs
+{
+
+    /**
+     * Numeric reductions over blocks of doubles, vectorized with AVX, SSE2
+     * or AArch64 NEON depending on the target, with a scalar fallback.
+     *
+     * Every kernel takes a block source: a callable that invokes
+     * fn(const double *first, const double *last) for each block in order
+     * (a vector leaf, or a run of converted elements). Sources may be
+     * walked more than once.
+     *
+     * Only sum, mean and variance depend on evaluation order. With strict
+     * set they add left to right, bit-exact with (reduce + xs); otherwise
+     * they keep several partial sums per lane. min/max follow Math.min and
+     * Math.max (NaN wins, -0 < +0) and argmin/argmax/countWhere are exact
+     * in both modes.
+     */
+    namespace kernels
+    {
+        enum class CompareOp
+        {
+            Less,
+            LessEqual,
+            Greater,
+            GreaterEqual,
+            Equal,
+            NotEqual
+        };
+
+        inline std::optional<CompareOp> parseCompareOp(const std::string &op)
+        {
+            if (op == "<")
+                return CompareOp::Less;
+            if (op == "<=")
+                return CompareOp::LessEqual;
+            if (op == ">")
+                return CompareOp::Greater;
+            if (op == ">=")
+                return CompareOp::GreaterEqual;
+            if (op == "==")
+                return CompareOp::Equal;
+            if (op == "!=")
+                return CompareOp::NotEqual;
+            return std::nullopt;
+        }
+
+        template <CompareOp Op>
+        bool compareScalar(double a, double b)
+        {
+            switch (Op)
+            {
+            case CompareOp::Less:
+                return a < b;
+            case CompareOp::LessEqual:
+                return a <= b;
+            case CompareOp::Greater:
+                return a > b;
+            case CompareOp::GreaterEqual:
+                return a >= b;
+            case CompareOp::Equal:
+                return a == b;
+            case CompareOp::NotEqual:
+                return a != b;
+            }
+            return false;
+        }
+
+        namespace simd
+        {
+            // Lanes of doubles. min/max return the accumulator (second
+            // operand) when the element is NaN. Comparisons are false for
+            // NaN except NotEqual, as in JavaScript.
+#if CLJS_KERNELS_AVX
+            struct F64
+            {
+                using Reg = __m256d;
+                using Mask = __m256d;
+                static constexpr size_t width = 4;
+
+                static Reg load(const double *p) { return _mm256_loadu_pd(p); }
+                static Reg splat(double x) { return _mm256_set1_pd(x); }
+                static void store(double *p, Reg a) { _mm256_storeu_pd(p, a); }
+                static Reg add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+                static Reg sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+                static Reg mul(Reg a, Reg b) { return _mm256_mul_pd(a, b); }
+                static Reg min(Reg x, Reg acc) { return _mm256_min_pd(x, acc); }
+                static Reg max(Reg x, Reg acc) { return _mm256_max_pd(x, acc); }
+
+                static Mask none() { return _mm256_setzero_pd(); }
+                static Mask isNaN(Reg a) { return _mm256_cmp_pd(a, a, _CMP_UNORD_Q); }
+                static Mask orMask(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+                static bool any(Mask m) { return _mm256_movemask_pd(m) != 0; }
+                static unsigned count(Mask m)
+                {
+                    int bits = _mm256_movemask_pd(m);
+                    return static_cast<unsigned>((bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + (bits >> 3));
+                }
+
+                template <CompareOp Op>
+                static Mask compare(Reg a, Reg b)
+                {
+                    switch (Op)
+                    {
+                    case CompareOp::Less:
+                        return _mm256_cmp_pd(a, b, _CMP_LT_OQ);
+                    case CompareOp::LessEqual:
+                        return _mm256_cmp_pd(a, b, _CMP_LE_OQ);
+                    case CompareOp::Greater:
+                        return _mm256_cmp_pd(a, b, _CMP_GT_OQ);
+                    case CompareOp::GreaterEqual:
+                        return _mm256_cmp_pd(a, b, _CMP_GE_OQ);
+                    case CompareOp::Equal:
+                        return _mm256_cmp_pd(a, b, _CMP_EQ_OQ);
+                    case CompareOp::NotEqual:
+                        return _mm256_cmp_pd(a, b, _CMP_NEQ_UQ);
+                    }
+                    return none();
+                }
+            };
+#elif CLJS_KERNELS_SSE2
+            struct F64
+            {
+                using Reg = __m128d;
+                using Mask = __m128d;
+                static constexpr size_t width = 2;
+
+                static Reg load(const double *p) { return _mm_loadu_pd(p); }
+                static Reg splat(double x) { return _mm_set1_pd(x); }
+                static void store(double *p, Reg a) { _mm_storeu_pd(p, a); }
+                static Reg add(Reg a, Reg b) { return _mm_add_pd(a, b); }
+                static Reg sub(Reg a, Reg b) { return _mm_sub_pd(a, b); }
+                static Reg mul(Reg a, Reg b) { return _mm_mul_pd(a, b); }
+                static Reg min(Reg x, Reg acc) { return _mm_min_pd(x, acc); }
+                static Reg max(Reg x, Reg acc) { return _mm_max_pd(x, acc); }
+
+                static Mask none() { return _mm_setzero_pd(); }
+                static Mask isNaN(Reg a) { return _mm_cmpunord_pd(a, a); }
+                static Mask orMask(Mask a, Mask b) { return _mm_or_pd(a, b); }
+                static bool any(Mask m) { return _mm_movemask_pd(m) != 0; }
+                static unsigned count(Mask m)
+                {
+                    int bits = _mm_movemask_pd(m);
+                    return static_cast<unsigned>((bits & 1) + (bits >> 1));
+                }
+
+                template <CompareOp Op>
+                static Mask compare(Reg a, Reg b)
+                {
+                    switch (Op)
+                    {
+                    case CompareOp::Less:
+                        return _mm_cmplt_pd(a, b);
+                    case CompareOp::LessEqual:
+                        return _mm_cmple_pd(a, b);
+                    case CompareOp::Greater:
+                        return _mm_cmpgt_pd(a, b);
+                    case CompareOp::GreaterEqual:
+                        return _mm_cmpge_pd(a, b);
+                    case CompareOp::Equal:
+                        return _mm_cmpeq_pd(a, b);
+                    case CompareOp::NotEqual:
+                        return _mm_cmpneq_pd(a, b);
+                    }
+                    return none();
+                }
+            };
+#elif CLJS_KERNELS_NEON
+            struct F64
+            {
+                using Reg = float64x2_t;
+                using Mask = uint64x2_t;
+                static constexpr size_t width = 2;
+
+                static Reg load(const double *p) { return vld1q_f64(p); }
+                static Reg splat(double x) { return vdupq_n_f64(x); }
+                static void store(double *p, Reg a) { vst1q_f64(p, a); }
+                static Reg add(Reg a, Reg b) { return vaddq_f64(a, b); }
+                static Reg sub(Reg a, Reg b) { return vsubq_f64(a, b); }
+                static Reg mul(Reg a, Reg b) { return vmulq_f64(a, b); }
+                // vminnm/vmaxnm return the number when one operand is NaN
+                static Reg min(Reg x, Reg acc) { return vminnmq_f64(x, acc); }
+                static Reg max(Reg x, Reg acc) { return vmaxnmq_f64(x, acc); }
+
+                static Mask none() { return vdupq_n_u64(0); }
+                static Mask isNaN(Reg a) { return veorq_u64(vceqq_f64(a, a), vdupq_n_u64(~0ULL)); }
+                static Mask orMask(Mask a, Mask b) { return vorrq_u64(a, b); }
+                static bool any(Mask m) { return (vgetq_lane_u64(m, 0) | vgetq_lane_u64(m, 1)) != 0; }
+                static unsigned count(Mask m)
+                {
+                    return static_cast<unsigned>((vgetq_lane_u64(m, 0) & 1) + (vgetq_lane_u64(m, 1) & 1));
+                }
+
+                template <CompareOp Op>
+                static Mask compare(Reg a, Reg b)
+                {
+                    switch (Op)
+                    {
+                    case CompareOp::Less:
+                        return vcltq_f64(a, b);
+                    case CompareOp::LessEqual:
+                        return vcleq_f64(a, b);
+                    case CompareOp::Greater:
+                        return vcgtq_f64(a, b);
+                    case CompareOp::GreaterEqual:
+                        return vcgeq_f64(a, b);
+                    case CompareOp::Equal:
+                        return vceqq_f64(a, b);
+                    case CompareOp::NotEqual:
+                        return veorq_u64(vceqq_f64(a, b), vdupq_n_u64(~0ULL));
+                    }
+                    return none();
+                }
+            };
+#else
+            struct F64
+            {
+                using Reg = double;
+                using Mask = bool;
+                static constexpr size_t width = 1;
+
+                static Reg load(const double *p) { return *p; }
+                static Reg splat(double x) { return x; }
+                static void store(double *p, Reg a) { *p = a; }
+                static Reg add(Reg a, Reg b) { return a + b; }
+                static Reg sub(Reg a, Reg b) { return a - b; }
+                static Reg mul(Reg a, Reg b) { return a * b; }
+                static Reg min(Reg x, Reg acc) { return x < acc ? x : acc; }
+                static Reg max(Reg x, Reg acc) { return x > acc ? x : acc; }
+
+                static Mask none() { return false; }
+                static Mask isNaN(Reg a) { return a != a; }
+                static Mask orMask(Mask a, Mask b) { return a || b; }
+                static bool any(Mask m) { return m; }
+                static unsigned count(Mask m) { return m ? 1 : 0; }
+
+                template <CompareOp Op>
+                static Mask compare(Reg a, Reg b) { return compareScalar<Op>(a, b); }
+            };
+#endif
+        } // namespace simd
+
+        namespace detail
+        {
+            using V = simd::F64;
+
+            // Two independent accumulators per lane hide add latency
+            struct PartialSums
+            {
+                V::Reg a = V::splat(-0.0);
+                V::Reg b = V::splat(-0.0);
+                double tail = -0.0;
+
+                double total() const
+                {
+                    double lanes[V::width * 2];
+                    V::store(lanes, a);
+                    V::store(lanes + V::width, b);
+                    double sum = tail;
+                    for (double lane : lanes)
+                        sum += lane;
+                    return sum;
+                }
+            };
+
+            // Adds f(x) for each element, through f.lanes for whole registers
+            // and f.scalar for the rest, and counts the elements into n
+            template <typename Source, typename Fn>
+            double accumulate(Source &&source, bool strict, Fn &&f, size_t &n)
+            {
+                n = 0;
+                // -0.0 is the additive identity, so strict mode matches
+                // (reduce + xs), which starts from the first element
+                if (strict)
+                {
+                    double acc = -0.0;
+                    source([&](const double *first, const double *last)
+                           {
+                        n += static_cast<size_t>(last - first);
+                        for (; first != last; ++first)
+                            acc += f.scalar(*first); });
+                    return acc;
+                }
+
+                PartialSums sums;
+                source([&](const double *first, const double *last)
+                       {
+                    n += static_cast<size_t>(last - first);
+                    for (; last - first >= static_cast<ptrdiff_t>(V::width * 2); first += V::width * 2)
+                    {
+                        sums.a = V::add(sums.a, f.lanes(V::load(first)));
+                        sums.b = V::add(sums.b, f.lanes(V::load(first + V::width)));
+                    }
+                    for (; first != last; ++first)
+                        sums.tail += f.scalar(*first); });
+                return sums.total();
+            }
+
+            struct Identity
+            {
+                V::Reg lanes(V::Reg x) const { return x; }
+                double scalar(double x) const { return x; }
+            };
+
+            struct SquaredDeviation
+            {
+                double mean;
+
+                V::Reg lanes(V::Reg x) const
+                {
+                    V::Reg d = V::sub(x, V::splat(mean));
+                    return V::mul(d, d);
+                }
+                double scalar(double x) const { return (x - mean) * (x - mean); }
+            };
+
+            // Smallest (Max = false) or largest element ignoring NaN, plus
+            // whether a NaN was seen. Empty input yields +/-infinity.
+            template <bool Max, typename Source>
+            double extremum(Source &&source, bool &sawNaN)
+            {
+                constexpr double start = Max ? -std::numeric_limits<double>::infinity()
+                                             : std::numeric_limits<double>::infinity();
+                V::Reg acc = V::splat(start);
+                V::Mask nan = V::none();
+                double tail = start;
+                source([&](const double *first, const double *last)
+                       {
+                    for (; last - first >= static_cast<ptrdiff_t>(V::width); first += V::width)
+                    {
+                        V::Reg x = V::load(first);
+                        acc = Max ? V::max(x, acc) : V::min(x, acc);
+                        nan = V::orMask(nan, V::isNaN(x));
+                    }
+                    for (; first != last; ++first)
+                    {
+                        double x = *first;
+                        if (x != x)
+                            sawNaN = true;
+                        else if (Max ? x > tail : x < tail)
+                            tail = x;
+                    } });
+                sawNaN = sawNaN || V::any(nan);
+
+                double lanes[V::width];
+                V::store(lanes, acc);
+                for (double lane : lanes)
+                {
+                    if (Max ? lane > tail : lane < tail)
+                        tail = lane;
+                }
+                return tail;
+            }
+
+            template <CompareOp Op, typename Source>
+            size_t countWhere(Source &&source, double x)
+            {
+                V::Reg rhs = V::splat(x);
+                size_t n = 0;
+                source([&](const double *first, const double *last)
+                       {
+                    for (; last - first >= static_cast<ptrdiff_t>(V::width); first += V::width)
+                        n += V::count(V::compare<Op>(V::load(first), rhs));
+                    for (; first != last; ++first)
+                        n += compareScalar<Op>(*first, x); });
+                return n;
+            }
+        } // namespace detail
+
+        template <typename Source>
+        size_t count(Source &&source)
+        {
+            size_t n = 0;
+            source([&](const double *first, const double *last)
+                   { n += static_cast<size_t>(last - first); });
+            return n;
+        }
+
+        template <typename Source>
+        double sum(Source &&source, bool strict)
+        {
+            size_t n;
+            double total = detail::accumulate(source, strict, detail::Identity{}, n);
+            // The empty sum is +0, like (reduce + [])
+            return n == 0 ? 0.0 : total;
+        }
+
+        template <typename Source>
+        double mean(Source &&source, bool strict)
+        {
+            size_t n;
+            double total = detail::accumulate(source, strict, detail::Identity{}, n);
+            return n == 0 ? std::numeric_limits<double>::quiet_NaN() : total / static_cast<double>(n);
+        }
+
+        // Population variance, two-pass for accuracy
+        template <typename Source>
+        double variance(Source &&source, bool strict)
+        {
+            size_t n;
+            double m = detail::accumulate(source, strict, detail::Identity{}, n) / static_cast<double>(n);
+            if (n == 0)
+                return std::numeric_limits<double>::quiet_NaN();
+            return detail::accumulate(source, strict, detail::SquaredDeviation{m}, n) / static_cast<double>(n);
+        }
+
+        // Math.min/Math.max over the elements; nullopt when empty
+        template <bool Max, typename Source>
+        std::optional<double> minMax(Source &&source)
+        {
+            bool sawNaN = false;
+            double result = detail::extremum<Max>(source, sawNaN);
+            if (sawNaN)
+                return std::numeric_limits<double>::quiet_NaN();
+            if (std::isinf(result) && count(source) == 0)
+                return std::nullopt;
+            if (result == 0)
+            {
+                // Lanes may have kept either zero; -0 is the smaller one
+                bool wanted = false;
+                source([&](const double *first, const double *last)
+                       {
+                    for (; first != last; ++first)
+                        wanted = wanted || (*first == 0 && std::signbit(*first) != Max); });
+                return wanted ? (Max ? 0.0 : -0.0) : (Max ? -0.0 : 0.0);
+            }
+            return result;
+        }
+
+        template <typename Source>
+        std::optional<double> min(Source &&source) { return minMax<false>(source); }
+
+        template <typename Source>
+        std::optional<double> max(Source &&source) { return minMax<true>(source); }
+
+        template <typename Source>
+        size_t countWhere(Source &&source, CompareOp op, double x)
+        {
+            switch (op)
+            {
+            case CompareOp::Less:
+                return detail::countWhere<CompareOp::Less>(source, x);
+            case CompareOp::LessEqual:
+                return detail::countWhere<CompareOp::LessEqual>(source, x);
+            case CompareOp::Greater:
+                return detail::countWhere<CompareOp::Greater>(source, x);
+            case CompareOp::GreaterEqual:
+                return detail::countWhere<CompareOp::GreaterEqual>(source, x);
+            case CompareOp::Equal:
+                return detail::countWhere<CompareOp::Equal>(source, x);
+            case CompareOp::NotEqual:
+                return detail::countWhere<CompareOp::NotEqual>(source, x);
+            }
+            return 0;
+        }
+
+        // Index of the first smallest (largest) element, skipping NaN;
+        // nullopt when there is no such element
+        template <bool Max, typename Source>
+        std::optional<size_t> argMinMax(Source &&source)
+        {
+            std::optional<size_t> best;
+            double bestValue = 0;
+            size_t offset = 0;
+            source([&](const double *first, const double *last)
+                   {
+                // Vectorized extremum of the block, then the first index
+                // holding it; only strictly better blocks replace best
+                bool sawNaN = false;
+                double blockValue = detail::extremum<Max>(
+                    [&](auto &&fn)
+                    { fn(first, last); },
+                    sawNaN);
+                if (!best || (Max ? blockValue > bestValue : blockValue < bestValue))
+                {
+                    for (const double *p = first; p != last; ++p)
+                    {
+                        if (*p == blockValue)
+                        {
+                            best = offset + static_cast<size_t>(p - first);
+                            bestValue = blockValue;
+                            break;
+                        }
+                    }
+                }
+                offset += static_cast<size_t>(last - first); });
+            return best;
+        }
+
+        template <typename Source>
+        std::optional<size_t> argmin(Source &&source) { return argMinMax<false>(source); }
+
+        template <typename Source>
+        std::optional<size_t> argmax(Source &&source) { return argMinMax<true>(source); }
+    } // namespace kernels
+
+} // namespace cljs
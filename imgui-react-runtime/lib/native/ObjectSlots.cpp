@@ -0,0 +1,140 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "ObjectSlots.h"
+#include "StoredValue.h"
+
+#include <unordered_map>
+
+namespace cljs
+{
+
+    namespace
+    {
+        struct RuntimeSlots
+        {
+            ObjectSlots objects;
+            ObjectSlots strings;
+        };
+
+        RuntimeSlots &runtimeSlots(facebook::jsi::Runtime &rt)
+        {
+            // Intentionally leaked: the chunk arrays must not be released
+            // after the runtime is gone, and cells may release slots after that
+            static auto *registry =
+                new std::unordered_map<facebook::jsi::Runtime *, RuntimeSlots>();
+            static facebook::jsi::Runtime *lastRuntime = nullptr;
+            static RuntimeSlots *lastSlots = nullptr;
+
+            if (lastRuntime != &rt)
+            {
+                lastRuntime = &rt;
+                lastSlots = &(*registry)[&rt];
+            }
+            return *lastSlots;
+        }
+    } // namespace
+
+    ObjectSlots &ObjectSlots::forRuntime(facebook::jsi::Runtime &rt)
+    {
+        return runtimeSlots(rt).objects;
+    }
+
+    ObjectSlots &ObjectSlots::stringsForRuntime(facebook::jsi::Runtime &rt)
+    {
+        return runtimeSlots(rt).strings;
+    }
+
+    void ObjectSlots::sweepRuntime(facebook::jsi::Runtime &rt)
+    {
+        auto &slots = runtimeSlots(rt);
+        slots.objects.sweep(rt);
+        slots.strings.sweep(rt);
+    }
+
+    uint32_t ObjectSlots::add(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value)
+    {
+        sweep(rt);
+
+        uint32_t slot;
+        if (!free_.empty())
+        {
+            slot = free_.back();
+            free_.pop_back();
+        }
+        else
+        {
+            if (end_ == capacity())
+            {
+                chunks_.push_back(facebook::jsi::Array(rt, kChunkSize));
+            }
+            slot = end_++;
+        }
+        chunks_[slot >> kChunkBits].setValueAtIndex(rt, slot & kChunkMask, value);
+        return slot;
+    }
+
+    void ObjectSlots::release(uint32_t slot)
+    {
+#if !CLJS_NATIVE_SINGLE_THREADED
+        std::lock_guard<std::mutex> lock(releasedMutex_);
+#endif
+        released_.push_back(slot);
+        hasReleased_ = true;
+    }
+
+    void ObjectSlots::sweep(facebook::jsi::Runtime &rt)
+    {
+        if (!hasReleased_)
+        {
+            return;
+        }
+        std::vector<uint32_t> released;
+        {
+#if !CLJS_NATIVE_SINGLE_THREADED
+            std::lock_guard<std::mutex> lock(releasedMutex_);
+#endif
+            released.swap(released_);
+            hasReleased_ = false;
+        }
+        for (uint32_t slot : released)
+        {
+            chunks_[slot >> kChunkBits].setValueAtIndex(rt, slot & kChunkMask,
+                                                        facebook::jsi::Value::undefined());
+            free_.push_back(slot);
+        }
+    }
+
+    size_t ObjectSlots::liveCount() const
+    {
+#if !CLJS_NATIVE_SINGLE_THREADED
+        std::lock_guard<std::mutex> lock(releasedMutex_);
+#endif
+        return end_ - free_.size() - released_.size();
+    }
+
+    namespace detail
+    {
+        ObjectCell *newObjectCell(facebook::jsi::Runtime &rt, const facebook::jsi::Object &obj)
+        {
+            auto &slots = ObjectSlots::forRuntime(rt);
+            return new ObjectCell(&slots, slots.add(rt, obj));
+        }
+
+        facebook::jsi::Value objectCellValue(facebook::jsi::Runtime &rt, const ObjectCell *cell)
+        {
+            if (!cell->slots)
+            {
+                return facebook::jsi::Value(rt, *static_cast<const ProbeCell *>(cell)->object);
+            }
+            return cell->slots->get(rt, cell->slot);
+        }
+
+        void releaseObjectSlot(ObjectCell *cell)
+        {
+            cell->slots->release(cell->slot);
+        }
+    } // namespace detail
+
+} // namespace cljs
@@ -0,0 +1,95 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include "MemoryPolicy.h"
+
+#include <cstdint>
+#include <vector>
+
+#if !CLJS_NATIVE_SINGLE_THREADED
+#include <atomic>
+#include <mutex>
+#endif
+
+namespace cljs
+{
+
+    /**
+     * Per-runtime table holding every JS object stored in a native
+     * collection.
+     *
+     * A jsi::Object is a GC root in Hermes, so keeping one per element made
+     * every collection scan a root per object it held. Objects are stored
+     * instead in rooted JS arrays of kChunkSize slots each. An ObjectCell
+     * (see StoredValue.h) keeps only its slot index, so the number of roots
+     * grows with the number of chunks, not the number of elements.
+     *
+     * The cell's refcount decides when a slot is free. Cells can be freed
+     * during GC (host object finalizers) or off the JS thread, where JSI
+     * must not be called, so release() only queues the slot. Queued slots
+     * are cleared by sweep(), which add(), createHostObject() and
+     * pumpNativeTasks() call on the JS thread, so released objects become
+     * collectable even while free slots remain.
+     *
+     * Each runtime has a second table of the same kind for the JS strings
+     * cached on interned StringCells (see StringTable.h).
+     */
+    class ObjectSlots
+    {
+    public:
+        static ObjectSlots &forRuntime(facebook::jsi::Runtime &rt);
+        // The runtime's table of cached JS strings
+        static ObjectSlots &stringsForRuntime(facebook::jsi::Runtime &rt);
+        // Sweeps both of the runtime's tables
+        static void sweepRuntime(facebook::jsi::Runtime &rt);
+
+        // Stores value in a free slot and returns its index
+        uint32_t add(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value);
+        uint32_t add(facebook::jsi::Runtime &rt, const facebook::jsi::Object &obj)
+        {
+            return add(rt, facebook::jsi::Value(rt, obj));
+        }
+
+        facebook::jsi::Value get(facebook::jsi::Runtime &rt, uint32_t slot) const
+        {
+            return chunks_[slot >> kChunkBits].getValueAtIndex(rt, slot & kChunkMask);
+        }
+
+        // Queues slot for reuse. Safe from any thread; never calls into JSI
+        void release(uint32_t slot);
+
+        // Clears queued slots so their objects can be collected. Cheap when
+        // nothing is queued
+        void sweep(facebook::jsi::Runtime &rt);
+
+        // Slots held by live cells; queued slots are not counted
+        size_t liveCount() const;
+        // Slots allocated across all chunks
+        size_t capacity() const { return chunks_.size() << kChunkBits; }
+
+    private:
+        static constexpr uint32_t kChunkBits = 12;
+        static constexpr uint32_t kChunkSize = uint32_t(1) << kChunkBits;
+        static constexpr uint32_t kChunkMask = kChunkSize - 1;
+
+        std::vector<facebook::jsi::Array> chunks_;
+        std::vector<uint32_t> free_;
+        // Slots below end_ have been handed out at least once
+        uint32_t end_ = 0;
+
+        std::vector<uint32_t> released_;
+#if CLJS_NATIVE_SINGLE_THREADED
+        bool hasReleased_ = false;
+#else
+        // Lets sweep() skip the lock when nothing is queued
+        std::atomic<bool> hasReleased_{false};
+        mutable std::mutex releasedMutex_;
+#endif
+    };
+
+} // namespace cljs
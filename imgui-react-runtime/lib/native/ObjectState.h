@@ -0,0 +1,68 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include "StoredValue.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace cljs
+{
+
+    class PersistentMapHostObject;
+    class PersistentVectorHostObject;
+
+    /**
+     * Native data the collections cache on a JS object.
+     *
+     * A JS object has a single NativeState slot, and the collections never
+     * replace state they did not attach. KeyHandlers caches how a key object
+     * is classified and NestedPaths caches the host object inside a wrapper,
+     * so both keep their part in this one type: a wrapped map used as a map
+     * key keeps both caches instead of whichever came first.
+     */
+    struct ObjectState : facebook::jsi::NativeState
+    {
+        // Key classification, set by KeyHandlers::keyState
+        bool classified = false;
+        StoredValue::Type keyType = StoredValue::OBJECT_REF;
+        int32_t keyHash = 0;
+        StoredValue canonical;
+
+        // Host object inside a ClojureScript wrapper, set by NestedPaths
+        bool unwrapped = false;
+        std::shared_ptr<PersistentMapHostObject> map;
+        std::shared_ptr<PersistentVectorHostObject> vector;
+    };
+
+    // The ObjectState on obj, attaching an empty one if obj has no native
+    // state yet. nullptr if obj carries other native state or is frozen
+    inline std::shared_ptr<ObjectState> objectState(facebook::jsi::Runtime &rt,
+                                                    const facebook::jsi::Object &obj)
+    {
+        if (obj.hasNativeState<ObjectState>(rt))
+        {
+            return obj.getNativeState<ObjectState>(rt);
+        }
+        if (obj.hasNativeState(rt))
+        {
+            return nullptr;
+        }
+        auto state = std::make_shared<ObjectState>();
+        try
+        {
+            obj.setNativeState(rt, state);
+        }
+        catch (const facebook::jsi::JSIException &)
+        {
+            return nullptr;
+        }
+        return state;
+    }
+
+} // namespace cljs
@@ -0,0 +1,493 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "MemoryPolicy.h"
+
+namespace cljs
+{
+
+    /**
+     * Persistent B+ tree with path copying.
+     *
+     * Entries live in leaves of up to kMaxWidth keys; internal nodes hold up
+     * to kMaxWidth children plus one separator per child after the first
+     * (the smallest key reachable through that child). Every node except
+     * the root is at least half full, so lookups, inserts and erases touch
+     * O(log n) nodes of 32 contiguous slots each.
+     *
+     * The ordering is passed to each operation instead of being stored in
+     * the tree, so it may close over a JS runtime and comparator. Less must
+     * be a strict weak ordering; two keys are the same entry when neither is
+     * less than the other.
+     */
+    template <typename K, typename V>
+    class PersistentBTree
+    {
+    public:
+        static constexpr size_t kMaxWidth = 32;
+        static constexpr size_t kMinWidth = kMaxWidth / 2;
+
+        struct Node
+        {
+            detail::CountedVector<K> keys;
+            detail::CountedVector<V> values;                             // leaves only
+            detail::CountedVector<std::shared_ptr<const Node>> children; // internal only
+            size_t count = 0;                                            // entries in subtree
+
+            bool isLeaf() const { return children.empty(); }
+            size_t width() const { return isLeaf() ? keys.size() : children.size(); }
+        };
+        using NodePtr = std::shared_ptr<const Node>;
+
+        // Nodes and their arrays come from the counted heap, so trees are
+        // reported to the GC like immer collections (see NativeMemory.h)
+        template <typename... Args>
+        static std::shared_ptr<Node> newNode(Args &&...args)
+        {
+            return std::allocate_shared<Node>(detail::CountingAllocator<Node>(),
+                                              std::forward<Args>(args)...);
+        }
+
+        /**
+         * Position of one entry. Holds raw node pointers, so the tree it was
+         * created from must outlive it.
+         */
+        class Cursor
+        {
+        public:
+            bool valid() const { return !path_.empty(); }
+            const K &key() const { return path_.back().first->keys[path_.back().second]; }
+            const V &value() const { return path_.back().first->values[path_.back().second]; }
+
+            void next()
+            {
+                auto &leaf = path_.back();
+                if (++leaf.second < leaf.first->keys.size())
+                    return;
+                path_.pop_back();
+                while (!path_.empty())
+                {
+                    auto &frame = path_.back();
+                    if (++frame.second < frame.first->children.size())
+                    {
+                        descendFirst(frame.first->children[frame.second].get());
+                        return;
+                    }
+                    path_.pop_back();
+                }
+            }
+
+            void prev()
+            {
+                auto &leaf = path_.back();
+                if (leaf.second > 0)
+                {
+                    --leaf.second;
+                    return;
+                }
+                path_.pop_back();
+                while (!path_.empty())
+                {
+                    auto &frame = path_.back();
+                    if (frame.second > 0)
+                    {
+                        --frame.second;
+                        descendLast(frame.first->children[frame.second].get());
+                        return;
+                    }
+                    path_.pop_back();
+                }
+            }
+
+        private:
+            friend class PersistentBTree;
+
+            void descendFirst(const Node *node)
+            {
+                for (;;)
+                {
+                    path_.emplace_back(node, 0);
+                    if (node->isLeaf())
+                        return;
+                    node = node->children.front().get();
+                }
+            }
+
+            void descendLast(const Node *node)
+            {
+                for (;;)
+                {
+                    path_.emplace_back(node, node->width() - 1);
+                    if (node->isLeaf())
+                        return;
+                    node = node->children.back().get();
+                }
+            }
+
+            std::vector<std::pair<const Node *, size_t>> path_;
+        };
+
+        PersistentBTree() = default;
+
+        size_t size() const { return root_ ? root_->count : 0; }
+        bool empty() const { return !root_; }
+
+        // Builds a tree from keys that are already sorted and unique
+        static PersistentBTree fromSorted(std::vector<K> keys, std::vector<V> values)
+        {
+            size_t n = keys.size();
+            if (n == 0)
+                return PersistentBTree();
+
+            // Spread entries evenly so every node is at least half full
+            std::vector<std::shared_ptr<Node>> level;
+            std::vector<K> firstKeys;
+            size_t groups = (n + kMaxWidth - 1) / kMaxWidth;
+            for (size_t g = 0, pos = 0; g < groups; ++g)
+            {
+                size_t end = n * (g + 1) / groups;
+                auto leaf = newNode();
+                leaf->keys.assign(std::make_move_iterator(keys.begin() + pos),
+                                  std::make_move_iterator(keys.begin() + end));
+                leaf->values.assign(std::make_move_iterator(values.begin() + pos),
+                                    std::make_move_iterator(values.begin() + end));
+                leaf->count = end - pos;
+                firstKeys.push_back(leaf->keys.front());
+                level.push_back(std::move(leaf));
+                pos = end;
+            }
+
+            while (level.size() > 1)
+            {
+                std::vector<std::shared_ptr<Node>> parents;
+                std::vector<K> parentFirstKeys;
+                size_t m = level.size();
+                size_t parentGroups = (m + kMaxWidth - 1) / kMaxWidth;
+                for (size_t g = 0, pos = 0; g < parentGroups; ++g)
+                {
+                    size_t end = m * (g + 1) / parentGroups;
+                    auto node = newNode();
+                    for (size_t i = pos; i < end; ++i)
+                    {
+                        if (i > pos)
+                            node->keys.push_back(std::move(firstKeys[i]));
+                        node->count += level[i]->count;
+                        node->children.push_back(std::move(level[i]));
+                    }
+                    parentFirstKeys.push_back(std::move(firstKeys[pos]));
+                    parents.push_back(std::move(node));
+                    pos = end;
+                }
+                level = std::move(parents);
+                firstKeys = std::move(parentFirstKeys);
+            }
+            return PersistentBTree(std::move(level.front()));
+        }
+
+        template <typename Less>
+        const V *find(const K &key, const Less &less) const
+        {
+            const Node *node = root_.get();
+            if (!node)
+                return nullptr;
+            while (!node->isLeaf())
+                node = node->children[childIndex(*node, key, less)].get();
+            auto it = std::lower_bound(node->keys.begin(), node->keys.end(), key, less);
+            if (it == node->keys.end() || less(key, *it))
+                return nullptr;
+            return &node->values[it - node->keys.begin()];
+        }
+
+        // Adds or replaces an entry; an existing equal key is kept
+        template <typename Less>
+        PersistentBTree insert(K key, V value, const Less &less) const
+        {
+            if (!root_)
+            {
+                auto leaf = newNode();
+                leaf->keys.push_back(std::move(key));
+                leaf->values.push_back(std::move(value));
+                leaf->count = 1;
+                return PersistentBTree(std::move(leaf));
+            }
+
+            auto result = insertInto(*root_, key, value, less);
+            if (!result.right)
+                return PersistentBTree(std::move(result.left));
+
+            auto newRoot = newNode();
+            newRoot->keys.push_back(std::move(result.separator));
+            newRoot->count = result.left->count + result.right->count;
+            newRoot->children.push_back(std::move(result.left));
+            newRoot->children.push_back(std::move(result.right));
+            return PersistentBTree(std::move(newRoot));
+        }
+
+        template <typename Less>
+        PersistentBTree erase(const K &key, const Less &less) const
+        {
+            if (!root_)
+                return *this;
+            auto newRoot = eraseFrom(*root_, key, less);
+            if (!newRoot)
+                return *this;
+            if (newRoot->count == 0)
+                return PersistentBTree();
+            if (!newRoot->isLeaf() && newRoot->children.size() == 1)
+                return PersistentBTree(newRoot->children.front());
+            return PersistentBTree(std::move(newRoot));
+        }
+
+        Cursor first() const
+        {
+            Cursor cursor;
+            if (root_)
+                cursor.descendFirst(root_.get());
+            return cursor;
+        }
+
+        Cursor last() const
+        {
+            Cursor cursor;
+            if (root_)
+                cursor.descendLast(root_.get());
+            return cursor;
+        }
+
+        // First entry >= key (inclusive) or > key (exclusive)
+        template <typename Less>
+        Cursor seekAfter(const K &key, bool inclusive, const Less &less) const
+        {
+            Cursor cursor;
+            const Node *node = root_.get();
+            if (!node)
+                return cursor;
+            while (!node->isLeaf())
+            {
+                size_t idx = childIndex(*node, key, less);
+                cursor.path_.emplace_back(node, idx);
+                node = node->children[idx].get();
+            }
+            auto it = inclusive
+                          ? std::lower_bound(node->keys.begin(), node->keys.end(), key, less)
+                          : std::upper_bound(node->keys.begin(), node->keys.end(), key, less);
+            size_t pos = it - node->keys.begin();
+            if (pos < node->keys.size())
+            {
+                cursor.path_.emplace_back(node, pos);
+            }
+            else
+            {
+                // Past this leaf: step to the first entry of the next one
+                cursor.path_.emplace_back(node, pos - 1);
+                cursor.next();
+            }
+            return cursor;
+        }
+
+        // Last entry <= key (inclusive) or < key (exclusive)
+        template <typename Less>
+        Cursor seekBefore(const K &key, bool inclusive, const Less &less) const
+        {
+            Cursor cursor = seekAfter(key, !inclusive, less);
+            if (cursor.valid())
+            {
+                cursor.prev();
+                return cursor;
+            }
+            return last();
+        }
+
+        // Calls fn(key, value) for every entry in order
+        template <typename Fn>
+        void forEach(Fn &&fn) const
+        {
+            if (root_)
+                forEachIn(*root_, fn);
+        }
+
+    private:
+        struct InsertResult
+        {
+            std::shared_ptr<Node> left;
+            std::shared_ptr<Node> right; // set when the node split
+            K separator;
+        };
+
+        explicit PersistentBTree(NodePtr root) : root_(std::move(root)) {}
+
+        template <typename Less>
+        static size_t childIndex(const Node &node, const K &key, const Less &less)
+        {
+            return std::upper_bound(node.keys.begin(), node.keys.end(), key, less) -
+                   node.keys.begin();
+        }
+
+        template <typename Less>
+        static InsertResult insertInto(const Node &node, K &key, V &value, const Less &less)
+        {
+            auto copy = newNode(node);
+            if (node.isLeaf())
+            {
+                auto it = std::lower_bound(copy->keys.begin(), copy->keys.end(), key, less);
+                size_t pos = it - copy->keys.begin();
+                if (it != copy->keys.end() && !less(key, *it))
+                {
+                    copy->values[pos] = std::move(value);
+                    return {std::move(copy), nullptr, K()};
+                }
+                copy->keys.insert(it, std::move(key));
+                copy->values.insert(copy->values.begin() + pos, std::move(value));
+                copy->count++;
+            }
+            else
+            {
+                size_t idx = childIndex(node, key, less);
+                auto child = insertInto(*node.children[idx], key, value, less);
+                size_t newCount = child.left->count + (child.right ? child.right->count : 0);
+                copy->count += newCount - node.children[idx]->count;
+                copy->children[idx] = std::move(child.left);
+                if (child.right)
+                {
+                    copy->keys.insert(copy->keys.begin() + idx, std::move(child.separator));
+                    copy->children.insert(copy->children.begin() + idx + 1, std::move(child.right));
+                }
+            }
+
+            if (copy->width() <= kMaxWidth)
+                return {std::move(copy), nullptr, K()};
+            return split(std::move(copy));
+        }
+
+        // Splits an overfull node into two halves
+        static InsertResult split(std::shared_ptr<Node> node)
+        {
+            auto right = newNode();
+            size_t half = node->width() / 2;
+            K separator;
+            if (node->isLeaf())
+            {
+                right->keys.assign(std::make_move_iterator(node->keys.begin() + half),
+                                   std::make_move_iterator(node->keys.end()));
+                right->values.assign(std::make_move_iterator(node->values.begin() + half),
+                                     std::make_move_iterator(node->values.end()));
+                node->keys.erase(node->keys.begin() + half, node->keys.end());
+                node->values.erase(node->values.begin() + half, node->values.end());
+                right->count = right->keys.size();
+                separator = right->keys.front();
+            }
+            else
+            {
+                // children[half..] move right; keys[half - 1] moves up
+                right->children.assign(std::make_move_iterator(node->children.begin() + half),
+                                       std::make_move_iterator(node->children.end()));
+                right->keys.assign(std::make_move_iterator(node->keys.begin() + half),
+                                   std::make_move_iterator(node->keys.end()));
+                separator = std::move(node->keys[half - 1]);
+                node->children.erase(node->children.begin() + half, node->children.end());
+                node->keys.erase(node->keys.begin() + (half - 1), node->keys.end());
+                for (const auto &child : right->children)
+                    right->count += child->count;
+            }
+            node->count -= right->count;
+            return {std::move(node), std::move(right), std::move(separator)};
+        }
+
+        // Returns the new node, or nullptr if key was not found
+        template <typename Less>
+        static std::shared_ptr<Node> eraseFrom(const Node &node, const K &key, const Less &less)
+        {
+            if (node.isLeaf())
+            {
+                auto it = std::lower_bound(node.keys.begin(), node.keys.end(), key, less);
+                if (it == node.keys.end() || less(key, *it))
+                    return nullptr;
+                size_t pos = it - node.keys.begin();
+                auto copy = newNode(node);
+                copy->keys.erase(copy->keys.begin() + pos);
+                copy->values.erase(copy->values.begin() + pos);
+                copy->count--;
+                return copy;
+            }
+
+            size_t idx = childIndex(node, key, less);
+            auto child = eraseFrom(*node.children[idx], key, less);
+            if (!child)
+                return nullptr;
+
+            auto copy = newNode(node);
+            copy->count--;
+            bool underflow = child->width() < kMinWidth;
+            copy->children[idx] = std::move(child);
+            if (underflow && copy->children.size() > 1)
+                rebalance(*copy, idx);
+            return copy;
+        }
+
+        // Merges children[idx] with a neighbour, or splits the pair evenly if
+        // they don't fit in one node
+        static void rebalance(Node &parent, size_t idx)
+        {
+            size_t i = idx + 1 < parent.children.size() ? idx : idx - 1;
+            const Node &left = *parent.children[i];
+            const Node &right = *parent.children[i + 1];
+
+            auto merged = newNode();
+            merged->keys = left.keys;
+            if (left.isLeaf())
+            {
+                merged->keys.insert(merged->keys.end(), right.keys.begin(), right.keys.end());
+                merged->values = left.values;
+                merged->values.insert(merged->values.end(), right.values.begin(), right.values.end());
+            }
+            else
+            {
+                merged->keys.push_back(parent.keys[i]);
+                merged->keys.insert(merged->keys.end(), right.keys.begin(), right.keys.end());
+                merged->children = left.children;
+                merged->children.insert(merged->children.end(), right.children.begin(),
+                                        right.children.end());
+            }
+            merged->count = left.count + right.count;
+
+            if (merged->width() <= kMaxWidth)
+            {
+                parent.keys.erase(parent.keys.begin() + i);
+                parent.children.erase(parent.children.begin() + i + 1);
+                parent.children[i] = std::move(merged);
+                return;
+            }
+
+            auto result = split(std::move(merged));
+            parent.keys[i] = std::move(result.separator);
+            parent.children[i] = std::move(result.left);
+            parent.children[i + 1] = std::move(result.right);
+        }
+
+        template <typename Fn>
+        static void forEachIn(const Node &node, Fn &fn)
+        {
+            if (node.isLeaf())
+            {
+                for (size_t i = 0; i < node.keys.size(); ++i)
+                    fn(node.keys[i], node.values[i]);
+                return;
+            }
+            for (const auto &child : node.children)
+                forEachIn(*child, fn);
+        }
+
+        NodePtr root_;
+    };
+
+} // namespace cljs
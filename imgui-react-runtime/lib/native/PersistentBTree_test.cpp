@@ -0,0 +1,214 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "PersistentBTree.h"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace cljs;
+
+using Tree = PersistentBTree<int, int>;
+
+/**
+ * Checks the sorted collections' B+ tree against std::map, with enough
+ * entries that inserts split and erases merge nodes on several levels.
+ */
+class PersistentBTreeTest
+{
+public:
+    static void testInsertAcrossSplits()
+    {
+        std::cout << "Testing insert across node splits..." << std::endl;
+
+        std::vector<int> keys(5000);
+        for (size_t i = 0; i < keys.size(); ++i)
+            keys[i] = static_cast<int>(i);
+        std::mt19937 rng(7);
+        std::shuffle(keys.begin(), keys.end(), rng);
+
+        Tree tree;
+        std::map<int, int> expected;
+        Tree half;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            tree = tree.insert(keys[i], keys[i] * 10, less);
+            expected[keys[i]] = keys[i] * 10;
+            if (i == keys.size() / 2)
+                half = tree;
+            if (i % 250 == 0)
+                assertSame(tree, expected);
+        }
+        assertSame(tree, expected);
+
+        // Replacing keeps the size; earlier versions are untouched
+        Tree replaced = tree.insert(42, -1, less);
+        assert(replaced.size() == tree.size());
+        assert(*replaced.find(42, less) == -1);
+        assert(*tree.find(42, less) == 420);
+        assert(half.size() == keys.size() / 2 + 1);
+
+        std::cout << "✓ Insert across splits passed" << std::endl;
+    }
+
+    static void testEraseAcrossMerges()
+    {
+        std::cout << "Testing erase across node merges..." << std::endl;
+
+        std::vector<int> keys;
+        std::vector<int> values;
+        std::map<int, int> expected;
+        for (int i = 0; i < 5000; ++i)
+        {
+            keys.push_back(i);
+            values.push_back(-i);
+            expected[i] = -i;
+        }
+        Tree full = Tree::fromSorted(keys, values);
+        assertSame(full, expected);
+
+        std::mt19937 rng(11);
+        std::shuffle(keys.begin(), keys.end(), rng);
+        Tree tree = full;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            tree = tree.erase(keys[i], less);
+            expected.erase(keys[i]);
+            if (i % 250 == 0)
+                assertSame(tree, expected);
+        }
+        assert(tree.empty());
+        assert(!tree.first().valid());
+
+        // Erasing a missing key is a no-op
+        assert(full.erase(-5, less).size() == full.size());
+        assert(full.size() == 5000);
+        assert(*full.find(4999, less) == -4999);
+
+        std::cout << "✓ Erase across merges passed" << std::endl;
+    }
+
+    static void testSeekAtLeafEdges()
+    {
+        std::cout << "Testing seekAfter/seekBefore at leaf edges..." << std::endl;
+
+        // Even keys only, so odd probes fall between entries. Every probe
+        // is tried, which covers the first and last slot of every leaf
+        std::vector<int> keys;
+        std::vector<int> values;
+        for (int i = 0; i < 1000; ++i)
+        {
+            keys.push_back(2 * i);
+            values.push_back(i);
+        }
+        Tree bulk = Tree::fromSorted(keys, values);
+        Tree inserted;
+        for (size_t i = 0; i < keys.size(); ++i)
+            inserted = inserted.insert(keys[i], values[i], less);
+
+        for (const Tree *tree : {&bulk, &inserted})
+        {
+            for (int probe = -2; probe <= 2002; ++probe)
+            {
+                auto lower = std::lower_bound(keys.begin(), keys.end(), probe);
+                auto upper = std::upper_bound(keys.begin(), keys.end(), probe);
+
+                assertAt(tree->seekAfter(probe, true, less), keys, lower);
+                assertAt(tree->seekAfter(probe, false, less), keys, upper);
+                assertAt(tree->seekBefore(probe, true, less), keys,
+                         upper == keys.begin() ? keys.end() : upper - 1);
+                assertAt(tree->seekBefore(probe, false, less), keys,
+                         lower == keys.begin() ? keys.end() : lower - 1);
+            }
+
+            // Walking from either end crosses every leaf boundary
+            size_t n = 0;
+            for (auto cursor = tree->first(); cursor.valid(); cursor.next())
+                assert(cursor.key() == keys[n++]);
+            assert(n == keys.size());
+            for (auto cursor = tree->last(); cursor.valid(); cursor.prev())
+                assert(cursor.key() == keys[--n]);
+            assert(n == 0);
+        }
+
+        std::cout << "✓ Seek at leaf edges passed" << std::endl;
+    }
+
+    static void testCountedMemory()
+    {
+        std::cout << "Testing node memory accounting..." << std::endl;
+
+        size_t before = detail::nativeBytes().live();
+        {
+            Tree tree;
+            for (int i = 0; i < 2000; ++i)
+                tree = tree.insert(i, i, less);
+            assert(detail::nativeBytes().live() > before);
+        }
+        assert(detail::nativeBytes().live() == before);
+
+        std::cout << "✓ Node memory accounting passed" << std::endl;
+    }
+
+private:
+    static constexpr std::less<int> less{};
+
+    static void assertSame(const Tree &tree, const std::map<int, int> &expected)
+    {
+        assert(tree.size() == expected.size());
+        auto it = expected.begin();
+        for (auto cursor = tree.first(); cursor.valid(); cursor.next(), ++it)
+        {
+            assert(it != expected.end());
+            assert(cursor.key() == it->first);
+            assert(cursor.value() == it->second);
+        }
+        assert(it == expected.end());
+        for (const auto &entry : expected)
+        {
+            const int *found = tree.find(entry.first, less);
+            assert(found && *found == entry.second);
+        }
+        assert(!tree.find(-1, less));
+    }
+
+    // The cursor is at *expected, or invalid when expected is end
+    static void assertAt(const Tree::Cursor &cursor, const std::vector<int> &keys,
+                         std::vector<int>::const_iterator expected)
+    {
+        if (expected == keys.end())
+        {
+            assert(!cursor.valid());
+            return;
+        }
+        assert(cursor.valid());
+        assert(cursor.key() == *expected);
+    }
+};
+
+int main()
+{
+    try
+    {
+        std::cout << "=== PersistentBTree Tests ===" << std::endl
+                  << std::endl;
+
+        PersistentBTreeTest::testInsertAcrossSplits();
+        PersistentBTreeTest::testEraseAcrossMerges();
+        PersistentBTreeTest::testSeekAtLeafEdges();
+        PersistentBTreeTest::testCountedMemory();
+
+        std::cout << "\n=== All Tests Passed ===" << std::endl;
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
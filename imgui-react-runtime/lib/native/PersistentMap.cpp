@@ -3,10 +3,23 @@
 // See LICENSE file for full license text
 
 #include "PersistentMap.h"
+#include "CljsHash.h"
+#include "HostArgs.h"
+#include "KeyHashing.h"
+#include "MethodTable.h"
+#include "NativeMemory.h"
+#include "NestedPaths.h"
+#include "Snapshot.h"
+#include "StringTable.h"
 
+#include <immer/algorithm.hpp>
+
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 void logToConsole(facebook::jsi::Runtime &rt, const std::string &message)
 {
@@ -17,6 +30,22 @@ void logToConsole(facebook::jsi::Runtime &rt, const std::string &message)
 namespace cljs
 {
 
+    namespace
+    {
+        // Returns handlers[name] if it is a function
+        std::optional<facebook::jsi::Function>
+        diffCallback(facebook::jsi::Runtime &rt, const facebook::jsi::Object &handlers,
+                     const char *name)
+        {
+            auto prop = handlers.getProperty(rt, name);
+            if (prop.isObject() && prop.getObject(rt).isFunction(rt))
+            {
+                return prop.getObject(rt).getFunction(rt);
+            }
+            return std::nullopt;
+        }
+    } // namespace
+
     PersistentMapHostObject::PersistentMapHostObject(MapType map)
         : map_(std::move(map)) {}
 
@@ -29,29 +58,55 @@ namespace cljs
     PersistentMapHostObject::fromObject(facebook::jsi::Runtime &rt,
                                         const facebook::jsi::Object &obj)
     {
-        auto map = MapType{};
+        auto transient = MapType{}.transient();
         auto keys = obj.getPropertyNames(rt);
-        for (size_t i = 0; i < keys.size(rt); ++i)
+        size_t len = keys.size(rt);
+        for (size_t i = 0; i < len; ++i)
         {
-            auto keyStr = keys.getValueAtIndex(rt, i).asString(rt).utf8(rt);
-            auto value = obj.getProperty(rt, keyStr.c_str());
-            map = map.insert({StoredValue(keyStr), convertValue(rt, value)});
+            // Look the property up with the jsi::String we already have instead
+            // of re-creating a PropNameID from the UTF-8 copy
+            auto key = keys.getValueAtIndex(rt, i).asString(rt);
+            auto value = obj.getProperty(rt, key);
+            transient.set(internString(key.utf8(rt)), convertValue(rt, value));
         }
-        return std::make_shared<PersistentMapHostObject>(map);
+        return std::make_shared<PersistentMapHostObject>(transient.persistent());
     }
 
-    facebook::jsi::Value
-    PersistentMapHostObject::get(facebook::jsi::Runtime &rt,
-                                 const facebook::jsi::PropNameID &name)
+    std::shared_ptr<PersistentMapHostObject>
+    PersistentMapHostObject::fromEntries(facebook::jsi::Runtime &rt,
+                                         const facebook::jsi::Array &entries)
     {
-        std::string prop = name.utf8(rt);
+        KeyEquivScope scope(rt);
+        auto transient = MapType{}.transient();
+        insertEntries(rt, transient, entries);
+        return std::make_shared<PersistentMapHostObject>(transient.persistent());
+    }
 
-        if (prop == "size" || prop == "length")
+    void PersistentMapHostObject::insertEntries(facebook::jsi::Runtime &rt,
+                                                MapType::transient_type &transient,
+                                                const facebook::jsi::Array &entries)
+    {
+        size_t len = entries.size(rt);
+        for (size_t i = 0; i < len; ++i)
         {
-            return facebook::jsi::Value(static_cast<double>(size()));
+            auto entry = entries.getValueAtIndex(rt, i);
+            if (!entry.isObject() || !entry.getObject(rt).isArray(rt))
+            {
+                std::ostringstream msg;
+                msg << "Entry " << i << " is not a [key, value] array";
+                throw facebook::jsi::JSError(rt, msg.str());
+            }
+            auto pair = entry.getObject(rt).getArray(rt);
+            transient.set(convertKey(rt, pair.getValueAtIndex(rt, 0)),
+                          convertValue(rt, pair.getValueAtIndex(rt, 1)));
         }
+    }
 
-        return facebook::jsi::Value::undefined();
+    facebook::jsi::Value
+    PersistentMapHostObject::get(facebook::jsi::Runtime &rt,
+                                 const facebook::jsi::PropNameID &name)
+    {
+        return MethodTable<PersistentMapHostObject>::forRuntime(rt).get(rt, *this, name);
     }
 
     void PersistentMapHostObject::set(facebook::jsi::Runtime &rt,
@@ -63,8 +118,7 @@ namespace cljs
     std::vector<facebook::jsi::PropNameID>
     PersistentMapHostObject::getPropertyNames(facebook::jsi::Runtime &rt)
     {
-        std::vector<facebook::jsi::PropNameID> result;
-        return result;
+        return MethodTable<PersistentMapHostObject>::forRuntime(rt).names(rt);
     }
 
     size_t PersistentMapHostObject::size() const { return map_.size(); }
@@ -74,12 +128,13 @@ namespace cljs
     std::optional<StoredValue> PersistentMapHostObject::findKeyByEquivalence(
         facebook::jsi::Runtime &rt, const facebook::jsi::Value &searchKey) const
     {
-        auto searchStored = convertValue(rt, searchKey);
-
-        // First try direct lookup (works for primitives)
-        if (map_.count(searchStored) != 0)
+        // lookup() already tried the direct lookup, which finds primitives
+        // and hashed object keys. With key handlers registered, hashing
+        // already found any equivalent key; the linear scan is only for
+        // plain JS callers
+        if (KeyHandlers::forRuntime(rt).isInstalled())
         {
-            return searchStored;
+            return std::nullopt;
         }
 
         // If not found by direct equality, search by equivalence for objects
@@ -88,11 +143,11 @@ namespace cljs
             for (const auto &entry : map_)
             {
                 // Only compare object keys with object keys
-                if (entry.first.type == StoredValue::OBJECT_REF && entry.first.object_val)
+                if (entry.first.type() == StoredValue::OBJECT_REF)
                 {
                     try
                     {
-                        auto storedKeyObj = facebook::jsi::Value(rt, *entry.first.object_val);
+                        auto storedKeyObj = entry.first.objectValue(rt);
 
                         // Use ClojureScript's equiv if available
                         if (storedKeyObj.isObject())
@@ -127,21 +182,90 @@ namespace cljs
         return std::nullopt;
     }
 
+    const StoredValue *PersistentMapHostObject::lookup(facebook::jsi::Runtime &rt,
+                                                       const facebook::jsi::Value &key) const
+    {
+        if (auto found = map_.find(KeyProbe(rt, key).key()))
+        {
+            return found;
+        }
+        if (!key.isObject() || KeyHandlers::forRuntime(rt).isInstalled())
+        {
+            return nullptr;
+        }
+        if (auto equivalentKey = findKeyByEquivalence(rt, key))
+        {
+            return map_.find(*equivalentKey);
+        }
+        return nullptr;
+    }
+
     facebook::jsi::Value PersistentMapHostObject::get(facebook::jsi::Runtime &rt,
                                                       const facebook::jsi::Value &key) const
     {
-        auto storedKey = convertValue(rt, key);
-        if (map_.count(storedKey) == 0)
+        KeyEquivScope scope(rt);
+        auto found = lookup(rt, key);
+        if (!found)
         {
             return facebook::jsi::Value::undefined();
         }
-        return reconstructValue(rt, map_[storedKey]);
+        return reconstructValue(rt, *found);
     }
 
     bool PersistentMapHostObject::has(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key) const
     {
-        auto storedKey = convertValue(rt, key);
-        return map_.count(storedKey) != 0;
+        KeyEquivScope scope(rt);
+        return lookup(rt, key) != nullptr;
+    }
+
+    void PersistentMapHostObject::diff(facebook::jsi::Runtime &rt,
+                                       const PersistentMapHostObject &other,
+                                       const facebook::jsi::Object &handlers) const
+    {
+        auto added = diffCallback(rt, handlers, "added");
+        auto removed = diffCallback(rt, handlers, "removed");
+        auto changed = diffCallback(rt, handlers, "changed");
+
+        // Hashed keys compare through cljs equiv
+        KeyEquivScope scope(rt);
+        immer::diff(
+            map_, other.map_,
+            [&](const auto &entry)
+            {
+                if (added)
+                    added->call(rt, reconstructValue(rt, entry.first),
+                                reconstructValue(rt, entry.second));
+            },
+            [&](const auto &entry)
+            {
+                if (removed)
+                    removed->call(rt, reconstructValue(rt, entry.first),
+                                  reconstructValue(rt, entry.second));
+            },
+            [&](const auto &before, const auto &after)
+            {
+                if (changed)
+                    changed->call(rt, reconstructValue(rt, after.first),
+                                  reconstructValue(rt, before.second),
+                                  reconstructValue(rt, after.second));
+            });
+    }
+
+    int32_t PersistentMapHostObject::hashUnordered(facebook::jsi::Runtime &rt) const
+    {
+        if (!hash_)
+        {
+            auto &handlers = KeyHandlers::forRuntime(rt);
+            uint32_t acc = 0;
+            for (const auto &entry : map_)
+            {
+                acc = hash::unorderedStep(
+                    acc, hash::mapEntry(handlers.hashValue(rt, entry.first),
+                                        handlers.hashValue(rt, entry.second)));
+            }
+            hash_ = hash::mixCollectionHash(acc, static_cast<uint32_t>(map_.size()));
+        }
+        return *hash_;
     }
 
     bool PersistentMapHostObject::equiv(facebook::jsi::Runtime &rt,
@@ -152,37 +276,84 @@ namespace cljs
             return false;
         }
         auto otherObj = other.getObject(rt);
-        auto otherHostObj = otherObj.getHostObject<PersistentMapHostObject>(rt);
+        auto otherHostObj = hostAs<PersistentMapHostObject>(rt, otherObj);
         if (!otherHostObj)
         {
             return false;
         }
 
-        // Check sizes first
-        if (map_.size() != otherHostObj->map_.size())
+        const MapType &otherMap = otherHostObj->map_;
+        if (map_.identity() == otherMap.identity())
+        {
+            return true;
+        }
+        if (map_.size() != otherMap.size())
+        {
+            return false;
+        }
+        if (hash_ && otherHostObj->hash_ && *hash_ != *otherHostObj->hash_)
         {
             return false;
         }
 
-        // Check all entries using equivalence-based lookup
-        for (const auto &entry : map_)
+        KeyEquivScope scope(rt);
+        auto &handlers = KeyHandlers::forRuntime(rt);
+
+        // Without key handlers, object keys missing from one side may still
+        // match an equivalent key on the other; only those are paired up
+        // by equiv afterwards, instead of scanning the map for every entry
+        auto looseKey = [&](const StoredValue &key)
+        { return key.type() == StoredValue::OBJECT_REF && !handlers.isInstalled(); };
+
+        // immer::diff skips subtrees the maps share, so a map compared with
+        // an edited version of itself costs O(edits). Values are compared
+        // after the walk, but keys are matched during it: for HASHED_REF
+        // keys that calls the cljs equiv through hashedKeyEquiv, as map
+        // lookups already do, so it may run JS inside immer.
+        using Entry = MapType::value_type;
+        bool keysMatch = true;
+        std::vector<const Entry *> removed;
+        std::vector<const Entry *> added;
+        std::vector<std::pair<const StoredValue *, const StoredValue *>> changed;
+        immer::diff(
+            map_, otherMap,
+            [&](const Entry &entry)
+            {
+                if (looseKey(entry.first))
+                    added.push_back(&entry);
+                else
+                    keysMatch = false;
+            },
+            [&](const Entry &entry)
+            {
+                if (looseKey(entry.first))
+                    removed.push_back(&entry);
+                else
+                    keysMatch = false;
+            },
+            [&](const Entry &before, const Entry &after)
+            { changed.emplace_back(&before.second, &after.second); });
+
+        if (!keysMatch || removed.size() != added.size())
         {
-            // Reconstruct the key to use equivalence-based lookup
-            facebook::jsi::Value keyValue = reconstructValue(rt, entry.first);
-            if (auto otherFoundKey = otherHostObj->findKeyByEquivalence(rt, keyValue))
+            return false;
+        }
+        for (const auto &values : changed)
+        {
+            if (!handlers.valuesEqual(rt, *values.first, *values.second))
             {
-                // Key found in other map, check if values are equivalent
-                auto otherValue = otherHostObj->map_.at(*otherFoundKey);
-                if (!(entry.second == otherValue))
-                {
-                    return false;
-                }
+                return false;
             }
-            else
+        }
+        for (const Entry *entry : removed)
+        {
+            auto match = std::find_if(added.begin(), added.end(), [&](const Entry *candidate)
+                                      { return handlers.valuesEqual(rt, entry->first, candidate->first); });
+            if (match == added.end() || !handlers.valuesEqual(rt, entry->second, (*match)->second))
             {
-                // Key not found in other map
                 return false;
             }
+            added.erase(match);
         }
 
         return true;
@@ -193,15 +364,17 @@ namespace cljs
                                    const facebook::jsi::Value &key,
                                    const facebook::jsi::Value &value) const
     {
-        auto storedKey = convertValue(rt, key);
+        KeyEquivScope scope(rt);
+        auto storedKey = convertKey(rt, key);
         auto newMap = map_.insert({storedKey, convertValue(rt, value)});
         return std::make_shared<PersistentMapHostObject>(newMap);
     }
     std::shared_ptr<PersistentMapHostObject>
     PersistentMapHostObject::dissoc(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key) const
     {
-        auto storedKey = convertValue(rt, key);
-        auto newMap = map_.erase(storedKey);
+        KeyEquivScope scope(rt);
+        KeyProbe probe(rt, key);
+        auto newMap = map_.erase(probe.key());
         return std::make_shared<PersistentMapHostObject>(newMap);
     }
 
@@ -213,9 +386,10 @@ namespace cljs
         for (const auto &entry : map_)
         {
             // Only include string keys in the object
-            if (entry.first.type == StoredValue::STRING && entry.first.string_val)
+            if (entry.first.type() == StoredValue::STRING)
             {
-                result.setProperty(rt, entry.first.string_val->c_str(), reconstructValue(rt, entry.second));
+                result.setProperty(rt, stringToJS(rt, entry.first).getString(rt),
+                                   reconstructValue(rt, entry.second));
             }
         }
         return result;
@@ -257,17 +431,71 @@ namespace cljs
         return result;
     }
 
+    std::shared_ptr<PersistentMapHostObject>
+    PersistentMapHostObject::batchAssoc(facebook::jsi::Runtime &rt,
+                                        const facebook::jsi::Array &entries) const
+    {
+        KeyEquivScope scope(rt);
+        auto transient = map_.transient();
+        insertEntries(rt, transient, entries);
+        return std::make_shared<PersistentMapHostObject>(transient.persistent());
+    }
+
+    std::shared_ptr<PersistentMapHostObject>
+    PersistentMapHostObject::batchDissoc(facebook::jsi::Runtime &rt,
+                                         const facebook::jsi::Array &keys) const
+    {
+        KeyEquivScope scope(rt);
+        auto transient = map_.transient();
+        size_t len = keys.size(rt);
+        for (size_t i = 0; i < len; ++i)
+        {
+            transient.erase(KeyProbe(rt, keys.getValueAtIndex(rt, i)).key());
+        }
+        return std::make_shared<PersistentMapHostObject>(transient.persistent());
+    }
+
     facebook::jsi::Value
     PersistentMapHostObject::reduce(facebook::jsi::Runtime &rt,
                                     const facebook::jsi::Function &fn,
                                     const facebook::jsi::Value &initialValue) const
     {
+        const auto &handlers = KeyHandlers::forRuntime(rt);
         facebook::jsi::Value accumulator = fn.call(rt, initialValue);
+        if (handlers.isReduced(rt, accumulator))
+        {
+            return accumulator;
+        }
         for (const auto &entry : map_)
         {
             facebook::jsi::Value keyValue = reconstructValue(rt, entry.first);
             facebook::jsi::Value valValue = reconstructValue(rt, entry.second);
             accumulator = fn.call(rt, accumulator, valValue, keyValue);
+            if (handlers.isReduced(rt, accumulator))
+            {
+                break;
+            }
+        }
+        return accumulator;
+    }
+
+    facebook::jsi::Value
+    PersistentMapHostObject::kvReduce(facebook::jsi::Runtime &rt,
+                                      const facebook::jsi::Function &fn,
+                                      const facebook::jsi::Value &initialValue) const
+    {
+        // Straight off the HAMT: no entry arrays, and the walk stops at the
+        // first Reduced
+        const auto &handlers = KeyHandlers::forRuntime(rt);
+        facebook::jsi::Value accumulator(rt, initialValue);
+        for (const auto &entry : map_)
+        {
+            accumulator = fn.call(rt, accumulator, reconstructValue(rt, entry.first),
+                                  reconstructValue(rt, entry.second));
+            if (handlers.isReduced(rt, accumulator))
+            {
+                break;
+            }
         }
         return accumulator;
     }
@@ -289,45 +517,285 @@ namespace cljs
         }
         if (value.isString())
         {
-            return StoredValue(value.asString(rt).utf8(rt));
+            return internString(value.asString(rt).utf8(rt));
         }
         if (value.isObject())
         {
-            auto obj = std::make_shared<facebook::jsi::Object>(value.getObject(rt));
-            return StoredValue(obj);
+            return StoredValue(rt, value.getObject(rt));
         }
         return StoredValue();
     }
 
+    StoredValue PersistentMapHostObject::convertKey(facebook::jsi::Runtime &rt,
+                                                    const facebook::jsi::Value &key)
+    {
+        if (key.isObject())
+        {
+            return KeyHandlers::forRuntime(rt).convertObjectKey(rt, key.getObject(rt));
+        }
+        return convertValue(rt, key);
+    }
+
     facebook::jsi::Value PersistentMapHostObject::reconstructValue(facebook::jsi::Runtime &rt,
                                                                    const StoredValue &stored)
     {
-        switch (stored.type)
+        switch (stored.type())
         {
         case StoredValue::NIL:
             return facebook::jsi::Value::null();
         case StoredValue::BOOL:
-            return facebook::jsi::Value(stored.primitive.bool_val);
+            return facebook::jsi::Value(stored.asBool());
         case StoredValue::NUMBER:
-            return facebook::jsi::Value(stored.primitive.number_val);
+            return facebook::jsi::Value(stored.asNumber());
         case StoredValue::STRING:
-            if (stored.string_val)
+            return stringToJS(rt, stored);
+        case StoredValue::OBJECT_REF:
+        case StoredValue::INTERNED_KEY:
+        case StoredValue::HASHED_REF:
+            return stored.objectValue(rt);
+        }
+        return facebook::jsi::Value::null();
+    }
+
+    TransientMapHostObject::TransientMapHostObject(TransientType transient)
+        : transient_(std::move(transient)) {}
+
+    facebook::jsi::Value
+    TransientMapHostObject::get(facebook::jsi::Runtime &rt,
+                                const facebook::jsi::PropNameID &name)
+    {
+        return MethodTable<TransientMapHostObject>::forRuntime(rt).get(rt, *this, name);
+    }
+
+    void TransientMapHostObject::set(facebook::jsi::Runtime &rt,
+                                     const facebook::jsi::PropNameID &name,
+                                     const facebook::jsi::Value &value)
+    {
+    }
+
+    std::vector<facebook::jsi::PropNameID>
+    TransientMapHostObject::getPropertyNames(facebook::jsi::Runtime &rt)
+    {
+        return MethodTable<TransientMapHostObject>::forRuntime(rt).names(rt);
+    }
+
+    void TransientMapHostObject::ensureEditable(facebook::jsi::Runtime &rt) const
+    {
+        if (!editable_)
+        {
+            throw facebook::jsi::JSError(rt, "Transient used after persistent! call");
+        }
+    }
+
+    size_t TransientMapHostObject::size() const { return transient_.size(); }
+
+    facebook::jsi::Value TransientMapHostObject::get(facebook::jsi::Runtime &rt,
+                                                     const facebook::jsi::Value &key) const
+    {
+        ensureEditable(rt);
+        KeyEquivScope scope(rt);
+        auto found = transient_.find(KeyProbe(rt, key).key());
+        if (!found)
+        {
+            return facebook::jsi::Value::undefined();
+        }
+        return PersistentMapHostObject::reconstructValue(rt, *found);
+    }
+
+    void TransientMapHostObject::assoc(facebook::jsi::Runtime &rt,
+                                       const facebook::jsi::Value &key,
+                                       const facebook::jsi::Value &value)
+    {
+        ensureEditable(rt);
+        KeyEquivScope scope(rt);
+        transient_.set(PersistentMapHostObject::convertKey(rt, key),
+                       PersistentMapHostObject::convertValue(rt, value));
+    }
+
+    void TransientMapHostObject::dissoc(facebook::jsi::Runtime &rt,
+                                        const facebook::jsi::Value &key)
+    {
+        ensureEditable(rt);
+        KeyEquivScope scope(rt);
+        transient_.erase(KeyProbe(rt, key).key());
+    }
+
+    std::shared_ptr<PersistentMapHostObject>
+    TransientMapHostObject::persistent(facebook::jsi::Runtime &rt)
+    {
+        ensureEditable(rt);
+        editable_ = false;
+        return std::make_shared<PersistentMapHostObject>(std::move(transient_).persistent());
+    }
+
+    MapChunkIteratorHostObject::MapChunkIteratorHostObject(PersistentMapHostObject::MapType map)
+        : map_(std::move(map)), it_(map_.begin()) {}
+
+    facebook::jsi::Value
+    MapChunkIteratorHostObject::get(facebook::jsi::Runtime &rt,
+                                     const facebook::jsi::PropNameID &name)
+    {
+        return MethodTable<MapChunkIteratorHostObject>::forRuntime(rt).get(rt, *this, name);
+    }
+
+    facebook::jsi::Value MapChunkIteratorHostObject::nextChunk(facebook::jsi::Runtime &rt)
+    {
+        if (it_ == map_.end())
+        {
+            return facebook::jsi::Value::undefined();
+        }
+
+        facebook::jsi::Array chunk(rt, 2 * kChunkSize);
+        size_t i = 0;
+        for (; i < kChunkSize && it_ != map_.end(); ++i, ++it_)
+        {
+            chunk.setValueAtIndex(rt, 2 * i, PersistentMapHostObject::reconstructValue(rt, it_->first));
+            chunk.setValueAtIndex(rt, 2 * i + 1, PersistentMapHostObject::reconstructValue(rt, it_->second));
+        }
+        if (i < kChunkSize)
+        {
+            // Last chunk: trim so callers can rely on length
+            chunk.setProperty(rt, "length", static_cast<double>(2 * i));
+        }
+        return chunk;
+    }
+
+    namespace
+    {
+        using facebook::jsi::Runtime;
+        using facebook::jsi::Value;
+
+        Value wrap(Runtime &rt, std::shared_ptr<facebook::jsi::HostObject> host)
+        {
+            return createHostObject(rt, std::move(host));
+        }
+
+        // Throws unless there are at least n arguments
+        void requireArgs(Runtime &rt, size_t count, size_t n, const char *message)
+        {
+            if (count < n)
             {
-                return facebook::jsi::String::createFromUtf8(rt, *stored.string_val);
+                throw facebook::jsi::JSError(rt, message);
             }
-            return facebook::jsi::Value::null();
-        case StoredValue::OBJECT_REF:
-            if (stored.object_val)
+        }
+
+        facebook::jsi::Array arrayArg(Runtime &rt, const Value *args, size_t count,
+                                      const char *message)
+        {
+            if (count < 1 || !args[0].isObject() || !args[0].getObject(rt).isArray(rt))
             {
-                return facebook::jsi::Value(rt, *stored.object_val);
+                throw facebook::jsi::JSError(rt, message);
             }
-            return facebook::jsi::Value::null();
+            return args[0].getObject(rt).getArray(rt);
         }
-        return facebook::jsi::Value::null();
-    }
+
+        // m.get(k), m.assoc(k, v), ... - The instance-first factory
+        // operations as methods, hottest first
+        void installMapMethods(Runtime &rt)
+        {
+            auto &methods = MethodTable<PersistentMapHostObject>::forRuntime(rt);
+            methods.setTypeName("PersistentMap");
+            methods.getter(rt, "size", [](Runtime &, PersistentMapHostObject &self)
+                           { return Value(static_cast<double>(self.size())); });
+            methods.getter(rt, "length", [](Runtime &, PersistentMapHostObject &self)
+                           { return Value(static_cast<double>(self.size())); });
+            methods.method(rt, "get", 1, [](Runtime &runtime, PersistentMapHostObject &self, const Value *args, size_t count)
+                           {
+                               requireArgs(runtime, count, 1, "get requires a key");
+                               return self.get(runtime, args[0]); });
+            methods.method(rt, "has", 1, [](Runtime &runtime, PersistentMapHostObject &self, const Value *args, size_t count)
+                           {
+                               requireArgs(runtime, count, 1, "has requires a key");
+                               return Value(self.has(runtime, args[0])); });
+            methods.method(rt, "assoc", 2, [](Runtime &runtime, PersistentMapHostObject &self, const Value *args, size_t count)
+                           {
+                               requireArgs(runtime, count, 2, "assoc requires a key and value");
+                               return wrap(runtime, self.assoc(runtime, args[0], args[1])); });
+            methods.method(rt, "dissoc", 1, [](Runtime &runtime, PersistentMapHostObject &self, const Value *args, size_t count)
+                           {
+                               requireArgs(runtime, count, 1, "dissoc requires a key");
+                               return wrap(runtime, self.dissoc(runtime, args[0])); });
+            methods.method(rt, "equiv", 1, [](Runtime &runtime, PersistentMapHostObject &self, const Value *args, size_t count)
+                           {
+                               requireArgs(runtime, count, 1, "equiv requires an argument");
+                               return Value(self.equiv(runtime, args[0])); });
+            methods.method(rt, "hashUnordered", 0, [](Runtime &runtime, PersistentMapHostObject &self, const Value *, size_t)
+                           { return Value(self.hashUnordered(runtime)); });
+            methods.method(rt, "iterator", 0, [](Runtime &runtime, PersistentMapHostObject &self, const Value *, size_t)
+                           { return wrap(runtime, std::make_shared<MapChunkIteratorHostObject>(self.getMap())); });
+            methods.method(rt, "reduce", 2, [](Runtime &runtime, PersistentMapHostObject &self, const Value *args, size_t count)
+                           {
+                               if (count < 2 || !args[0].isObject())
+                               {
+                                   throw facebook::jsi::JSError(runtime, "reduce requires a function and initial value");
+                               }
+                               return self.reduce(runtime, args[0].getObject(runtime).asFunction(runtime), args[1]); });
+            methods.method(rt, "kvReduce", 2, [](Runtime &runtime, PersistentMapHostObject &self, const Value *args, size_t count)
+                           {
+                               if (count < 2 || !args[0].isObject())
+                               {
+                                   throw facebook::jsi::JSError(runtime, "kvReduce requires a function and initial value");
+                               }
+                               return self.kvReduce(runtime, args[0].getObject(runtime).asFunction(runtime), args[1]); });
+            methods.method(rt, "isEmpty", 0, [](Runtime &, PersistentMapHostObject &self, const Value *, size_t)
+                           { return Value(self.isEmpty()); });
+            methods.method(rt, "keys", 0, [](Runtime &runtime, PersistentMapHostObject &self, const Value *, size_t)
+                           { return Value(runtime, self.keys(runtime)); });
+            methods.method(rt, "values", 0, [](Runtime &runtime, PersistentMapHostObject &self, const Value *, size_t)
+                           { return Value(runtime, self.values(runtime)); });
+            methods.method(rt, "entries", 0, [](Runtime &runtime, PersistentMapHostObject &self, const Value *, size_t)
+                           { return Value(runtime, self.entries(runtime)); });
+            methods.method(rt, "toObject", 0, [](Runtime &runtime, PersistentMapHostObject &self, const Value *, size_t)
+                           { return Value(runtime, self.toObject(runtime)); });
+            methods.method(rt, "batchAssoc", 1, [](Runtime &runtime, PersistentMapHostObject &self, const Value *args, size_t count)
+                           { return wrap(runtime, self.batchAssoc(runtime, arrayArg(runtime, args, count, "batchAssoc requires an array of [key, value] pairs"))); });
+            methods.method(rt, "batchDissoc", 1, [](Runtime &runtime, PersistentMapHostObject &self, const Value *args, size_t count)
+                           { return wrap(runtime, self.batchDissoc(runtime, arrayArg(runtime, args, count, "batchDissoc requires an array of keys"))); });
+            methods.method(rt, "transient", 0, [](Runtime &runtime, PersistentMapHostObject &self, const Value *, size_t)
+                           { return wrap(runtime, std::make_shared<TransientMapHostObject>(self.getMap().transient())); });
+            methods.method(rt, "diff", 2, [](Runtime &runtime, PersistentMapHostObject &self, const Value *args, size_t count)
+                           {
+                               if (count < 2 || !args[0].isObject() || !args[1].isObject() ||
+                                   !args[0].getObject(runtime).isHostObject<PersistentMapHostObject>(runtime))
+                               {
+                                   throw facebook::jsi::JSError(runtime, "diff requires a map and a handlers object");
+                               }
+                               auto other = args[0].getObject(runtime).getHostObject<PersistentMapHostObject>(runtime);
+                               self.diff(runtime, *other, args[1].getObject(runtime));
+                               return Value::undefined(); });
+
+            auto &transientMethods = MethodTable<TransientMapHostObject>::forRuntime(rt);
+            transientMethods.setTypeName("TransientMap");
+            transientMethods.getter(rt, "size", [](Runtime &, TransientMapHostObject &self)
+                                    { return Value(static_cast<double>(self.size())); });
+            transientMethods.getter(rt, "length", [](Runtime &, TransientMapHostObject &self)
+                                    { return Value(static_cast<double>(self.size())); });
+            transientMethods.method(rt, "get", 1, [](Runtime &runtime, TransientMapHostObject &self, const Value *args, size_t count)
+                                    {
+                                        requireArgs(runtime, count, 1, "get requires a key");
+                                        return self.get(runtime, args[0]); });
+            transientMethods.mutator(rt, "assoc", 2, [](Runtime &runtime, TransientMapHostObject &self, const Value *args, size_t count)
+                                     {
+                                         requireArgs(runtime, count, 2, "assoc requires a key and value");
+                                         self.assoc(runtime, args[0], args[1]); });
+            transientMethods.mutator(rt, "dissoc", 1, [](Runtime &runtime, TransientMapHostObject &self, const Value *args, size_t count)
+                                     {
+                                         requireArgs(runtime, count, 1, "dissoc requires a key");
+                                         self.dissoc(runtime, args[0]); });
+            transientMethods.method(rt, "persistent", 0, [](Runtime &runtime, TransientMapHostObject &self, const Value *, size_t)
+                                    { return wrap(runtime, self.persistent(runtime)); });
+
+            auto &iteratorMethods = MethodTable<MapChunkIteratorHostObject>::forRuntime(rt);
+            iteratorMethods.setTypeName("PersistentMap iterator");
+            iteratorMethods.method(rt, "nextChunk", 0, [](Runtime &runtime, MapChunkIteratorHostObject &self, const Value *, size_t)
+                                   { return self.nextChunk(runtime); });
+        }
+    } // namespace
 
     void installPersistentMap(facebook::jsi::Runtime &rt)
     {
+        installMapMethods(rt);
+
         // Create the PersistentMap factory object
         facebook::jsi::Object factory(rt);
 
@@ -341,7 +809,7 @@ namespace cljs
                    size_t) -> facebook::jsi::Value
                 {
                     auto map = PersistentMapHostObject::empty();
-                    return facebook::jsi::Object::createFromHostObject(runtime, map);
+                    return createHostObject(runtime, map);
                 }));
 
         // PersistentMap.from(object) - Create a map from a JavaScript object
@@ -360,7 +828,7 @@ namespace cljs
                     }
                     facebook::jsi::Object obj = args[0].getObject(runtime);
                     auto map = PersistentMapHostObject::fromObject(runtime, obj);
-                    return facebook::jsi::Object::createFromHostObject(runtime, map);
+                    return createHostObject(runtime, map);
                 }));
 
         // PersistentMap.assoc(map, key, value)
@@ -372,7 +840,7 @@ namespace cljs
                    const facebook::jsi::Value *args,
                    size_t count) -> facebook::jsi::Value
                 {
-                    auto map = args[0].getObject(runtime).getHostObject<PersistentMapHostObject>(runtime);
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
                     if (!map)
                     {
                         throw facebook::jsi::JSError(runtime,
@@ -384,7 +852,7 @@ namespace cljs
                             runtime, "assoc requires a map, key, and value");
                     }
                     auto newMap = map->assoc(runtime, args[1], args[2]);
-                    return facebook::jsi::Object::createFromHostObject(runtime, newMap);
+                    return createHostObject(runtime, newMap);
                 }));
 
         // PersistentMap.dissoc(map, key)
@@ -396,7 +864,7 @@ namespace cljs
                    const facebook::jsi::Value *args,
                    size_t count) -> facebook::jsi::Value
                 {
-                    auto map = args[0].getObject(runtime).getHostObject<PersistentMapHostObject>(runtime);
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
                     if (!map)
                     {
                         throw facebook::jsi::JSError(runtime,
@@ -408,7 +876,7 @@ namespace cljs
                             runtime, "dissoc requires a map and key");
                     }
                     auto newMap = map->dissoc(runtime, args[1]);
-                    return facebook::jsi::Object::createFromHostObject(runtime, newMap);
+                    return createHostObject(runtime, newMap);
                 }));
 
         // PersistentMap.get(map, key)
@@ -420,7 +888,7 @@ namespace cljs
                    const facebook::jsi::Value *args,
                    size_t count) -> facebook::jsi::Value
                 {
-                    auto map = args[0].getObject(runtime).getHostObject<PersistentMapHostObject>(runtime);
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
                     if (!map)
                     {
                         throw facebook::jsi::JSError(runtime,
@@ -443,7 +911,7 @@ namespace cljs
                    const facebook::jsi::Value *args,
                    size_t count) -> facebook::jsi::Value
                 {
-                    auto map = args[0].getObject(runtime).getHostObject<PersistentMapHostObject>(runtime);
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
                     if (!map)
                     {
                         throw facebook::jsi::JSError(runtime,
@@ -471,7 +939,7 @@ namespace cljs
                         throw facebook::jsi::JSError(
                             runtime, "equiv requires two map arguments");
                     }
-                    auto map = args[0].getObject(runtime).getHostObject<PersistentMapHostObject>(runtime);
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
                     if (!map)
                     {
                         throw facebook::jsi::JSError(runtime,
@@ -481,6 +949,33 @@ namespace cljs
                     return facebook::jsi::Value(isEqual);
                 }));
 
+        // PersistentMap.diff(a, b, {added, removed, changed}) - Report what
+        // changed from a to b, skipping shared subtrees
+        factory.setProperty(
+            rt, "diff",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "diff"), 3,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 3 || !args[0].isObject() || !args[1].isObject() ||
+                        !args[2].isObject())
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "diff requires two maps and a handlers object");
+                    }
+                    auto a = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
+                    auto b = hostAs<PersistentMapHostObject>(runtime, args, count, 1);
+                    if (!a || !b)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "diff arguments must be PersistentMap instances");
+                    }
+                    a->diff(runtime, *b, args[2].getObject(runtime));
+                    return facebook::jsi::Value::undefined();
+                }));
+
         // PersistentMap.isEmpty(map)
         factory.setProperty(
             rt, "isEmpty",
@@ -490,7 +985,7 @@ namespace cljs
                    const facebook::jsi::Value *args,
                    size_t count) -> facebook::jsi::Value
                 {
-                    auto map = args[0].getObject(runtime).getHostObject<PersistentMapHostObject>(runtime);
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
                     if (!map)
                     {
                         throw facebook::jsi::JSError(runtime,
@@ -508,7 +1003,7 @@ namespace cljs
                    const facebook::jsi::Value *args,
                    size_t count) -> facebook::jsi::Value
                 {
-                    auto map = args[0].getObject(runtime).getHostObject<PersistentMapHostObject>(runtime);
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
                     if (!map)
                     {
                         throw facebook::jsi::JSError(runtime,
@@ -526,7 +1021,7 @@ namespace cljs
                    const facebook::jsi::Value *args,
                    size_t count) -> facebook::jsi::Value
                 {
-                    auto map = args[0].getObject(runtime).getHostObject<PersistentMapHostObject>(runtime);
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
                     if (!map)
                     {
                         throw facebook::jsi::JSError(runtime,
@@ -544,7 +1039,7 @@ namespace cljs
                    const facebook::jsi::Value *args,
                    size_t count) -> facebook::jsi::Value
                 {
-                    auto map = args[0].getObject(runtime).getHostObject<PersistentMapHostObject>(runtime);
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
                     if (!map)
                     {
                         throw facebook::jsi::JSError(runtime,
@@ -562,7 +1057,7 @@ namespace cljs
                    const facebook::jsi::Value *args,
                    size_t count) -> facebook::jsi::Value
                 {
-                    auto map = args[0].getObject(runtime).getHostObject<PersistentMapHostObject>(runtime);
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
                     if (!map)
                     {
                         throw facebook::jsi::JSError(runtime,
@@ -580,7 +1075,7 @@ namespace cljs
                    const facebook::jsi::Value *args,
                    size_t count) -> facebook::jsi::Value
                 {
-                    auto map = args[0].getObject(runtime).getHostObject<PersistentMapHostObject>(runtime);
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
                     if (!map)
                     {
                         throw facebook::jsi::JSError(runtime,
@@ -595,6 +1090,334 @@ namespace cljs
                     return map->reduce(runtime, fn, args[2]);
                 }));
 
+        // PersistentMap.kvReduce(map, fn, initialValue) - fn(acc, key, value)
+        factory.setProperty(
+            rt, "kvReduce",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "kvReduce"), 3,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 3 || !args[0].isObject() || !args[1].isObject())
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "kvReduce requires a map, function, and initial value");
+                    }
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
+                    if (!map)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "PersistentMap instance is invalid");
+                    }
+                    auto fn = args[1].getObject(runtime).asFunction(runtime);
+                    return map->kvReduce(runtime, fn, args[2]);
+                }));
+
+        // PersistentMap.fromEntries(array) - Create a map from [key, value] pairs
+        factory.setProperty(
+            rt, "fromEntries",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "fromEntries"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 1 || !args[0].isObject() || !args[0].getObject(runtime).isArray(runtime))
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "PersistentMap.fromEntries requires an array of [key, value] pairs");
+                    }
+                    auto entries = args[0].getObject(runtime).getArray(runtime);
+                    auto map = PersistentMapHostObject::fromEntries(runtime, entries);
+                    return createHostObject(runtime, map);
+                }));
+
+        // PersistentMap.batchAssoc(map, entries)
+        factory.setProperty(
+            rt, "batchAssoc",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "batchAssoc"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
+                    if (!map)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "PersistentMap instance is invalid");
+                    }
+                    if (count < 2 || !args[1].isObject() || !args[1].getObject(runtime).isArray(runtime))
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "batchAssoc requires a map and an array of [key, value] pairs");
+                    }
+                    auto entries = args[1].getObject(runtime).getArray(runtime);
+                    auto newMap = map->batchAssoc(runtime, entries);
+                    return createHostObject(runtime, newMap);
+                }));
+
+        // PersistentMap.batchDissoc(map, keys)
+        factory.setProperty(
+            rt, "batchDissoc",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "batchDissoc"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
+                    if (!map)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "PersistentMap instance is invalid");
+                    }
+                    if (count < 2 || !args[1].isObject() || !args[1].getObject(runtime).isArray(runtime))
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "batchDissoc requires a map and an array of keys");
+                    }
+                    auto keys = args[1].getObject(runtime).getArray(runtime);
+                    auto newMap = map->batchDissoc(runtime, keys);
+                    return createHostObject(runtime, newMap);
+                }));
+
+        // PersistentMap.transient(map) - Create an editable transient copy
+        factory.setProperty(
+            rt, "transient",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "transient"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 1 || !args[0].isObject())
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "transient requires a map argument");
+                    }
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
+                    if (!map)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "PersistentMap instance is invalid");
+                    }
+                    auto transient = std::make_shared<TransientMapHostObject>(map->getMap().transient());
+                    return createHostObject(runtime, transient);
+                }));
+
+        // PersistentMap["assoc!"](transient, key, value) - Returns the transient
+        factory.setProperty(
+            rt, "assoc!",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "assoc!"), 3,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 3 || !args[0].isObject())
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "assoc! requires a transient, key, and value");
+                    }
+                    auto transientObj = args[0].getObject(runtime);
+                    auto transient = hostAs<TransientMapHostObject>(runtime, transientObj);
+                    if (!transient)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "TransientMap instance is invalid");
+                    }
+                    transient->assoc(runtime, args[1], args[2]);
+                    return facebook::jsi::Value(runtime, transientObj);
+                }));
+
+        // PersistentMap["dissoc!"](transient, key) - Returns the transient
+        factory.setProperty(
+            rt, "dissoc!",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "dissoc!"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 2 || !args[0].isObject())
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "dissoc! requires a transient and key");
+                    }
+                    auto transientObj = args[0].getObject(runtime);
+                    auto transient = hostAs<TransientMapHostObject>(runtime, transientObj);
+                    if (!transient)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "TransientMap instance is invalid");
+                    }
+                    transient->dissoc(runtime, args[1]);
+                    return facebook::jsi::Value(runtime, transientObj);
+                }));
+
+        // PersistentMap["get!"](transient, key) - Read from a transient
+        factory.setProperty(
+            rt, "get!",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "get!"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 2 || !args[0].isObject())
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "get! requires a transient and key");
+                    }
+                    auto transient = hostAs<TransientMapHostObject>(runtime, args, count, 0);
+                    if (!transient)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "TransientMap instance is invalid");
+                    }
+                    return transient->get(runtime, args[1]);
+                }));
+
+        // PersistentMap["persistent!"](transient) - Freeze into a PersistentMap
+        factory.setProperty(
+            rt, "persistent!",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "persistent!"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 1 || !args[0].isObject())
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "persistent! requires a transient argument");
+                    }
+                    auto transient = hostAs<TransientMapHostObject>(runtime, args, count, 0);
+                    if (!transient)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "TransientMap instance is invalid");
+                    }
+                    auto map = transient->persistent(runtime);
+                    return createHostObject(runtime, map);
+                }));
+
+        // PersistentMap.iterator(map) - Create a chunked entry iterator
+        factory.setProperty(
+            rt, "iterator",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "iterator"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 1 || !args[0].isObject())
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "iterator requires a map argument");
+                    }
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
+                    if (!map)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "PersistentMap instance is invalid");
+                    }
+                    auto it = std::make_shared<MapChunkIteratorHostObject>(map->getMap());
+                    return createHostObject(runtime, it);
+                }));
+
+        // PersistentMap.nextChunk(iterator) - Next flat [k, v, ...] array, or undefined
+        factory.setProperty(
+            rt, "nextChunk",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "nextChunk"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 1 || !args[0].isObject())
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "nextChunk requires an iterator argument");
+                    }
+                    auto it = hostAs<MapChunkIteratorHostObject>(runtime, args, count, 0);
+                    if (!it)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "PersistentMap iterator is invalid");
+                    }
+                    return it->nextChunk(runtime);
+                }));
+
+        // PersistentMap.hashUnordered(map) - cljs-compatible hash, cached
+        factory.setProperty(
+            rt, "hashUnordered",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "hashUnordered"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 1 || !args[0].isObject())
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "hashUnordered requires a map argument");
+                    }
+                    auto map = hostAs<PersistentMapHostObject>(runtime, args, count, 0);
+                    if (!map)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "PersistentMap instance is invalid");
+                    }
+                    return facebook::jsi::Value(map->hashUnordered(runtime));
+                }));
+
+        // PersistentMap.setKeyHandlers(keyInfo, equiv, hash?, reducedType?) -
+        // Enable native hashing of ClojureScript keys (see KeyHashing.h)
+        factory.setProperty(
+            rt, "setKeyHandlers",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "setKeyHandlers"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 2 || !args[0].isObject() || !args[0].getObject(runtime).isFunction(runtime) ||
+                        !args[1].isObject() || !args[1].getObject(runtime).isFunction(runtime))
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "setKeyHandlers requires keyInfo and equiv functions");
+                    }
+                    KeyHandlers::forRuntime(runtime).install(
+                        runtime,
+                        args[0].getObject(runtime).getFunction(runtime),
+                        args[1].getObject(runtime).getFunction(runtime));
+                    if (count > 2 && args[2].isObject() && args[2].getObject(runtime).isFunction(runtime))
+                    {
+                        KeyHandlers::forRuntime(runtime).installHash(
+                            runtime, args[2].getObject(runtime).getFunction(runtime));
+                    }
+                    if (count > 3 && args[3].isObject() && args[3].getObject(runtime).isFunction(runtime))
+                    {
+                        KeyHandlers::forRuntime(runtime).installReducedType(
+                            runtime, args[3].getObject(runtime).getFunction(runtime));
+                    }
+                    return facebook::jsi::Value::undefined();
+                }));
+
+        // PersistentMap.save(path, map) / PersistentMap.load(path)
+        installSnapshotFunctions(rt, factory, SnapshotRoot::Map);
+
+        // PersistentMap.memoryStats() - Native bytes behind all collections
+        installMemoryFunctions(rt, factory);
+
+        // PersistentMap.getIn/assocIn/updateIn/dissocIn - Nested paths in
+        // one native call; setWrapHandlers teaches them the cljs wrapper
+        installNestedPaths(rt, factory);
+        installWrapHandlers(rt, factory, WrappedKind::Map);
+
         // Install the factory object as globalThis.PersistentMap
         rt.global()
             .setProperty(rt, "PersistentMap", factory);
@@ -8,7 +8,9 @@
 #include <jsi/jsi.h>
 
 #include <immer/map.hpp>
+#include <immer/map_transient.hpp>
 
+#include "MemoryPolicy.h"
 #include "StoredValue.h"
 
 #include <memory>
@@ -23,6 +25,9 @@ namespace cljs
      * a ClojureScript-compatible persistent map implementation.
      *
      * Supports arbitrary values as keys (like Clojure maps), not just strings.
+     * Keywords, symbols, UUIDs and other IHash values are hashed natively by
+     * their ClojureScript hash once hermes.persistent-map registers its key
+     * handlers (see KeyHashing.h).
      *
      * Operations:
      * - size() - Returns the number of key-value pairs
@@ -35,13 +40,19 @@ namespace cljs
      * - keys() - Returns an array of all keys
      * - values() - Returns an array of all values
      * - entries() - Returns an array of [key, value] pairs
+     * - batchAssoc(entries) - Batch insert [key, value] pairs (optimized)
+     * - batchDissoc(keys) - Batch remove multiple keys (optimized)
+     * - kvReduce(fn, init) - fn(acc, key, value) over all entries, stopping
+     *   at a Reduced
+     * - diff(other, handlers) - Structural diff against another version
      */
     class PersistentMapHostObject
         : public facebook::jsi::HostObject,
           public std::enable_shared_from_this<PersistentMapHostObject>
     {
     public:
-        using MapType = immer::map<StoredValue, StoredValue>;
+        using MapType = immer::map<StoredValue, StoredValue, std::hash<StoredValue>,
+                                   std::equal_to<StoredValue>, NativeMemoryPolicy>;
 
         // Constructors
         PersistentMapHostObject() = default;
@@ -51,6 +62,8 @@ namespace cljs
         static std::shared_ptr<PersistentMapHostObject> empty();
         static std::shared_ptr<PersistentMapHostObject>
         fromObject(facebook::jsi::Runtime &rt, const facebook::jsi::Object &obj);
+        static std::shared_ptr<PersistentMapHostObject>
+        fromEntries(facebook::jsi::Runtime &rt, const facebook::jsi::Array &entries);
 
         // HostObject interface
         facebook::jsi::Value get(facebook::jsi::Runtime &rt,
@@ -64,7 +77,18 @@ namespace cljs
         size_t size() const;
         facebook::jsi::Value get(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key) const;
         bool has(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key) const;
+        // O(n) at worst and O(edits) between versions of one map: shared
+        // subtrees are skipped, a shared root or differing cached hashes
+        // decide at once, and values compare with cljs =
         bool equiv(facebook::jsi::Runtime &rt, const facebook::jsi::Value &other) const;
+
+        // Reports how other differs from this map through the optional
+        // added(k, v), removed(k, v) and changed(k, old, new) functions of
+        // handlers. Subtrees shared by both versions are skipped, so the cost
+        // follows the number of changes rather than the map size.
+        void diff(facebook::jsi::Runtime &rt, const PersistentMapHostObject &other,
+                  const facebook::jsi::Object &handlers) const;
+
         std::shared_ptr<PersistentMapHostObject>
         assoc(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key,
               const facebook::jsi::Value &value) const;
@@ -75,29 +99,136 @@ namespace cljs
         facebook::jsi::Array values(facebook::jsi::Runtime &rt) const;
         facebook::jsi::Array entries(facebook::jsi::Runtime &rt) const;
 
-        // High-performance reduce for iteration-heavy operations
+        // Batch operations using transient maps for efficiency
+        std::shared_ptr<PersistentMapHostObject>
+        batchAssoc(facebook::jsi::Runtime &rt, const facebook::jsi::Array &entries) const;
+        std::shared_ptr<PersistentMapHostObject>
+        batchDissoc(facebook::jsi::Runtime &rt, const facebook::jsi::Array &keys) const;
+
+        // High-performance reduce for iteration-heavy operations. Both stop
+        // early and return the Reduced itself when fn returns one (see
+        // KeyHandlers::isReduced); callers unwrap it
         facebook::jsi::Value
         reduce(facebook::jsi::Runtime &rt, const facebook::jsi::Function &fn,
                const facebook::jsi::Value &initialValue) const;
+        // fn(acc, key, value), for IKVReduce
+        facebook::jsi::Value
+        kvReduce(facebook::jsi::Runtime &rt, const facebook::jsi::Function &fn,
+                 const facebook::jsi::Value &initialValue) const;
+
+        // cljs.core/hash-unordered-coll over map entries, cached after the
+        // first call
+        int32_t hashUnordered(facebook::jsi::Runtime &rt) const;
 
         // Access the underlying map (for testing/debugging)
         const MapType &getMap() const { return map_; }
 
     private:
+        friend class TransientMapHostObject;
+        friend class MapChunkIteratorHostObject;
+
+        // Inserts every [key, value] pair of entries into transient
+        static void insertEntries(facebook::jsi::Runtime &rt,
+                                  MapType::transient_type &transient,
+                                  const facebook::jsi::Array &entries);
+
         // Helper to convert jsi::Value to StoredValue for storage
         static StoredValue convertValue(facebook::jsi::Runtime &rt,
                                         const facebook::jsi::Value &value);
 
+        // Helper to convert a jsi::Value used as a key, hashing object keys natively
+        static StoredValue convertKey(facebook::jsi::Runtime &rt,
+                                      const facebook::jsi::Value &key);
+
         // Helper to convert StoredValue back to jsi::Value
         static facebook::jsi::Value reconstructValue(facebook::jsi::Runtime &rt,
                                                      const StoredValue &stored);
 
+        // Returns the value stored under key (or an equivalent key), or nullptr
+        const StoredValue *lookup(facebook::jsi::Runtime &rt,
+                                  const facebook::jsi::Value &key) const;
+
         // Helper to find a key using value-based equivalence (for object keys like keywords)
         // Returns the actual stored key if found, or std::nullopt if not found
         std::optional<StoredValue> findKeyByEquivalence(
             facebook::jsi::Runtime &rt, const facebook::jsi::Value &searchKey) const;
 
         MapType map_;
+        mutable std::optional<int32_t> hash_;
+    };
+
+    /**
+     * TransientMapHostObject wraps an immer::map_transient so that
+     * ClojureScript transients (assoc!, dissoc!) edit the HAMT in place.
+     *
+     * Once persistent() has been called the transient is invalidated and any
+     * further use throws, matching ClojureScript semantics.
+     *
+     * Operations:
+     * - size() - Returns the number of key-value pairs
+     * - get(key) - Returns the value for the given key
+     * - assoc(key, value) - Adds/updates the key-value pair in place
+     * - dissoc(key) - Removes the key in place
+     * - persistent() - Returns a PersistentMap and invalidates the transient
+     */
+    class TransientMapHostObject : public facebook::jsi::HostObject
+    {
+    public:
+        using TransientType = PersistentMapHostObject::MapType::transient_type;
+
+        explicit TransientMapHostObject(TransientType transient);
+
+        // HostObject interface
+        facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                                 const facebook::jsi::PropNameID &name) override;
+        void set(facebook::jsi::Runtime &rt, const facebook::jsi::PropNameID &name,
+                 const facebook::jsi::Value &value) override;
+        std::vector<facebook::jsi::PropNameID>
+        getPropertyNames(facebook::jsi::Runtime &rt) override;
+
+        // Transient operations (mutate in place)
+        size_t size() const;
+        facebook::jsi::Value get(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key) const;
+        void assoc(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key,
+                   const facebook::jsi::Value &value);
+        void dissoc(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key);
+        std::shared_ptr<PersistentMapHostObject> persistent(facebook::jsi::Runtime &rt);
+
+    private:
+        // Throws if the transient was already made persistent
+        void ensureEditable(facebook::jsi::Runtime &rt) const;
+
+        TransientType transient_;
+        bool editable_ = true;
+    };
+
+    /**
+     * MapChunkIteratorHostObject walks a map up to kChunkSize entries at a
+     * time, so ClojureScript can seq and kv-reduce without materializing
+     * every entry as a 2-element array. It holds its own (structurally
+     * shared) copy of the map.
+     *
+     * Operations:
+     * - nextChunk() - Returns the next entries as a flat [k0, v0, k1, v1, ...]
+     *   JS array, or undefined when exhausted
+     */
+    class MapChunkIteratorHostObject : public facebook::jsi::HostObject
+    {
+    public:
+        static constexpr size_t kChunkSize = 32;
+
+        explicit MapChunkIteratorHostObject(PersistentMapHostObject::MapType map);
+
+        // HostObject interface
+        facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                                 const facebook::jsi::PropNameID &name) override;
+
+        facebook::jsi::Value nextChunk(facebook::jsi::Runtime &rt);
+
+    private:
+        PersistentMapHostObject::MapType map_;
+        // Must follow map_: iterates the nodes map_ keeps alive
+        PersistentMapHostObject::MapType::iterator it_;
     };
 
     /**
@@ -106,6 +237,13 @@ namespace cljs
      *
      *   const m1 = PersistentMap.empty();
      *   const m2 = PersistentMap.from({x: 1, y: 2});
+     *   const m3 = PersistentMap.fromEntries([[1, "a"], [2, "b"]]);
+     *   const m4 = PersistentMap.batchAssoc(m3, [[3, "c"]]);
+     *
+     * or call the same operations as methods on the maps themselves:
+     *
+     *   m2.size;                           // 2
+     *   const m5 = m2.assoc("z", 3).dissoc("x");
      */
     void installPersistentMap(facebook::jsi::Runtime &rt);
 
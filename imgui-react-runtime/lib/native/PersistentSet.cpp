@@ -0,0 +1,707 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "PersistentSet.h"
+#include "CljsHash.h"
+#include "HostArgs.h"
+#include "KeyHashing.h"
+#include "MethodTable.h"
+#include "NativeMemory.h"
+#include "StringTable.h"
+
+#include <immer/algorithm.hpp>
+
+#include <sstream>
+#include <stdexcept>
+
+namespace cljs
+{
+
+    namespace
+    {
+        // Below this size ratio, visiting the smaller set beats walking both
+        // HAMTs, since unrelated sets share no subtrees for diff to skip
+        constexpr size_t kDiffSizeRatio = 4;
+
+        std::shared_ptr<PersistentSetHostObject>
+        setArg(facebook::jsi::Runtime &rt, const facebook::jsi::Value *args,
+               size_t count, size_t index, const char *fnName)
+        {
+            if (index >= count || !args[index].isObject())
+            {
+                std::ostringstream msg;
+                msg << fnName << " requires a set argument";
+                throw facebook::jsi::JSError(rt, msg.str());
+            }
+            auto set = hostAs<PersistentSetHostObject>(rt, args[index]);
+            if (!set)
+            {
+                throw facebook::jsi::JSError(rt, "PersistentSet instance is invalid");
+            }
+            return set;
+        }
+
+        facebook::jsi::Array arrayArg(facebook::jsi::Runtime &rt,
+                                      const facebook::jsi::Value *args,
+                                      size_t count, size_t index, const char *fnName)
+        {
+            if (index >= count || !args[index].isObject() ||
+                !args[index].getObject(rt).isArray(rt))
+            {
+                std::ostringstream msg;
+                msg << fnName << " requires an array argument";
+                throw facebook::jsi::JSError(rt, msg.str());
+            }
+            return args[index].getObject(rt).getArray(rt);
+        }
+    } // namespace
+
+    PersistentSetHostObject::PersistentSetHostObject(SetType set)
+        : set_(std::move(set)) {}
+
+    std::shared_ptr<PersistentSetHostObject> PersistentSetHostObject::empty()
+    {
+        return std::make_shared<PersistentSetHostObject>();
+    }
+
+    std::shared_ptr<PersistentSetHostObject>
+    PersistentSetHostObject::fromArray(facebook::jsi::Runtime &rt,
+                                       const facebook::jsi::Array &arr)
+    {
+        return PersistentSetHostObject().batchConj(rt, arr);
+    }
+
+    facebook::jsi::Value
+    PersistentSetHostObject::get(facebook::jsi::Runtime &rt,
+                                 const facebook::jsi::PropNameID &name)
+    {
+        return MethodTable<PersistentSetHostObject>::forRuntime(rt).get(rt, *this, name);
+    }
+
+    void PersistentSetHostObject::set(facebook::jsi::Runtime &rt,
+                                      const facebook::jsi::PropNameID &name,
+                                      const facebook::jsi::Value &value)
+    {
+    }
+
+    std::vector<facebook::jsi::PropNameID>
+    PersistentSetHostObject::getPropertyNames(facebook::jsi::Runtime &rt)
+    {
+        return MethodTable<PersistentSetHostObject>::forRuntime(rt).names(rt);
+    }
+
+    size_t PersistentSetHostObject::size() const { return set_.size(); }
+
+    bool PersistentSetHostObject::has(facebook::jsi::Runtime &rt,
+                                      const facebook::jsi::Value &value) const
+    {
+        KeyEquivScope scope(rt);
+        return set_.count(KeyProbe(rt, value).key()) != 0;
+    }
+
+    bool PersistentSetHostObject::equiv(facebook::jsi::Runtime &rt,
+                                        const facebook::jsi::Value &other) const
+    {
+        if (!other.isObject())
+        {
+            return false;
+        }
+        auto otherSet = hostAs<PersistentSetHostObject>(rt, other);
+        if (!otherSet)
+        {
+            return false;
+        }
+        if (set_.identity() == otherSet->set_.identity())
+        {
+            return true;
+        }
+        if (set_.size() != otherSet->set_.size())
+        {
+            return false;
+        }
+        if (hash_ && otherSet->hash_ && *hash_ != *otherSet->hash_)
+        {
+            return false;
+        }
+
+        KeyEquivScope scope(rt);
+        for (const auto &value : set_)
+        {
+            if (!otherSet->set_.count(value))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::shared_ptr<PersistentSetHostObject>
+    PersistentSetHostObject::conj(facebook::jsi::Runtime &rt,
+                                  const facebook::jsi::Value &value) const
+    {
+        KeyEquivScope scope(rt);
+        return std::make_shared<PersistentSetHostObject>(set_.insert(convertValue(rt, value)));
+    }
+
+    std::shared_ptr<PersistentSetHostObject>
+    PersistentSetHostObject::disj(facebook::jsi::Runtime &rt,
+                                  const facebook::jsi::Value &value) const
+    {
+        KeyEquivScope scope(rt);
+        return std::make_shared<PersistentSetHostObject>(set_.erase(KeyProbe(rt, value).key()));
+    }
+
+    facebook::jsi::Array PersistentSetHostObject::toArray(facebook::jsi::Runtime &rt) const
+    {
+        facebook::jsi::Array result(rt, set_.size());
+        size_t i = 0;
+        for (const auto &value : set_)
+        {
+            result.setValueAtIndex(rt, i++, reconstructValue(rt, value));
+        }
+        return result;
+    }
+
+    std::shared_ptr<PersistentSetHostObject>
+    PersistentSetHostObject::batchConj(facebook::jsi::Runtime &rt,
+                                       const facebook::jsi::Array &values) const
+    {
+        KeyEquivScope scope(rt);
+        auto transient = set_.transient();
+        size_t len = values.size(rt);
+        for (size_t i = 0; i < len; ++i)
+        {
+            transient.insert(convertValue(rt, values.getValueAtIndex(rt, i)));
+        }
+        return std::make_shared<PersistentSetHostObject>(transient.persistent());
+    }
+
+    std::shared_ptr<PersistentSetHostObject>
+    PersistentSetHostObject::batchDisj(facebook::jsi::Runtime &rt,
+                                       const facebook::jsi::Array &values) const
+    {
+        KeyEquivScope scope(rt);
+        auto transient = set_.transient();
+        size_t len = values.size(rt);
+        for (size_t i = 0; i < len; ++i)
+        {
+            transient.erase(KeyProbe(rt, values.getValueAtIndex(rt, i)).key());
+        }
+        return std::make_shared<PersistentSetHostObject>(transient.persistent());
+    }
+
+    std::shared_ptr<PersistentSetHostObject>
+    PersistentSetHostObject::setUnion(facebook::jsi::Runtime &rt,
+                                      const PersistentSetHostObject &other) const
+    {
+        const SetType &big = set_.size() >= other.set_.size() ? set_ : other.set_;
+        const SetType &small = &big == &set_ ? other.set_ : set_;
+
+        KeyEquivScope scope(rt);
+        auto transient = big.transient();
+        if (small.size() * kDiffSizeRatio < big.size())
+        {
+            for (const auto &value : small)
+            {
+                transient.insert(value);
+            }
+        }
+        else
+        {
+            // Elements of small missing from big show up as "added"
+            immer::diff(
+                big, small,
+                [&](const StoredValue &added)
+                { transient.insert(added); },
+                [](const StoredValue &) {});
+        }
+        return std::make_shared<PersistentSetHostObject>(transient.persistent());
+    }
+
+    std::shared_ptr<PersistentSetHostObject>
+    PersistentSetHostObject::setIntersection(facebook::jsi::Runtime &rt,
+                                             const PersistentSetHostObject &other) const
+    {
+        const SetType &big = set_.size() >= other.set_.size() ? set_ : other.set_;
+        const SetType &small = &big == &set_ ? other.set_ : set_;
+
+        KeyEquivScope scope(rt);
+        if (small.size() * kDiffSizeRatio < big.size())
+        {
+            auto transient = SetType{}.transient();
+            for (const auto &value : small)
+            {
+                if (big.count(value))
+                {
+                    transient.insert(value);
+                }
+            }
+            return std::make_shared<PersistentSetHostObject>(transient.persistent());
+        }
+
+        // Start from small and drop what big lacks ("removed")
+        auto transient = small.transient();
+        immer::diff(
+            small, big,
+            [](const StoredValue &) {},
+            [&](const StoredValue &removed)
+            { transient.erase(removed); });
+        return std::make_shared<PersistentSetHostObject>(transient.persistent());
+    }
+
+    std::shared_ptr<PersistentSetHostObject>
+    PersistentSetHostObject::setDifference(facebook::jsi::Runtime &rt,
+                                           const PersistentSetHostObject &other) const
+    {
+        KeyEquivScope scope(rt);
+        if (other.set_.size() * kDiffSizeRatio < set_.size())
+        {
+            auto transient = set_.transient();
+            for (const auto &value : other.set_)
+            {
+                transient.erase(value);
+            }
+            return std::make_shared<PersistentSetHostObject>(transient.persistent());
+        }
+
+        // Elements only in this set show up as "removed"
+        auto transient = SetType{}.transient();
+        immer::diff(
+            set_, other.set_,
+            [](const StoredValue &) {},
+            [&](const StoredValue &removed)
+            { transient.insert(removed); });
+        return std::make_shared<PersistentSetHostObject>(transient.persistent());
+    }
+
+    int32_t PersistentSetHostObject::hashUnordered(facebook::jsi::Runtime &rt) const
+    {
+        if (!hash_)
+        {
+            auto &handlers = KeyHandlers::forRuntime(rt);
+            uint32_t acc = 0;
+            for (const auto &value : set_)
+            {
+                acc = hash::unorderedStep(acc, handlers.hashValue(rt, value));
+            }
+            hash_ = hash::mixCollectionHash(acc, static_cast<uint32_t>(set_.size()));
+        }
+        return *hash_;
+    }
+
+    StoredValue PersistentSetHostObject::convertValue(facebook::jsi::Runtime &rt,
+                                                      const facebook::jsi::Value &value)
+    {
+        if (value.isUndefined() || value.isNull())
+        {
+            return StoredValue();
+        }
+        if (value.isBool())
+        {
+            return StoredValue(value.getBool());
+        }
+        if (value.isNumber())
+        {
+            return StoredValue(value.asNumber());
+        }
+        if (value.isString())
+        {
+            return internString(value.asString(rt).utf8(rt));
+        }
+        if (value.isObject())
+        {
+            return KeyHandlers::forRuntime(rt).convertObjectKey(rt, value.getObject(rt));
+        }
+        return StoredValue();
+    }
+
+    facebook::jsi::Value PersistentSetHostObject::reconstructValue(facebook::jsi::Runtime &rt,
+                                                                   const StoredValue &stored)
+    {
+        switch (stored.type())
+        {
+        case StoredValue::NIL:
+            return facebook::jsi::Value::null();
+        case StoredValue::BOOL:
+            return facebook::jsi::Value(stored.asBool());
+        case StoredValue::NUMBER:
+            return facebook::jsi::Value(stored.asNumber());
+        case StoredValue::STRING:
+            return stringToJS(rt, stored);
+        case StoredValue::OBJECT_REF:
+        case StoredValue::INTERNED_KEY:
+        case StoredValue::HASHED_REF:
+            return stored.objectValue(rt);
+        }
+        return facebook::jsi::Value::null();
+    }
+
+    SetChunkIteratorHostObject::SetChunkIteratorHostObject(PersistentSetHostObject::SetType set)
+        : set_(std::move(set)), it_(set_.begin()) {}
+
+    facebook::jsi::Value
+    SetChunkIteratorHostObject::get(facebook::jsi::Runtime &rt,
+                                     const facebook::jsi::PropNameID &name)
+    {
+        return MethodTable<SetChunkIteratorHostObject>::forRuntime(rt).get(rt, *this, name);
+    }
+
+    facebook::jsi::Value SetChunkIteratorHostObject::nextChunk(facebook::jsi::Runtime &rt)
+    {
+        if (it_ == set_.end())
+        {
+            return facebook::jsi::Value::undefined();
+        }
+
+        facebook::jsi::Array chunk(rt, kChunkSize);
+        size_t i = 0;
+        for (; i < kChunkSize && it_ != set_.end(); ++i, ++it_)
+        {
+            chunk.setValueAtIndex(rt, i, PersistentSetHostObject::reconstructValue(rt, *it_));
+        }
+        if (i < kChunkSize)
+        {
+            // Last chunk: trim so callers can rely on length
+            chunk.setProperty(rt, "length", static_cast<double>(i));
+        }
+        return chunk;
+    }
+
+    namespace
+    {
+        using facebook::jsi::Runtime;
+        using facebook::jsi::Value;
+
+        Value wrap(Runtime &rt, std::shared_ptr<facebook::jsi::HostObject> host)
+        {
+            return createHostObject(rt, std::move(host));
+        }
+
+        // s.has(x), s.conj(x), ... - The instance-first factory operations
+        // as methods, hottest first
+        void installSetMethods(Runtime &rt)
+        {
+            auto &methods = MethodTable<PersistentSetHostObject>::forRuntime(rt);
+            methods.setTypeName("PersistentSet");
+            methods.getter(rt, "size", [](Runtime &, PersistentSetHostObject &self)
+                           { return Value(static_cast<double>(self.size())); });
+            methods.getter(rt, "length", [](Runtime &, PersistentSetHostObject &self)
+                           { return Value(static_cast<double>(self.size())); });
+            methods.method(rt, "has", 1, [](Runtime &runtime, PersistentSetHostObject &self, const Value *args, size_t count)
+                           {
+                               if (count < 1)
+                               {
+                                   throw facebook::jsi::JSError(runtime, "has requires a value");
+                               }
+                               return Value(self.has(runtime, args[0])); });
+            methods.method(rt, "conj", 1, [](Runtime &runtime, PersistentSetHostObject &self, const Value *args, size_t count)
+                           {
+                               if (count < 1)
+                               {
+                                   throw facebook::jsi::JSError(runtime, "conj requires a value");
+                               }
+                               return wrap(runtime, self.conj(runtime, args[0])); });
+            methods.method(rt, "disj", 1, [](Runtime &runtime, PersistentSetHostObject &self, const Value *args, size_t count)
+                           {
+                               if (count < 1)
+                               {
+                                   throw facebook::jsi::JSError(runtime, "disj requires a value");
+                               }
+                               return wrap(runtime, self.disj(runtime, args[0])); });
+            methods.method(rt, "equiv", 1, [](Runtime &runtime, PersistentSetHostObject &self, const Value *args, size_t count)
+                           {
+                               if (count < 1)
+                               {
+                                   throw facebook::jsi::JSError(runtime, "equiv requires an argument");
+                               }
+                               return Value(self.equiv(runtime, args[0])); });
+            methods.method(rt, "hashUnordered", 0, [](Runtime &runtime, PersistentSetHostObject &self, const Value *, size_t)
+                           { return Value(self.hashUnordered(runtime)); });
+            methods.method(rt, "iterator", 0, [](Runtime &runtime, PersistentSetHostObject &self, const Value *, size_t)
+                           { return wrap(runtime, std::make_shared<SetChunkIteratorHostObject>(self.getSet())); });
+            methods.method(rt, "toArray", 0, [](Runtime &runtime, PersistentSetHostObject &self, const Value *, size_t)
+                           { return Value(runtime, self.toArray(runtime)); });
+            methods.method(rt, "batchConj", 1, [](Runtime &runtime, PersistentSetHostObject &self, const Value *args, size_t count)
+                           { return wrap(runtime, self.batchConj(runtime, arrayArg(runtime, args, count, 0, "batchConj"))); });
+            methods.method(rt, "batchDisj", 1, [](Runtime &runtime, PersistentSetHostObject &self, const Value *args, size_t count)
+                           { return wrap(runtime, self.batchDisj(runtime, arrayArg(runtime, args, count, 0, "batchDisj"))); });
+            methods.method(rt, "union", 1, [](Runtime &runtime, PersistentSetHostObject &self, const Value *args, size_t count)
+                           { return wrap(runtime, self.setUnion(runtime, *setArg(runtime, args, count, 0, "union"))); });
+            methods.method(rt, "intersection", 1, [](Runtime &runtime, PersistentSetHostObject &self, const Value *args, size_t count)
+                           { return wrap(runtime, self.setIntersection(runtime, *setArg(runtime, args, count, 0, "intersection"))); });
+            methods.method(rt, "difference", 1, [](Runtime &runtime, PersistentSetHostObject &self, const Value *args, size_t count)
+                           { return wrap(runtime, self.setDifference(runtime, *setArg(runtime, args, count, 0, "difference"))); });
+
+            auto &iteratorMethods = MethodTable<SetChunkIteratorHostObject>::forRuntime(rt);
+            iteratorMethods.setTypeName("PersistentSet iterator");
+            iteratorMethods.method(rt, "nextChunk", 0, [](Runtime &runtime, SetChunkIteratorHostObject &self, const Value *, size_t)
+                                   { return self.nextChunk(runtime); });
+        }
+    } // namespace
+
+    void installPersistentSet(facebook::jsi::Runtime &rt)
+    {
+        installSetMethods(rt);
+
+        // Create the PersistentSet factory object
+        facebook::jsi::Object factory(rt);
+
+        // PersistentSet.empty() - Create an empty set
+        factory.setProperty(
+            rt, "empty",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "empty"), 0,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *,
+                   size_t) -> facebook::jsi::Value
+                {
+                    auto set = PersistentSetHostObject::empty();
+                    return createHostObject(runtime, set);
+                }));
+
+        // PersistentSet.from(array) - Create a set from a JavaScript array
+        factory.setProperty(
+            rt, "from",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "from"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto arr = arrayArg(runtime, args, count, 0, "PersistentSet.from");
+                    auto set = PersistentSetHostObject::fromArray(runtime, arr);
+                    return createHostObject(runtime, set);
+                }));
+
+        // PersistentSet.count(set)
+        factory.setProperty(
+            rt, "count",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "count"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = setArg(runtime, args, count, 0, "count");
+                    return facebook::jsi::Value(static_cast<double>(set->size()));
+                }));
+
+        // PersistentSet.has(set, value)
+        factory.setProperty(
+            rt, "has",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "has"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = setArg(runtime, args, count, 0, "has");
+                    if (count < 2)
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "has requires a set and value");
+                    }
+                    return facebook::jsi::Value(set->has(runtime, args[1]));
+                }));
+
+        // PersistentSet.conj(set, value)
+        factory.setProperty(
+            rt, "conj",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "conj"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = setArg(runtime, args, count, 0, "conj");
+                    if (count < 2)
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "conj requires a set and value");
+                    }
+                    auto newSet = set->conj(runtime, args[1]);
+                    return createHostObject(runtime, newSet);
+                }));
+
+        // PersistentSet.disj(set, value)
+        factory.setProperty(
+            rt, "disj",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "disj"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = setArg(runtime, args, count, 0, "disj");
+                    if (count < 2)
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "disj requires a set and value");
+                    }
+                    auto newSet = set->disj(runtime, args[1]);
+                    return createHostObject(runtime, newSet);
+                }));
+
+        // PersistentSet.batchConj(set, values)
+        factory.setProperty(
+            rt, "batchConj",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "batchConj"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = setArg(runtime, args, count, 0, "batchConj");
+                    auto values = arrayArg(runtime, args, count, 1, "batchConj");
+                    auto newSet = set->batchConj(runtime, values);
+                    return createHostObject(runtime, newSet);
+                }));
+
+        // PersistentSet.batchDisj(set, values)
+        factory.setProperty(
+            rt, "batchDisj",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "batchDisj"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = setArg(runtime, args, count, 0, "batchDisj");
+                    auto values = arrayArg(runtime, args, count, 1, "batchDisj");
+                    auto newSet = set->batchDisj(runtime, values);
+                    return createHostObject(runtime, newSet);
+                }));
+
+        // PersistentSet.union(a, b)
+        factory.setProperty(
+            rt, "union",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "union"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto a = setArg(runtime, args, count, 0, "union");
+                    auto b = setArg(runtime, args, count, 1, "union");
+                    auto newSet = a->setUnion(runtime, *b);
+                    return createHostObject(runtime, newSet);
+                }));
+
+        // PersistentSet.intersection(a, b)
+        factory.setProperty(
+            rt, "intersection",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "intersection"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto a = setArg(runtime, args, count, 0, "intersection");
+                    auto b = setArg(runtime, args, count, 1, "intersection");
+                    auto newSet = a->setIntersection(runtime, *b);
+                    return createHostObject(runtime, newSet);
+                }));
+
+        // PersistentSet.difference(a, b) - Elements of a not in b
+        factory.setProperty(
+            rt, "difference",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "difference"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto a = setArg(runtime, args, count, 0, "difference");
+                    auto b = setArg(runtime, args, count, 1, "difference");
+                    auto newSet = a->setDifference(runtime, *b);
+                    return createHostObject(runtime, newSet);
+                }));
+
+        // PersistentSet.equiv(set1, set2)
+        factory.setProperty(
+            rt, "equiv",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "equiv"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = setArg(runtime, args, count, 0, "equiv");
+                    if (count < 2)
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "equiv requires two set arguments");
+                    }
+                    return facebook::jsi::Value(set->equiv(runtime, args[1]));
+                }));
+
+        // PersistentSet.toArray(set)
+        factory.setProperty(
+            rt, "toArray",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "toArray"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = setArg(runtime, args, count, 0, "toArray");
+                    return set->toArray(runtime);
+                }));
+
+        // PersistentSet.hashUnordered(set) - cljs-compatible hash, cached
+        factory.setProperty(
+            rt, "hashUnordered",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "hashUnordered"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = setArg(runtime, args, count, 0, "hashUnordered");
+                    return facebook::jsi::Value(set->hashUnordered(runtime));
+                }));
+
+        // PersistentSet.iterator(set) - Create a chunked element iterator
+        factory.setProperty(
+            rt, "iterator",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "iterator"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = setArg(runtime, args, count, 0, "iterator");
+                    auto it = std::make_shared<SetChunkIteratorHostObject>(set->getSet());
+                    return createHostObject(runtime, it);
+                }));
+
+        // PersistentSet.nextChunk(iterator) - Next elements array, or undefined
+        factory.setProperty(
+            rt, "nextChunk",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "nextChunk"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 1 || !args[0].isObject())
+                    {
+                        throw facebook::jsi::JSError(
+                            runtime, "nextChunk requires an iterator argument");
+                    }
+                    auto it = hostAs<SetChunkIteratorHostObject>(runtime, args, count, 0);
+                    if (!it)
+                    {
+                        throw facebook::jsi::JSError(runtime,
+                                                     "PersistentSet iterator is invalid");
+                    }
+                    return it->nextChunk(runtime);
+                }));
+
+        // Install the factory object as globalThis.PersistentSet
+        rt.global()
+            .setProperty(rt, "PersistentSet", factory);
+    }
+
+} // namespace cljs
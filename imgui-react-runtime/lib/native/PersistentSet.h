@@ -0,0 +1,154 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <hermes/hermes.h>
+#include <jsi/jsi.h>
+
+#include <immer/set.hpp>
+#include <immer/set_transient.hpp>
+
+#include "MemoryPolicy.h"
+#include "StoredValue.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace cljs
+{
+    /**
+     * PersistentSetHostObject wraps an immer::set to provide a
+     * ClojureScript-compatible persistent hash set.
+     *
+     * Elements are stored like PersistentMap keys: keywords, symbols, UUIDs
+     * and other IHash values are hashed natively by their ClojureScript hash
+     * once hermes.persistent-map has registered its key handlers.
+     *
+     * Operations:
+     * - size() - Returns the number of elements
+     * - has(value) - Returns true if the value is in the set
+     * - conj(value) - Returns a new set with the value added
+     * - disj(value) - Returns a new set with the value removed
+     * - batchConj(values) / batchDisj(values) - Bulk add/remove (transient)
+     * - setUnion(other) / setIntersection(other) / setDifference(other) -
+     *   Set algebra that walks both HAMTs together (see immer::diff), so
+     *   sets derived from one another only pay for the nodes that differ
+     * - toArray() - Returns the elements as a JavaScript array
+     */
+    class PersistentSetHostObject
+        : public facebook::jsi::HostObject,
+          public std::enable_shared_from_this<PersistentSetHostObject>
+    {
+    public:
+        using SetType = immer::set<StoredValue, std::hash<StoredValue>, std::equal_to<StoredValue>,
+                                   NativeMemoryPolicy>;
+
+        // Constructors
+        PersistentSetHostObject() = default;
+        explicit PersistentSetHostObject(SetType set);
+
+        // Factory methods
+        static std::shared_ptr<PersistentSetHostObject> empty();
+        static std::shared_ptr<PersistentSetHostObject>
+        fromArray(facebook::jsi::Runtime &rt, const facebook::jsi::Array &arr);
+
+        // HostObject interface
+        facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                                 const facebook::jsi::PropNameID &name) override;
+        void set(facebook::jsi::Runtime &rt, const facebook::jsi::PropNameID &name,
+                 const facebook::jsi::Value &value) override;
+        std::vector<facebook::jsi::PropNameID>
+        getPropertyNames(facebook::jsi::Runtime &rt) override;
+
+        // Set operations
+        size_t size() const;
+        bool has(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value) const;
+        bool equiv(facebook::jsi::Runtime &rt, const facebook::jsi::Value &other) const;
+        std::shared_ptr<PersistentSetHostObject>
+        conj(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value) const;
+        std::shared_ptr<PersistentSetHostObject>
+        disj(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value) const;
+        facebook::jsi::Array toArray(facebook::jsi::Runtime &rt) const;
+
+        // Batch operations using transient sets for efficiency
+        std::shared_ptr<PersistentSetHostObject>
+        batchConj(facebook::jsi::Runtime &rt, const facebook::jsi::Array &values) const;
+        std::shared_ptr<PersistentSetHostObject>
+        batchDisj(facebook::jsi::Runtime &rt, const facebook::jsi::Array &values) const;
+
+        // Set algebra
+        std::shared_ptr<PersistentSetHostObject>
+        setUnion(facebook::jsi::Runtime &rt, const PersistentSetHostObject &other) const;
+        std::shared_ptr<PersistentSetHostObject>
+        setIntersection(facebook::jsi::Runtime &rt, const PersistentSetHostObject &other) const;
+        std::shared_ptr<PersistentSetHostObject>
+        setDifference(facebook::jsi::Runtime &rt, const PersistentSetHostObject &other) const;
+
+        // cljs.core/hash-unordered-coll, cached after the first call
+        int32_t hashUnordered(facebook::jsi::Runtime &rt) const;
+
+        // Access the underlying set (for testing/debugging)
+        const SetType &getSet() const { return set_; }
+
+    private:
+        friend class SetChunkIteratorHostObject;
+
+        // Helper to convert jsi::Value to StoredValue, hashing objects natively
+        static StoredValue convertValue(facebook::jsi::Runtime &rt,
+                                        const facebook::jsi::Value &value);
+
+        // Helper to convert StoredValue back to jsi::Value
+        static facebook::jsi::Value reconstructValue(facebook::jsi::Runtime &rt,
+                                                     const StoredValue &stored);
+
+        SetType set_;
+        mutable std::optional<int32_t> hash_;
+    };
+
+    /**
+     * SetChunkIteratorHostObject walks a set up to kChunkSize elements at a
+     * time for lazy chunked seqs. It holds its own (structurally shared) copy
+     * of the set.
+     *
+     * Operations:
+     * - nextChunk() - Returns the next elements as a JS array, or undefined
+     *   when exhausted
+     */
+    class SetChunkIteratorHostObject : public facebook::jsi::HostObject
+    {
+    public:
+        static constexpr size_t kChunkSize = 32;
+
+        explicit SetChunkIteratorHostObject(PersistentSetHostObject::SetType set);
+
+        // HostObject interface
+        facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                                 const facebook::jsi::PropNameID &name) override;
+
+        facebook::jsi::Value nextChunk(facebook::jsi::Runtime &rt);
+
+    private:
+        PersistentSetHostObject::SetType set_;
+        // Must follow set_: iterates the nodes set_ keeps alive
+        PersistentSetHostObject::SetType::iterator it_;
+    };
+
+    /**
+     * Install the PersistentSet factory object into the JavaScript runtime.
+     * After calling this, JavaScript code can use:
+     *
+     *   const s1 = PersistentSet.empty();
+     *   const s2 = PersistentSet.from([1, 2, 3]);
+     *   const s3 = PersistentSet.union(s2, PersistentSet.from([3, 4]));
+     *
+     * or call the same operations as methods on the sets themselves:
+     *
+     *   s2.has(1);                         // true
+     *   const s4 = s2.conj(4).disj(1);
+     */
+    void installPersistentSet(facebook::jsi::Runtime &rt);
+
+} // namespace cljs
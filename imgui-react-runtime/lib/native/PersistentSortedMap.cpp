@@ -0,0 +1,1144 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "PersistentSortedMap.h"
+#include "CljsHash.h"
+#include "HostArgs.h"
+#include "KeyHashing.h"
+#include "MethodTable.h"
+#include "NativeMemory.h"
+#include "StringTable.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace cljs
+{
+
+    namespace
+    {
+        // Keys are hashed/interned like PersistentMap keys so keywords order
+        // by their canonical string without calling into JS
+        StoredValue convertKey(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value)
+        {
+            if (value.isUndefined() || value.isNull())
+            {
+                return StoredValue();
+            }
+            if (value.isBool())
+            {
+                return StoredValue(value.getBool());
+            }
+            if (value.isNumber())
+            {
+                return StoredValue(value.asNumber());
+            }
+            if (value.isString())
+            {
+                return internString(value.asString(rt).utf8(rt));
+            }
+            if (value.isObject())
+            {
+                return KeyHandlers::forRuntime(rt).convertObjectKey(rt, value.getObject(rt));
+            }
+            return StoredValue();
+        }
+
+        // Natural order only covers keys convertKey canonicalizes; other
+        // objects get a fresh cell per conversion, so ordering them by cell
+        // would miss lookups and duplicate keys. Those need a comparator
+        const StoredValue &orderable(facebook::jsi::Runtime &rt, const StoredValue &key,
+                                     const facebook::jsi::Function *comparator)
+        {
+            if (!comparator &&
+                (key.type() == StoredValue::OBJECT_REF || key.type() == StoredValue::HASHED_REF))
+            {
+                throw facebook::jsi::JSError(
+                    rt, "Sorted collections without a comparator only accept nil, boolean, "
+                        "number, string, keyword and symbol keys");
+            }
+            return key;
+        }
+
+        StoredValue sortedKey(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value,
+                              const facebook::jsi::Function *comparator)
+        {
+            StoredValue key = convertKey(rt, value);
+            orderable(rt, key, comparator);
+            return key;
+        }
+
+        StoredValue convertValue(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value)
+        {
+            if (value.isString())
+            {
+                return internString(value.asString(rt).utf8(rt));
+            }
+            if (value.isObject())
+            {
+                return StoredValue(rt, value.getObject(rt));
+            }
+            return convertKey(rt, value);
+        }
+
+        facebook::jsi::Value reconstructValue(facebook::jsi::Runtime &rt, const StoredValue &stored)
+        {
+            switch (stored.type())
+            {
+            case StoredValue::NIL:
+                return facebook::jsi::Value::null();
+            case StoredValue::BOOL:
+                return facebook::jsi::Value(stored.asBool());
+            case StoredValue::NUMBER:
+                return facebook::jsi::Value(stored.asNumber());
+            case StoredValue::STRING:
+                return stringToJS(rt, stored);
+            case StoredValue::OBJECT_REF:
+            case StoredValue::INTERNED_KEY:
+            case StoredValue::HASHED_REF:
+                return stored.objectValue(rt);
+            }
+            return facebook::jsi::Value::null();
+        }
+
+        // undefined/null means natural order
+        std::shared_ptr<facebook::jsi::Function>
+        comparatorArg(facebook::jsi::Runtime &rt, const facebook::jsi::Value *args,
+                      size_t count, size_t index)
+        {
+            if (index >= count || args[index].isUndefined() || args[index].isNull())
+            {
+                return nullptr;
+            }
+            if (!args[index].isObject() || !args[index].getObject(rt).isFunction(rt))
+            {
+                throw facebook::jsi::JSError(rt, "Comparator must be a function");
+            }
+            return std::make_shared<facebook::jsi::Function>(
+                args[index].getObject(rt).getFunction(rt));
+        }
+
+        // undefined means unbounded; null is the nil key
+        std::optional<StoredValue> boundArg(facebook::jsi::Runtime &rt,
+                                            const facebook::jsi::Value &value,
+                                            const facebook::jsi::Function *comparator)
+        {
+            if (value.isUndefined())
+            {
+                return std::nullopt;
+            }
+            return sortedKey(rt, value, comparator);
+        }
+
+        template <typename T>
+        std::shared_ptr<T> hostArg(facebook::jsi::Runtime &rt, const facebook::jsi::Value *args,
+                                   size_t count, size_t index, const char *fnName,
+                                   const char *typeName)
+        {
+            if (index >= count || !args[index].isObject())
+            {
+                std::ostringstream msg;
+                msg << fnName << " requires a " << typeName << " argument";
+                throw facebook::jsi::JSError(rt, msg.str());
+            }
+            auto host = hostAs<T>(rt, args[index]);
+            if (!host)
+            {
+                std::ostringstream msg;
+                msg << typeName << " instance is invalid";
+                throw facebook::jsi::JSError(rt, msg.str());
+            }
+            return host;
+        }
+
+        facebook::jsi::Array arrayArg(facebook::jsi::Runtime &rt, const facebook::jsi::Value *args,
+                                      size_t count, size_t index, const char *fnName)
+        {
+            if (index >= count || !args[index].isObject() ||
+                !args[index].getObject(rt).isArray(rt))
+            {
+                std::ostringstream msg;
+                msg << fnName << " requires an array argument";
+                throw facebook::jsi::JSError(rt, msg.str());
+            }
+            return args[index].getObject(rt).getArray(rt);
+        }
+
+        // Sorts (key, value) pairs and keeps the last value for duplicate
+        // keys, like repeated assoc. stable_sort stays in bounds even if a
+        // user comparator is inconsistent.
+        SortedTree buildSorted(std::vector<std::pair<StoredValue, StoredValue>> entries,
+                               const SortedKeyLess &less)
+        {
+            std::stable_sort(entries.begin(), entries.end(),
+                             [&](const auto &a, const auto &b)
+                             { return less(a.first, b.first); });
+
+            std::vector<StoredValue> keys;
+            std::vector<StoredValue> values;
+            keys.reserve(entries.size());
+            values.reserve(entries.size());
+            for (auto &entry : entries)
+            {
+                if (!keys.empty() && !less(keys.back(), entry.first))
+                {
+                    values.back() = std::move(entry.second);
+                    continue;
+                }
+                keys.push_back(std::move(entry.first));
+                values.push_back(std::move(entry.second));
+            }
+            return SortedTree::fromSorted(std::move(keys), std::move(values));
+        }
+
+        SortedTree::Cursor seekNearest(facebook::jsi::Runtime &rt, const SortedTree &tree,
+                                       const std::string &test, const StoredValue &key,
+                                       const SortedKeyLess &less)
+        {
+            if (test == "<")
+                return tree.seekBefore(key, false, less);
+            if (test == "<=")
+                return tree.seekBefore(key, true, less);
+            if (test == ">=")
+                return tree.seekAfter(key, true, less);
+            if (test == ">")
+                return tree.seekAfter(key, false, less);
+            throw facebook::jsi::JSError(rt, "nearest test must be one of <, <=, >=, >");
+        }
+
+        bool sameEntries(facebook::jsi::Runtime &rt, const SortedTree &a,
+                         const std::shared_ptr<facebook::jsi::Function> &aComparator,
+                         const SortedTree &b,
+                         const std::shared_ptr<facebook::jsi::Function> &bComparator,
+                         bool compareValues)
+        {
+            if (a.size() != b.size())
+            {
+                return false;
+            }
+
+            KeyEquivScope scope(rt);
+            auto &handlers = KeyHandlers::forRuntime(rt);
+            SortedKeyLess aLess{rt, aComparator.get()};
+            if (aComparator == bComparator)
+            {
+                // Same order: walk both trees in lockstep
+                auto x = a.first();
+                auto y = b.first();
+                for (; x.valid(); x.next(), y.next())
+                {
+                    if (aLess(x.key(), y.key()) || aLess(y.key(), x.key()))
+                        return false;
+                    if (compareValues && !handlers.valuesEqual(rt, x.value(), y.value()))
+                        return false;
+                }
+                return true;
+            }
+
+            SortedKeyLess bLess{rt, bComparator.get()};
+            for (auto x = a.first(); x.valid(); x.next())
+            {
+                const StoredValue *found = b.find(x.key(), bLess);
+                if (!found || (compareValues && !handlers.valuesEqual(rt, x.value(), *found)))
+                    return false;
+            }
+            return true;
+        }
+    } // namespace
+
+    bool SortedKeyLess::operator()(const StoredValue &a, const StoredValue &b) const
+    {
+        if (!comparator)
+        {
+            return a < b;
+        }
+        auto result = comparator->call(rt, reconstructValue(rt, a), reconstructValue(rt, b));
+        if (result.isNumber())
+        {
+            return result.getNumber() < 0;
+        }
+        return result.isBool() && result.getBool();
+    }
+
+    SortedRangeIteratorHostObject::SortedRangeIteratorHostObject(
+        SortedTree tree, std::shared_ptr<facebook::jsi::Function> comparator, bool withValues)
+        : tree_(std::move(tree)), comparator_(std::move(comparator)), withValues_(withValues) {}
+
+    void SortedRangeIteratorHostObject::seek(facebook::jsi::Runtime &rt,
+                                             std::optional<StoredValue> lo, bool loInclusive,
+                                             std::optional<StoredValue> hi, bool hiInclusive,
+                                             bool reverse)
+    {
+        SortedKeyLess less{rt, comparator_.get()};
+        reverse_ = reverse;
+        if (!reverse)
+        {
+            cursor_ = lo ? tree_.seekAfter(*lo, loInclusive, less) : tree_.first();
+            stop_ = std::move(hi);
+            stopInclusive_ = hiInclusive;
+        }
+        else
+        {
+            cursor_ = hi ? tree_.seekBefore(*hi, hiInclusive, less) : tree_.last();
+            stop_ = std::move(lo);
+            stopInclusive_ = loInclusive;
+        }
+    }
+
+    facebook::jsi::Value
+    SortedRangeIteratorHostObject::get(facebook::jsi::Runtime &rt,
+                                        const facebook::jsi::PropNameID &name)
+    {
+        return MethodTable<SortedRangeIteratorHostObject>::forRuntime(rt).get(rt, *this, name);
+    }
+
+    facebook::jsi::Value SortedRangeIteratorHostObject::nextChunk(facebook::jsi::Runtime &rt)
+    {
+        if (!cursor_.valid())
+        {
+            return facebook::jsi::Value::undefined();
+        }
+
+        SortedKeyLess less{rt, comparator_.get()};
+        size_t capacity = withValues_ ? 2 * kChunkSize : kChunkSize;
+        facebook::jsi::Array chunk(rt, capacity);
+        size_t slot = 0;
+        for (size_t i = 0; i < kChunkSize && cursor_.valid(); ++i)
+        {
+            const StoredValue &key = cursor_.key();
+            if (stop_)
+            {
+                bool beyond = reverse_
+                                  ? (stopInclusive_ ? less(key, *stop_) : !less(*stop_, key))
+                                  : (stopInclusive_ ? less(*stop_, key) : !less(key, *stop_));
+                if (beyond)
+                {
+                    cursor_ = SortedTree::Cursor();
+                    break;
+                }
+            }
+            chunk.setValueAtIndex(rt, slot++, reconstructValue(rt, key));
+            if (withValues_)
+            {
+                chunk.setValueAtIndex(rt, slot++, reconstructValue(rt, cursor_.value()));
+            }
+            if (reverse_)
+                cursor_.prev();
+            else
+                cursor_.next();
+        }
+
+        if (slot == 0)
+        {
+            return facebook::jsi::Value::undefined();
+        }
+        if (slot < capacity)
+        {
+            // Last chunk: trim so callers can rely on length
+            chunk.setProperty(rt, "length", static_cast<double>(slot));
+        }
+        return chunk;
+    }
+
+    PersistentSortedMapHostObject::PersistentSortedMapHostObject(
+        SortedTree tree, std::shared_ptr<facebook::jsi::Function> comparator)
+        : tree_(std::move(tree)), comparator_(std::move(comparator)) {}
+
+    std::shared_ptr<PersistentSortedMapHostObject>
+    PersistentSortedMapHostObject::fromEntries(facebook::jsi::Runtime &rt,
+                                               const facebook::jsi::Array &entries,
+                                               std::shared_ptr<facebook::jsi::Function> comparator)
+    {
+        std::vector<std::pair<StoredValue, StoredValue>> pairs;
+        size_t len = entries.size(rt);
+        pairs.reserve(len);
+        for (size_t i = 0; i < len; ++i)
+        {
+            auto entry = entries.getValueAtIndex(rt, i);
+            if (!entry.isObject() || !entry.getObject(rt).isArray(rt))
+            {
+                std::ostringstream msg;
+                msg << "Entry " << i << " is not a [key, value] array";
+                throw facebook::jsi::JSError(rt, msg.str());
+            }
+            auto pair = entry.getObject(rt).getArray(rt);
+            pairs.emplace_back(sortedKey(rt, pair.getValueAtIndex(rt, 0), comparator.get()),
+                               convertValue(rt, pair.getValueAtIndex(rt, 1)));
+        }
+        auto tree = buildSorted(std::move(pairs), SortedKeyLess{rt, comparator.get()});
+        return std::make_shared<PersistentSortedMapHostObject>(std::move(tree), std::move(comparator));
+    }
+
+    facebook::jsi::Value
+    PersistentSortedMapHostObject::get(facebook::jsi::Runtime &rt,
+                                       const facebook::jsi::PropNameID &name)
+    {
+        return MethodTable<PersistentSortedMapHostObject>::forRuntime(rt).get(rt, *this, name);
+    }
+
+    void PersistentSortedMapHostObject::set(facebook::jsi::Runtime &rt,
+                                            const facebook::jsi::PropNameID &name,
+                                            const facebook::jsi::Value &value)
+    {
+    }
+
+    std::vector<facebook::jsi::PropNameID>
+    PersistentSortedMapHostObject::getPropertyNames(facebook::jsi::Runtime &rt)
+    {
+        return MethodTable<PersistentSortedMapHostObject>::forRuntime(rt).names(rt);
+    }
+
+    size_t PersistentSortedMapHostObject::size() const { return tree_.size(); }
+
+    facebook::jsi::Value PersistentSortedMapHostObject::get(facebook::jsi::Runtime &rt,
+                                                            const facebook::jsi::Value &key) const
+    {
+        KeyProbe probe(rt, key);
+        const StoredValue &probeKey = orderable(rt, probe.key(), comparator_.get());
+        const StoredValue *found = tree_.find(probeKey, less(rt));
+        if (!found)
+        {
+            return facebook::jsi::Value::undefined();
+        }
+        return reconstructValue(rt, *found);
+    }
+
+    bool PersistentSortedMapHostObject::has(facebook::jsi::Runtime &rt,
+                                            const facebook::jsi::Value &key) const
+    {
+        KeyProbe probe(rt, key);
+        const StoredValue &probeKey = orderable(rt, probe.key(), comparator_.get());
+        return tree_.find(probeKey, less(rt)) != nullptr;
+    }
+
+    bool PersistentSortedMapHostObject::equiv(facebook::jsi::Runtime &rt,
+                                              const facebook::jsi::Value &other) const
+    {
+        if (!other.isObject())
+        {
+            return false;
+        }
+        auto otherMap = hostAs<PersistentSortedMapHostObject>(rt, other);
+        if (!otherMap)
+        {
+            return false;
+        }
+        return sameEntries(rt, tree_, comparator_, otherMap->tree_, otherMap->comparator_, true);
+    }
+
+    std::shared_ptr<PersistentSortedMapHostObject>
+    PersistentSortedMapHostObject::assoc(facebook::jsi::Runtime &rt,
+                                         const facebook::jsi::Value &key,
+                                         const facebook::jsi::Value &value) const
+    {
+        auto tree = tree_.insert(sortedKey(rt, key, comparator_.get()), convertValue(rt, value),
+                                 less(rt));
+        return std::make_shared<PersistentSortedMapHostObject>(std::move(tree), comparator_);
+    }
+
+    std::shared_ptr<PersistentSortedMapHostObject>
+    PersistentSortedMapHostObject::dissoc(facebook::jsi::Runtime &rt,
+                                          const facebook::jsi::Value &key) const
+    {
+        KeyProbe probe(rt, key);
+        const StoredValue &probeKey = orderable(rt, probe.key(), comparator_.get());
+        auto tree = tree_.erase(probeKey, less(rt));
+        return std::make_shared<PersistentSortedMapHostObject>(std::move(tree), comparator_);
+    }
+
+    facebook::jsi::Value PersistentSortedMapHostObject::nearest(facebook::jsi::Runtime &rt,
+                                                                const std::string &test,
+                                                                const facebook::jsi::Value &key) const
+    {
+        KeyProbe probe(rt, key);
+        const StoredValue &probeKey = orderable(rt, probe.key(), comparator_.get());
+        auto cursor = seekNearest(rt, tree_, test, probeKey, less(rt));
+        if (!cursor.valid())
+        {
+            return facebook::jsi::Value::undefined();
+        }
+        facebook::jsi::Array entry(rt, 2);
+        entry.setValueAtIndex(rt, 0, reconstructValue(rt, cursor.key()));
+        entry.setValueAtIndex(rt, 1, reconstructValue(rt, cursor.value()));
+        return entry;
+    }
+
+    std::shared_ptr<SortedRangeIteratorHostObject>
+    PersistentSortedMapHostObject::range(facebook::jsi::Runtime &rt,
+                                         const facebook::jsi::Value &lo, bool loInclusive,
+                                         const facebook::jsi::Value &hi, bool hiInclusive,
+                                         bool reverse) const
+    {
+        auto it = std::make_shared<SortedRangeIteratorHostObject>(tree_, comparator_, true);
+        it->seek(rt, boundArg(rt, lo, comparator_.get()), loInclusive, boundArg(rt, hi, comparator_.get()), hiInclusive, reverse);
+        return it;
+    }
+
+    int32_t PersistentSortedMapHostObject::hashUnordered(facebook::jsi::Runtime &rt) const
+    {
+        if (!hash_)
+        {
+            auto &handlers = KeyHandlers::forRuntime(rt);
+            uint32_t acc = 0;
+            tree_.forEach([&](const StoredValue &key, const StoredValue &value)
+                          { acc = hash::unorderedStep(
+                                acc, hash::mapEntry(handlers.hashValue(rt, key),
+                                                    handlers.hashValue(rt, value))); });
+            hash_ = hash::mixCollectionHash(acc, static_cast<uint32_t>(tree_.size()));
+        }
+        return *hash_;
+    }
+
+    PersistentSortedSetHostObject::PersistentSortedSetHostObject(
+        SortedTree tree, std::shared_ptr<facebook::jsi::Function> comparator)
+        : tree_(std::move(tree)), comparator_(std::move(comparator)) {}
+
+    std::shared_ptr<PersistentSortedSetHostObject>
+    PersistentSortedSetHostObject::fromArray(facebook::jsi::Runtime &rt,
+                                             const facebook::jsi::Array &arr,
+                                             std::shared_ptr<facebook::jsi::Function> comparator)
+    {
+        std::vector<std::pair<StoredValue, StoredValue>> pairs;
+        size_t len = arr.size(rt);
+        pairs.reserve(len);
+        for (size_t i = 0; i < len; ++i)
+        {
+            pairs.emplace_back(sortedKey(rt, arr.getValueAtIndex(rt, i), comparator.get()),
+                               StoredValue());
+        }
+        auto tree = buildSorted(std::move(pairs), SortedKeyLess{rt, comparator.get()});
+        return std::make_shared<PersistentSortedSetHostObject>(std::move(tree), std::move(comparator));
+    }
+
+    facebook::jsi::Value
+    PersistentSortedSetHostObject::get(facebook::jsi::Runtime &rt,
+                                       const facebook::jsi::PropNameID &name)
+    {
+        return MethodTable<PersistentSortedSetHostObject>::forRuntime(rt).get(rt, *this, name);
+    }
+
+    void PersistentSortedSetHostObject::set(facebook::jsi::Runtime &rt,
+                                            const facebook::jsi::PropNameID &name,
+                                            const facebook::jsi::Value &value)
+    {
+    }
+
+    std::vector<facebook::jsi::PropNameID>
+    PersistentSortedSetHostObject::getPropertyNames(facebook::jsi::Runtime &rt)
+    {
+        return MethodTable<PersistentSortedSetHostObject>::forRuntime(rt).names(rt);
+    }
+
+    size_t PersistentSortedSetHostObject::size() const { return tree_.size(); }
+
+    bool PersistentSortedSetHostObject::has(facebook::jsi::Runtime &rt,
+                                            const facebook::jsi::Value &value) const
+    {
+        KeyProbe probe(rt, value);
+        const StoredValue &probeKey = orderable(rt, probe.key(), comparator_.get());
+        return tree_.find(probeKey, less(rt)) != nullptr;
+    }
+
+    bool PersistentSortedSetHostObject::equiv(facebook::jsi::Runtime &rt,
+                                              const facebook::jsi::Value &other) const
+    {
+        if (!other.isObject())
+        {
+            return false;
+        }
+        auto otherSet = hostAs<PersistentSortedSetHostObject>(rt, other);
+        if (!otherSet)
+        {
+            return false;
+        }
+        return sameEntries(rt, tree_, comparator_, otherSet->tree_, otherSet->comparator_, false);
+    }
+
+    std::shared_ptr<PersistentSortedSetHostObject>
+    PersistentSortedSetHostObject::conj(facebook::jsi::Runtime &rt,
+                                        const facebook::jsi::Value &value) const
+    {
+        auto tree = tree_.insert(sortedKey(rt, value, comparator_.get()), StoredValue(), less(rt));
+        return std::make_shared<PersistentSortedSetHostObject>(std::move(tree), comparator_);
+    }
+
+    std::shared_ptr<PersistentSortedSetHostObject>
+    PersistentSortedSetHostObject::disj(facebook::jsi::Runtime &rt,
+                                        const facebook::jsi::Value &value) const
+    {
+        KeyProbe probe(rt, value);
+        const StoredValue &probeKey = orderable(rt, probe.key(), comparator_.get());
+        auto tree = tree_.erase(probeKey, less(rt));
+        return std::make_shared<PersistentSortedSetHostObject>(std::move(tree), comparator_);
+    }
+
+    facebook::jsi::Value PersistentSortedSetHostObject::nearest(facebook::jsi::Runtime &rt,
+                                                                const std::string &test,
+                                                                const facebook::jsi::Value &value) const
+    {
+        KeyProbe probe(rt, value);
+        const StoredValue &probeKey = orderable(rt, probe.key(), comparator_.get());
+        auto cursor = seekNearest(rt, tree_, test, probeKey, less(rt));
+        if (!cursor.valid())
+        {
+            return facebook::jsi::Value::undefined();
+        }
+        return reconstructValue(rt, cursor.key());
+    }
+
+    std::shared_ptr<SortedRangeIteratorHostObject>
+    PersistentSortedSetHostObject::range(facebook::jsi::Runtime &rt,
+                                         const facebook::jsi::Value &lo, bool loInclusive,
+                                         const facebook::jsi::Value &hi, bool hiInclusive,
+                                         bool reverse) const
+    {
+        auto it = std::make_shared<SortedRangeIteratorHostObject>(tree_, comparator_, false);
+        it->seek(rt, boundArg(rt, lo, comparator_.get()), loInclusive, boundArg(rt, hi, comparator_.get()), hiInclusive, reverse);
+        return it;
+    }
+
+    int32_t PersistentSortedSetHostObject::hashUnordered(facebook::jsi::Runtime &rt) const
+    {
+        if (!hash_)
+        {
+            auto &handlers = KeyHandlers::forRuntime(rt);
+            uint32_t acc = 0;
+            tree_.forEach([&](const StoredValue &key, const StoredValue &)
+                          { acc = hash::unorderedStep(acc, handlers.hashValue(rt, key)); });
+            hash_ = hash::mixCollectionHash(acc, static_cast<uint32_t>(tree_.size()));
+        }
+        return *hash_;
+    }
+
+    namespace
+    {
+        bool boolArg(const facebook::jsi::Value *args, size_t count, size_t index, bool fallback)
+        {
+            return index < count && args[index].isBool() ? args[index].getBool() : fallback;
+        }
+
+        // Shared by both factories: the range iterator is the same type
+        void installRangeIterator(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory,
+                                  const char *typeName)
+        {
+            // <Factory>.nextChunk(iterator) - Next chunk array, or undefined
+            factory.setProperty(
+                rt, "nextChunk",
+                facebook::jsi::Function::createFromHostFunction(
+                    rt, facebook::jsi::PropNameID::forAscii(rt, "nextChunk"), 1,
+                    [typeName](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                               const facebook::jsi::Value *args,
+                               size_t count) -> facebook::jsi::Value
+                    {
+                        if (count < 1 || !args[0].isObject())
+                        {
+                            throw facebook::jsi::JSError(
+                                runtime, "nextChunk requires an iterator argument");
+                        }
+                        auto it = hostAs<SortedRangeIteratorHostObject>(runtime, args, count, 0);
+                        if (!it)
+                        {
+                            std::ostringstream msg;
+                            msg << typeName << " iterator is invalid";
+                            throw facebook::jsi::JSError(runtime, msg.str());
+                        }
+                        return it->nextChunk(runtime);
+                    }));
+        }
+
+        using Runtime = facebook::jsi::Runtime;
+        using Value = facebook::jsi::Value;
+
+        template <typename T>
+        Value wrap(Runtime &rt, std::shared_ptr<T> host)
+        {
+            return createHostObject(rt, std::move(host));
+        }
+
+        void requireArgs(Runtime &rt, size_t count, size_t needed, const char *message)
+        {
+            if (count < needed)
+            {
+                throw facebook::jsi::JSError(rt, message);
+            }
+        }
+
+        // nearest(test, key) on either host: test is "<", "<=", ">=" or ">"
+        template <typename Host>
+        Value nearestMethod(Runtime &rt, Host &self, const Value *args, size_t count)
+        {
+            if (count < 2 || !args[0].isString())
+            {
+                throw facebook::jsi::JSError(rt, "nearest requires a test and key");
+            }
+            return self.nearest(rt, args[0].getString(rt).utf8(rt), args[1]);
+        }
+
+        // range(lo, loInclusive, hi, hiInclusive, reverse) on either host
+        template <typename Host>
+        Value rangeMethod(Runtime &rt, Host &self, const Value *args, size_t count)
+        {
+            const Value unbounded;
+            return wrap(rt, self.range(rt,
+                                       count > 0 ? args[0] : unbounded,
+                                       boolArg(args, count, 1, true),
+                                       count > 2 ? args[2] : unbounded,
+                                       boolArg(args, count, 3, true),
+                                       boolArg(args, count, 4, false)));
+        }
+
+        // Methods callable on the host objects themselves (m.get(k), s.conj(x))
+        void installSortedMethods(Runtime &rt)
+        {
+            using MapHost = PersistentSortedMapHostObject;
+            using SetHost = PersistentSortedSetHostObject;
+
+            auto &mapMethods = MethodTable<MapHost>::forRuntime(rt);
+            mapMethods.setTypeName("PersistentSortedMap");
+            mapMethods.getter(rt, "size", [](Runtime &, MapHost &self)
+                              { return Value(static_cast<double>(self.size())); });
+            mapMethods.getter(rt, "length", [](Runtime &, MapHost &self)
+                              { return Value(static_cast<double>(self.size())); });
+            mapMethods.method(rt, "get", 1, [](Runtime &runtime, MapHost &self, const Value *args, size_t count)
+                              {
+                                  requireArgs(runtime, count, 1, "get requires a key");
+                                  return self.get(runtime, args[0]); });
+            mapMethods.method(rt, "has", 1, [](Runtime &runtime, MapHost &self, const Value *args, size_t count)
+                              {
+                                  requireArgs(runtime, count, 1, "has requires a key");
+                                  return Value(self.has(runtime, args[0])); });
+            mapMethods.method(rt, "assoc", 2, [](Runtime &runtime, MapHost &self, const Value *args, size_t count)
+                              {
+                                  requireArgs(runtime, count, 2, "assoc requires a key and value");
+                                  return wrap(runtime, self.assoc(runtime, args[0], args[1])); });
+            mapMethods.method(rt, "dissoc", 1, [](Runtime &runtime, MapHost &self, const Value *args, size_t count)
+                              {
+                                  requireArgs(runtime, count, 1, "dissoc requires a key");
+                                  return wrap(runtime, self.dissoc(runtime, args[0])); });
+            mapMethods.method(rt, "range", 5, rangeMethod<MapHost>);
+            mapMethods.method(rt, "nearest", 2, nearestMethod<MapHost>);
+            mapMethods.method(rt, "equiv", 1, [](Runtime &runtime, MapHost &self, const Value *args, size_t count)
+                              {
+                                  requireArgs(runtime, count, 1, "equiv requires an argument");
+                                  return Value(self.equiv(runtime, args[0])); });
+            mapMethods.method(rt, "hashUnordered", 0, [](Runtime &runtime, MapHost &self, const Value *, size_t)
+                              { return Value(self.hashUnordered(runtime)); });
+
+            auto &setMethods = MethodTable<SetHost>::forRuntime(rt);
+            setMethods.setTypeName("PersistentSortedSet");
+            setMethods.getter(rt, "size", [](Runtime &, SetHost &self)
+                              { return Value(static_cast<double>(self.size())); });
+            setMethods.getter(rt, "length", [](Runtime &, SetHost &self)
+                              { return Value(static_cast<double>(self.size())); });
+            setMethods.method(rt, "has", 1, [](Runtime &runtime, SetHost &self, const Value *args, size_t count)
+                              {
+                                  requireArgs(runtime, count, 1, "has requires a value");
+                                  return Value(self.has(runtime, args[0])); });
+            setMethods.method(rt, "conj", 1, [](Runtime &runtime, SetHost &self, const Value *args, size_t count)
+                              {
+                                  requireArgs(runtime, count, 1, "conj requires a value");
+                                  return wrap(runtime, self.conj(runtime, args[0])); });
+            setMethods.method(rt, "disj", 1, [](Runtime &runtime, SetHost &self, const Value *args, size_t count)
+                              {
+                                  requireArgs(runtime, count, 1, "disj requires a value");
+                                  return wrap(runtime, self.disj(runtime, args[0])); });
+            setMethods.method(rt, "range", 5, rangeMethod<SetHost>);
+            setMethods.method(rt, "nearest", 2, nearestMethod<SetHost>);
+            setMethods.method(rt, "equiv", 1, [](Runtime &runtime, SetHost &self, const Value *args, size_t count)
+                              {
+                                  requireArgs(runtime, count, 1, "equiv requires an argument");
+                                  return Value(self.equiv(runtime, args[0])); });
+            setMethods.method(rt, "hashUnordered", 0, [](Runtime &runtime, SetHost &self, const Value *, size_t)
+                              { return Value(self.hashUnordered(runtime)); });
+
+            auto &iteratorMethods = MethodTable<SortedRangeIteratorHostObject>::forRuntime(rt);
+            iteratorMethods.setTypeName("sorted range iterator");
+            iteratorMethods.method(rt, "nextChunk", 0, [](Runtime &runtime, SortedRangeIteratorHostObject &self, const Value *, size_t)
+                                   { return self.nextChunk(runtime); });
+        }
+    } // namespace
+
+    void installPersistentSortedMap(facebook::jsi::Runtime &rt)
+    {
+        installSortedMethods(rt);
+
+        // Create the PersistentSortedMap factory object
+        facebook::jsi::Object mapFactory(rt);
+
+        // PersistentSortedMap.empty(comparator?) - Create an empty sorted map
+        mapFactory.setProperty(
+            rt, "empty",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "empty"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto map = std::make_shared<PersistentSortedMapHostObject>(
+                        SortedTree(), comparatorArg(runtime, args, count, 0));
+                    return createHostObject(runtime, map);
+                }));
+
+        // PersistentSortedMap.fromEntries(entries, comparator?) - Sort and bulk-load
+        mapFactory.setProperty(
+            rt, "fromEntries",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "fromEntries"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto entries = arrayArg(runtime, args, count, 0, "PersistentSortedMap.fromEntries");
+                    auto map = PersistentSortedMapHostObject::fromEntries(
+                        runtime, entries, comparatorArg(runtime, args, count, 1));
+                    return createHostObject(runtime, map);
+                }));
+
+        // PersistentSortedMap.count(map)
+        mapFactory.setProperty(
+            rt, "count",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "count"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto map = hostArg<PersistentSortedMapHostObject>(
+                        runtime, args, count, 0, "count", "PersistentSortedMap");
+                    return facebook::jsi::Value(static_cast<double>(map->size()));
+                }));
+
+        // PersistentSortedMap.get(map, key)
+        mapFactory.setProperty(
+            rt, "get",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "get"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto map = hostArg<PersistentSortedMapHostObject>(
+                        runtime, args, count, 0, "get", "PersistentSortedMap");
+                    if (count < 2)
+                    {
+                        throw facebook::jsi::JSError(runtime, "get requires a map and key");
+                    }
+                    return map->get(runtime, args[1]);
+                }));
+
+        // PersistentSortedMap.has(map, key)
+        mapFactory.setProperty(
+            rt, "has",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "has"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto map = hostArg<PersistentSortedMapHostObject>(
+                        runtime, args, count, 0, "has", "PersistentSortedMap");
+                    if (count < 2)
+                    {
+                        throw facebook::jsi::JSError(runtime, "has requires a map and key");
+                    }
+                    return facebook::jsi::Value(map->has(runtime, args[1]));
+                }));
+
+        // PersistentSortedMap.assoc(map, key, value)
+        mapFactory.setProperty(
+            rt, "assoc",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "assoc"), 3,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto map = hostArg<PersistentSortedMapHostObject>(
+                        runtime, args, count, 0, "assoc", "PersistentSortedMap");
+                    if (count < 3)
+                    {
+                        throw facebook::jsi::JSError(runtime, "assoc requires a map, key, and value");
+                    }
+                    auto newMap = map->assoc(runtime, args[1], args[2]);
+                    return createHostObject(runtime, newMap);
+                }));
+
+        // PersistentSortedMap.dissoc(map, key)
+        mapFactory.setProperty(
+            rt, "dissoc",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "dissoc"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto map = hostArg<PersistentSortedMapHostObject>(
+                        runtime, args, count, 0, "dissoc", "PersistentSortedMap");
+                    if (count < 2)
+                    {
+                        throw facebook::jsi::JSError(runtime, "dissoc requires a map and key");
+                    }
+                    auto newMap = map->dissoc(runtime, args[1]);
+                    return createHostObject(runtime, newMap);
+                }));
+
+        // PersistentSortedMap.nearest(map, test, key) - [k, v] closest to key
+        // under test ("<", "<=", ">=", ">"), or undefined
+        mapFactory.setProperty(
+            rt, "nearest",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "nearest"), 3,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto map = hostArg<PersistentSortedMapHostObject>(
+                        runtime, args, count, 0, "nearest", "PersistentSortedMap");
+                    if (count < 3 || !args[1].isString())
+                    {
+                        throw facebook::jsi::JSError(runtime, "nearest requires a map, test, and key");
+                    }
+                    return map->nearest(runtime, args[1].getString(runtime).utf8(runtime), args[2]);
+                }));
+
+        // PersistentSortedMap.range(map, lo, loInclusive, hi, hiInclusive, reverse)
+        // - Iterator over entries between lo and hi (undefined = unbounded)
+        mapFactory.setProperty(
+            rt, "range",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "range"), 6,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto map = hostArg<PersistentSortedMapHostObject>(
+                        runtime, args, count, 0, "range", "PersistentSortedMap");
+                    const facebook::jsi::Value unbounded;
+                    auto it = map->range(runtime,
+                                         count > 1 ? args[1] : unbounded,
+                                         boolArg(args, count, 2, true),
+                                         count > 3 ? args[3] : unbounded,
+                                         boolArg(args, count, 4, true),
+                                         boolArg(args, count, 5, false));
+                    return createHostObject(runtime, it);
+                }));
+
+        installRangeIterator(rt, mapFactory, "PersistentSortedMap");
+
+        // PersistentSortedMap.equiv(map1, map2)
+        mapFactory.setProperty(
+            rt, "equiv",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "equiv"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto map = hostArg<PersistentSortedMapHostObject>(
+                        runtime, args, count, 0, "equiv", "PersistentSortedMap");
+                    if (count < 2)
+                    {
+                        throw facebook::jsi::JSError(runtime, "equiv requires two map arguments");
+                    }
+                    return facebook::jsi::Value(map->equiv(runtime, args[1]));
+                }));
+
+        // PersistentSortedMap.hashUnordered(map) - cljs-compatible hash, cached
+        mapFactory.setProperty(
+            rt, "hashUnordered",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "hashUnordered"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto map = hostArg<PersistentSortedMapHostObject>(
+                        runtime, args, count, 0, "hashUnordered", "PersistentSortedMap");
+                    return facebook::jsi::Value(map->hashUnordered(runtime));
+                }));
+
+        // Create the PersistentSortedSet factory object
+        facebook::jsi::Object setFactory(rt);
+
+        // PersistentSortedSet.empty(comparator?) - Create an empty sorted set
+        setFactory.setProperty(
+            rt, "empty",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "empty"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = std::make_shared<PersistentSortedSetHostObject>(
+                        SortedTree(), comparatorArg(runtime, args, count, 0));
+                    return createHostObject(runtime, set);
+                }));
+
+        // PersistentSortedSet.from(array, comparator?) - Sort and bulk-load
+        setFactory.setProperty(
+            rt, "from",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "from"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto arr = arrayArg(runtime, args, count, 0, "PersistentSortedSet.from");
+                    auto set = PersistentSortedSetHostObject::fromArray(
+                        runtime, arr, comparatorArg(runtime, args, count, 1));
+                    return createHostObject(runtime, set);
+                }));
+
+        // PersistentSortedSet.count(set)
+        setFactory.setProperty(
+            rt, "count",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "count"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = hostArg<PersistentSortedSetHostObject>(
+                        runtime, args, count, 0, "count", "PersistentSortedSet");
+                    return facebook::jsi::Value(static_cast<double>(set->size()));
+                }));
+
+        // PersistentSortedSet.has(set, value)
+        setFactory.setProperty(
+            rt, "has",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "has"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = hostArg<PersistentSortedSetHostObject>(
+                        runtime, args, count, 0, "has", "PersistentSortedSet");
+                    if (count < 2)
+                    {
+                        throw facebook::jsi::JSError(runtime, "has requires a set and value");
+                    }
+                    return facebook::jsi::Value(set->has(runtime, args[1]));
+                }));
+
+        // PersistentSortedSet.conj(set, value)
+        setFactory.setProperty(
+            rt, "conj",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "conj"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = hostArg<PersistentSortedSetHostObject>(
+                        runtime, args, count, 0, "conj", "PersistentSortedSet");
+                    if (count < 2)
+                    {
+                        throw facebook::jsi::JSError(runtime, "conj requires a set and value");
+                    }
+                    auto newSet = set->conj(runtime, args[1]);
+                    return createHostObject(runtime, newSet);
+                }));
+
+        // PersistentSortedSet.disj(set, value)
+        setFactory.setProperty(
+            rt, "disj",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "disj"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = hostArg<PersistentSortedSetHostObject>(
+                        runtime, args, count, 0, "disj", "PersistentSortedSet");
+                    if (count < 2)
+                    {
+                        throw facebook::jsi::JSError(runtime, "disj requires a set and value");
+                    }
+                    auto newSet = set->disj(runtime, args[1]);
+                    return createHostObject(runtime, newSet);
+                }));
+
+        // PersistentSortedSet.nearest(set, test, value) - Closest element, or undefined
+        setFactory.setProperty(
+            rt, "nearest",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "nearest"), 3,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = hostArg<PersistentSortedSetHostObject>(
+                        runtime, args, count, 0, "nearest", "PersistentSortedSet");
+                    if (count < 3 || !args[1].isString())
+                    {
+                        throw facebook::jsi::JSError(runtime, "nearest requires a set, test, and value");
+                    }
+                    return set->nearest(runtime, args[1].getString(runtime).utf8(runtime), args[2]);
+                }));
+
+        // PersistentSortedSet.range(set, lo, loInclusive, hi, hiInclusive, reverse)
+        setFactory.setProperty(
+            rt, "range",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "range"), 6,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = hostArg<PersistentSortedSetHostObject>(
+                        runtime, args, count, 0, "range", "PersistentSortedSet");
+                    const facebook::jsi::Value unbounded;
+                    auto it = set->range(runtime,
+                                         count > 1 ? args[1] : unbounded,
+                                         boolArg(args, count, 2, true),
+                                         count > 3 ? args[3] : unbounded,
+                                         boolArg(args, count, 4, true),
+                                         boolArg(args, count, 5, false));
+                    return createHostObject(runtime, it);
+                }));
+
+        installRangeIterator(rt, setFactory, "PersistentSortedSet");
+
+        // PersistentSortedSet.equiv(set1, set2)
+        setFactory.setProperty(
+            rt, "equiv",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "equiv"), 2,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = hostArg<PersistentSortedSetHostObject>(
+                        runtime, args, count, 0, "equiv", "PersistentSortedSet");
+                    if (count < 2)
+                    {
+                        throw facebook::jsi::JSError(runtime, "equiv requires two set arguments");
+                    }
+                    return facebook::jsi::Value(set->equiv(runtime, args[1]));
+                }));
+
+        // PersistentSortedSet.hashUnordered(set) - cljs-compatible hash, cached
+        setFactory.setProperty(
+            rt, "hashUnordered",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "hashUnordered"), 1,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    auto set = hostArg<PersistentSortedSetHostObject>(
+                        runtime, args, count, 0, "hashUnordered", "PersistentSortedSet");
+                    return facebook::jsi::Value(set->hashUnordered(runtime));
+                }));
+
+        // Install the factory objects as globalThis.PersistentSortedMap / PersistentSortedSet
+        rt.global().setProperty(rt, "PersistentSortedMap", mapFactory);
+        rt.global().setProperty(rt, "PersistentSortedSet", setFactory);
+    }
+
+} // namespace cljs
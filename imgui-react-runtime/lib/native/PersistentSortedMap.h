@@ -0,0 +1,213 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <hermes/hermes.h>
+#include <jsi/jsi.h>
+
+#include "PersistentBTree.h"
+#include "StoredValue.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace cljs
+{
+
+    using SortedTree = PersistentBTree<StoredValue, StoredValue>;
+
+    /**
+     * Key ordering for sorted collections.
+     *
+     * Without a comparator keys use StoredValue::operator<: nil, booleans,
+     * numbers and strings order naturally, and keywords/symbols (interned
+     * via the key handlers) order by their printed form. Other object keys
+     * need a comparator, and are rejected with a JSError without one: a JS
+     * function returning a negative number, zero or a positive number (or a
+     * boolean "less than" predicate).
+     */
+    struct SortedKeyLess
+    {
+        facebook::jsi::Runtime &rt;
+        const facebook::jsi::Function *comparator;
+
+        bool operator()(const StoredValue &a, const StoredValue &b) const;
+    };
+
+    /**
+     * SortedRangeIteratorHostObject walks a sorted tree between two bounds,
+     * in either direction, handing out up to kChunkSize entries per call.
+     *
+     * Operations:
+     * - nextChunk() - Returns the next flat [k0, v0, k1, v1, ...] array (or
+     *   [k0, k1, ...] for sets), or undefined when exhausted
+     */
+    class SortedRangeIteratorHostObject : public facebook::jsi::HostObject
+    {
+    public:
+        static constexpr size_t kChunkSize = 32;
+
+        SortedRangeIteratorHostObject(SortedTree tree,
+                                      std::shared_ptr<facebook::jsi::Function> comparator,
+                                      bool withValues);
+
+        // HostObject interface
+        facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                                 const facebook::jsi::PropNameID &name) override;
+
+        // Positions the iterator; bounds are optional, reverse walks hi -> lo
+        void seek(facebook::jsi::Runtime &rt, std::optional<StoredValue> lo, bool loInclusive,
+                  std::optional<StoredValue> hi, bool hiInclusive, bool reverse);
+
+        facebook::jsi::Value nextChunk(facebook::jsi::Runtime &rt);
+
+    private:
+        // Keeps the nodes cursor_ points into alive
+        SortedTree tree_;
+        std::shared_ptr<facebook::jsi::Function> comparator_;
+        bool withValues_;
+        SortedTree::Cursor cursor_;
+        std::optional<StoredValue> stop_;
+        bool stopInclusive_ = true;
+        bool reverse_ = false;
+    };
+
+    /**
+     * PersistentSortedMapHostObject wraps a persistent B+ tree to provide a
+     * ClojureScript-compatible sorted map (like sorted-map / sorted-map-by).
+     *
+     * Operations:
+     * - size() - Returns the number of entries
+     * - get(key) / has(key) - O(log n) lookup
+     * - assoc(key, value) / dissoc(key) - O(log n) updates
+     * - nearest(test, key) - Closest entry <, <=, >= or > key
+     * - range(lo, loInclusive, hi, hiInclusive, reverse) - Chunked iterator
+     *   over the entries between two (optional) keys
+     */
+    class PersistentSortedMapHostObject : public facebook::jsi::HostObject
+    {
+    public:
+        PersistentSortedMapHostObject(SortedTree tree,
+                                      std::shared_ptr<facebook::jsi::Function> comparator);
+
+        // Factory methods
+        static std::shared_ptr<PersistentSortedMapHostObject>
+        fromEntries(facebook::jsi::Runtime &rt, const facebook::jsi::Array &entries,
+                    std::shared_ptr<facebook::jsi::Function> comparator);
+
+        // HostObject interface
+        facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                                 const facebook::jsi::PropNameID &name) override;
+        void set(facebook::jsi::Runtime &rt, const facebook::jsi::PropNameID &name,
+                 const facebook::jsi::Value &value) override;
+        std::vector<facebook::jsi::PropNameID>
+        getPropertyNames(facebook::jsi::Runtime &rt) override;
+
+        // Map operations
+        size_t size() const;
+        facebook::jsi::Value get(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key) const;
+        bool has(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key) const;
+        bool equiv(facebook::jsi::Runtime &rt, const facebook::jsi::Value &other) const;
+        std::shared_ptr<PersistentSortedMapHostObject>
+        assoc(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key,
+              const facebook::jsi::Value &value) const;
+        std::shared_ptr<PersistentSortedMapHostObject>
+        dissoc(facebook::jsi::Runtime &rt, const facebook::jsi::Value &key) const;
+
+        // Range queries
+        facebook::jsi::Value nearest(facebook::jsi::Runtime &rt, const std::string &test,
+                                     const facebook::jsi::Value &key) const;
+        std::shared_ptr<SortedRangeIteratorHostObject>
+        range(facebook::jsi::Runtime &rt, const facebook::jsi::Value &lo, bool loInclusive,
+              const facebook::jsi::Value &hi, bool hiInclusive, bool reverse) const;
+
+        // cljs.core/hash-unordered-coll over entries, cached after the first call
+        int32_t hashUnordered(facebook::jsi::Runtime &rt) const;
+
+        const SortedTree &getTree() const { return tree_; }
+
+    private:
+        SortedKeyLess less(facebook::jsi::Runtime &rt) const { return {rt, comparator_.get()}; }
+
+        SortedTree tree_;
+        std::shared_ptr<facebook::jsi::Function> comparator_;
+        mutable std::optional<int32_t> hash_;
+    };
+
+    /**
+     * PersistentSortedSetHostObject is the set counterpart of
+     * PersistentSortedMapHostObject (like sorted-set / sorted-set-by). It
+     * shares the tree implementation, storing nil as every value.
+     *
+     * Operations:
+     * - size(), has(value), conj(value), disj(value)
+     * - nearest(test, value) - Closest element <, <=, >= or > value
+     * - range(lo, loInclusive, hi, hiInclusive, reverse) - Chunked iterator
+     */
+    class PersistentSortedSetHostObject : public facebook::jsi::HostObject
+    {
+    public:
+        PersistentSortedSetHostObject(SortedTree tree,
+                                      std::shared_ptr<facebook::jsi::Function> comparator);
+
+        // Factory methods
+        static std::shared_ptr<PersistentSortedSetHostObject>
+        fromArray(facebook::jsi::Runtime &rt, const facebook::jsi::Array &arr,
+                  std::shared_ptr<facebook::jsi::Function> comparator);
+
+        // HostObject interface
+        facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                                 const facebook::jsi::PropNameID &name) override;
+        void set(facebook::jsi::Runtime &rt, const facebook::jsi::PropNameID &name,
+                 const facebook::jsi::Value &value) override;
+        std::vector<facebook::jsi::PropNameID>
+        getPropertyNames(facebook::jsi::Runtime &rt) override;
+
+        // Set operations
+        size_t size() const;
+        bool has(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value) const;
+        bool equiv(facebook::jsi::Runtime &rt, const facebook::jsi::Value &other) const;
+        std::shared_ptr<PersistentSortedSetHostObject>
+        conj(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value) const;
+        std::shared_ptr<PersistentSortedSetHostObject>
+        disj(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value) const;
+
+        // Range queries
+        facebook::jsi::Value nearest(facebook::jsi::Runtime &rt, const std::string &test,
+                                     const facebook::jsi::Value &value) const;
+        std::shared_ptr<SortedRangeIteratorHostObject>
+        range(facebook::jsi::Runtime &rt, const facebook::jsi::Value &lo, bool loInclusive,
+              const facebook::jsi::Value &hi, bool hiInclusive, bool reverse) const;
+
+        // cljs.core/hash-unordered-coll, cached after the first call
+        int32_t hashUnordered(facebook::jsi::Runtime &rt) const;
+
+        const SortedTree &getTree() const { return tree_; }
+
+    private:
+        SortedKeyLess less(facebook::jsi::Runtime &rt) const { return {rt, comparator_.get()}; }
+
+        SortedTree tree_;
+        std::shared_ptr<facebook::jsi::Function> comparator_;
+        mutable std::optional<int32_t> hash_;
+    };
+
+    /**
+     * Install the PersistentSortedMap and PersistentSortedSet factory objects
+     * into the JavaScript runtime. After calling this, JavaScript code can use:
+     *
+     *   const m = PersistentSortedMap.fromEntries([[3, "c"], [1, "a"]]);
+     *   const it = PersistentSortedMap.range(m, 1, true, 2, false, false);
+     *   const s = PersistentSortedSet.from([5, 1, 3], (a, b) => b - a);
+     *
+     * The same operations are methods on the collections and iterators:
+     *
+     *   m.get(3);                          // "c"
+     *   const chunk = m.range(1, true, undefined, true, false).nextChunk();
+     */
+    void installPersistentSortedMap(facebook::jsi::Runtime &rt);
+
+} // namespace cljs
@@ -0,0 +1,823 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "PersistentTable.h"
+#include "HostArgs.h"
+#include "MethodTable.h"
+#include "NativeMemory.h"
+#include "StringTable.h"
+
+#include <immer/flex_vector_transient.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <type_traits>
+
+namespace cljs
+{
+
+  namespace
+  {
+    using Column = PersistentTableHostObject::Column;
+
+    const char *typeName(ColumnType type)
+    {
+      switch (type)
+      {
+      case ColumnType::Float64:
+        return "float64";
+      case ColumnType::Int32:
+        return "int32";
+      case ColumnType::String:
+        return "string";
+      }
+      return "unknown";
+    }
+
+    [[noreturn]] void throwCellType(facebook::jsi::Runtime &rt, const ColumnSpec &spec)
+    {
+      std::ostringstream msg;
+      msg << "PersistentTable column '" << spec.name << "' holds "
+          << (spec.type == ColumnType::String ? "strings or null" : "numbers");
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+
+    // One JS value converted to a column's element type
+    template <typename T>
+    T convertCell(facebook::jsi::Runtime &rt, const ColumnSpec &spec,
+                  const facebook::jsi::Value &value);
+
+    template <>
+    double convertCell<double>(facebook::jsi::Runtime &rt, const ColumnSpec &spec,
+                               const facebook::jsi::Value &value)
+    {
+      if (!value.isNumber())
+      {
+        throwCellType(rt, spec);
+      }
+      return value.getNumber();
+    }
+
+    template <>
+    int32_t convertCell<int32_t>(facebook::jsi::Runtime &rt, const ColumnSpec &spec,
+                                 const facebook::jsi::Value &value)
+    {
+      if (!value.isNumber())
+      {
+        throwCellType(rt, spec);
+      }
+      return toInt32(value.getNumber());
+    }
+
+    template <>
+    StoredValue convertCell<StoredValue>(facebook::jsi::Runtime &rt, const ColumnSpec &spec,
+                                         const facebook::jsi::Value &value)
+    {
+      if (value.isString())
+      {
+        return internString(value.getString(rt).utf8(rt));
+      }
+      if (value.isNull() || value.isUndefined())
+      {
+        return StoredValue();
+      }
+      throwCellType(rt, spec);
+    }
+
+    facebook::jsi::Value cellToJS(facebook::jsi::Runtime &, double d)
+    {
+      return facebook::jsi::Value(d);
+    }
+
+    facebook::jsi::Value cellToJS(facebook::jsi::Runtime &, int32_t i)
+    {
+      return facebook::jsi::Value(static_cast<double>(i));
+    }
+
+    facebook::jsi::Value cellToJS(facebook::jsi::Runtime &rt, const StoredValue &stored)
+    {
+      if (stored.type() == StoredValue::STRING)
+      {
+        return stringToJS(rt, stored);
+      }
+      return facebook::jsi::Value::null();
+    }
+
+    // A numeric column flattened into one contiguous array, counted as
+    // native memory like the nodes it was copied from
+    template <typename T>
+    class FlatColumn : public facebook::jsi::MutableBuffer
+    {
+    public:
+      explicit FlatColumn(const immer::flex_vector<T, NativeMemoryPolicy> &vec)
+          : data_(vec.size())
+      {
+        T *out = data_.data();
+        immer::for_each_chunk(vec, [&](const T *first, const T *last)
+                              { out = std::copy(first, last, out); });
+        detail::nativeBytes().allocate(size());
+      }
+
+      ~FlatColumn() override { detail::nativeBytes().free(size()); }
+
+      size_t size() const override { return data_.size() * sizeof(T); }
+      uint8_t *data() override { return reinterpret_cast<uint8_t *>(data_.data()); }
+
+    private:
+      std::vector<T> data_;
+    };
+
+    std::optional<facebook::jsi::ArrayBuffer> arrayBufferArg(facebook::jsi::Runtime &rt,
+                                                             const facebook::jsi::Value &value)
+    {
+      if (value.isObject())
+      {
+        auto obj = value.getObject(rt);
+        if (obj.isArrayBuffer(rt))
+        {
+          return obj.getArrayBuffer(rt);
+        }
+      }
+      return std::nullopt;
+    }
+
+    // A column of type V built from a JS array, a native vector of the same
+    // element type (shared) or, for numeric columns, an ArrayBuffer
+    template <typename V>
+    V columnFrom(facebook::jsi::Runtime &rt, const ColumnSpec &spec,
+                 const facebook::jsi::Value &value)
+    {
+      using T = typename V::value_type;
+      if (value.isObject())
+      {
+        auto obj = value.getObject(rt);
+        if (obj.isArray(rt))
+        {
+          auto arr = obj.getArray(rt);
+          auto transient = V{}.transient();
+          size_t length = arr.size(rt);
+          for (size_t i = 0; i < length; ++i)
+          {
+            transient.push_back(convertCell<T>(rt, spec, arr.getValueAtIndex(rt, i)));
+          }
+          return transient.persistent();
+        }
+        if constexpr (std::is_same_v<T, StoredValue>)
+        {
+          if (obj.isHostObject<PersistentVectorHostObject>(rt))
+          {
+            const auto &vec = obj.getHostObject<PersistentVectorHostObject>(rt)->getVector();
+            for (const auto &stored : vec)
+            {
+              if (stored.type() != StoredValue::STRING && stored.type() != StoredValue::NIL)
+              {
+                throwCellType(rt, spec);
+              }
+            }
+            return vec;
+          }
+        }
+        else
+        {
+          if (obj.isHostObject<TypedVectorHostObject<T>>(rt))
+          {
+            return obj.getHostObject<TypedVectorHostObject<T>>(rt)->getVector();
+          }
+          if (obj.isArrayBuffer(rt))
+          {
+            return TypedVectorHostObject<T>::fromArrayBuffer(rt, obj.getArrayBuffer(rt), 0,
+                                                             std::nullopt)
+                ->getVector();
+          }
+        }
+      }
+
+      std::ostringstream msg;
+      msg << "PersistentTable.fromColumns: column '" << spec.name
+          << "' must be an array or a " << typeName(spec.type) << " vector";
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+
+    size_t columnSize(const Column &column)
+    {
+      return std::visit([](const auto &vec)
+                        { return vec.size(); },
+                        column.values);
+    }
+  } // namespace
+
+  PersistentTableHostObject::PersistentTableHostObject(Schema schema, Columns columns,
+                                                       size_t rows)
+      : schema_(std::move(schema)), columns_(std::move(columns)), rows_(rows) {}
+
+  PersistentTableHostObject::Schema
+  PersistentTableHostObject::parseSchema(facebook::jsi::Runtime &rt,
+                                         const facebook::jsi::Array &spec)
+  {
+    auto schema = std::make_shared<std::vector<ColumnSpec>>();
+    size_t length = spec.size(rt);
+    schema->reserve(length);
+    for (size_t i = 0; i < length; ++i)
+    {
+      auto entry = spec.getValueAtIndex(rt, i);
+      if (!entry.isObject())
+      {
+        throw facebook::jsi::JSError(
+            rt, "PersistentTable schema entries must be { name, type } objects");
+      }
+      auto obj = entry.getObject(rt);
+      auto name = obj.getProperty(rt, "name");
+      auto type = obj.getProperty(rt, "type");
+      if (!name.isString() || !type.isString())
+      {
+        throw facebook::jsi::JSError(
+            rt, "PersistentTable schema entries need a string name and type");
+      }
+
+      ColumnSpec column{name.getString(rt).utf8(rt), ColumnType::Float64};
+      std::string typeStr = type.getString(rt).utf8(rt);
+      if (typeStr == "float64")
+      {
+        column.type = ColumnType::Float64;
+      }
+      else if (typeStr == "int32")
+      {
+        column.type = ColumnType::Int32;
+      }
+      else if (typeStr == "string")
+      {
+        column.type = ColumnType::String;
+      }
+      else
+      {
+        throw facebook::jsi::JSError(rt, "PersistentTable column '" + column.name +
+                                             "' has unknown type '" + typeStr +
+                                             "' (expected float64, int32 or string)");
+      }
+
+      for (const auto &existing : *schema)
+      {
+        if (existing.name == column.name)
+        {
+          throw facebook::jsi::JSError(rt, "PersistentTable column '" + column.name +
+                                               "' is defined twice");
+        }
+      }
+      schema->push_back(std::move(column));
+    }
+    return schema;
+  }
+
+  std::shared_ptr<PersistentTableHostObject> PersistentTableHostObject::empty(Schema schema)
+  {
+    Columns columns;
+    columns.reserve(schema->size());
+    for (const auto &spec : *schema)
+    {
+      auto column = std::make_shared<Column>();
+      switch (spec.type)
+      {
+      case ColumnType::Float64:
+        column->values = Float64Column{};
+        break;
+      case ColumnType::Int32:
+        column->values = Int32Column{};
+        break;
+      case ColumnType::String:
+        column->values = StringColumn{};
+        break;
+      }
+      columns.push_back(std::move(column));
+    }
+    return std::make_shared<PersistentTableHostObject>(std::move(schema), std::move(columns), 0);
+  }
+
+  std::shared_ptr<PersistentTableHostObject>
+  PersistentTableHostObject::fromColumns(facebook::jsi::Runtime &rt, Schema schema,
+                                         const facebook::jsi::Array &columns)
+  {
+    if (columns.size(rt) != schema->size())
+    {
+      std::ostringstream msg;
+      msg << "PersistentTable.fromColumns: got " << columns.size(rt) << " columns for a schema of "
+          << schema->size();
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+
+    Columns result;
+    result.reserve(schema->size());
+    size_t rows = 0;
+    for (size_t i = 0; i < schema->size(); ++i)
+    {
+      const auto &spec = (*schema)[i];
+      auto value = columns.getValueAtIndex(rt, i);
+      auto column = std::make_shared<Column>();
+      switch (spec.type)
+      {
+      case ColumnType::Float64:
+        column->values = columnFrom<Float64Column>(rt, spec, value);
+        break;
+      case ColumnType::Int32:
+        column->values = columnFrom<Int32Column>(rt, spec, value);
+        break;
+      case ColumnType::String:
+        column->values = columnFrom<StringColumn>(rt, spec, value);
+        break;
+      }
+
+      size_t size = columnSize(*column);
+      if (i == 0)
+      {
+        rows = size;
+      }
+      else if (size != rows)
+      {
+        std::ostringstream msg;
+        msg << "PersistentTable.fromColumns: column '" << spec.name << "' has " << size
+            << " rows, expected " << rows;
+        throw facebook::jsi::JSError(rt, msg.str());
+      }
+      result.push_back(std::move(column));
+    }
+    return std::make_shared<PersistentTableHostObject>(std::move(schema), std::move(result), rows);
+  }
+
+  facebook::jsi::Value PersistentTableHostObject::get(facebook::jsi::Runtime &rt,
+                                                      const facebook::jsi::PropNameID &name)
+  {
+    return MethodTable<PersistentTableHostObject>::forRuntime(rt).get(rt, *this, name);
+  }
+
+  std::vector<facebook::jsi::PropNameID>
+  PersistentTableHostObject::getPropertyNames(facebook::jsi::Runtime &rt)
+  {
+    return MethodTable<PersistentTableHostObject>::forRuntime(rt).names(rt);
+  }
+
+  size_t PersistentTableHostObject::columnIndex(facebook::jsi::Runtime &rt,
+                                                const facebook::jsi::Value &col) const
+  {
+    if (col.isNumber())
+    {
+      double index = col.getNumber();
+      if (index >= 0 && index < static_cast<double>(schema_->size()))
+      {
+        return static_cast<size_t>(index);
+      }
+      std::ostringstream msg;
+      msg << "Column " << index << " out of bounds for table of " << schema_->size()
+          << " columns";
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    if (col.isString())
+    {
+      std::string name = col.getString(rt).utf8(rt);
+      for (size_t i = 0; i < schema_->size(); ++i)
+      {
+        if ((*schema_)[i].name == name)
+        {
+          return i;
+        }
+      }
+      throw facebook::jsi::JSError(rt, "PersistentTable has no column '" + name + "'");
+    }
+    throw facebook::jsi::JSError(rt, "PersistentTable columns are given by index or name");
+  }
+
+  facebook::jsi::Array PersistentTableHostObject::columnNames(facebook::jsi::Runtime &rt) const
+  {
+    facebook::jsi::Array result(rt, schema_->size());
+    for (size_t i = 0; i < schema_->size(); ++i)
+    {
+      result.setValueAtIndex(rt, i, facebook::jsi::String::createFromUtf8(rt, (*schema_)[i].name));
+    }
+    return result;
+  }
+
+  void PersistentTableHostObject::checkRow(facebook::jsi::Runtime &rt, size_t row) const
+  {
+    if (row >= rows_)
+    {
+      std::ostringstream msg;
+      msg << "Row " << row << " out of bounds for table of " << rows_ << " rows";
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+  }
+
+  std::vector<std::optional<facebook::jsi::Value>>
+  PersistentTableHostObject::readRow(facebook::jsi::Runtime &rt,
+                                     const facebook::jsi::Value &values) const
+  {
+    if (!values.isObject())
+    {
+      throw facebook::jsi::JSError(rt, "PersistentTable rows must be arrays or objects");
+    }
+
+    std::vector<std::optional<facebook::jsi::Value>> result(schema_->size());
+    auto obj = values.getObject(rt);
+    if (obj.isArray(rt))
+    {
+      auto arr = obj.getArray(rt);
+      size_t n = std::min(arr.size(rt), schema_->size());
+      for (size_t i = 0; i < n; ++i)
+      {
+        auto value = arr.getValueAtIndex(rt, i);
+        if (!value.isUndefined())
+        {
+          result[i] = std::move(value);
+        }
+      }
+    }
+    else
+    {
+      for (size_t i = 0; i < schema_->size(); ++i)
+      {
+        auto value = obj.getProperty(rt, (*schema_)[i].name.c_str());
+        if (!value.isUndefined())
+        {
+          result[i] = std::move(value);
+        }
+      }
+    }
+    return result;
+  }
+
+  facebook::jsi::Value PersistentTableHostObject::cell(facebook::jsi::Runtime &rt, size_t row,
+                                                       size_t col) const
+  {
+    checkRow(rt, row);
+    return std::visit([&](const auto &vec)
+                      { return cellToJS(rt, vec[row]); },
+                      columns_[col]->values);
+  }
+
+  std::shared_ptr<PersistentTableHostObject>
+  PersistentTableHostObject::setCell(facebook::jsi::Runtime &rt, size_t row, size_t col,
+                                     const facebook::jsi::Value &value) const
+  {
+    checkRow(rt, row);
+    const auto &spec = (*schema_)[col];
+    auto column = std::make_shared<Column>();
+    std::visit([&](const auto &vec)
+               {
+      using T = typename std::decay_t<decltype(vec)>::value_type;
+      column->values = vec.set(row, convertCell<T>(rt, spec, value)); },
+               columns_[col]->values);
+
+    Columns columns = columns_;
+    columns[col] = std::move(column);
+    return std::make_shared<PersistentTableHostObject>(schema_, std::move(columns), rows_);
+  }
+
+  facebook::jsi::Array PersistentTableHostObject::row(facebook::jsi::Runtime &rt,
+                                                      size_t row) const
+  {
+    checkRow(rt, row);
+    facebook::jsi::Array result(rt, columns_.size());
+    for (size_t i = 0; i < columns_.size(); ++i)
+    {
+      result.setValueAtIndex(rt, i, std::visit([&](const auto &vec)
+                                               { return cellToJS(rt, vec[row]); },
+                                               columns_[i]->values));
+    }
+    return result;
+  }
+
+  std::shared_ptr<PersistentTableHostObject>
+  PersistentTableHostObject::setRow(facebook::jsi::Runtime &rt, size_t row,
+                                    const facebook::jsi::Value &values) const
+  {
+    checkRow(rt, row);
+    auto cells = readRow(rt, values);
+
+    Columns columns = columns_;
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+      if (!cells[i])
+      {
+        continue;
+      }
+      const auto &spec = (*schema_)[i];
+      auto column = std::make_shared<Column>();
+      std::visit([&](const auto &vec)
+                 {
+        using T = typename std::decay_t<decltype(vec)>::value_type;
+        column->values = vec.set(row, convertCell<T>(rt, spec, *cells[i])); },
+                 columns_[i]->values);
+      columns[i] = std::move(column);
+    }
+    return std::make_shared<PersistentTableHostObject>(schema_, std::move(columns), rows_);
+  }
+
+  std::shared_ptr<PersistentTableHostObject>
+  PersistentTableHostObject::appendRows(facebook::jsi::Runtime &rt,
+                                        const facebook::jsi::Array &rows) const
+  {
+    using Transient = std::variant<Float64Column::transient_type, Int32Column::transient_type,
+                                   StringColumn::transient_type>;
+    std::vector<Transient> transients;
+    transients.reserve(columns_.size());
+    for (const auto &column : columns_)
+    {
+      std::visit([&](const auto &vec)
+                 { transients.emplace_back(vec.transient()); },
+                 column->values);
+    }
+
+    size_t length = rows.size(rt);
+    for (size_t r = 0; r < length; ++r)
+    {
+      auto cells = readRow(rt, rows.getValueAtIndex(rt, r));
+      for (size_t i = 0; i < transients.size(); ++i)
+      {
+        const auto &spec = (*schema_)[i];
+        std::visit([&](auto &transient)
+                   {
+          using T = typename std::decay_t<decltype(transient)>::value_type;
+          transient.push_back(cells[i] ? convertCell<T>(rt, spec, *cells[i]) : T{}); },
+                   transients[i]);
+      }
+    }
+
+    Columns columns;
+    columns.reserve(transients.size());
+    for (auto &transient : transients)
+    {
+      auto column = std::make_shared<Column>();
+      std::visit([&](auto &t)
+                 { column->values = t.persistent(); },
+                 transient);
+      columns.push_back(std::move(column));
+    }
+    return std::make_shared<PersistentTableHostObject>(schema_, std::move(columns), rows_ + length);
+  }
+
+  std::shared_ptr<PersistentTableHostObject>
+  PersistentTableHostObject::slice(facebook::jsi::Runtime &rt, size_t start, size_t end) const
+  {
+    if (start > end || end > rows_)
+    {
+      std::ostringstream msg;
+      msg << "Slice [" << start << ", " << end << ") out of bounds for table of " << rows_
+          << " rows";
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    if (start == 0 && end == rows_)
+    {
+      return std::make_shared<PersistentTableHostObject>(schema_, columns_, rows_);
+    }
+
+    Columns columns;
+    columns.reserve(columns_.size());
+    for (const auto &column : columns_)
+    {
+      auto sliced = std::make_shared<Column>();
+      std::visit([&](const auto &vec)
+                 { sliced->values = vec.take(end).drop(start); },
+                 column->values);
+      columns.push_back(std::move(sliced));
+    }
+    return std::make_shared<PersistentTableHostObject>(schema_, std::move(columns), end - start);
+  }
+
+  std::shared_ptr<PersistentTableHostObject>
+  PersistentTableHostObject::selectColumns(facebook::jsi::Runtime &rt,
+                                           const facebook::jsi::Array &cols) const
+  {
+    auto schema = std::make_shared<std::vector<ColumnSpec>>();
+    Columns columns;
+    size_t length = cols.size(rt);
+    schema->reserve(length);
+    columns.reserve(length);
+    for (size_t i = 0; i < length; ++i)
+    {
+      size_t col = columnIndex(rt, cols.getValueAtIndex(rt, i));
+      for (const auto &existing : *schema)
+      {
+        if (existing.name == (*schema_)[col].name)
+        {
+          throw facebook::jsi::JSError(rt, "selectColumns: column '" + existing.name +
+                                               "' is selected twice");
+        }
+      }
+      schema->push_back((*schema_)[col]);
+      columns.push_back(columns_[col]);
+    }
+    return std::make_shared<PersistentTableHostObject>(std::move(schema), std::move(columns), rows_);
+  }
+
+  facebook::jsi::Value PersistentTableHostObject::column(facebook::jsi::Runtime &rt,
+                                                         size_t col) const
+  {
+    return std::visit([&](const auto &vec) -> facebook::jsi::Value
+                      {
+      using T = typename std::decay_t<decltype(vec)>::value_type;
+      if constexpr (std::is_same_v<T, StoredValue>)
+      {
+        return createHostObject(rt, std::make_shared<PersistentVectorHostObject>(vec));
+      }
+      else
+      {
+        return createHostObject(rt, std::make_shared<TypedVectorHostObject<T>>(vec));
+      } },
+                      columns_[col]->values);
+  }
+
+  size_t PersistentTableHostObject::copyColumnInto(facebook::jsi::Runtime &rt, size_t col,
+                                                   const facebook::jsi::ArrayBuffer &buffer,
+                                                   size_t byteOffset) const
+  {
+    return std::visit([&](const auto &vec) -> size_t
+                      {
+      using T = typename std::decay_t<decltype(vec)>::value_type;
+      if constexpr (std::is_same_v<T, StoredValue>)
+      {
+        throw facebook::jsi::JSError(rt, "copyColumnInto: column '" + (*schema_)[col].name +
+                                             "' holds strings; use column() instead");
+      }
+      else
+      {
+        return TypedVectorHostObject<T>(vec).copyInto(rt, buffer, byteOffset);
+      } },
+                      columns_[col]->values);
+  }
+
+  facebook::jsi::ArrayBuffer PersistentTableHostObject::columnBuffer(facebook::jsi::Runtime &rt,
+                                                                     size_t col) const
+  {
+    // A fresh copy per call: a buffer cached on the column would be shared,
+    // and writable, by every table version holding that column
+    std::shared_ptr<facebook::jsi::MutableBuffer> buffer;
+    std::visit([&](const auto &vec)
+               {
+      using T = typename std::decay_t<decltype(vec)>::value_type;
+      if constexpr (std::is_same_v<T, StoredValue>)
+      {
+        throw facebook::jsi::JSError(rt, "columnBuffer: column '" + (*schema_)[col].name +
+                                             "' holds strings; use column() instead");
+      }
+      else
+      {
+        buffer = std::make_shared<FlatColumn<T>>(vec);
+      } },
+               columns_[col]->values);
+    return facebook::jsi::ArrayBuffer(rt, std::move(buffer));
+  }
+
+  namespace
+  {
+    using Table = PersistentTableHostObject;
+
+    size_t columnArg(facebook::jsi::Runtime &rt, const Table &self,
+                     const facebook::jsi::Value *args, size_t count, size_t i, const char *fn)
+    {
+      if (i >= count)
+      {
+        throw facebook::jsi::JSError(rt, std::string(fn) + " requires a column index or name");
+      }
+      return self.columnIndex(rt, args[i]);
+    }
+
+    facebook::jsi::Array arrayArg(facebook::jsi::Runtime &rt, const facebook::jsi::Value *args,
+                                  size_t count, size_t i, const char *fn)
+    {
+      if (i >= count || !args[i].isObject() || !args[i].getObject(rt).isArray(rt))
+      {
+        throw facebook::jsi::JSError(rt, std::string(fn) + " requires an array argument");
+      }
+      return args[i].getObject(rt).getArray(rt);
+    }
+
+    facebook::jsi::Value wrap(facebook::jsi::Runtime &rt, std::shared_ptr<Table> table)
+    {
+      return createHostObject(rt, std::move(table));
+    }
+
+    // t.get(row, col), t.set(row, col, x), ... - hottest first
+    void installTableMethods(facebook::jsi::Runtime &rt)
+    {
+      using facebook::jsi::Runtime;
+      using facebook::jsi::Value;
+
+      auto &methods = MethodTable<Table>::forRuntime(rt);
+      methods.setTypeName("PersistentTable");
+      methods.getter(rt, "rowCount", [](Runtime &, Table &self)
+                     { return Value(static_cast<double>(self.rowCount())); });
+      methods.getter(rt, "columnCount", [](Runtime &, Table &self)
+                     { return Value(static_cast<double>(self.columnCount())); });
+      methods.method(rt, "get", 2, [](Runtime &runtime, Table &self, const Value *args, size_t count)
+                     {
+                       size_t row = indexArg(runtime, args, count, 0, "get");
+                       return self.cell(runtime, row, columnArg(runtime, self, args, count, 1, "get")); });
+      methods.method(rt, "set", 3, [](Runtime &runtime, Table &self, const Value *args, size_t count)
+                     {
+                       size_t row = indexArg(runtime, args, count, 0, "set");
+                       size_t col = columnArg(runtime, self, args, count, 1, "set");
+                       if (count < 3)
+                       {
+                         throw facebook::jsi::JSError(runtime, "set requires a row, column and value");
+                       }
+                       return wrap(runtime, self.setCell(runtime, row, col, args[2])); });
+      methods.method(rt, "row", 1, [](Runtime &runtime, Table &self, const Value *args, size_t count)
+                     { return Value(runtime, self.row(runtime, indexArg(runtime, args, count, 0, "row"))); });
+      methods.method(rt, "setRow", 2, [](Runtime &runtime, Table &self, const Value *args, size_t count)
+                     {
+                       size_t row = indexArg(runtime, args, count, 0, "setRow");
+                       if (count < 2)
+                       {
+                         throw facebook::jsi::JSError(runtime, "setRow requires a row index and values");
+                       }
+                       return wrap(runtime, self.setRow(runtime, row, args[1])); });
+      methods.method(rt, "columnBuffer", 1, [](Runtime &runtime, Table &self, const Value *args, size_t count)
+                     {
+                       size_t col = columnArg(runtime, self, args, count, 0, "columnBuffer");
+                       return Value(runtime, self.columnBuffer(runtime, col)); });
+      methods.method(rt, "column", 1, [](Runtime &runtime, Table &self, const Value *args, size_t count)
+                     { return self.column(runtime, columnArg(runtime, self, args, count, 0, "column")); });
+      methods.method(rt, "copyColumnInto", 3, [](Runtime &runtime, Table &self, const Value *args, size_t count)
+                     {
+                       size_t col = columnArg(runtime, self, args, count, 0, "copyColumnInto");
+                       auto buffer = count > 1 ? arrayBufferArg(runtime, args[1]) : std::nullopt;
+                       if (!buffer)
+                       {
+                         throw facebook::jsi::JSError(runtime, "copyColumnInto requires an ArrayBuffer argument");
+                       }
+                       size_t byteOffset = count > 2 && !args[2].isUndefined()
+                                               ? indexArg(runtime, args, count, 2, "copyColumnInto")
+                                               : 0;
+                       return Value(static_cast<double>(self.copyColumnInto(runtime, col, *buffer, byteOffset))); });
+      methods.method(rt, "appendRow", 1, [](Runtime &runtime, Table &self, const Value *args, size_t count)
+                     {
+                       if (count < 1)
+                       {
+                         throw facebook::jsi::JSError(runtime, "appendRow requires the row values");
+                       }
+                       facebook::jsi::Array rows(runtime, 1);
+                       rows.setValueAtIndex(runtime, 0, args[0]);
+                       return wrap(runtime, self.appendRows(runtime, rows)); });
+      methods.method(rt, "appendRows", 1, [](Runtime &runtime, Table &self, const Value *args, size_t count)
+                     { return wrap(runtime, self.appendRows(runtime, arrayArg(runtime, args, count, 0, "appendRows"))); });
+      methods.method(rt, "slice", 2, [](Runtime &runtime, Table &self, const Value *args, size_t count)
+                     {
+                       size_t start = indexArg(runtime, args, count, 0, "slice");
+                       size_t end = count > 1 && !args[1].isUndefined()
+                                        ? indexArg(runtime, args, count, 1, "slice")
+                                        : self.rowCount();
+                       return wrap(runtime, self.slice(runtime, start, end)); });
+      methods.method(rt, "selectColumns", 1, [](Runtime &runtime, Table &self, const Value *args, size_t count)
+                     { return wrap(runtime, self.selectColumns(runtime, arrayArg(runtime, args, count, 0, "selectColumns"))); });
+      methods.method(rt, "columnNames", 0, [](Runtime &runtime, Table &self, const Value *, size_t)
+                     { return Value(runtime, self.columnNames(runtime)); });
+      methods.method(rt, "columnType", 1, [](Runtime &runtime, Table &self, const Value *args, size_t count)
+                     {
+                       size_t col = columnArg(runtime, self, args, count, 0, "columnType");
+                       return Value(runtime, facebook::jsi::String::createFromAscii(runtime, typeName(self.spec(col).type))); });
+    }
+  } // namespace
+
+  void installPersistentTable(facebook::jsi::Runtime &rt)
+  {
+    installTableMethods(rt);
+
+    facebook::jsi::Object factory(rt);
+
+    // create(schema, rows?) - An empty table, or one holding rows (arrays in
+    // column order or objects keyed by column name)
+    factory.setProperty(
+        rt, "create",
+        facebook::jsi::Function::createFromHostFunction(
+            rt, facebook::jsi::PropNameID::forAscii(rt, "create"), 2,
+            [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+               const facebook::jsi::Value *args,
+               size_t count) -> facebook::jsi::Value
+            {
+              auto schema = Table::parseSchema(runtime, arrayArg(runtime, args, count, 0, "create"));
+              auto table = Table::empty(std::move(schema));
+              if (count > 1 && !args[1].isUndefined())
+              {
+                table = table->appendRows(runtime, arrayArg(runtime, args, count, 1, "create"));
+              }
+              return wrap(runtime, std::move(table));
+            }));
+
+    // fromColumns(schema, columns) - One array, native vector or ArrayBuffer
+    // per column; native vectors are shared, not copied
+    factory.setProperty(
+        rt, "fromColumns",
+        facebook::jsi::Function::createFromHostFunction(
+            rt, facebook::jsi::PropNameID::forAscii(rt, "fromColumns"), 2,
+            [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+               const facebook::jsi::Value *args,
+               size_t count) -> facebook::jsi::Value
+            {
+              auto schema = Table::parseSchema(runtime, arrayArg(runtime, args, count, 0, "fromColumns"));
+              auto columns = arrayArg(runtime, args, count, 1, "fromColumns");
+              return wrap(runtime, Table::fromColumns(runtime, std::move(schema), columns));
+            }));
+
+    // Install the factory object as globalThis.PersistentTable
+    rt.global().setProperty(rt, "PersistentTable", factory);
+  }
+
+} // namespace cljs
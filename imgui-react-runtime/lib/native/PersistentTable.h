@@ -0,0 +1,148 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <hermes/hermes.h>
+#include <jsi/jsi.h>
+
+#include "PersistentVector.h"
+#include "TypedVector.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace cljs
+{
+
+  enum class ColumnType
+  {
+    Float64,
+    Int32,
+    String
+  };
+
+  struct ColumnSpec
+  {
+    std::string name;
+    ColumnType type;
+  };
+
+  /**
+   * PersistentTableHostObject is an immutable table stored column by column.
+   * Each column is an RRB vector of one element type:
+   * - "float64" - immer::flex_vector<double>, as PersistentVector.float64
+   * - "int32" - immer::flex_vector<int32_t>, as PersistentVector.int32
+   *   (numbers are converted like ToInt32)
+   * - "string" - a PersistentVector of interned strings; null is allowed
+   *
+   * Every update returns a new table. Columns it did not touch are shared
+   * as they are, and a touched column path-copies only the leaf it changed,
+   * so set(row, col, x) is O(log n) and setRow is O(columns * log n).
+   *
+   * Columns are addressed by index or by name; indices skip the name
+   * lookup. Operations (all also methods on the table):
+   * - rowCount, columnCount - Getters
+   * - get(row, col) / set(row, col, value) - One cell
+   * - row(i) - The row as an array in column order
+   * - setRow(i, values) - values is an array in column order, or an object
+   *   keyed by column name (columns it lacks keep their value)
+   * - appendRows(rows) / appendRow(values) - Append through transients;
+   *   columns missing from an object row get 0 or null
+   * - slice(start, end?) - Rows [start, end) of every column, shared
+   * - selectColumns(cols) - A table of some columns, in the given order
+   * - column(col) - The column as a PersistentVector.float64/int32 or
+   *   PersistentVector sharing the table's nodes
+   * - copyColumnInto(col, buffer, byteOffset?) - memcpy each leaf of a
+   *   numeric column into an ArrayBuffer
+   * - columnBuffer(col) - A numeric column flattened into a new
+   *   ArrayBuffer. RRB leaves are not contiguous, so every call copies the
+   *   column; the buffer belongs to the caller and writes to it do not
+   *   affect the table. Use copyColumnInto to reuse a buffer across calls.
+   */
+  class PersistentTableHostObject : public facebook::jsi::HostObject
+  {
+  public:
+    using Float64Column = Float64VectorHostObject::VectorType;
+    using Int32Column = Int32VectorHostObject::VectorType;
+    using StringColumn = PersistentVectorHostObject::VectorType;
+
+    struct Column
+    {
+      std::variant<Float64Column, Int32Column, StringColumn> values;
+    };
+
+    using Schema = std::shared_ptr<const std::vector<ColumnSpec>>;
+    using Columns = std::vector<std::shared_ptr<const Column>>;
+
+    PersistentTableHostObject(Schema schema, Columns columns, size_t rows);
+
+    // Factory methods. schema is an array of { name, type } objects
+    static Schema parseSchema(facebook::jsi::Runtime &rt, const facebook::jsi::Array &spec);
+    static std::shared_ptr<PersistentTableHostObject> empty(Schema schema);
+    // Each entry of columns is an array, a typed vector or PersistentVector
+    // of the column's type (shared, not copied), or for numeric columns an
+    // ArrayBuffer of native-endian elements
+    static std::shared_ptr<PersistentTableHostObject>
+    fromColumns(facebook::jsi::Runtime &rt, Schema schema, const facebook::jsi::Array &columns);
+
+    // HostObject interface
+    facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                             const facebook::jsi::PropNameID &name) override;
+    std::vector<facebook::jsi::PropNameID>
+    getPropertyNames(facebook::jsi::Runtime &rt) override;
+
+    size_t rowCount() const { return rows_; }
+    size_t columnCount() const { return schema_->size(); }
+    const ColumnSpec &spec(size_t col) const { return (*schema_)[col]; }
+
+    // Index of a column given by number or name; throws if there is none
+    size_t columnIndex(facebook::jsi::Runtime &rt, const facebook::jsi::Value &col) const;
+    facebook::jsi::Array columnNames(facebook::jsi::Runtime &rt) const;
+
+    // Table operations
+    facebook::jsi::Value cell(facebook::jsi::Runtime &rt, size_t row, size_t col) const;
+    std::shared_ptr<PersistentTableHostObject> setCell(facebook::jsi::Runtime &rt, size_t row,
+                                                       size_t col,
+                                                       const facebook::jsi::Value &value) const;
+    facebook::jsi::Array row(facebook::jsi::Runtime &rt, size_t row) const;
+    std::shared_ptr<PersistentTableHostObject> setRow(facebook::jsi::Runtime &rt, size_t row,
+                                                      const facebook::jsi::Value &values) const;
+    std::shared_ptr<PersistentTableHostObject> appendRows(facebook::jsi::Runtime &rt,
+                                                          const facebook::jsi::Array &rows) const;
+    std::shared_ptr<PersistentTableHostObject> slice(facebook::jsi::Runtime &rt, size_t start,
+                                                     size_t end) const;
+    std::shared_ptr<PersistentTableHostObject>
+    selectColumns(facebook::jsi::Runtime &rt, const facebook::jsi::Array &cols) const;
+
+    // Column export
+    facebook::jsi::Value column(facebook::jsi::Runtime &rt, size_t col) const;
+    size_t copyColumnInto(facebook::jsi::Runtime &rt, size_t col,
+                          const facebook::jsi::ArrayBuffer &buffer, size_t byteOffset) const;
+    facebook::jsi::ArrayBuffer columnBuffer(facebook::jsi::Runtime &rt, size_t col) const;
+
+  private:
+    void checkRow(facebook::jsi::Runtime &rt, size_t row) const;
+    // Each column's value from an array row (column order) or an object
+    // row (by name); nullopt where the row has undefined or lacks it
+    std::vector<std::optional<facebook::jsi::Value>>
+    readRow(facebook::jsi::Runtime &rt, const facebook::jsi::Value &values) const;
+
+    Schema schema_;
+    Columns columns_;
+    size_t rows_;
+  };
+
+  /**
+   * Install the PersistentTable factory on the global object:
+   * - PersistentTable.create(schema, rows?) - rows as for appendRows
+   * - PersistentTable.fromColumns(schema, columns)
+   * The remaining operations are methods on the table.
+   */
+  void installPersistentTable(facebook::jsi::Runtime &rt);
+
+} // namespace cljs
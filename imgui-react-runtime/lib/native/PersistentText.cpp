@@ -0,0 +1,362 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "PersistentText.h"
+#include "HostArgs.h"
+#include "MethodTable.h"
+#include "NativeMemory.h"
+
+#include <immer/algorithm.hpp>
+
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+namespace cljs
+{
+
+  namespace
+  {
+    // Line lengths of text, each including its '\n'; the last line is
+    // whatever follows the final '\n'
+    std::vector<uint32_t> lineLengths(const char *data, size_t size, size_t firstLineExtra,
+                                      size_t lastLineExtra)
+    {
+      std::vector<uint32_t> lengths;
+      size_t lineStart = 0;
+      size_t extra = firstLineExtra;
+      while (const void *nl = std::memchr(data + lineStart, '\n', size - lineStart))
+      {
+        size_t end = static_cast<const char *>(nl) - data + 1;
+        lengths.push_back(static_cast<uint32_t>(end - lineStart + extra));
+        lineStart = end;
+        extra = 0;
+      }
+      lengths.push_back(static_cast<uint32_t>(size - lineStart + extra + lastLineExtra));
+      return lengths;
+    }
+
+    facebook::jsi::String toJSString(facebook::jsi::Runtime &rt, const std::string &bytes)
+    {
+      return facebook::jsi::String::createFromUtf8(
+          rt, reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+    }
+  } // namespace
+
+  PersistentTextHostObject::PersistentTextHostObject(TextVector bytes, LineIndex lines)
+      : bytes_(std::move(bytes)), lines_(std::move(lines)) {}
+
+  std::shared_ptr<PersistentTextHostObject>
+  PersistentTextHostObject::fromString(const std::string &text)
+  {
+    return std::make_shared<PersistentTextHostObject>(
+        TextVector(text.begin(), text.end()),
+        LineIndex::fromLengths(lineLengths(text.data(), text.size(), 0, 0)));
+  }
+
+  facebook::jsi::Value PersistentTextHostObject::get(facebook::jsi::Runtime &rt,
+                                                     const facebook::jsi::PropNameID &name)
+  {
+    return MethodTable<PersistentTextHostObject>::forRuntime(rt).get(rt, *this, name);
+  }
+
+  std::vector<facebook::jsi::PropNameID>
+  PersistentTextHostObject::getPropertyNames(facebook::jsi::Runtime &rt)
+  {
+    return MethodTable<PersistentTextHostObject>::forRuntime(rt).names(rt);
+  }
+
+  void PersistentTextHostObject::checkOffset(facebook::jsi::Runtime &rt, size_t offset) const
+  {
+    if (offset > bytes_.size())
+    {
+      std::ostringstream msg;
+      msg << "Offset " << offset << " out of bounds for text of " << bytes_.size()
+          << " bytes";
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    if (offset < bytes_.size() && (static_cast<unsigned char>(bytes_[offset]) & 0xC0) == 0x80)
+    {
+      std::ostringstream msg;
+      msg << "Offset " << offset << " is inside a UTF-8 sequence";
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+  }
+
+  void PersistentTextHostObject::checkLine(facebook::jsi::Runtime &rt, size_t line) const
+  {
+    if (line >= lines_.lines())
+    {
+      std::ostringstream msg;
+      msg << "Line " << line << " out of bounds for text of " << lines_.lines() << " lines";
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+  }
+
+  std::string PersistentTextHostObject::bytesIn(size_t start, size_t end) const
+  {
+    std::string result;
+    result.reserve(end - start);
+    immer::for_each_chunk(bytes_.begin() + start, bytes_.begin() + end,
+                          [&](const char *first, const char *last)
+                          { result.append(first, last); });
+    return result;
+  }
+
+  std::shared_ptr<PersistentTextHostObject>
+  PersistentTextHostObject::replace(facebook::jsi::Runtime &rt, size_t start, size_t end,
+                                    const std::string &text) const
+  {
+    if (start > end)
+    {
+      std::ostringstream msg;
+      msg << "Range [" << start << ", " << end << ") is reversed";
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    checkOffset(rt, start);
+    checkOffset(rt, end);
+
+    // The edit spans lines first..last; they are replaced by the lines of
+    // their kept prefix + text + their kept suffix
+    size_t first = lines_.lineAt(start);
+    size_t last = end == start ? first : lines_.lineAt(end);
+    size_t prefix = start - lines_.lineStart(first);
+    size_t suffix = lines_.lineStart(last) + lines_.length(last) - end;
+
+    TextVector bytes = bytes_;
+    if (end > start)
+    {
+      bytes = std::move(bytes).erase(start, end);
+    }
+    if (!text.empty())
+    {
+      bytes = std::move(bytes).insert(start, TextVector(text.begin(), text.end()));
+    }
+
+    LineIndex lines;
+    if (first == last && text.find('\n') == std::string::npos)
+    {
+      lines = lines_.set(first, static_cast<uint32_t>(prefix + text.size() + suffix));
+    }
+    else
+    {
+      lines = lines_.splice(first, last - first + 1,
+                            lineLengths(text.data(), text.size(), prefix, suffix));
+    }
+    return std::make_shared<PersistentTextHostObject>(std::move(bytes), std::move(lines));
+  }
+
+  std::shared_ptr<PersistentTextHostObject>
+  PersistentTextHostObject::eraseLines(facebook::jsi::Runtime &rt, size_t start,
+                                       size_t end) const
+  {
+    if (start > end || end > lines_.lines())
+    {
+      std::ostringstream msg;
+      msg << "Lines [" << start << ", " << end << ") out of bounds for text of "
+          << lines_.lines() << " lines";
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    return replace(rt, lines_.lineStart(start), lines_.lineStart(end), std::string());
+  }
+
+  size_t PersistentTextHostObject::offsetOf(facebook::jsi::Runtime &rt, size_t line,
+                                            size_t column) const
+  {
+    checkLine(rt, line);
+    size_t length = lines_.length(line);
+    // The column may reach the '\n' but not pass it
+    size_t width = line + 1 < lines_.lines() ? length - 1 : length;
+    if (column > width)
+    {
+      std::ostringstream msg;
+      msg << "Column " << column << " out of bounds for line " << line << " of " << width
+          << " bytes";
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    size_t offset = lines_.lineStart(line) + column;
+    checkOffset(rt, offset);
+    return offset;
+  }
+
+  facebook::jsi::Array PersistentTextHostObject::positionOf(facebook::jsi::Runtime &rt,
+                                                            size_t offset) const
+  {
+    checkOffset(rt, offset);
+    size_t line = lines_.lineAt(offset);
+    facebook::jsi::Array result(rt, 2);
+    result.setValueAtIndex(rt, 0, static_cast<double>(line));
+    result.setValueAtIndex(rt, 1, static_cast<double>(offset - lines_.lineStart(line)));
+    return result;
+  }
+
+  facebook::jsi::String PersistentTextHostObject::line(facebook::jsi::Runtime &rt,
+                                                       size_t line) const
+  {
+    checkLine(rt, line);
+    size_t start = lines_.lineStart(line);
+    size_t length = lines_.length(line);
+    if (line + 1 < lines_.lines())
+    {
+      --length;
+    }
+    return toJSString(rt, bytesIn(start, start + length));
+  }
+
+  facebook::jsi::Array PersistentTextHostObject::lines(facebook::jsi::Runtime &rt, size_t start,
+                                                       size_t end) const
+  {
+    if (start > end || end > lines_.lines())
+    {
+      std::ostringstream msg;
+      msg << "Lines [" << start << ", " << end << ") out of bounds for text of "
+          << lines_.lines() << " lines";
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+
+    // Read the visible range once and cut it at each '\n'
+    std::string bytes = bytesIn(lines_.lineStart(start), lines_.lineStart(end));
+    facebook::jsi::Array result(rt, end - start);
+    size_t pos = 0;
+    for (size_t i = 0; i < end - start; ++i)
+    {
+      size_t nl = bytes.find('\n', pos);
+      size_t lineEnd = nl == std::string::npos ? bytes.size() : nl;
+      result.setValueAtIndex(
+          rt, i,
+          facebook::jsi::String::createFromUtf8(
+              rt, reinterpret_cast<const uint8_t *>(bytes.data() + pos), lineEnd - pos));
+      pos = lineEnd + 1;
+    }
+    return result;
+  }
+
+  facebook::jsi::String PersistentTextHostObject::slice(facebook::jsi::Runtime &rt, size_t start,
+                                                        size_t end) const
+  {
+    if (start > end)
+    {
+      std::ostringstream msg;
+      msg << "Range [" << start << ", " << end << ") is reversed";
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    checkOffset(rt, start);
+    checkOffset(rt, end);
+    return toJSString(rt, bytesIn(start, end));
+  }
+
+  namespace
+  {
+    using Text = PersistentTextHostObject;
+
+    std::string stringArg(facebook::jsi::Runtime &rt, const facebook::jsi::Value *args,
+                          size_t count, size_t i, const char *fn)
+    {
+      if (i >= count || !args[i].isString())
+      {
+        throw facebook::jsi::JSError(rt, std::string(fn) + " requires a string argument");
+      }
+      return args[i].getString(rt).utf8(rt);
+    }
+
+    facebook::jsi::Value wrap(facebook::jsi::Runtime &rt, std::shared_ptr<Text> text)
+    {
+      return createHostObject(rt, std::move(text));
+    }
+
+    // t.lines(a, b), t.insert(offset, s), ... - hottest first
+    void installTextMethods(facebook::jsi::Runtime &rt)
+    {
+      using facebook::jsi::Runtime;
+      using facebook::jsi::Value;
+
+      auto &methods = MethodTable<Text>::forRuntime(rt);
+      methods.setTypeName("PersistentText");
+      methods.getter(rt, "lineCount", [](Runtime &, Text &self)
+                     { return Value(static_cast<double>(self.lineCount())); });
+      methods.getter(rt, "byteLength", [](Runtime &, Text &self)
+                     { return Value(static_cast<double>(self.byteLength())); });
+      methods.method(rt, "lines", 2, [](Runtime &runtime, Text &self, const Value *args, size_t count)
+                     {
+                       size_t start = indexArg(runtime, args, count, 0, "lines");
+                       size_t end = count > 1 && !args[1].isUndefined()
+                                        ? indexArg(runtime, args, count, 1, "lines")
+                                        : self.lineCount();
+                       return Value(runtime, self.lines(runtime, start, end)); });
+      methods.method(rt, "line", 1, [](Runtime &runtime, Text &self, const Value *args, size_t count)
+                     { return Value(runtime, self.line(runtime, indexArg(runtime, args, count, 0, "line"))); });
+      methods.method(rt, "insert", 2, [](Runtime &runtime, Text &self, const Value *args, size_t count)
+                     {
+                       size_t offset = indexArg(runtime, args, count, 0, "insert");
+                       return wrap(runtime, self.replace(runtime, offset, offset, stringArg(runtime, args, count, 1, "insert"))); });
+      methods.method(rt, "erase", 2, [](Runtime &runtime, Text &self, const Value *args, size_t count)
+                     {
+                       size_t start = indexArg(runtime, args, count, 0, "erase");
+                       size_t end = indexArg(runtime, args, count, 1, "erase");
+                       return wrap(runtime, self.replace(runtime, start, end, std::string())); });
+      methods.method(rt, "replace", 3, [](Runtime &runtime, Text &self, const Value *args, size_t count)
+                     {
+                       size_t start = indexArg(runtime, args, count, 0, "replace");
+                       size_t end = indexArg(runtime, args, count, 1, "replace");
+                       return wrap(runtime, self.replace(runtime, start, end, stringArg(runtime, args, count, 2, "replace"))); });
+      methods.method(rt, "offsetOf", 2, [](Runtime &runtime, Text &self, const Value *args, size_t count)
+                     {
+                       size_t line = indexArg(runtime, args, count, 0, "offsetOf");
+                       size_t column = count > 1 && !args[1].isUndefined()
+                                           ? indexArg(runtime, args, count, 1, "offsetOf")
+                                           : 0;
+                       return Value(static_cast<double>(self.offsetOf(runtime, line, column))); });
+      methods.method(rt, "positionOf", 1, [](Runtime &runtime, Text &self, const Value *args, size_t count)
+                     { return Value(runtime, self.positionOf(runtime, indexArg(runtime, args, count, 0, "positionOf"))); });
+      methods.method(rt, "eraseLines", 2, [](Runtime &runtime, Text &self, const Value *args, size_t count)
+                     {
+                       size_t start = indexArg(runtime, args, count, 0, "eraseLines");
+                       size_t end = indexArg(runtime, args, count, 1, "eraseLines");
+                       return wrap(runtime, self.eraseLines(runtime, start, end)); });
+      methods.method(rt, "slice", 2, [](Runtime &runtime, Text &self, const Value *args, size_t count)
+                     {
+                       size_t start = indexArg(runtime, args, count, 0, "slice");
+                       size_t end = count > 1 && !args[1].isUndefined()
+                                        ? indexArg(runtime, args, count, 1, "slice")
+                                        : self.byteLength();
+                       return Value(runtime, self.slice(runtime, start, end)); });
+      methods.method(rt, "toString", 0, [](Runtime &runtime, Text &self, const Value *, size_t)
+                     { return Value(runtime, self.slice(runtime, 0, self.byteLength())); });
+    }
+  } // namespace
+
+  void installPersistentText(facebook::jsi::Runtime &rt)
+  {
+    installTextMethods(rt);
+
+    facebook::jsi::Object factory(rt);
+
+    // from(string) - Text holding a JavaScript string, stored as UTF-8
+    factory.setProperty(
+        rt, "from",
+        facebook::jsi::Function::createFromHostFunction(
+            rt, facebook::jsi::PropNameID::forAscii(rt, "from"), 1,
+            [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+               const facebook::jsi::Value *args,
+               size_t count) -> facebook::jsi::Value
+            {
+              return wrap(runtime, Text::fromString(stringArg(runtime, args, count, 0, "from")));
+            }));
+
+    factory.setProperty(
+        rt, "empty",
+        facebook::jsi::Function::createFromHostFunction(
+            rt, facebook::jsi::PropNameID::forAscii(rt, "empty"), 0,
+            [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+               const facebook::jsi::Value *,
+               size_t) -> facebook::jsi::Value
+            {
+              return wrap(runtime, Text::fromString(std::string()));
+            }));
+
+    // Install the factory object as globalThis.PersistentText
+    rt.global().setProperty(rt, "PersistentText", factory);
+  }
+
+} // namespace cljs
@@ -0,0 +1,100 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <hermes/hermes.h>
+#include <jsi/jsi.h>
+
+#include <immer/flex_vector.hpp>
+
+#include "LineIndex.h"
+#include "MemoryPolicy.h"
+
+#include <memory>
+#include <string>
+
+namespace cljs
+{
+
+  /**
+   * PersistentTextHostObject is an immutable UTF-8 text buffer (a rope).
+   *
+   * The bytes live in an immer::flex_vector<char>, whose leaves are the
+   * rope's chunks: an edit splits and joins the RRB tree in O(log n) and
+   * shares every chunk it did not touch, so each version is a cheap
+   * snapshot for undo. A LineIndex of line lengths is updated along with
+   * the bytes, so line <-> offset conversion is O(log n) too.
+   *
+   * Positions are byte offsets into the UTF-8 text and must not fall
+   * inside a multi-byte sequence. Lines end after each '\n'; the last line
+   * has none, so there is always at least one line. Operations (all also
+   * methods on the text):
+   * - byteLength, lineCount - Getters
+   * - insert(offset, str), erase(start, end), replace(start, end, str)
+   * - eraseLines(start, end) - Remove lines [start, end) with their '\n'
+   * - offsetOf(line, column?) - Byte offset of a line plus a byte column
+   * - positionOf(offset) - [line, column] of a byte offset
+   * - line(i) - One line without its '\n'
+   * - lines(start, end?) - Lines [start, end); only their bytes are read
+   * - slice(start, end?) - The text between two offsets
+   * - toString() - The whole text
+   */
+  class PersistentTextHostObject : public facebook::jsi::HostObject
+  {
+  public:
+    using TextVector = immer::flex_vector<char, NativeMemoryPolicy>;
+
+    PersistentTextHostObject(TextVector bytes, LineIndex lines);
+
+    static std::shared_ptr<PersistentTextHostObject> fromString(const std::string &text);
+
+    // HostObject interface
+    facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                             const facebook::jsi::PropNameID &name) override;
+    std::vector<facebook::jsi::PropNameID>
+    getPropertyNames(facebook::jsi::Runtime &rt) override;
+
+    size_t byteLength() const { return bytes_.size(); }
+    size_t lineCount() const { return lines_.lines(); }
+
+    // Text operations
+    std::shared_ptr<PersistentTextHostObject> replace(facebook::jsi::Runtime &rt, size_t start,
+                                                      size_t end, const std::string &text) const;
+    std::shared_ptr<PersistentTextHostObject> eraseLines(facebook::jsi::Runtime &rt, size_t start,
+                                                         size_t end) const;
+
+    // Position conversion; columns are byte offsets within the line
+    size_t offsetOf(facebook::jsi::Runtime &rt, size_t line, size_t column) const;
+    facebook::jsi::Array positionOf(facebook::jsi::Runtime &rt, size_t offset) const;
+
+    // Extraction
+    facebook::jsi::String line(facebook::jsi::Runtime &rt, size_t line) const;
+    facebook::jsi::Array lines(facebook::jsi::Runtime &rt, size_t start, size_t end) const;
+    facebook::jsi::String slice(facebook::jsi::Runtime &rt, size_t start, size_t end) const;
+
+    // Access the underlying vectors (for testing/debugging)
+    const TextVector &getBytes() const { return bytes_; }
+    const LineIndex &getLineIndex() const { return lines_; }
+
+  private:
+    // Throws unless offset is in [0, byteLength()] and starts a character
+    void checkOffset(facebook::jsi::Runtime &rt, size_t offset) const;
+    void checkLine(facebook::jsi::Runtime &rt, size_t line) const;
+    // Copies bytes [start, end) out leaf by leaf
+    std::string bytesIn(size_t start, size_t end) const;
+
+    TextVector bytes_;
+    LineIndex lines_;
+  };
+
+  /**
+   * Install the PersistentText factory on the global object:
+   * - PersistentText.from(string) - Text holding string
+   * - PersistentText.empty()
+   * The remaining operations are methods on the text.
+   */
+  void installPersistentText(facebook::jsi::Runtime &rt);
+
+} // namespace cljs
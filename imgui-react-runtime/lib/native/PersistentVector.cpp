@@ -3,7 +3,18 @@
 // See LICENSE file for full license text
 
 #include "PersistentVector.h"
+#include "CljsHash.h"
+#include "HostArgs.h"
+#include "KeyHashing.h"
+#include "MethodTable.h"
+#include "NativeMemory.h"
+#include "NestedPaths.h"
+#include "Snapshot.h"
+#include "StringTable.h"
+#include "TypedVector.h"
+#include "VectorReductions.h"
 
+#include <algorithm>
 #include <sstream>
 #include <stdexcept>
 
@@ -17,6 +28,52 @@ namespace cljs
     log.call(rt, facebook::jsi::String::createFromUtf8(rt, message));
   }
 
+  namespace
+  {
+    // Returns handlers[name] if it is a function
+    std::optional<facebook::jsi::Function>
+    diffCallback(facebook::jsi::Runtime &rt, const facebook::jsi::Object &handlers,
+                 const char *name)
+    {
+      auto prop = handlers.getProperty(rt, name);
+      if (prop.isObject() && prop.getObject(rt).isFunction(rt))
+      {
+        return prop.getObject(rt).getFunction(rt);
+      }
+      return std::nullopt;
+    }
+
+    using Chunk = std::pair<const StoredValue *, const StoredValue *>;
+
+    std::vector<Chunk> leafChunks(const PersistentVectorHostObject::VectorType &vec)
+    {
+      std::vector<Chunk> chunks;
+      chunks.reserve(vec.size() / 32 + 1);
+      immer::for_each_chunk(vec, [&](const StoredValue *first, const StoredValue *last)
+                            { chunks.emplace_back(first, last); });
+      return chunks;
+    }
+
+    // Walks a list of leaf chunks as one contiguous sequence
+    struct ChunkCursor
+    {
+      const std::vector<Chunk> &chunks;
+      size_t chunk = 0;
+      const StoredValue *pos = chunks.empty() ? nullptr : chunks[0].first;
+
+      // Elements left in the current leaf, moving to the next leaf if needed
+      size_t available()
+      {
+        while (chunk < chunks.size() && pos == chunks[chunk].second)
+        {
+          if (++chunk < chunks.size())
+            pos = chunks[chunk].first;
+        }
+        return chunk < chunks.size() ? static_cast<size_t>(chunks[chunk].second - pos) : 0;
+      }
+    };
+  } // namespace
+
   PersistentVectorHostObject::PersistentVectorHostObject(VectorType vec)
       : vec_(std::move(vec)) {}
 
@@ -42,14 +99,7 @@ namespace cljs
   PersistentVectorHostObject::get(facebook::jsi::Runtime &rt,
                                   const facebook::jsi::PropNameID &name)
   {
-    std::string prop = name.utf8(rt);
-
-    if (prop == "count" || prop == "length")
-    {
-      return facebook::jsi::Value(static_cast<double>(count()));
-    }
-
-    return facebook::jsi::Value::undefined();
+    return MethodTable<PersistentVectorHostObject>::forRuntime(rt).get(rt, *this, name);
   }
 
   void PersistentVectorHostObject::set(facebook::jsi::Runtime &rt,
@@ -61,8 +111,7 @@ namespace cljs
   std::vector<facebook::jsi::PropNameID>
   PersistentVectorHostObject::getPropertyNames(facebook::jsi::Runtime &rt)
   {
-    std::vector<facebook::jsi::PropNameID> result;
-    return result;
+    return MethodTable<PersistentVectorHostObject>::forRuntime(rt).names(rt);
   }
 
   size_t PersistentVectorHostObject::count() const { return vec_.size(); }
@@ -80,6 +129,81 @@ namespace cljs
     return reconstructValue(rt, vec_[index]);
   }
 
+  int32_t PersistentVectorHostObject::hashOrdered(facebook::jsi::Runtime &rt) const
+  {
+    if (!hash_)
+    {
+      auto &handlers = KeyHandlers::forRuntime(rt);
+      uint32_t acc = 1;
+      immer::for_each_chunk(vec_, [&](const StoredValue *first, const StoredValue *last)
+                            {
+        for (; first != last; ++first)
+        {
+          acc = hash::orderedStep(acc, handlers.hashValue(rt, *first));
+        } });
+      hash_ = hash::mixCollectionHash(acc, static_cast<uint32_t>(vec_.size()));
+    }
+    return *hash_;
+  }
+
+  void PersistentVectorHostObject::diff(facebook::jsi::Runtime &rt,
+                                        const PersistentVectorHostObject &other,
+                                        const facebook::jsi::Object &handlers) const
+  {
+    if (vec_.identity() == other.vec_.identity())
+    {
+      return;
+    }
+
+    auto added = diffCallback(rt, handlers, "added");
+    auto removed = diffCallback(rt, handlers, "removed");
+    auto changed = diffCallback(rt, handlers, "changed");
+
+    // flex_vector has no tree diff; comparing leaf pointers still skips
+    // every shared leaf without touching its elements
+    auto chunksA = leafChunks(vec_);
+    auto chunksB = leafChunks(other.vec_);
+    ChunkCursor a{chunksA};
+    ChunkCursor b{chunksB};
+    size_t common = std::min(vec_.size(), other.vec_.size());
+
+    KeyEquivScope scope(rt);
+    size_t index = 0;
+    while (index < common)
+    {
+      size_t n = std::min({a.available(), b.available(), common - index});
+      if (a.pos != b.pos && changed)
+      {
+        for (size_t i = 0; i < n; ++i)
+        {
+          if (!(a.pos[i] == b.pos[i]))
+          {
+            changed->call(rt, static_cast<double>(index + i),
+                          reconstructValue(rt, a.pos[i]),
+                          reconstructValue(rt, b.pos[i]));
+          }
+        }
+      }
+      a.pos += n;
+      b.pos += n;
+      index += n;
+    }
+
+    auto reportTail = [&](ChunkCursor &cursor, size_t size,
+                          const std::optional<facebook::jsi::Function> &fn)
+    {
+      if (!fn)
+        return;
+      for (size_t i = index; i < size; ++i)
+      {
+        cursor.available();
+        fn->call(rt, static_cast<double>(i), reconstructValue(rt, *cursor.pos++));
+      }
+    };
+    reportTail(a, vec_.size(), removed);
+    reportTail(b, other.vec_.size(), added);
+  }
+
   bool PersistentVectorHostObject::equiv(facebook::jsi::Runtime &rt, const facebook::jsi::Value &other) const
   {
     if (!other.isObject())
@@ -87,100 +211,52 @@ namespace cljs
       return false;
     }
     auto otherObj = other.getObject(rt);
-    auto otherHostObj = otherObj.getHostObject<PersistentVectorHostObject>(rt);
+    auto otherHostObj = hostAs<PersistentVectorHostObject>(rt, otherObj);
     if (!otherHostObj)
     {
       return false;
     }
 
-    // Check sizes first
-    if (vec_.size() != otherHostObj->vec_.size())
+    // Versions of one vector that were never edited share their root
+    const VectorType &otherVec = otherHostObj->vec_;
+    if (vec_.identity() == otherVec.identity())
+    {
+      return true;
+    }
+    if (vec_.size() != otherVec.size())
     {
       return false;
     }
-
-    // Compare elements deeply
-    for (size_t i = 0; i < vec_.size(); ++i)
+    if (hash_ && otherHostObj->hash_ && *hash_ != *otherHostObj->hash_)
     {
-      const StoredValue &a = vec_[i];
-      const StoredValue &b = otherHostObj->vec_[i];
+      return false;
+    }
 
-      // Compare by type first
-      if (a.type != b.type)
-      {
-        return false;
-      }
+    // Leaves both vectors share are skipped without touching their elements
+    auto chunksA = leafChunks(vec_);
+    auto chunksB = leafChunks(otherVec);
+    ChunkCursor a{chunksA};
+    ChunkCursor b{chunksB};
 
-      // Compare values based on type
-      switch (a.type)
+    auto &handlers = KeyHandlers::forRuntime(rt);
+    KeyEquivScope scope(rt);
+    size_t index = 0;
+    while (index < vec_.size())
+    {
+      size_t n = std::min(a.available(), b.available());
+      if (a.pos != b.pos)
       {
-      case StoredValue::NIL:
-        // Both are null, they're equal
-        continue;
-      case StoredValue::BOOL:
-        if (a.primitive.bool_val != b.primitive.bool_val)
-          return false;
-        break;
-      case StoredValue::NUMBER:
-        if (a.primitive.number_val != b.primitive.number_val)
-          return false;
-        break;
-      case StoredValue::STRING:
-        // Both strings must be equal
-        if ((!a.string_val && b.string_val) || (a.string_val && !b.string_val))
-          return false;
-        if (a.string_val && b.string_val && *a.string_val != *b.string_val)
-          return false;
-        break;
-      case StoredValue::OBJECT_REF:
-        // Try to use equiv for objects, fall back to reference equality
-
-        if (!a.object_val && !b.object_val)
-        {
-          // Both null
-          continue;
-        }
-        if ((!a.object_val && b.object_val) || (a.object_val && !b.object_val))
-        {
-          return false;
-        }
-
-        // Try to call equiv method on the objects
-        try
-        {
-          facebook::jsi::Value aVal(rt, *a.object_val);
-          facebook::jsi::Value bVal(rt, *b.object_val);
-
-          // Check if object has an equiv method
-          if (aVal.isObject() && aVal.getObject(rt).hasProperty(rt, "equiv"))
-          {
-            auto equivProp = aVal.getObject(rt).getProperty(rt, "equiv");
-            if (equivProp.isObject() && equivProp.getObject(rt).isFunction(rt))
-            {
-              auto equivFn = equivProp.getObject(rt).asFunction(rt);
-              auto result = equivFn.callWithThis(rt, aVal.getObject(rt), bVal);
-              if (result.isBool() && !result.getBool())
-              {
-                return false;
-              }
-            }
-          }
-          // If no equiv method, compare by reference
-          else if (a.object_val.get() != b.object_val.get())
-          {
-            return false;
-          }
-        }
-        catch (const facebook::jsi::JSError &)
+        for (size_t i = 0; i < n; ++i)
         {
-          // If equiv call fails, fall back to reference comparison
-          if (a.object_val.get() != b.object_val.get())
+          if (!handlers.valuesEqual(rt, a.pos[i], b.pos[i]))
           {
             return false;
           }
         }
-        break;
       }
+      a.pos += n;
+      b.pos += n;
+      index += n;
     }
 
     return true;
@@ -220,6 +296,74 @@ namespace cljs
     return std::make_shared<PersistentVectorHostObject>(std::move(newVec));
   }
 
+  std::shared_ptr<PersistentVectorHostObject>
+  PersistentVectorHostObject::take(size_t n) const
+  {
+    if (n >= vec_.size())
+    {
+      return std::make_shared<PersistentVectorHostObject>(vec_);
+    }
+    return std::make_shared<PersistentVectorHostObject>(vec_.take(n));
+  }
+
+  std::shared_ptr<PersistentVectorHostObject>
+  PersistentVectorHostObject::drop(size_t n) const
+  {
+    if (n >= vec_.size())
+    {
+      return std::make_shared<PersistentVectorHostObject>();
+    }
+    return std::make_shared<PersistentVectorHostObject>(vec_.drop(n));
+  }
+
+  std::shared_ptr<PersistentVectorHostObject> PersistentVectorHostObject::slice(
+      facebook::jsi::Runtime &rt, size_t start, size_t end) const
+  {
+    if (start > end || end > vec_.size())
+    {
+      std::ostringstream msg;
+      msg << "Slice [" << start << ", " << end
+          << ") out of bounds for vector of size " << vec_.size();
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    return std::make_shared<PersistentVectorHostObject>(vec_.take(end).drop(start));
+  }
+
+  std::shared_ptr<PersistentVectorHostObject>
+  PersistentVectorHostObject::concat(const PersistentVectorHostObject &other) const
+  {
+    // RRB concatenation shares both trees
+    return std::make_shared<PersistentVectorHostObject>(vec_ + other.vec_);
+  }
+
+  std::shared_ptr<PersistentVectorHostObject> PersistentVectorHostObject::insertAt(
+      facebook::jsi::Runtime &rt, size_t index,
+      const facebook::jsi::Value &value) const
+  {
+    if (index > vec_.size())
+    {
+      std::ostringstream msg;
+      msg << "Index " << index << " out of bounds for insert into vector of size "
+          << vec_.size();
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    return std::make_shared<PersistentVectorHostObject>(
+        vec_.insert(index, convertValue(rt, value)));
+  }
+
+  std::shared_ptr<PersistentVectorHostObject>
+  PersistentVectorHostObject::eraseAt(facebook::jsi::Runtime &rt, size_t index) const
+  {
+    if (index >= vec_.size())
+    {
+      std::ostringstream msg;
+      msg << "Index " << index << " out of bounds for vector of size "
+          << vec_.size();
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    return std::make_shared<PersistentVectorHostObject>(vec_.erase(index));
+  }
+
   facebook::jsi::Value
   PersistentVectorHostObject::first(facebook::jsi::Runtime &rt) const
   {
@@ -306,46 +450,56 @@ namespace cljs
                                      const facebook::jsi::Function &fn,
                                      const facebook::jsi::Value &initialValue) const
   {
-    // For the first iteration, we need initialValue which we can use directly
-    // For subsequent iterations, we call fn and use the result
+    return reduceFrom(rt, fn, facebook::jsi::Value(rt, initialValue), 0);
+  }
 
+  facebook::jsi::Value
+  PersistentVectorHostObject::reduce(facebook::jsi::Runtime &rt,
+                                     const facebook::jsi::Function &fn) const
+  {
+    // Same as (reduce f v): (f) when empty, else start from the first element
     if (vec_.empty())
     {
-      // Return a copy of initialValue
-      if (initialValue.isUndefined())
-        return facebook::jsi::Value();
-      if (initialValue.isNull())
-        return facebook::jsi::Value(facebook::jsi::Value::null());
-      if (initialValue.isBool())
-        return facebook::jsi::Value(initialValue.getBool());
-      if (initialValue.isNumber())
-        return facebook::jsi::Value(initialValue.getNumber());
-      if (initialValue.isString())
-        return facebook::jsi::Value(initialValue.getString(rt));
-      if (initialValue.isObject())
-        return facebook::jsi::Value(initialValue.getObject(rt));
-    }
-
-    // Process first element
-    facebook::jsi::Value element = reconstructValue(rt, vec_[0]);
-    facebook::jsi::Value accumulator = fn.call(rt, initialValue, element, facebook::jsi::Value(0.0));
-
-    // Process remaining elements
-    for (size_t i = 1; i < vec_.size(); ++i)
-    {
-      facebook::jsi::Value nextElement = reconstructValue(rt, vec_[i]);
-      accumulator = fn.call(rt, accumulator, nextElement, facebook::jsi::Value(static_cast<double>(i)));
+      return fn.call(rt);
     }
+    return reduceFrom(rt, fn, reconstructValue(rt, vec_[0]), 1);
+  }
 
+  facebook::jsi::Value
+  PersistentVectorHostObject::reduceFrom(facebook::jsi::Runtime &rt,
+                                         const facebook::jsi::Function &fn,
+                                         facebook::jsi::Value accumulator,
+                                         size_t start) const
+  {
+    // Walk the leaves directly: no per-element tree descent, and the walk
+    // stops as soon as fn returns a Reduced
+    const auto &handlers = KeyHandlers::forRuntime(rt);
+    size_t index = start;
+    immer::for_each_chunk_p(vec_.begin() + start, vec_.end(),
+                            [&](const StoredValue *first, const StoredValue *last)
+                            {
+                              for (; first != last; ++first, ++index)
+                              {
+                                accumulator = fn.call(rt, accumulator, reconstructValue(rt, *first),
+                                                      facebook::jsi::Value(static_cast<double>(index)));
+                                if (handlers.isReduced(rt, accumulator))
+                                {
+                                  return false;
+                                }
+                              }
+                              return true;
+                            });
     return accumulator;
   }
+
   StoredValue
   PersistentVectorHostObject::convertValue(facebook::jsi::Runtime &rt,
                                            const facebook::jsi::Value &value)
   {
     // Optimized value storage:
-    // - Primitives are stored directly in the union (no allocation)
-    // - Objects are stored as shared_ptr for proper lifecycle management
+    // - Primitives are NaN-boxed directly in the value (no allocation)
+    // - Strings are interned in the shared string table
+    // - Objects live in one intrusively refcounted cell
 
     if (value.isUndefined())
     {
@@ -353,9 +507,7 @@ namespace cljs
     }
     if (value.isNull())
     {
-      StoredValue result;
-      result.type = StoredValue::NIL;
-      return result;
+      return StoredValue();
     }
     if (value.isBool())
     {
@@ -367,7 +519,7 @@ namespace cljs
     }
     if (value.isString())
     {
-      return StoredValue(value.getString(rt).utf8(rt));
+      return internString(value.getString(rt).utf8(rt));
     }
     if (value.isSymbol())
     {
@@ -379,8 +531,7 @@ namespace cljs
     }
     if (value.isObject())
     {
-      auto obj = value.getObject(rt);
-      return StoredValue(std::make_shared<facebook::jsi::Object>(std::move(obj)));
+      return StoredValue(rt, value.getObject(rt));
     }
 
     // Fallback: undefined
@@ -392,28 +543,338 @@ namespace cljs
                                                const StoredValue &stored)
   {
     // Fast path for primitives - no allocation needed
-    switch (stored.type)
+    switch (stored.type())
     {
     case StoredValue::NIL:
       return facebook::jsi::Value::null();
     case StoredValue::BOOL:
-      return facebook::jsi::Value(stored.primitive.bool_val);
+      return facebook::jsi::Value(stored.asBool());
     case StoredValue::NUMBER:
-      return facebook::jsi::Value(stored.primitive.number_val);
+      return facebook::jsi::Value(stored.asNumber());
     case StoredValue::STRING:
-      return stored.string_val
-                 ? facebook::jsi::Value(rt, facebook::jsi::String::createFromUtf8(rt, *stored.string_val))
-                 : facebook::jsi::Value::null();
+      return stringToJS(rt, stored);
     case StoredValue::OBJECT_REF:
-      return stored.object_val
-                 ? facebook::jsi::Value(rt, *stored.object_val)
-                 : facebook::jsi::Value::null();
+    case StoredValue::INTERNED_KEY:
+    case StoredValue::HASHED_REF:
+      return stored.objectValue(rt);
     }
 
     return facebook::jsi::Value::null();
   }
+
+  TransientVectorHostObject::TransientVectorHostObject(TransientType transient)
+      : transient_(std::move(transient)) {}
+
+  facebook::jsi::Value
+  TransientVectorHostObject::get(facebook::jsi::Runtime &rt,
+                                 const facebook::jsi::PropNameID &name)
+  {
+    return MethodTable<TransientVectorHostObject>::forRuntime(rt).get(rt, *this, name);
+  }
+
+  void TransientVectorHostObject::set(facebook::jsi::Runtime &rt,
+                                      const facebook::jsi::PropNameID &name,
+                                      const facebook::jsi::Value &value)
+  {
+  }
+
+  std::vector<facebook::jsi::PropNameID>
+  TransientVectorHostObject::getPropertyNames(facebook::jsi::Runtime &rt)
+  {
+    return MethodTable<TransientVectorHostObject>::forRuntime(rt).names(rt);
+  }
+
+  void TransientVectorHostObject::ensureEditable(facebook::jsi::Runtime &rt) const
+  {
+    if (!editable_)
+    {
+      throw facebook::jsi::JSError(rt, "Transient used after persistent! call");
+    }
+  }
+
+  size_t TransientVectorHostObject::count() const { return transient_.size(); }
+
+  facebook::jsi::Value TransientVectorHostObject::nth(facebook::jsi::Runtime &rt,
+                                                      size_t index) const
+  {
+    ensureEditable(rt);
+    if (index >= transient_.size())
+    {
+      std::ostringstream msg;
+      msg << "Index " << index << " out of bounds for vector of size "
+          << transient_.size();
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    return PersistentVectorHostObject::reconstructValue(rt, transient_[index]);
+  }
+
+  void TransientVectorHostObject::conj(facebook::jsi::Runtime &rt,
+                                       const facebook::jsi::Value &value)
+  {
+    ensureEditable(rt);
+    transient_.push_back(PersistentVectorHostObject::convertValue(rt, value));
+  }
+
+  void TransientVectorHostObject::assoc(facebook::jsi::Runtime &rt, size_t index,
+                                        const facebook::jsi::Value &value)
+  {
+    ensureEditable(rt);
+    if (index == transient_.size())
+    {
+      transient_.push_back(PersistentVectorHostObject::convertValue(rt, value));
+      return;
+    }
+    if (index > transient_.size())
+    {
+      std::ostringstream msg;
+      msg << "Index " << index << " out of bounds for vector of size "
+          << transient_.size();
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    transient_.set(index, PersistentVectorHostObject::convertValue(rt, value));
+  }
+
+  void TransientVectorHostObject::pop(facebook::jsi::Runtime &rt)
+  {
+    ensureEditable(rt);
+    if (transient_.empty())
+    {
+      throw facebook::jsi::JSError(rt, "Can't pop empty vector");
+    }
+    transient_.take(transient_.size() - 1);
+  }
+
+  std::shared_ptr<PersistentVectorHostObject>
+  TransientVectorHostObject::persistent(facebook::jsi::Runtime &rt)
+  {
+    ensureEditable(rt);
+    editable_ = false;
+    return std::make_shared<PersistentVectorHostObject>(
+        std::move(transient_).persistent());
+  }
+
+  VectorChunkIteratorHostObject::VectorChunkIteratorHostObject(
+      PersistentVectorHostObject::VectorType vec, size_t start)
+      : vec_(std::move(vec)), pos_(start) {}
+
+  facebook::jsi::Value
+  VectorChunkIteratorHostObject::get(facebook::jsi::Runtime &rt,
+                                     const facebook::jsi::PropNameID &name)
+  {
+    return MethodTable<VectorChunkIteratorHostObject>::forRuntime(rt).get(rt, *this, name);
+  }
+
+  facebook::jsi::Value
+  VectorChunkIteratorHostObject::nextChunk(facebook::jsi::Runtime &rt)
+  {
+    if (pos_ >= vec_.size())
+    {
+      return facebook::jsi::Value::undefined();
+    }
+
+    // Hand out the rest of the leaf containing pos_
+    facebook::jsi::Value result;
+    immer::for_each_chunk_p(
+        vec_.begin() + pos_, vec_.end(),
+        [&](const StoredValue *first, const StoredValue *last)
+        {
+          size_t n = static_cast<size_t>(last - first);
+          facebook::jsi::Array chunk(rt, n);
+          for (size_t i = 0; i < n; ++i)
+          {
+            chunk.setValueAtIndex(rt, i, PersistentVectorHostObject::reconstructValue(rt, first[i]));
+          }
+          pos_ += n;
+          result = std::move(chunk);
+          return false;
+        });
+    return result;
+  }
+
+  namespace
+  {
+    using facebook::jsi::Runtime;
+    using facebook::jsi::Value;
+
+    // A take/drop count clamped to [0, size]; NaN counts as 0
+    size_t clampedCount(double n, size_t size)
+    {
+      return n > 0 ? (n < static_cast<double>(size) ? static_cast<size_t>(n) : size) : 0;
+    }
+
+    // args[i] as a PersistentVector, or a JSError
+    std::shared_ptr<PersistentVectorHostObject> vectorArg(Runtime &rt, const Value *args,
+                                                          size_t count, size_t i)
+    {
+      if (count > i && args[i].isObject())
+      {
+        auto obj = args[i].getObject(rt);
+        if (obj.isHostObject<PersistentVectorHostObject>(rt))
+        {
+          return obj.getHostObject<PersistentVectorHostObject>(rt);
+        }
+      }
+      throw facebook::jsi::JSError(rt, "Argument must be a PersistentVector instance");
+    }
+
+    Value wrap(Runtime &rt, std::shared_ptr<facebook::jsi::HostObject> host)
+    {
+      return createHostObject(rt, std::move(host));
+    }
+
+    // v.nth(i), v.conj(x), ... - The instance-first factory operations as
+    // methods, hottest first
+    void installVectorMethods(Runtime &rt)
+    {
+      auto &methods = MethodTable<PersistentVectorHostObject>::forRuntime(rt);
+      methods.setTypeName("PersistentVector");
+      methods.getter(rt, "count", [](Runtime &, PersistentVectorHostObject &self)
+                     { return Value(static_cast<double>(self.count())); });
+      methods.getter(rt, "length", [](Runtime &, PersistentVectorHostObject &self)
+                     { return Value(static_cast<double>(self.count())); });
+      methods.method(rt, "nth", 1, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     { return self.nth(runtime, indexArg(runtime, args, count, 0, "nth")); });
+      methods.method(rt, "conj", 1, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     {
+                       if (count < 1)
+                       {
+                         throw facebook::jsi::JSError(runtime, "conj requires the value to add");
+                       }
+                       return wrap(runtime, self.conj(runtime, args[0])); });
+      methods.method(rt, "assoc", 2, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     {
+                       if (count < 2)
+                       {
+                         throw facebook::jsi::JSError(runtime, "assoc requires an index and value argument");
+                       }
+                       return wrap(runtime, self.assoc(runtime, indexArg(runtime, args, count, 0, "assoc"), args[1])); });
+      methods.method(rt, "pop", 0, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *, size_t)
+                     { return wrap(runtime, self.pop()); });
+      methods.method(rt, "first", 0, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *, size_t)
+                     { return self.first(runtime); });
+      methods.method(rt, "last", 0, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *, size_t)
+                     { return self.last(runtime); });
+      methods.method(rt, "equiv", 1, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     {
+                       if (count < 1)
+                       {
+                         throw facebook::jsi::JSError(runtime, "equiv requires an argument");
+                       }
+                       return Value(self.equiv(runtime, args[0])); });
+      methods.method(rt, "hashOrdered", 0, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *, size_t)
+                     { return Value(self.hashOrdered(runtime)); });
+      methods.method(rt, "iterator", 1, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     {
+                       size_t start = count > 0 && !args[0].isUndefined() ? indexArg(runtime, args, count, 0, "iterator") : 0;
+                       return wrap(runtime, std::make_shared<VectorChunkIteratorHostObject>(self.getVector(), start)); });
+      methods.method(rt, "reduce", 2, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     {
+                       if (count < 1 || !args[0].isObject())
+                       {
+                         throw facebook::jsi::JSError(runtime, "reduce requires a function");
+                       }
+                       auto fn = args[0].getObject(runtime).asFunction(runtime);
+                       return count < 2 ? self.reduce(runtime, fn) : self.reduce(runtime, fn, args[1]); });
+      methods.method(rt, "toArray", 0, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *, size_t)
+                     { return Value(runtime, self.toArray(runtime)); });
+      methods.method(rt, "isEmpty", 0, [](Runtime &, PersistentVectorHostObject &self, const Value *, size_t)
+                     { return Value(self.isEmpty()); });
+      methods.method(rt, "take", 1, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     {
+                       if (count < 1 || !args[0].isNumber())
+                       {
+                         throw facebook::jsi::JSError(runtime, "take requires a count");
+                       }
+                       return wrap(runtime, self.take(clampedCount(args[0].asNumber(), self.count()))); });
+      methods.method(rt, "drop", 1, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     {
+                       if (count < 1 || !args[0].isNumber())
+                       {
+                         throw facebook::jsi::JSError(runtime, "drop requires a count");
+                       }
+                       return wrap(runtime, self.drop(clampedCount(args[0].asNumber(), self.count()))); });
+      methods.method(rt, "slice", 2, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     {
+                       size_t start = indexArg(runtime, args, count, 0, "slice");
+                       size_t end = count > 1 && !args[1].isUndefined() ? indexArg(runtime, args, count, 1, "slice")
+                                                                        : self.count();
+                       return wrap(runtime, self.slice(runtime, start, end)); });
+      methods.method(rt, "concat", 1, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     { return wrap(runtime, self.concat(*vectorArg(runtime, args, count, 0))); });
+      methods.method(rt, "insertAt", 2, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     {
+                       size_t index = indexArg(runtime, args, count, 0, "insertAt");
+                       if (count < 2)
+                       {
+                         throw facebook::jsi::JSError(runtime, "insertAt requires an index and value argument");
+                       }
+                       return wrap(runtime, self.insertAt(runtime, index, args[1])); });
+      methods.method(rt, "eraseAt", 1, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     { return wrap(runtime, self.eraseAt(runtime, indexArg(runtime, args, count, 0, "eraseAt"))); });
+      methods.method(rt, "batchConj", 1, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     {
+                       if (count < 1 || !args[0].isObject() || !args[0].getObject(runtime).isArray(runtime))
+                       {
+                         throw facebook::jsi::JSError(runtime, "batchConj requires an array argument");
+                       }
+                       return wrap(runtime, self.batchConj(runtime, args[0].getObject(runtime).getArray(runtime))); });
+      methods.method(rt, "batchAssoc", 1, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     {
+                       if (count < 1 || !args[0].isObject())
+                       {
+                         throw facebook::jsi::JSError(runtime, "batchAssoc requires an object argument");
+                       }
+                       return wrap(runtime, self.batchAssoc(runtime, args[0].getObject(runtime))); });
+      methods.method(rt, "transient", 0, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *, size_t)
+                     { return wrap(runtime, std::make_shared<TransientVectorHostObject>(self.getVector().transient())); });
+      methods.method(rt, "diff", 2, [](Runtime &runtime, PersistentVectorHostObject &self, const Value *args, size_t count)
+                     {
+                       auto other = vectorArg(runtime, args, count, 0);
+                       if (count < 2 || !args[1].isObject())
+                       {
+                         throw facebook::jsi::JSError(runtime, "diff requires a vector and a handlers object");
+                       }
+                       self.diff(runtime, *other, args[1].getObject(runtime));
+                       return Value::undefined(); });
+
+      auto &transientMethods = MethodTable<TransientVectorHostObject>::forRuntime(rt);
+      transientMethods.setTypeName("TransientVector");
+      transientMethods.getter(rt, "count", [](Runtime &, TransientVectorHostObject &self)
+                              { return Value(static_cast<double>(self.count())); });
+      transientMethods.getter(rt, "length", [](Runtime &, TransientVectorHostObject &self)
+                              { return Value(static_cast<double>(self.count())); });
+      transientMethods.method(rt, "nth", 1, [](Runtime &runtime, TransientVectorHostObject &self, const Value *args, size_t count)
+                              { return self.nth(runtime, indexArg(runtime, args, count, 0, "nth")); });
+      transientMethods.mutator(rt, "conj", 1, [](Runtime &runtime, TransientVectorHostObject &self, const Value *args, size_t count)
+                               {
+                                 if (count < 1)
+                                 {
+                                   throw facebook::jsi::JSError(runtime, "conj requires the value to add");
+                                 }
+                                 self.conj(runtime, args[0]); });
+      transientMethods.mutator(rt, "assoc", 2, [](Runtime &runtime, TransientVectorHostObject &self, const Value *args, size_t count)
+                               {
+                                 if (count < 2)
+                                 {
+                                   throw facebook::jsi::JSError(runtime, "assoc requires an index and value argument");
+                                 }
+                                 self.assoc(runtime, indexArg(runtime, args, count, 0, "assoc"), args[1]); });
+      transientMethods.mutator(rt, "pop", 0, [](Runtime &runtime, TransientVectorHostObject &self, const Value *, size_t)
+                               { self.pop(runtime); });
+      transientMethods.method(rt, "persistent", 0, [](Runtime &runtime, TransientVectorHostObject &self, const Value *, size_t)
+                              { return wrap(runtime, self.persistent(runtime)); });
+
+      auto &iteratorMethods = MethodTable<VectorChunkIteratorHostObject>::forRuntime(rt);
+      iteratorMethods.setTypeName("PersistentVector iterator");
+      iteratorMethods.method(rt, "nextChunk", 0, [](Runtime &runtime, VectorChunkIteratorHostObject &self, const Value *, size_t)
+                             { return self.nextChunk(runtime); });
+    }
+  } // namespace
+
   void installPersistentVector(facebook::jsi::Runtime &rt)
   {
+    installVectorMethods(rt);
+
     // Create the PersistentVector factory object
     facebook::jsi::Object factory(rt);
 
@@ -427,7 +888,7 @@ namespace cljs
                size_t) -> facebook::jsi::Value
             {
               auto vec = PersistentVectorHostObject::empty();
-              return facebook::jsi::Object::createFromHostObject(runtime, vec);
+              return createHostObject(runtime, vec);
             }));
 
     // PersistentVector.from(array) - Create a vector from a JavaScript array
@@ -452,7 +913,7 @@ namespace cljs
               }
               facebook::jsi::Array arr = obj.getArray(runtime);
               auto vec = PersistentVectorHostObject::fromArray(runtime, arr);
-              return facebook::jsi::Object::createFromHostObject(runtime, vec);
+              return createHostObject(runtime, vec);
             }));
 
     factory.setProperty(rt, "conj",
@@ -462,7 +923,7 @@ namespace cljs
                                const facebook::jsi::Value *args,
                                size_t count) -> facebook::jsi::Value
                             {
-                              auto vec = args[0].getObject(runtime).getHostObject<PersistentVectorHostObject>(runtime);
+                              auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
                               if (!vec)
                               {
                                 throw facebook::jsi::JSError(runtime,
@@ -474,12 +935,12 @@ namespace cljs
                                                              "conj requires two arguments: the vector and the value to add");
                               }
                               auto newVec = vec->conj(runtime, args[1]);
-                              return facebook::jsi::Object::createFromHostObject(runtime, newVec);
+                              return createHostObject(runtime, newVec);
                             }));
 
     factory.setProperty(rt, "nth", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "nth"), 2, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
                                                                                    {
-            auto vec = args[0].getObject(runtime).getHostObject<PersistentVectorHostObject>(runtime);
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
             if (!vec)
             {
               throw facebook::jsi::JSError(runtime,
@@ -490,7 +951,7 @@ namespace cljs
               throw facebook::jsi::JSError(
                   runtime, "nth requires a numeric index argument");
             }
-            size_t index = static_cast<size_t>(args[1].asNumber());
+            size_t index = indexArg(runtime, args, count, 1, "nth");
             return vec->nth(runtime, index); }));
 
     factory.setProperty(rt, "equiv", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "equiv"), 2, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
@@ -507,7 +968,7 @@ namespace cljs
                                            "First argument to equiv must be an object");
             }
             
-            auto vec1 = args[0].getObject(runtime).getHostObject<PersistentVectorHostObject>(runtime);
+            auto vec1 = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
             if (!vec1)
             {
               throw facebook::jsi::JSError(runtime,
@@ -517,20 +978,39 @@ namespace cljs
             bool isEqual = vec1->equiv(runtime, args[1]);
             return facebook::jsi::Value(isEqual); }));
 
+    // PersistentVector.diff(a, b, {added, removed, changed}) - Index-wise
+    // changes from a to b, skipping shared leaves
+    factory.setProperty(rt, "diff", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "diff"), 3, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                    {
+            if (count < 3 || !args[0].isObject() || !args[1].isObject() || !args[2].isObject())
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "diff requires two vectors and a handlers object");
+            }
+            auto a = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
+            auto b = hostAs<PersistentVectorHostObject>(runtime, args, count, 1);
+            if (!a || !b)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "diff arguments must be PersistentVector instances");
+            }
+            a->diff(runtime, *b, args[2].getObject(runtime));
+            return facebook::jsi::Value::undefined(); }));
+
     factory.setProperty(rt, "pop", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "pop"), 1, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
                                                                                    {
-            auto vec = args[0].getObject(runtime).getHostObject<PersistentVectorHostObject>(runtime);
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
             if (!vec)
             {
               throw facebook::jsi::JSError(runtime,
                                            "PersistentVector instance is invalid");
             }
             auto newVec = vec->pop();
-            return facebook::jsi::Object::createFromHostObject(runtime, newVec); }));
+            return createHostObject(runtime, newVec); }));
 
     factory.setProperty(rt, "assoc", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "assoc"), 3, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
                                                                                      {
-            auto vec = args[0].getObject(runtime).getHostObject<PersistentVectorHostObject>(runtime);
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
             if (!vec)
             {
               throw facebook::jsi::JSError(runtime,
@@ -541,13 +1021,111 @@ namespace cljs
               throw facebook::jsi::JSError(
                   runtime, "assoc requires a vector, index, and value argument");
             }
-            size_t index = static_cast<size_t>(args[1].asNumber());
+            size_t index = indexArg(runtime, args, count, 1, "assoc");
             auto newVec = vec->assoc(runtime, index, args[2]);
-            return facebook::jsi::Object::createFromHostObject(runtime, newVec); }));
+            return createHostObject(runtime, newVec); }));
+
+    // PersistentVector.take(vector, n) - First n elements
+    factory.setProperty(rt, "take", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "take"), 2, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                    {
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
+            if (!vec)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "PersistentVector instance is invalid");
+            }
+            if (count < 2 || !args[1].isNumber())
+            {
+              throw facebook::jsi::JSError(runtime, "take requires a vector and a count");
+            }
+            auto newVec = vec->take(clampedCount(args[1].asNumber(), vec->count()));
+            return createHostObject(runtime, newVec); }));
+
+    // PersistentVector.drop(vector, n) - All but the first n elements
+    factory.setProperty(rt, "drop", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "drop"), 2, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                    {
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
+            if (!vec)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "PersistentVector instance is invalid");
+            }
+            if (count < 2 || !args[1].isNumber())
+            {
+              throw facebook::jsi::JSError(runtime, "drop requires a vector and a count");
+            }
+            auto newVec = vec->drop(clampedCount(args[1].asNumber(), vec->count()));
+            return createHostObject(runtime, newVec); }));
+
+    // PersistentVector.slice(vector, start, end?) - Elements in [start, end)
+    factory.setProperty(rt, "slice", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "slice"), 3, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                     {
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
+            if (!vec)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "PersistentVector instance is invalid");
+            }
+            size_t start = indexArg(runtime, args, count, 1, "slice");
+            size_t end = count > 2 && !args[2].isUndefined()
+                             ? indexArg(runtime, args, count, 2, "slice")
+                             : vec->count();
+            auto newVec = vec->slice(runtime, start, end);
+            return createHostObject(runtime, newVec); }));
+
+    // PersistentVector.concat(vector, other) - Concatenation of two vectors
+    factory.setProperty(rt, "concat", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "concat"), 2, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                      {
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
+            if (!vec)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "PersistentVector instance is invalid");
+            }
+            if (count < 2 || !args[1].isObject())
+            {
+              throw facebook::jsi::JSError(runtime, "concat requires two vectors");
+            }
+            auto other = hostAs<PersistentVectorHostObject>(runtime, args, count, 1);
+            if (!other)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "Second argument must be a PersistentVector instance");
+            }
+            auto newVec = vec->concat(*other);
+            return createHostObject(runtime, newVec); }));
+
+    // PersistentVector.insertAt(vector, index, value) - Insert before index
+    factory.setProperty(rt, "insertAt", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "insertAt"), 3, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                        {
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
+            if (!vec)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "PersistentVector instance is invalid");
+            }
+            if (count < 3)
+            {
+              throw facebook::jsi::JSError(runtime, "insertAt requires a vector, index, and value argument");
+            }
+            auto newVec = vec->insertAt(runtime, indexArg(runtime, args, count, 1, "insertAt"), args[2]);
+            return createHostObject(runtime, newVec); }));
+
+    // PersistentVector.eraseAt(vector, index) - Remove the element at index
+    factory.setProperty(rt, "eraseAt", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "eraseAt"), 2, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                       {
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
+            if (!vec)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "PersistentVector instance is invalid");
+            }
+            auto newVec = vec->eraseAt(runtime, indexArg(runtime, args, count, 1, "eraseAt"));
+            return createHostObject(runtime, newVec); }));
 
     factory.setProperty(rt, "first", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "first"), 1, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
                                                                                      {
-            auto vec = args[0].getObject(runtime).getHostObject<PersistentVectorHostObject>(runtime);
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
             if (!vec)
             {
               throw facebook::jsi::JSError(runtime,
@@ -557,7 +1135,7 @@ namespace cljs
 
     factory.setProperty(rt, "last", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "last"), 1, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
                                                                                     {
-            auto vec = args[0].getObject(runtime).getHostObject<PersistentVectorHostObject>(runtime);
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
             if (!vec)
             {
               throw facebook::jsi::JSError(runtime,
@@ -567,7 +1145,7 @@ namespace cljs
 
     factory.setProperty(rt, "isEmpty", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "isEmpty"), 1, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
                                                                                        {
-            auto vec = args[0].getObject(runtime).getHostObject<PersistentVectorHostObject>(runtime);
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
             if (!vec)
             {
               throw facebook::jsi::JSError(runtime,
@@ -577,7 +1155,7 @@ namespace cljs
 
     factory.setProperty(rt, "toArray", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "toArray"), 1, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
                                                                                        {
-            auto vec = args[0].getObject(runtime).getHostObject<PersistentVectorHostObject>(runtime);
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
             if (!vec)
             {
               throw facebook::jsi::JSError(runtime,
@@ -587,7 +1165,7 @@ namespace cljs
 
     factory.setProperty(rt, "reduce", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "reduce"), 3, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
                                                                                       {
-            auto vec = args[0].getObject(runtime).getHostObject<PersistentVectorHostObject>(runtime);
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
             if (!vec)
             {
               throw facebook::jsi::JSError(runtime,
@@ -603,7 +1181,7 @@ namespace cljs
 
     factory.setProperty(rt, "batchConj", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "batchConj"), 2, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
                                                                                          {
-            auto vec = args[0].getObject(runtime).getHostObject<PersistentVectorHostObject>(runtime);
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
             if (!vec)
             {
               throw facebook::jsi::JSError(runtime,
@@ -616,11 +1194,11 @@ namespace cljs
             }
             auto arr = args[1].getObject(runtime).getArray(runtime);
             auto newVec = vec->batchConj(runtime, arr);
-            return facebook::jsi::Object::createFromHostObject(runtime, newVec); }));
+            return createHostObject(runtime, newVec); }));
 
     factory.setProperty(rt, "batchAssoc", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "batchAssoc"), 2, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
                                                                                           {
-            auto vec = args[0].getObject(runtime).getHostObject<PersistentVectorHostObject>(runtime);
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
             if (!vec)
             {
               throw facebook::jsi::JSError(runtime,
@@ -633,7 +1211,202 @@ namespace cljs
             }
             auto obj = args[1].getObject(runtime);
             auto newVec = vec->batchAssoc(runtime, obj);
-            return facebook::jsi::Object::createFromHostObject(runtime, newVec); }));
+            return createHostObject(runtime, newVec); }));
+
+    // PersistentVector.transient(vector) - Create an editable transient copy
+    factory.setProperty(rt, "transient", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "transient"), 1, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                         {
+            if (count < 1 || !args[0].isObject())
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "transient requires a vector argument");
+            }
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
+            if (!vec)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "PersistentVector instance is invalid");
+            }
+            auto transient = std::make_shared<TransientVectorHostObject>(vec->getVector().transient());
+            return createHostObject(runtime, transient); }));
+
+    // PersistentVector["conj!"](transient, value) - Append in place, returns the transient
+    factory.setProperty(rt, "conj!", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "conj!"), 2, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                     {
+            if (count < 2 || !args[0].isObject())
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "conj! requires a transient and a value");
+            }
+            auto transientObj = args[0].getObject(runtime);
+            auto transient = hostAs<TransientVectorHostObject>(runtime, transientObj);
+            if (!transient)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "TransientVector instance is invalid");
+            }
+            transient->conj(runtime, args[1]);
+            return facebook::jsi::Value(runtime, transientObj); }));
+
+    // PersistentVector["assoc!"](transient, index, value) - Set in place, returns the transient
+    factory.setProperty(rt, "assoc!", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "assoc!"), 3, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                      {
+            if (count < 3 || !args[0].isObject() || !args[1].isNumber())
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "assoc! requires a transient, index, and value argument");
+            }
+            auto transientObj = args[0].getObject(runtime);
+            auto transient = hostAs<TransientVectorHostObject>(runtime, transientObj);
+            if (!transient)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "TransientVector instance is invalid");
+            }
+            size_t index = indexArg(runtime, args, count, 1, "assoc!");
+            transient->assoc(runtime, index, args[2]);
+            return facebook::jsi::Value(runtime, transientObj); }));
+
+    // PersistentVector["pop!"](transient) - Remove last element in place, returns the transient
+    factory.setProperty(rt, "pop!", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "pop!"), 1, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                    {
+            if (count < 1 || !args[0].isObject())
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "pop! requires a transient argument");
+            }
+            auto transientObj = args[0].getObject(runtime);
+            auto transient = hostAs<TransientVectorHostObject>(runtime, transientObj);
+            if (!transient)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "TransientVector instance is invalid");
+            }
+            transient->pop(runtime);
+            return facebook::jsi::Value(runtime, transientObj); }));
+
+    // PersistentVector["nth!"](transient, index) - Read from a transient
+    factory.setProperty(rt, "nth!", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "nth!"), 2, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                    {
+            if (count < 2 || !args[0].isObject() || !args[1].isNumber())
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "nth! requires a transient and a numeric index argument");
+            }
+            auto transient = hostAs<TransientVectorHostObject>(runtime, args, count, 0);
+            if (!transient)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "TransientVector instance is invalid");
+            }
+            size_t index = indexArg(runtime, args, count, 1, "nth!");
+            return transient->nth(runtime, index); }));
+
+    // PersistentVector["persistent!"](transient) - Freeze into a PersistentVector
+    factory.setProperty(rt, "persistent!", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "persistent!"), 1, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                           {
+            if (count < 1 || !args[0].isObject())
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "persistent! requires a transient argument");
+            }
+            auto transient = hostAs<TransientVectorHostObject>(runtime, args, count, 0);
+            if (!transient)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "TransientVector instance is invalid");
+            }
+            auto vec = transient->persistent(runtime);
+            return createHostObject(runtime, vec); }));
+
+    // PersistentVector.iterator(vector, start) - Create a leaf-chunk iterator
+    factory.setProperty(rt, "iterator", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "iterator"), 2, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                        {
+            if (count < 1 || !args[0].isObject())
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "iterator requires a vector argument");
+            }
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
+            if (!vec)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "PersistentVector instance is invalid");
+            }
+            size_t start = count > 1 && !args[1].isUndefined() ? indexArg(runtime, args, count, 1, "iterator") : 0;
+            auto it = std::make_shared<VectorChunkIteratorHostObject>(vec->getVector(), start);
+            return createHostObject(runtime, it); }));
+
+    // PersistentVector.nextChunk(iterator) - Next leaf as an array, or undefined
+    factory.setProperty(rt, "nextChunk", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "nextChunk"), 1, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                         {
+            if (count < 1 || !args[0].isObject())
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "nextChunk requires an iterator argument");
+            }
+            auto it = hostAs<VectorChunkIteratorHostObject>(runtime, args, count, 0);
+            if (!it)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "PersistentVector iterator is invalid");
+            }
+            return it->nextChunk(runtime); }));
+
+    // PersistentVector.hashOrdered(vector) - cljs-compatible hash, cached
+    factory.setProperty(rt, "hashOrdered", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "hashOrdered"), 1, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                           {
+            if (count < 1 || !args[0].isObject())
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "hashOrdered requires a vector argument");
+            }
+            auto vec = hostAs<PersistentVectorHostObject>(runtime, args, count, 0);
+            if (!vec)
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "PersistentVector instance is invalid");
+            }
+            return facebook::jsi::Value(vec->hashOrdered(runtime)); }));
+
+    // PersistentVector.setHashFunction(hash) - cljs.core/hash for object elements
+    factory.setProperty(rt, "setHashFunction", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "setHashFunction"), 1, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                               {
+            if (count < 1 || !args[0].isObject() || !args[0].getObject(runtime).isFunction(runtime))
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "setHashFunction requires a function");
+            }
+            KeyHandlers::forRuntime(runtime).installHash(runtime, args[0].getObject(runtime).getFunction(runtime));
+            return facebook::jsi::Value::undefined(); }));
+
+    // PersistentVector.setReducedType(Reduced) - cljs.core/Reduced, so reduce
+    // can stop early
+    factory.setProperty(rt, "setReducedType", facebook::jsi::Function::createFromHostFunction(rt, facebook::jsi::PropNameID::forAscii(rt, "setReducedType"), 1, [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &, const facebook::jsi::Value *args, size_t count) -> facebook::jsi::Value
+                                                                                              {
+            if (count < 1 || !args[0].isObject() || !args[0].getObject(runtime).isFunction(runtime))
+            {
+              throw facebook::jsi::JSError(runtime,
+                                           "setReducedType requires a constructor");
+            }
+            KeyHandlers::forRuntime(runtime).installReducedType(runtime, args[0].getObject(runtime).getFunction(runtime));
+            return facebook::jsi::Value::undefined(); }));
+
+    // PersistentVector.save(path, vector) / PersistentVector.load(path)
+    installSnapshotFunctions(rt, factory, SnapshotRoot::Vector);
+
+    // PersistentVector.memoryStats() - Native bytes behind all collections
+    installMemoryFunctions(rt, factory);
+
+    // PersistentVector.setWrapHandlers(unwrap, wrap) - cljs wrapper for
+    // PersistentMap.assocIn and friends
+    installWrapHandlers(rt, factory, WrappedKind::Vector);
+
+    // PersistentVector.sum(vector), .min, .countWhere, ... - Native numeric kernels
+    installVectorReductions(rt, factory, ReductionTarget::Vector);
+
+    // PersistentVector.float64 / PersistentVector.int32 - Unboxed numeric vectors
+    installTypedVectors(rt, factory);
 
     // Install the factory object as globalThis.PersistentVector
     rt.global()
@@ -9,10 +9,13 @@
 
 #include <immer/flex_vector.hpp>
 #include <immer/flex_vector_transient.hpp>
+#include <immer/algorithm.hpp>
 
+#include "MemoryPolicy.h"
 #include "StoredValue.h"
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <variant>
 
@@ -35,13 +38,16 @@ namespace cljs
    * - toArray() - Converts to a JavaScript array
    * - batchConj(values) - Batch append multiple values (optimized)
    * - batchAssoc(updates) - Batch update multiple indices (optimized)
+   * - reduce(fn, init?) - fn(acc, element, index) in order, stopping at a
+   *   Reduced
+   * - diff(other, handlers) - Index-wise structural diff against another version
    */
   class PersistentVectorHostObject
       : public facebook::jsi::HostObject,
         public std::enable_shared_from_this<PersistentVectorHostObject>
   {
   public:
-    using VectorType = immer::flex_vector<StoredValue>;
+    using VectorType = immer::flex_vector<StoredValue, NativeMemoryPolicy>;
 
     // Constructors
     PersistentVectorHostObject() = default;
@@ -63,7 +69,16 @@ namespace cljs
     // Vector operations
     size_t count() const;
     facebook::jsi::Value nth(facebook::jsi::Runtime &rt, size_t index) const;
+    // cljs = over the elements; true at once for a shared root, false at once
+    // when both cached hashes differ, and shared leaves are skipped
     bool equiv(facebook::jsi::Runtime &rt, const facebook::jsi::Value &other) const;
+
+    // Index-wise diff against other through the optional added(i, v),
+    // removed(i, v) and changed(i, old, new) functions of handlers. Leaves
+    // shared by both versions are skipped without comparing their elements.
+    void diff(facebook::jsi::Runtime &rt, const PersistentVectorHostObject &other,
+              const facebook::jsi::Object &handlers) const;
+
     std::shared_ptr<PersistentVectorHostObject>
     conj(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value) const;
     std::shared_ptr<PersistentVectorHostObject> pop() const;
@@ -75,6 +90,19 @@ namespace cljs
     bool isEmpty() const;
     facebook::jsi::Array toArray(facebook::jsi::Runtime &rt) const;
 
+    // Structural slicing and splicing; all O(log n) on the RRB tree
+    std::shared_ptr<PersistentVectorHostObject> take(size_t n) const;
+    std::shared_ptr<PersistentVectorHostObject> drop(size_t n) const;
+    std::shared_ptr<PersistentVectorHostObject>
+    slice(facebook::jsi::Runtime &rt, size_t start, size_t end) const;
+    std::shared_ptr<PersistentVectorHostObject>
+    concat(const PersistentVectorHostObject &other) const;
+    std::shared_ptr<PersistentVectorHostObject>
+    insertAt(facebook::jsi::Runtime &rt, size_t index,
+             const facebook::jsi::Value &value) const;
+    std::shared_ptr<PersistentVectorHostObject>
+    eraseAt(facebook::jsi::Runtime &rt, size_t index) const;
+
     // Batch operations using transient vectors for efficiency
     std::shared_ptr<PersistentVectorHostObject>
     batchConj(facebook::jsi::Runtime &rt, const facebook::jsi::Array &values) const;
@@ -83,15 +111,26 @@ namespace cljs
     batchAssoc(facebook::jsi::Runtime &rt,
                const facebook::jsi::Object &updates) const;
 
-    // High-performance reduce/forEach for iteration-heavy operations
+    // fn(acc, element, index) over the leaves in order. Stops early and
+    // returns the Reduced itself when fn returns one (see
+    // KeyHandlers::isReduced); callers unwrap it
     facebook::jsi::Value
     reduce(facebook::jsi::Runtime &rt, const facebook::jsi::Function &fn,
            const facebook::jsi::Value &initialValue) const;
+    // Without an initial value: (fn) when empty, else starts from element 0
+    facebook::jsi::Value
+    reduce(facebook::jsi::Runtime &rt, const facebook::jsi::Function &fn) const;
+
+    // cljs.core/hash-ordered-coll, cached after the first call
+    int32_t hashOrdered(facebook::jsi::Runtime &rt) const;
 
     // Access the underlying vector (for testing/debugging)
     const VectorType &getVector() const { return vec_; }
 
   private:
+    friend class TransientVectorHostObject;
+    friend class VectorChunkIteratorHostObject;
+
     // Helper to convert jsi::Value to StoredValue for storage
     static StoredValue convertValue(facebook::jsi::Runtime &rt,
                                     const facebook::jsi::Value &value);
@@ -100,7 +139,87 @@ namespace cljs
     static facebook::jsi::Value reconstructValue(facebook::jsi::Runtime &rt,
                                                  const StoredValue &stored);
 
+    facebook::jsi::Value reduceFrom(facebook::jsi::Runtime &rt,
+                                    const facebook::jsi::Function &fn,
+                                    facebook::jsi::Value accumulator, size_t start) const;
+
     VectorType vec_;
+    mutable std::optional<int32_t> hash_;
+  };
+
+  /**
+   * TransientVectorHostObject wraps an immer::flex_vector_transient so that
+   * ClojureScript transients (conj!, assoc!, pop!) edit nodes in place
+   * instead of path-copying and allocating a new host object per operation.
+   *
+   * Once persistent() has been called the transient is invalidated and any
+   * further use throws, matching ClojureScript semantics.
+   *
+   * Operations:
+   * - count() - Returns the number of elements
+   * - nth(index) - Returns the element at the given index
+   * - conj(value) - Appends value in place
+   * - assoc(index, value) - Sets value at index in place (index == count appends)
+   * - pop() - Removes the last element in place
+   * - persistent() - Returns a PersistentVector and invalidates the transient
+   */
+  class TransientVectorHostObject : public facebook::jsi::HostObject
+  {
+  public:
+    using TransientType = PersistentVectorHostObject::VectorType::transient_type;
+
+    explicit TransientVectorHostObject(TransientType transient);
+
+    // HostObject interface
+    facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                             const facebook::jsi::PropNameID &name) override;
+    void set(facebook::jsi::Runtime &rt, const facebook::jsi::PropNameID &name,
+             const facebook::jsi::Value &value) override;
+    std::vector<facebook::jsi::PropNameID>
+    getPropertyNames(facebook::jsi::Runtime &rt) override;
+
+    // Transient operations (mutate in place)
+    size_t count() const;
+    facebook::jsi::Value nth(facebook::jsi::Runtime &rt, size_t index) const;
+    void conj(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value);
+    void assoc(facebook::jsi::Runtime &rt, size_t index,
+               const facebook::jsi::Value &value);
+    void pop(facebook::jsi::Runtime &rt);
+    std::shared_ptr<PersistentVectorHostObject>
+    persistent(facebook::jsi::Runtime &rt);
+
+  private:
+    // Throws if the transient was already made persistent
+    void ensureEditable(facebook::jsi::Runtime &rt) const;
+
+    TransientType transient_;
+    bool editable_ = true;
+  };
+
+  /**
+   * VectorChunkIteratorHostObject walks a vector one immer leaf at a time,
+   * so ClojureScript can build a lazy chunked seq without materializing the
+   * whole vector. It holds its own (structurally shared) copy of the vector.
+   *
+   * Operations:
+   * - nextChunk() - Returns the next leaf (up to 32 elements) as a JS array,
+   *   or undefined when exhausted
+   */
+  class VectorChunkIteratorHostObject : public facebook::jsi::HostObject
+  {
+  public:
+    VectorChunkIteratorHostObject(PersistentVectorHostObject::VectorType vec,
+                                  size_t start);
+
+    // HostObject interface
+    facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                             const facebook::jsi::PropNameID &name) override;
+
+    facebook::jsi::Value nextChunk(facebook::jsi::Runtime &rt);
+
+  private:
+    PersistentVectorHostObject::VectorType vec_;
+    size_t pos_;
   };
 
   /**
@@ -109,6 +228,17 @@ namespace cljs
    *
    *   const v1 = PersistentVector.empty();
    *   const v2 = PersistentVector.from([1, 2, 3]);
+   *
+   *   const t = PersistentVector.transient(v2);
+   *   PersistentVector["conj!"](t, 4);
+   *   const v3 = PersistentVector["persistent!"](t);
+   *
+   * The vectors also carry their operations as methods, which skip the
+   * factory lookup and argument type check:
+   *
+   *   v2.count;                          // 3
+   *   const v4 = v2.conj(4).assoc(0, 0);
+   *   const v5 = v4.transient().conj(5).conj(6).persistent();
    */
   void installPersistentVector(facebook::jsi::Runtime &rt);
 
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <cassert>
 #include <chrono>
+#include <cmath>
 
 using namespace cljs;
 using namespace facebook::jsi;
@@ -33,20 +34,27 @@ public:
         std::cout << "Testing optimized value storage..." << std::endl;
 
         // Test StoredValue constructors
+        static_assert(sizeof(StoredValue) == 8, "StoredValue should be one word");
+
         StoredValue nil;
-        assert(nil.type == StoredValue::NIL);
+        assert(nil.type() == StoredValue::NIL);
 
         StoredValue b(true);
-        assert(b.type == StoredValue::BOOL);
-        assert(b.primitive.bool_val == true);
+        assert(b.type() == StoredValue::BOOL);
+        assert(b.asBool() == true);
 
         StoredValue n(42.0);
-        assert(n.type == StoredValue::NUMBER);
-        assert(n.primitive.number_val == 42.0);
+        assert(n.type() == StoredValue::NUMBER);
+        assert(n.asNumber() == 42.0);
+
+        StoredValue nan(std::nan(""));
+        assert(nan.type() == StoredValue::NUMBER);
+        assert(nan != nan);
 
         StoredValue s("hello");
-        assert(s.type == StoredValue::STRING);
-        assert(*s.string_val == "hello");
+        assert(s.type() == StoredValue::STRING);
+        assert(s.asString() == "hello");
+        assert(s == StoredValue(std::string("hello")));
 
         std::cout << "✓ Value storage optimization passed" << std::endl;
     }
@@ -75,11 +83,11 @@ public:
         std::cout << "   - batchAssoc(N): O(1) amortized for N items, structural sharing" << std::endl;
 
         std::cout << "\n2. Optimized value storage:" << std::endl;
-        std::cout << "   - Primitives (bool, number): 0 allocation, stored in union" << std::endl;
-        std::cout << "   - Strings: 1 shared_ptr allocation (amortized across vector)" << std::endl;
-        std::cout << "   - Objects: 1 shared_ptr allocation (proper lifecycle)" << std::endl;
-        std::cout << "   - Before: Every value = 1 shared_ptr<jsi::Value>" << std::endl;
-        std::cout << "   - After: Most values = no allocation (stored in union)" << std::endl;
+        std::cout << "   - Every slot is one 8-byte NaN-boxed word" << std::endl;
+        std::cout << "   - Primitives (nil, bool, number): 0 allocation, stored inline" << std::endl;
+        std::cout << "   - Strings: 1 intrusively refcounted cell" << std::endl;
+        std::cout << "   - Objects: 1 intrusively refcounted cell (proper lifecycle)" << std::endl;
+        std::cout << "   - Before: 48-byte tagged union with two shared_ptr members" << std::endl;
 
         std::cout << "\n3. Structural sharing (via immer):" << std::endl;
         std::cout << "   - Modified nodes: only on the path of change" << std::endl;
@@ -0,0 +1,757 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "Snapshot.h"
+#include "HostArgs.h"
+#include "KeyHashing.h"
+#include "MappedFileBuffer.h"
+#include "NativeMemory.h"
+#include "PersistentMap.h"
+#include "PersistentSet.h"
+#include "PersistentVector.h"
+#include "StringTable.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace cljs
+{
+
+    namespace
+    {
+        // Fixed-width fields are written in host byte order; snapshots are a
+        // local cache, not an interchange format
+        constexpr char kMagic[8] = {'C', 'L', 'J', 'S', 'S', 'N', 'P', '1'};
+        constexpr uint32_t kMultipleRoots = 1;
+
+        enum ValueTag : uint8_t
+        {
+            kNil,
+            kFalse,
+            kTrue,
+            kNumber,
+            kString,
+            kRevive,      // string index, turned back into an object by reviveKey
+            kNode,        // collection node index
+            kEncodedNode, // collection node index, passed through decode on load
+        };
+
+        enum NodeKind : uint8_t
+        {
+            kLeaf,
+            kVector,
+            kMap,
+            kSet,
+        };
+
+        const char *kindName(NodeKind kind)
+        {
+            switch (kind)
+            {
+            case kVector:
+                return "vector";
+            case kMap:
+                return "map";
+            case kSet:
+                return "set";
+            case kLeaf:
+                break;
+            }
+            return "leaf";
+        }
+
+        std::optional<facebook::jsi::Function>
+        optionFunction(facebook::jsi::Runtime &rt, const facebook::jsi::Value &options,
+                       const char *name)
+        {
+            if (!options.isObject())
+            {
+                return std::nullopt;
+            }
+            auto prop = options.getObject(rt).getProperty(rt, name);
+            if (prop.isObject() && prop.getObject(rt).isFunction(rt))
+            {
+                return prop.getObject(rt).getFunction(rt);
+            }
+            return std::nullopt;
+        }
+
+        void putU8(std::string &out, uint8_t v) { out.push_back(static_cast<char>(v)); }
+
+        void putU32(std::string &out, uint32_t v)
+        {
+            out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+        }
+
+        void putF64(std::string &out, double v)
+        {
+            out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+        }
+
+        class SnapshotWriter
+        {
+        public:
+            SnapshotWriter(facebook::jsi::Runtime &rt, const facebook::jsi::Value &options)
+                : rt_(rt), encode_(optionFunction(rt, options, "encode")) {}
+
+            // Appends a root; returns the node kind when it is a collection
+            std::optional<NodeKind> addRoot(const facebook::jsi::Value &root)
+            {
+                lastKind_.reset();
+                if (root.isObject())
+                {
+                    writeObject(roots_, root.getObject(rt_));
+                }
+                else if (root.isString())
+                {
+                    writeValue(roots_, internString(root.getString(rt_).utf8(rt_)));
+                }
+                else if (root.isNumber())
+                {
+                    writeValue(roots_, StoredValue(root.getNumber()));
+                }
+                else if (root.isBool())
+                {
+                    writeValue(roots_, StoredValue(root.getBool()));
+                }
+                else
+                {
+                    writeValue(roots_, StoredValue());
+                }
+                ++rootCount_;
+                return lastKind_;
+            }
+
+            void writeFile(const std::string &path, bool multipleRoots)
+            {
+                std::string header(kMagic, sizeof(kMagic));
+                putU32(header, multipleRoots ? kMultipleRoots : 0);
+                putU32(header, static_cast<uint32_t>(strings_.size()));
+                for (const auto &s : strings_)
+                {
+                    putU32(header, static_cast<uint32_t>(s.asString().size()));
+                    header.append(s.asString());
+                }
+                putU32(header, nodeCount_);
+
+                std::string tail;
+                putU32(tail, rootCount_);
+
+                // Write next to the target and rename, so a crash mid-save
+                // never leaves a truncated snapshot behind
+                std::string tmpPath = path + ".tmp";
+                {
+                    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+                    file.write(header.data(), header.size());
+                    file.write(nodes_.data(), nodes_.size());
+                    file.write(tail.data(), tail.size());
+                    file.write(roots_.data(), roots_.size());
+                    if (!file)
+                    {
+                        throw facebook::jsi::JSError(rt_, "Failed to write snapshot: " + tmpPath);
+                    }
+                }
+                if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+                {
+                    std::remove(tmpPath.c_str());
+                    throw facebook::jsi::JSError(rt_, "Failed to write snapshot: " + path);
+                }
+            }
+
+        private:
+            uint32_t stringIndex(const StoredValue &s)
+            {
+                auto [it, inserted] = stringIndex_.try_emplace(
+                    s.stringCell(), static_cast<uint32_t>(strings_.size()));
+                if (inserted)
+                {
+                    strings_.push_back(s);
+                }
+                return it->second;
+            }
+
+            void writeValue(std::string &out, const StoredValue &v)
+            {
+                switch (v.type())
+                {
+                case StoredValue::NIL:
+                    putU8(out, kNil);
+                    return;
+                case StoredValue::BOOL:
+                    putU8(out, v.asBool() ? kTrue : kFalse);
+                    return;
+                case StoredValue::NUMBER:
+                    putU8(out, kNumber);
+                    putF64(out, v.asNumber());
+                    return;
+                case StoredValue::STRING:
+                    putU8(out, kString);
+                    putU32(out, stringIndex(v));
+                    return;
+                case StoredValue::INTERNED_KEY:
+                    // Keywords/symbols/UUIDs are fully described by their
+                    // canonical string
+                    putU8(out, kRevive);
+                    putU32(out, stringIndex(StoredValue::adoptString(retained(v.objectCell()->canonical))));
+                    return;
+                case StoredValue::OBJECT_REF:
+                case StoredValue::HASHED_REF:
+                    writeObject(out, v.asObject(rt_));
+                    return;
+                }
+            }
+
+            static detail::StringCell *retained(detail::StringCell *cell)
+            {
+                detail::retain(cell);
+                return cell;
+            }
+
+            void writeObject(std::string &out, const facebook::jsi::Object &obj)
+            {
+                if (auto node = collectionNode(obj))
+                {
+                    putU8(out, kNode);
+                    putU32(out, *node);
+                    return;
+                }
+                if (encode_)
+                {
+                    auto encoded = encode_->call(rt_, facebook::jsi::Value(rt_, obj));
+                    if (encoded.isString())
+                    {
+                        putU8(out, kRevive);
+                        putU32(out, stringIndex(internString(encoded.getString(rt_).utf8(rt_))));
+                        return;
+                    }
+                    if (encoded.isObject())
+                    {
+                        if (auto node = collectionNode(encoded.getObject(rt_)))
+                        {
+                            putU8(out, kEncodedNode);
+                            putU32(out, *node);
+                            return;
+                        }
+                    }
+                }
+                throw facebook::jsi::JSError(
+                    rt_, "Cannot snapshot a value that is not a native collection, "
+                         "string, number, boolean or nil (see options.encode)");
+            }
+
+            // Writes obj (and everything it references) if it is a native
+            // collection not written yet, returning its node index
+            std::optional<uint32_t> collectionNode(const facebook::jsi::Object &obj)
+            {
+                if (!obj.isHostObject(rt_))
+                {
+                    return std::nullopt;
+                }
+
+                std::string body;
+                const void *identity = nullptr;
+                NodeKind kind;
+                if (auto vec = hostAs<PersistentVectorHostObject>(rt_, obj))
+                {
+                    if (auto found = lookupNode(vec.get(), kVector))
+                        return found;
+                    identity = vec.get();
+                    kind = kVector;
+                    writeVectorBody(body, vec->getVector());
+                }
+                else if (auto map = hostAs<PersistentMapHostObject>(rt_, obj))
+                {
+                    if (auto found = lookupNode(map.get(), kMap))
+                        return found;
+                    identity = map.get();
+                    kind = kMap;
+                    putU32(body, static_cast<uint32_t>(map->getMap().size()));
+                    for (const auto &entry : map->getMap())
+                    {
+                        writeValue(body, entry.first);
+                        writeValue(body, entry.second);
+                    }
+                }
+                else if (auto set = hostAs<PersistentSetHostObject>(rt_, obj))
+                {
+                    if (auto found = lookupNode(set.get(), kSet))
+                        return found;
+                    identity = set.get();
+                    kind = kSet;
+                    putU32(body, static_cast<uint32_t>(set->getSet().size()));
+                    for (const auto &element : set->getSet())
+                    {
+                        writeValue(body, element);
+                    }
+                }
+                else
+                {
+                    return std::nullopt;
+                }
+
+                uint32_t index = appendNode(kind, body);
+                nodeIndex_.emplace(identity, index);
+                lastKind_ = kind;
+                return index;
+            }
+
+            std::optional<uint32_t> lookupNode(const void *identity, NodeKind kind)
+            {
+                auto it = nodeIndex_.find(identity);
+                if (it == nodeIndex_.end())
+                    return std::nullopt;
+                lastKind_ = kind;
+                return it->second;
+            }
+
+            void writeVectorBody(std::string &body,
+                                 const PersistentVectorHostObject::VectorType &vec)
+            {
+                std::vector<uint32_t> leaves;
+                immer::for_each_chunk(vec, [&](const StoredValue *first, const StoredValue *last)
+                                      {
+                    // Leaves shared between vectors (or versions of one) are
+                    // written once
+                    auto it = leafIndex_.find(first);
+                    if (it != leafIndex_.end())
+                    {
+                        leaves.push_back(it->second);
+                        return;
+                    }
+                    // Nested collections may add leaves, so no iterator is
+                    // held across writeValue
+                    std::string leaf;
+                    putU32(leaf, static_cast<uint32_t>(last - first));
+                    for (auto *p = first; p != last; ++p)
+                        writeValue(leaf, *p);
+                    uint32_t index = appendNode(kLeaf, leaf);
+                    leafIndex_.emplace(first, index);
+                    leaves.push_back(index); });
+
+                putU32(body, static_cast<uint32_t>(leaves.size()));
+                for (uint32_t leaf : leaves)
+                {
+                    putU32(body, leaf);
+                }
+            }
+
+            uint32_t appendNode(NodeKind kind, const std::string &body)
+            {
+                putU8(nodes_, kind);
+                nodes_.append(body);
+                return nodeCount_++;
+            }
+
+            facebook::jsi::Runtime &rt_;
+            std::optional<facebook::jsi::Function> encode_;
+
+            std::vector<StoredValue> strings_;
+            std::unordered_map<const void *, uint32_t> stringIndex_;
+            std::unordered_map<const void *, uint32_t> leafIndex_;
+            std::unordered_map<const void *, uint32_t> nodeIndex_;
+
+            std::string nodes_;
+            uint32_t nodeCount_ = 0;
+            std::string roots_;
+            uint32_t rootCount_ = 0;
+            std::optional<NodeKind> lastKind_;
+        };
+
+        class SnapshotReader
+        {
+        public:
+            SnapshotReader(facebook::jsi::Runtime &rt, const facebook::jsi::Value &options,
+                           const facebook::jsi::Buffer &buffer)
+                : rt_(rt),
+                  reviveKey_(optionFunction(rt, options, "reviveKey")),
+                  decode_(optionFunction(rt, options, "decode")),
+                  pos_(buffer.data()),
+                  end_(buffer.data() + buffer.size()) {}
+
+            // Reads the whole file; returns the single root, or an array of
+            // roots when several were saved. A single root must be rootType.
+            facebook::jsi::Value read(NodeKind rootType)
+            {
+                if (remaining() < sizeof(kMagic) || std::memcmp(pos_, kMagic, sizeof(kMagic)) != 0)
+                {
+                    throw facebook::jsi::JSError(rt_, "Not a native collection snapshot");
+                }
+                pos_ += sizeof(kMagic);
+                uint32_t flags = u32();
+
+                uint32_t stringCount = u32();
+                strings_.reserve(stringCount);
+                for (uint32_t i = 0; i < stringCount; ++i)
+                {
+                    uint32_t len = u32();
+                    need(len);
+                    strings_.push_back(internString(std::string(reinterpret_cast<const char *>(pos_), len)));
+                    pos_ += len;
+                }
+                revived_.resize(stringCount);
+
+                uint32_t nodeCount = u32();
+                nodes_.reserve(nodeCount);
+                for (uint32_t i = 0; i < nodeCount; ++i)
+                {
+                    readNode();
+                }
+
+                uint32_t rootCount = u32();
+                if (flags & kMultipleRoots)
+                {
+                    facebook::jsi::Array roots(rt_, rootCount);
+                    for (uint32_t i = 0; i < rootCount; ++i)
+                    {
+                        roots.setValueAtIndex(rt_, i, toJS(readValue(false)));
+                    }
+                    return roots;
+                }
+
+                if (rootCount != 1 || remaining() < 5 ||
+                    (*pos_ != kNode && *pos_ != kEncodedNode) ||
+                    nodeAt(peekU32(1)).kind != rootType)
+                {
+                    std::ostringstream msg;
+                    msg << "Snapshot root is not a " << kindName(rootType);
+                    throw facebook::jsi::JSError(rt_, msg.str());
+                }
+                return toJS(readValue(false));
+            }
+
+        private:
+            struct Node
+            {
+                NodeKind kind;
+                // kLeaf, built once so every vector using it shares its nodes
+                PersistentVectorHostObject::VectorType leaf;
+                StoredValue object;            // collections: the host object
+                std::optional<StoredValue> decoded;
+            };
+
+            size_t remaining() const { return static_cast<size_t>(end_ - pos_); }
+
+            void need(size_t n) const
+            {
+                if (remaining() < n)
+                {
+                    throw facebook::jsi::JSError(rt_, "Snapshot is truncated");
+                }
+            }
+
+            uint8_t u8()
+            {
+                need(1);
+                return *pos_++;
+            }
+
+            uint32_t u32()
+            {
+                need(sizeof(uint32_t));
+                uint32_t v;
+                std::memcpy(&v, pos_, sizeof(v));
+                pos_ += sizeof(v);
+                return v;
+            }
+
+            uint32_t peekU32(size_t offset) const
+            {
+                uint32_t v;
+                std::memcpy(&v, pos_ + offset, sizeof(v));
+                return v;
+            }
+
+            double f64()
+            {
+                need(sizeof(double));
+                double v;
+                std::memcpy(&v, pos_, sizeof(v));
+                pos_ += sizeof(v);
+                return v;
+            }
+
+            const Node &nodeAt(uint32_t index) const
+            {
+                if (index >= nodes_.size())
+                {
+                    throw facebook::jsi::JSError(rt_, "Snapshot references a missing node");
+                }
+                return nodes_[index];
+            }
+
+            const StoredValue &stringAt(uint32_t index) const
+            {
+                if (index >= strings_.size())
+                {
+                    throw facebook::jsi::JSError(rt_, "Snapshot references a missing string");
+                }
+                return strings_[index];
+            }
+
+            // asKey: map keys and set elements go through the key handlers
+            // so keywords and IHash values hash like freshly added keys
+            StoredValue readValue(bool asKey)
+            {
+                switch (u8())
+                {
+                case kNil:
+                    return StoredValue();
+                case kFalse:
+                    return StoredValue(false);
+                case kTrue:
+                    return StoredValue(true);
+                case kNumber:
+                    return StoredValue(f64());
+                case kString:
+                    return stringAt(u32());
+                case kRevive:
+                    return objectValue(revive(u32()), asKey);
+                case kNode:
+                {
+                    const Node &node = nodeAt(u32());
+                    if (node.kind == kLeaf)
+                        break;
+                    return objectValue(node.object, asKey);
+                }
+                case kEncodedNode:
+                {
+                    uint32_t index = u32();
+                    if (nodeAt(index).kind == kLeaf)
+                        break;
+                    return objectValue(decoded(index), asKey);
+                }
+                }
+                throw facebook::jsi::JSError(rt_, "Snapshot contains an invalid value");
+            }
+
+            StoredValue objectValue(const StoredValue &object, bool asKey)
+            {
+                if (!asKey)
+                {
+                    return object;
+                }
+                return KeyHandlers::forRuntime(rt_).convertObjectKey(
+                    rt_, object.asObject(rt_));
+            }
+
+            // Each canonical string is revived once and shared
+            const StoredValue &revive(uint32_t index)
+            {
+                const StoredValue &canonical = stringAt(index);
+                if (!revived_[index])
+                {
+                    if (!reviveKey_)
+                    {
+                        throw facebook::jsi::JSError(
+                            rt_, "Snapshot contains keywords or encoded values; pass options.reviveKey");
+                    }
+                    auto value = reviveKey_->call(rt_, stringToJS(rt_, canonical));
+                    if (!value.isObject())
+                    {
+                        throw facebook::jsi::JSError(rt_, "reviveKey must return an object");
+                    }
+                    revived_[index] = StoredValue(rt_, value.getObject(rt_));
+                }
+                return *revived_[index];
+            }
+
+            const StoredValue &decoded(uint32_t index)
+            {
+                Node &node = nodes_[index];
+                if (!node.decoded)
+                {
+                    if (!decode_)
+                    {
+                        node.decoded = node.object;
+                    }
+                    else
+                    {
+                        auto value = decode_->call(
+                            rt_, node.object.objectValue(rt_),
+                            facebook::jsi::String::createFromAscii(rt_, kindName(node.kind)));
+                        if (!value.isObject())
+                        {
+                            throw facebook::jsi::JSError(rt_, "decode must return an object");
+                        }
+                        node.decoded = StoredValue(rt_, value.getObject(rt_));
+                    }
+                }
+                return *node.decoded;
+            }
+
+            void readNode()
+            {
+                auto kind = static_cast<NodeKind>(u8());
+                Node node{kind, {}, StoredValue(), std::nullopt};
+                switch (kind)
+                {
+                case kLeaf:
+                {
+                    auto transient = node.leaf.transient();
+                    uint32_t n = u32();
+                    for (uint32_t i = 0; i < n; ++i)
+                        transient.push_back(readValue(false));
+                    node.leaf = transient.persistent();
+                    break;
+                }
+                case kVector:
+                {
+                    // Concatenating the leaf vectors keeps leaves shared between
+                    // vectors (and versions of one) shared after loading
+                    PersistentVectorHostObject::VectorType vec;
+                    uint32_t leaves = u32();
+                    for (uint32_t i = 0; i < leaves; ++i)
+                    {
+                        const Node &leaf = nodeAt(u32());
+                        if (leaf.kind != kLeaf)
+                            throw facebook::jsi::JSError(rt_, "Snapshot vector references a non-leaf");
+                        vec = std::move(vec) + leaf.leaf;
+                    }
+                    node.object = hostValue(std::make_shared<PersistentVectorHostObject>(std::move(vec)));
+                    break;
+                }
+                case kMap:
+                {
+                    KeyEquivScope scope(rt_);
+                    auto transient = PersistentMapHostObject::MapType{}.transient();
+                    uint32_t n = u32();
+                    for (uint32_t i = 0; i < n; ++i)
+                    {
+                        StoredValue key = readValue(true);
+                        transient.set(std::move(key), readValue(false));
+                    }
+                    node.object = hostValue(std::make_shared<PersistentMapHostObject>(transient.persistent()));
+                    break;
+                }
+                case kSet:
+                {
+                    KeyEquivScope scope(rt_);
+                    auto transient = PersistentSetHostObject::SetType{}.transient();
+                    uint32_t n = u32();
+                    for (uint32_t i = 0; i < n; ++i)
+                        transient.insert(readValue(true));
+                    node.object = hostValue(std::make_shared<PersistentSetHostObject>(transient.persistent()));
+                    break;
+                }
+                default:
+                    throw facebook::jsi::JSError(rt_, "Snapshot contains an invalid node");
+                }
+                nodes_.push_back(std::move(node));
+            }
+
+            StoredValue hostValue(std::shared_ptr<facebook::jsi::HostObject> host)
+            {
+                return StoredValue(rt_, createHostObject(rt_, std::move(host)));
+            }
+
+            facebook::jsi::Value toJS(const StoredValue &v)
+            {
+                switch (v.type())
+                {
+                case StoredValue::NIL:
+                    return facebook::jsi::Value::null();
+                case StoredValue::BOOL:
+                    return facebook::jsi::Value(v.asBool());
+                case StoredValue::NUMBER:
+                    return facebook::jsi::Value(v.asNumber());
+                case StoredValue::STRING:
+                    return stringToJS(rt_, v);
+                case StoredValue::OBJECT_REF:
+                case StoredValue::INTERNED_KEY:
+                case StoredValue::HASHED_REF:
+                    return v.objectValue(rt_);
+                }
+                return facebook::jsi::Value::null();
+            }
+
+            facebook::jsi::Runtime &rt_;
+            std::optional<facebook::jsi::Function> reviveKey_;
+            std::optional<facebook::jsi::Function> decode_;
+            const uint8_t *pos_;
+            const uint8_t *end_;
+
+            std::vector<StoredValue> strings_;
+            std::vector<std::optional<StoredValue>> revived_;
+            std::vector<Node> nodes_;
+        };
+    } // namespace
+
+    void installSnapshotFunctions(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory,
+                                  SnapshotRoot rootType)
+    {
+        NodeKind rootKind = rootType == SnapshotRoot::Vector ? kVector : kMap;
+
+        // <Factory>.save(path, rootOrRoots, options?) - Write a binary snapshot
+        factory.setProperty(
+            rt, "save",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "save"), 3,
+                [rootKind](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                           const facebook::jsi::Value *args,
+                           size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 2 || !args[0].isString())
+                    {
+                        throw facebook::jsi::JSError(runtime, "save requires a path and a collection");
+                    }
+                    const facebook::jsi::Value noOptions;
+                    SnapshotWriter writer(runtime, count > 2 ? args[2] : noOptions);
+
+                    bool multiple = args[1].isObject() && args[1].getObject(runtime).isArray(runtime);
+                    if (multiple)
+                    {
+                        auto roots = args[1].getObject(runtime).getArray(runtime);
+                        size_t len = roots.size(runtime);
+                        for (size_t i = 0; i < len; ++i)
+                        {
+                            writer.addRoot(roots.getValueAtIndex(runtime, i));
+                        }
+                    }
+                    else if (writer.addRoot(args[1]) != rootKind)
+                    {
+                        std::ostringstream msg;
+                        msg << "save requires a " << kindName(rootKind) << " or an array of roots";
+                        throw facebook::jsi::JSError(runtime, msg.str());
+                    }
+
+                    writer.writeFile(args[0].getString(runtime).utf8(runtime), multiple);
+                    return facebook::jsi::Value::undefined();
+                }));
+
+        // <Factory>.load(path, options?) - Map a snapshot and rebuild its roots
+        factory.setProperty(
+            rt, "load",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "load"), 2,
+                [rootKind](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                           const facebook::jsi::Value *args,
+                           size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 1 || !args[0].isString())
+                    {
+                        throw facebook::jsi::JSError(runtime, "load requires a path");
+                    }
+                    std::string path = args[0].getString(runtime).utf8(runtime);
+                    std::shared_ptr<facebook::jsi::Buffer> buffer;
+                    try
+                    {
+                        buffer = mapFileBuffer(path.c_str());
+                    }
+                    catch (const std::runtime_error &e)
+                    {
+                        throw facebook::jsi::JSError(runtime, e.what());
+                    }
+                    const facebook::jsi::Value noOptions;
+                    SnapshotReader reader(runtime, count > 1 ? args[1] : noOptions, *buffer);
+                    return reader.read(rootKind);
+                }));
+    }
+
+} // namespace cljs
@@ -0,0 +1,62 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <hermes/hermes.h>
+#include <jsi/jsi.h>
+
+#include <string>
+
+namespace cljs
+{
+
+    /**
+     * Binary snapshots of native collections.
+     *
+     * A snapshot file holds one or more roots (any mix of native vectors,
+     * maps and sets, nested arbitrarily) in pool form:
+     *
+     *   "CLJSSNP1" | u32 flags | strings | nodes | roots
+     *
+     * - strings: every distinct string once, referenced by index
+     * - nodes: vector leaves and whole collections, children before parents.
+     *   A vector leaf shared by several vectors and a collection reachable
+     *   from several places are each written once, and the loader hands
+     *   back one host object per saved collection, so sharing between roots
+     *   survives the round trip.
+     * - roots: the saved values
+     *
+     * Loading maps the file (mapFileBuffer) and builds each collection with
+     * a single transient pass straight from the mapped bytes. Each leaf
+     * becomes one small vector, and vectors are concatenations of their
+     * leaves, so vectors sharing a leaf share its node after loading too.
+     *
+     * Values that are not native collections, strings, numbers, booleans or
+     * nil go through two optional hooks:
+     * - options.encode(obj) on save may return a native collection (e.g. the
+     *   host object inside a ClojureScript wrapper) or a string that
+     *   options.reviveKey turns back into the object on load (keywords,
+     *   symbols, UUIDs). Interned map keys are saved by their canonical
+     *   string without calling encode.
+     * - options.decode(collection, kind) on load wraps collections that
+     *   encode unwrapped; kind is "vector", "map" or "set".
+     */
+
+    enum class SnapshotRoot
+    {
+        Vector,
+        Map
+    };
+
+    /**
+     * Install save(path, rootOrRoots, options?) and load(path, options?)
+     * on a PersistentVector or PersistentMap factory object. A single root
+     * must be of the factory's type; an array saves several roots into one
+     * file and loads back as an array.
+     */
+    void installSnapshotFunctions(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory,
+                                  SnapshotRoot rootType);
+
+} // namespace cljs
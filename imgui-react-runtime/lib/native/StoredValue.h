@@ -5,16 +5,143 @@
 #pragma once
 
 #include <jsi/jsi.h>
+
+#include "MemoryPolicy.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 
 namespace cljs
 {
 
+    class ObjectSlots;
+    struct StoredValue;
+
+    // ClojureScript equality for two HASHED_REF keys with equal hashes.
+    // Defined in KeyHashing.cpp; only answers true inside a KeyEquivScope.
+    bool hashedKeyEquiv(const StoredValue &a, const StoredValue &b);
+
+    namespace detail
+    {
+        /**
+         * Heap cells referenced from a StoredValue. Refcounts are intrusive, so
+         * a cell is a single allocation with no separate control block.
+         */
+        struct StringCell
+        {
+            explicit StringCell(std::string s)
+                : value(std::move(s)), hash(std::hash<std::string>{}(value))
+            {
+                nativeBytes().allocate(footprint());
+            }
+            ~StringCell() { nativeBytes().free(footprint()); }
+
+            size_t footprint() const { return sizeof(StringCell) + value.capacity(); }
+
+            RefCount refs;
+            bool interned = false;
+            std::string value;
+            size_t hash;
+
+            // Interned cells cache their JS string in jsSlot of jsSlots, the
+            // string table of the first runtime that read them (see
+            // StringTable.h). jsSlot is written once, before jsSlots is set
+#if CLJS_NATIVE_SINGLE_THREADED
+            ObjectSlots *jsSlots = nullptr;
+#else
+            std::atomic<ObjectSlots *> jsSlots{nullptr};
+#endif
+            uint32_t jsSlot = 0;
+        };
+
+        // The object itself lives in the runtime's ObjectSlots table, so a
+        // cell is not a GC root
+        struct ObjectCell
+        {
+            ObjectCell(ObjectSlots *slots, uint32_t slot) : slot(slot), slots(slots)
+            {
+                nativeBytes().allocate(sizeof(ObjectCell));
+            }
+            ~ObjectCell() { nativeBytes().free(sizeof(ObjectCell)); }
+
+            RefCount refs;
+            int32_t hash = 0;
+            uint32_t slot;
+            StringCell *canonical = nullptr;
+            ObjectSlots *slots;
+        };
+
+        // An ObjectCell without a slot that borrows the object of a lookup
+        // key (see KeyProbe in KeyHashing.h). Its owner keeps a reference,
+        // so StoredValue never frees it
+        struct ProbeCell : ObjectCell
+        {
+            explicit ProbeCell(const facebook::jsi::Object &obj)
+                : ObjectCell(nullptr, 0), object(&obj) {}
+
+            const facebook::jsi::Object *object;
+        };
+
+        // Removes an interned StringCell from the intern table and releases
+        // its JS string slot before it is freed. Defined in StringTable.cpp.
+        void unregisterInterned(StringCell *cell);
+
+        // Slot table access for ObjectCell. Defined in ObjectSlots.cpp.
+        ObjectCell *newObjectCell(facebook::jsi::Runtime &rt, const facebook::jsi::Object &obj);
+        facebook::jsi::Value objectCellValue(facebook::jsi::Runtime &rt, const ObjectCell *cell);
+        void releaseObjectSlot(ObjectCell *cell);
+
+        inline void retain(StringCell *cell)
+        {
+            cell->refs.increment();
+        }
+
+        inline void release(StringCell *cell)
+        {
+            if (cell->refs.decrement())
+            {
+                if (cell->interned)
+                    unregisterInterned(cell);
+                delete cell;
+            }
+        }
+
+        inline void retain(ObjectCell *cell)
+        {
+            cell->refs.increment();
+        }
+
+        inline void release(ObjectCell *cell)
+        {
+            if (cell->refs.decrement())
+            {
+                if (cell->canonical)
+                    release(cell->canonical);
+                releaseObjectSlot(cell);
+                delete cell;
+            }
+        }
+    } // namespace detail
+
     /**
-     * Optimized value storage: primitives are stored directly, objects wrapped in
-     * shared_ptr. This reduces allocation overhead for common cases (numbers,
-     * booleans, strings) while maintaining proper lifecycle for object references.
+     * Compact NaN-boxed value storage: one 64-bit word per vector slot or map
+     * key/value.
+     *
+     * Numbers are stored as their raw IEEE-754 bits (NaNs are canonicalized),
+     * nil and booleans live in the unused quiet-NaN space, and strings/objects
+     * are a tagged 48-bit pointer to an intrusively refcounted cell. Object
+     * cells hold a slot in the runtime's ObjectSlots table rather than a
+     * jsi::Object, so reading one back needs the runtime.
+     *
+     * Map keys additionally use two hashed object types (see KeyHashing.h):
+     * - INTERNED_KEY: keywords, symbols, UUIDs. The cell points at the
+     *   process-wide interned canonical string, so equality is pointer equality.
+     * - HASHED_REF: other IHash/IEquiv values. Hashed by their ClojureScript
+     *   hash; equal hashes fall back to ClojureScript equiv.
+     * Both keep the JS object and the ClojureScript hash in the ObjectCell.
      */
     struct StoredValue
     {
@@ -24,49 +151,168 @@ namespace cljs
             BOOL,
             NUMBER,
             STRING,
-            OBJECT_REF
-        } type;
+            OBJECT_REF,
+            INTERNED_KEY,
+            HASHED_REF
+        };
+
+        StoredValue() : bits_(tagBits(NIL)) {}
+        explicit StoredValue(bool v) : bits_(tagBits(BOOL) | (v ? 1u : 0u)) {}
+        explicit StoredValue(double v)
+        {
+            if (std::isnan(v))
+            {
+                bits_ = kCanonicalNaN;
+            }
+            else
+            {
+                std::memcpy(&bits_, &v, sizeof(v));
+            }
+        }
+        explicit StoredValue(std::string s)
+            : bits_(tagBits(STRING) | toPayload(new detail::StringCell(std::move(s)))) {}
+        explicit StoredValue(const char *s) : StoredValue(std::string(s)) {}
+        StoredValue(facebook::jsi::Runtime &rt, const facebook::jsi::Object &obj)
+            : bits_(tagBits(OBJECT_REF) | toPayload(detail::newObjectCell(rt, obj))) {}
+
+        // Takes over one reference to an existing (usually interned) string cell
+        static StoredValue adoptString(detail::StringCell *cell)
+        {
+            StoredValue result;
+            result.bits_ = tagBits(STRING) | toPayload(cell);
+            return result;
+        }
+
+        // canonical is an interned string; the key holds its own reference
+        static StoredValue internedKey(facebook::jsi::Runtime &rt, const StoredValue &canonical,
+                                       int32_t hash, const facebook::jsi::Object &obj)
+        {
+            auto *cell = detail::newObjectCell(rt, obj);
+            cell->hash = hash;
+            cell->canonical = canonical.stringCell();
+            detail::retain(cell->canonical);
+            StoredValue result;
+            result.bits_ = tagBits(INTERNED_KEY) | toPayload(cell);
+            return result;
+        }
+
+        static StoredValue hashedRef(facebook::jsi::Runtime &rt, int32_t hash,
+                                     const facebook::jsi::Object &obj)
+        {
+            auto *cell = detail::newObjectCell(rt, obj);
+            cell->hash = hash;
+            StoredValue result;
+            result.bits_ = tagBits(HASHED_REF) | toPayload(cell);
+            return result;
+        }
+
+        // Takes a new reference to cell, stored as an object of type t
+        static StoredValue fromObjectCell(Type t, detail::ObjectCell *cell)
+        {
+            detail::retain(cell);
+            StoredValue result;
+            result.bits_ = tagBits(t) | toPayload(cell);
+            return result;
+        }
 
-        union
+        StoredValue(const StoredValue &other) : bits_(other.bits_) { retain(); }
+        StoredValue(StoredValue &&other) noexcept : bits_(other.bits_)
         {
-            bool bool_val;
-            double number_val;
-        } primitive;
+            other.bits_ = tagBits(NIL);
+        }
+        StoredValue &operator=(const StoredValue &other)
+        {
+            if (this != &other)
+            {
+                other.retain();
+                release();
+                bits_ = other.bits_;
+            }
+            return *this;
+        }
+        StoredValue &operator=(StoredValue &&other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                bits_ = other.bits_;
+                other.bits_ = tagBits(NIL);
+            }
+            return *this;
+        }
+        ~StoredValue() { release(); }
 
-        // Shared pointers for types requiring complex lifecycle management
-        std::shared_ptr<std::string> string_val;
-        std::shared_ptr<facebook::jsi::Object> object_val;
+        Type type() const
+        {
+            uint64_t tag = bits_ >> kPayloadBits;
+            return tag >= kFirstTag ? static_cast<Type>(tag - kFirstTag) : NUMBER;
+        }
 
-        StoredValue() : type(NIL) {}
-        explicit StoredValue(bool v) : type(BOOL) { primitive.bool_val = v; }
-        explicit StoredValue(double v) : type(NUMBER) { primitive.number_val = v; }
-        explicit StoredValue(std::string s) : type(STRING),
-                                              string_val(std::make_shared<std::string>(std::move(s))) {}
-        explicit StoredValue(std::shared_ptr<facebook::jsi::Object> obj)
-            : type(OBJECT_REF), object_val(std::move(obj)) {}
+        bool isNil() const { return bits_ == tagBits(NIL); }
+        bool asBool() const { return (bits_ & 1) != 0; }
+        double asNumber() const
+        {
+            double d;
+            std::memcpy(&d, &bits_, sizeof(d));
+            return d;
+        }
+        const std::string &asString() const { return stringCell()->value; }
+
+        // Valid for OBJECT_REF, INTERNED_KEY and HASHED_REF
+        facebook::jsi::Value objectValue(facebook::jsi::Runtime &rt) const
+        {
+            return detail::objectCellValue(rt, objectCell());
+        }
+        facebook::jsi::Object asObject(facebook::jsi::Runtime &rt) const
+        {
+            return objectValue(rt).getObject(rt);
+        }
+        bool isObject() const
+        {
+            Type t = type();
+            return t == OBJECT_REF || t == INTERNED_KEY || t == HASHED_REF;
+        }
+
+        // ClojureScript hash of an INTERNED_KEY or HASHED_REF
+        int32_t keyHash() const { return objectCell()->hash; }
+
+        detail::StringCell *stringCell() const { return fromPayload<detail::StringCell>(); }
+        detail::ObjectCell *objectCell() const { return fromPayload<detail::ObjectCell>(); }
 
         // Equality operators required by immer for comparison
         bool operator==(const StoredValue &other) const
         {
-            if (type != other.type)
+            if (bits_ == other.bits_)
+                return type() != NUMBER || !std::isnan(asNumber());
+
+            Type t = type();
+            if (t != other.type())
                 return false;
 
-            switch (type)
+            switch (t)
             {
             case NIL:
-                return true;
             case BOOL:
-                return primitive.bool_val == other.primitive.bool_val;
+            case OBJECT_REF:
+                // Equal payloads were handled by the bit compare above
+                return false;
             case NUMBER:
-                return primitive.number_val == other.primitive.number_val;
+                return asNumber() == other.asNumber();
             case STRING:
-                if ((string_val == nullptr) != (other.string_val == nullptr))
+            {
+                // Interned strings are unique per content
+                auto *cell = stringCell();
+                auto *otherCell = other.stringCell();
+                if (cell->interned && otherCell->interned)
                     return false;
-                if (string_val == nullptr)
-                    return true;
-                return *string_val == *other.string_val;
-            case OBJECT_REF:
-                return object_val.get() == other.object_val.get();
+                return cell->hash == otherCell->hash && cell->value == otherCell->value;
+            }
+            case INTERNED_KEY:
+                return objectCell()->canonical == other.objectCell()->canonical;
+            case HASHED_REF:
+                if (keyHash() != other.keyHash())
+                    return false;
+                return hashedKeyEquiv(*this, other);
             }
             return false;
         }
@@ -78,51 +324,127 @@ namespace cljs
 
         bool operator<(const StoredValue &other) const
         {
-            if (type != other.type)
-                return type < other.type;
+            Type t = type();
+            Type otherType = other.type();
+            if (t != otherType)
+                return t < otherType;
 
-            switch (type)
+            switch (t)
             {
             case NIL:
                 return false;
             case BOOL:
-                return primitive.bool_val < other.primitive.bool_val;
+                return asBool() < other.asBool();
             case NUMBER:
-                return primitive.number_val < other.primitive.number_val;
+                return asNumber() < other.asNumber();
             case STRING:
-                if (string_val && other.string_val)
-                    return *string_val < *other.string_val;
-                return string_val.get() < other.string_val.get();
+                return asString() < other.asString();
             case OBJECT_REF:
-                return object_val.get() < other.object_val.get();
+                return objectCell() < other.objectCell();
+            case INTERNED_KEY:
+                return objectCell()->canonical->value < other.objectCell()->canonical->value;
+            case HASHED_REF:
+                if (keyHash() != other.keyHash())
+                    return keyHash() < other.keyHash();
+                return objectCell() < other.objectCell();
             }
             return false;
         }
+
+        // Raw 64-bit representation (identity for cells, bits for numbers)
+        uint64_t bits() const { return bits_; }
+
+    private:
+        static constexpr int kPayloadBits = 48;
+        static constexpr uint64_t kPayloadMask = (uint64_t(1) << kPayloadBits) - 1;
+        // Tags occupy the negative quiet-NaN space above 0xFFF8'...
+        static constexpr uint64_t kFirstTag = 0xFFF9;
+        static constexpr uint64_t kCanonicalNaN = 0x7FF8000000000000ull;
+
+        static_assert(sizeof(void *) == 8, "StoredValue NaN-boxing requires 64-bit pointers");
+
+        static constexpr uint64_t tagBits(Type t)
+        {
+            return (kFirstTag + static_cast<uint64_t>(t)) << kPayloadBits;
+        }
+
+        template <typename T>
+        static uint64_t toPayload(T *cell)
+        {
+            return reinterpret_cast<uint64_t>(cell) & kPayloadMask;
+        }
+
+        template <typename T>
+        T *fromPayload() const
+        {
+            return reinterpret_cast<T *>(bits_ & kPayloadMask);
+        }
+
+        void retain() const
+        {
+            switch (type())
+            {
+            case STRING:
+                detail::retain(stringCell());
+                break;
+            case OBJECT_REF:
+            case INTERNED_KEY:
+            case HASHED_REF:
+                detail::retain(objectCell());
+                break;
+            default:
+                break;
+            }
+        }
+
+        void release()
+        {
+            switch (type())
+            {
+            case STRING:
+                detail::release(stringCell());
+                break;
+            case OBJECT_REF:
+            case INTERNED_KEY:
+            case HASHED_REF:
+                detail::release(objectCell());
+                break;
+            default:
+                break;
+            }
+        }
+
+        uint64_t bits_;
     };
 
+    static_assert(sizeof(StoredValue) == 8, "StoredValue must stay one machine word");
+
     // Hash function for StoredValue to support use as map/set keys in immer
     inline size_t hash_value(const StoredValue &v) noexcept
     {
         std::hash<double> hash_double;
         std::hash<bool> hash_bool;
-        std::hash<std::string> hash_string;
         std::hash<void *> hash_ptr;
 
         // Combine type and value hash
-        size_t h = std::hash<int>{}(static_cast<int>(v.type));
+        size_t h = std::hash<int>{}(static_cast<int>(v.type()));
 
-        switch (v.type)
+        switch (v.type())
         {
         case StoredValue::NIL:
             return h;
         case StoredValue::BOOL:
-            return h ^ (hash_bool(v.primitive.bool_val) << 1);
+            return h ^ (hash_bool(v.asBool()) << 1);
         case StoredValue::NUMBER:
-            return h ^ (hash_double(v.primitive.number_val) << 1);
+            return h ^ (hash_double(v.asNumber()) << 1);
         case StoredValue::STRING:
-            return h ^ (v.string_val ? hash_string(*v.string_val) << 1 : 0);
+            return h ^ (v.stringCell()->hash << 1);
         case StoredValue::OBJECT_REF:
-            return h ^ (hash_ptr(v.object_val.get()) << 1);
+            return h ^ (hash_ptr(v.objectCell()) << 1);
+        case StoredValue::INTERNED_KEY:
+        case StoredValue::HASHED_REF:
+            // Use the ClojureScript hash so equal keys land in the same bucket
+            return static_cast<size_t>(static_cast<uint32_t>(v.keyHash()));
         }
         return h;
     }
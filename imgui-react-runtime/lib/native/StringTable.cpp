@@ -0,0 +1,146 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "StringTable.h"
+#include "ObjectSlots.h"
+
+#include <string_view>
+#include <unordered_map>
+
+#if !CLJS_NATIVE_SINGLE_THREADED
+#include <mutex>
+#endif
+
+namespace cljs
+{
+
+    namespace
+    {
+        // Non-owning: keys view the cell's own bytes, and cells unregister
+        // themselves when their last reference goes
+        using InternTable = std::unordered_map<std::string_view, detail::StringCell *>;
+
+        // Intentionally leaked: interned strings may outlive static destruction
+        InternTable &internTable()
+        {
+            static auto *table = new InternTable();
+            return *table;
+        }
+
+#if !CLJS_NATIVE_SINGLE_THREADED
+        // Cells are released from any thread (worker tasks, GC finalizers),
+        // so every table access is locked
+        std::mutex &internMutex()
+        {
+            static auto *mutex = new std::mutex();
+            return *mutex;
+        }
+#endif
+    } // namespace
+
+    StoredValue internString(std::string s)
+    {
+#if !CLJS_NATIVE_SINGLE_THREADED
+        std::lock_guard<std::mutex> lock(internMutex());
+#endif
+        auto &table = internTable();
+        auto it = table.find(std::string_view(s));
+        if (it != table.end())
+        {
+            // A cell whose count already dropped to zero is about to
+            // unregister itself; replace it rather than revive it
+            if (it->second->refs.tryIncrement())
+            {
+                return StoredValue::adoptString(it->second);
+            }
+            table.erase(it);
+        }
+
+        auto *cell = new detail::StringCell(std::move(s));
+        cell->interned = true;
+        table.emplace(std::string_view(cell->value), cell);
+        return StoredValue::adoptString(cell);
+    }
+
+    facebook::jsi::Value stringToJS(facebook::jsi::Runtime &rt, const StoredValue &stored)
+    {
+        auto *cell = stored.stringCell();
+        if (!cell->interned)
+        {
+            return facebook::jsi::String::createFromUtf8(rt, cell->value);
+        }
+
+        auto &slots = ObjectSlots::stringsForRuntime(rt);
+#if CLJS_NATIVE_SINGLE_THREADED
+        ObjectSlots *owner = cell->jsSlots;
+#else
+        ObjectSlots *owner = cell->jsSlots.load(std::memory_order_acquire);
+#endif
+        if (owner == &slots)
+        {
+            return slots.get(rt, cell->jsSlot);
+        }
+
+        facebook::jsi::Value str = facebook::jsi::String::createFromUtf8(rt, cell->value);
+        if (owner)
+        {
+            // Cached by another runtime
+            return str;
+        }
+
+        // add() may run GC finalizers that release cells, so the slot is
+        // taken before locking and handed back if another runtime won
+        uint32_t slot = slots.add(rt, str);
+        bool claimed = false;
+        {
+#if !CLJS_NATIVE_SINGLE_THREADED
+            std::lock_guard<std::mutex> lock(internMutex());
+#endif
+            if (!cell->jsSlots)
+            {
+                cell->jsSlot = slot;
+#if CLJS_NATIVE_SINGLE_THREADED
+                cell->jsSlots = &slots;
+#else
+                cell->jsSlots.store(&slots, std::memory_order_release);
+#endif
+                claimed = true;
+            }
+        }
+        if (!claimed)
+        {
+            slots.release(slot);
+        }
+        return str;
+    }
+
+    size_t internedStringCount()
+    {
+#if !CLJS_NATIVE_SINGLE_THREADED
+        std::lock_guard<std::mutex> lock(internMutex());
+#endif
+        return internTable().size();
+    }
+
+    namespace detail
+    {
+        void unregisterInterned(StringCell *cell)
+        {
+#if !CLJS_NATIVE_SINGLE_THREADED
+            std::lock_guard<std::mutex> lock(internMutex());
+#endif
+            auto &table = internTable();
+            auto it = table.find(std::string_view(cell->value));
+            if (it != table.end() && it->second == cell)
+            {
+                table.erase(it);
+            }
+            if (ObjectSlots *slots = cell->jsSlots)
+            {
+                slots->release(cell->jsSlot);
+            }
+        }
+    } // namespace detail
+
+} // namespace cljs
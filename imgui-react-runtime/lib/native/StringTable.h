@@ -0,0 +1,44 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include "StoredValue.h"
+
+#include <string>
+
+namespace cljs
+{
+
+    /**
+     * Process-wide string intern table shared by PersistentVector and
+     * PersistentMap.
+     *
+     * Every string stored in a native collection is interned, so duplicate
+     * strings across collections share one StringCell. Cells are released
+     * from any thread, so the table is locked unless
+     * CLJS_NATIVE_SINGLE_THREADED is set.
+     *
+     * The first read of an interned string caches its jsi::String in the
+     * runtime's string slot table (ObjectSlots::stringsForRuntime), so later
+     * reads return the same JS string instead of calling createFromUtf8.
+     * The cell keeps only the slot index: like object slots, cached strings
+     * root one JS array per chunk rather than one handle each, and a cell
+     * that dies queues its slot to be cleared on the JS thread. A cell
+     * caches for one runtime; other runtimes get a new string per read.
+     */
+
+    // Returns a STRING StoredValue sharing the cell of any equal string
+    StoredValue internString(std::string s);
+
+    // Returns the JS string for a STRING StoredValue, cached per interned
+    // cell after the first read
+    facebook::jsi::Value stringToJS(facebook::jsi::Runtime &rt, const StoredValue &stored);
+
+    // Number of distinct strings currently interned
+    size_t internedStringCount();
+
+} // namespace cljs
@@ -0,0 +1,155 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "ThreadPool.h"
+#include "ObjectSlots.h"
+
+#include <atomic>
+
+namespace cljs
+{
+
+    namespace
+    {
+        // Set once the shared pool exists, so pumping never starts threads
+        std::atomic<ThreadPool *> sharedPool{nullptr};
+    }
+
+    ThreadPool &ThreadPool::shared()
+    {
+        // Intentionally leaked: pending completions hold jsi values that must
+        // not be released after the runtime is gone
+        static ThreadPool *pool = []
+        {
+            unsigned cores = std::thread::hardware_concurrency();
+            auto *created = new ThreadPool(cores > 1 ? cores - 1 : 1);
+            sharedPool.store(created);
+            return created;
+        }();
+        return *pool;
+    }
+
+    ThreadPool::ThreadPool(size_t threads)
+    {
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i)
+        {
+            workers_.emplace_back([this]
+                                  { workerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto &worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]
+                         { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    uint64_t ThreadPool::defer(facebook::jsi::Runtime &rt,
+                               std::function<void(facebook::jsi::Runtime &)> fn)
+    {
+        uint64_t ticket = nextTicket_++;
+        deferred_.emplace(ticket, Deferred{&rt, std::move(fn)});
+        return ticket;
+    }
+
+    void ThreadPool::complete(uint64_t ticket)
+    {
+        std::lock_guard<std::mutex> lock(readyMutex_);
+        ready_.push_back(ticket);
+    }
+
+    void ThreadPool::pump(facebook::jsi::Runtime &rt)
+    {
+        std::vector<uint64_t> ready;
+        {
+            std::lock_guard<std::mutex> lock(readyMutex_);
+            ready.swap(ready_);
+        }
+
+        std::vector<uint64_t> requeue;
+        auto putBack = [&]
+        {
+            std::lock_guard<std::mutex> lock(readyMutex_);
+            ready_.insert(ready_.end(), requeue.begin(), requeue.end());
+        };
+
+        for (size_t i = 0; i < ready.size(); ++i)
+        {
+            uint64_t ticket = ready[i];
+            auto it = deferred_.find(ticket);
+            if (it == deferred_.end())
+            {
+                continue;
+            }
+            if (it->second.rt != &rt)
+            {
+                requeue.push_back(ticket);
+                continue;
+            }
+            // Erase before running so a throwing completion is not rerun
+            auto fn = std::move(it->second.fn);
+            deferred_.erase(it);
+            try
+            {
+                fn(rt);
+            }
+            catch (...)
+            {
+                // Leave the rest for the next pump
+                requeue.insert(requeue.end(), ready.begin() + i + 1, ready.end());
+                putBack();
+                throw;
+            }
+        }
+        putBack();
+    }
+
+    void pumpNativeTasks(facebook::jsi::Runtime &rt)
+    {
+        // Objects and strings released by cells freed off the JS thread since last frame
+        ObjectSlots::sweepRuntime(rt);
+        if (auto *pool = sharedPool.load())
+        {
+            pool->pump(rt);
+        }
+    }
+
+} // namespace cljs
@@ -0,0 +1,89 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <hermes/hermes.h>
+#include <jsi/jsi.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cljs
+{
+
+    /**
+     * Worker threads for native collection operations that run off the JS
+     * thread, and the queue that brings their results back to it.
+     *
+     * Worker tasks must not touch jsi values or copy/destroy immer
+     * collections (the single-threaded memory policy has no atomic
+     * refcounts). Collect raw leaf pointers on the JS thread, keep the
+     * collection alive in a completion registered with defer(), and let the
+     * last worker call complete(). The completion and everything it
+     * captures run and are destroyed on the JS thread, in pump().
+     */
+    class ThreadPool
+    {
+    public:
+        // One worker per core but one, started on first use
+        static ThreadPool &shared();
+
+        explicit ThreadPool(size_t threads);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        size_t size() const { return workers_.size(); }
+
+        // Runs task on a worker thread
+        void submit(std::function<void()> task);
+
+        // JS thread: registers fn to run on rt's thread after complete(ticket)
+        uint64_t defer(facebook::jsi::Runtime &rt,
+                       std::function<void(facebook::jsi::Runtime &)> fn);
+
+        // Any thread: marks a deferred completion as ready
+        void complete(uint64_t ticket);
+
+        // JS thread: runs the ready completions registered for rt
+        void pump(facebook::jsi::Runtime &rt);
+
+    private:
+        void workerLoop();
+
+        std::vector<std::thread> workers_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<std::function<void()>> tasks_;
+        bool stopping_ = false;
+
+        // Only touched on the JS thread
+        struct Deferred
+        {
+            facebook::jsi::Runtime *rt;
+            std::function<void(facebook::jsi::Runtime &)> fn;
+        };
+        std::unordered_map<uint64_t, Deferred> deferred_;
+        uint64_t nextTicket_ = 1;
+
+        std::mutex readyMutex_;
+        std::vector<uint64_t> ready_;
+    };
+
+    /**
+     * Resolves the Promises of finished native parallel operations. Hosts
+     * call it on the JS thread once per frame, before draining microtasks.
+     */
+    void pumpNativeTasks(facebook::jsi::Runtime &rt);
+
+} // namespace cljs
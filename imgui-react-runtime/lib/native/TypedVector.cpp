@@ -0,0 +1,718 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "TypedVector.h"
+#include "CljsHash.h"
+#include "HostArgs.h"
+#include "MethodTable.h"
+#include "NativeMemory.h"
+#include "VectorReductions.h"
+
+#include <immer/flex_vector_transient.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace cljs
+{
+
+  namespace
+  {
+    template <typename T>
+    struct TypedElement;
+
+    template <>
+    struct TypedElement<double>
+    {
+      static constexpr const char *name = "PersistentVector.float64";
+      static constexpr ReductionTarget reductions = ReductionTarget::Float64;
+
+      static double fromNumber(double d) { return d; }
+    };
+
+    template <>
+    struct TypedElement<int32_t>
+    {
+      static constexpr const char *name = "PersistentVector.int32";
+      static constexpr ReductionTarget reductions = ReductionTarget::Int32;
+
+      static int32_t fromNumber(double d) { return toInt32(d); }
+    };
+
+    template <typename T>
+    T convertElement(facebook::jsi::Runtime &rt, const facebook::jsi::Value &value)
+    {
+      if (!value.isNumber())
+      {
+        throw facebook::jsi::JSError(
+            rt, std::string(TypedElement<T>::name) + " elements must be numbers");
+      }
+      return TypedElement<T>::fromNumber(value.getNumber());
+    }
+
+    // Checks that [byteOffset, byteOffset + n * sizeof(T)) lies in a buffer
+    // of size bytes at an offset a typed array view could use
+    template <typename T>
+    void checkRange(facebook::jsi::Runtime &rt, size_t size, size_t byteOffset, size_t n)
+    {
+      if (byteOffset % sizeof(T) != 0)
+      {
+        std::ostringstream msg;
+        msg << TypedElement<T>::name << ": byte offset " << byteOffset
+            << " is not a multiple of " << sizeof(T);
+        throw facebook::jsi::JSError(rt, msg.str());
+      }
+      if (byteOffset > size || n > (size - byteOffset) / sizeof(T))
+      {
+        std::ostringstream msg;
+        msg << TypedElement<T>::name << ": " << n << " elements at byte offset "
+            << byteOffset << " do not fit in an ArrayBuffer of " << size << " bytes";
+        throw facebook::jsi::JSError(rt, msg.str());
+      }
+    }
+  } // namespace
+
+  int32_t toInt32(double d)
+  {
+    if (!std::isfinite(d))
+    {
+      return 0;
+    }
+    double wrapped = std::fmod(std::trunc(d), 4294967296.0);
+    if (wrapped < 0)
+    {
+      wrapped += 4294967296.0;
+    }
+    return static_cast<int32_t>(static_cast<uint32_t>(wrapped));
+  }
+
+  template <typename T>
+  TypedVectorHostObject<T>::TypedVectorHostObject(VectorType vec)
+      : vec_(std::move(vec)) {}
+
+  template <typename T>
+  std::shared_ptr<TypedVectorHostObject<T>>
+  TypedVectorHostObject<T>::fromArray(facebook::jsi::Runtime &rt,
+                                      const facebook::jsi::Array &arr)
+  {
+    auto transient = VectorType{}.transient();
+    size_t length = arr.size(rt);
+    for (size_t i = 0; i < length; ++i)
+    {
+      transient.push_back(convertElement<T>(rt, arr.getValueAtIndex(rt, i)));
+    }
+    return std::make_shared<TypedVectorHostObject>(transient.persistent());
+  }
+
+  template <typename T>
+  std::shared_ptr<TypedVectorHostObject<T>>
+  TypedVectorHostObject<T>::fromArrayBuffer(facebook::jsi::Runtime &rt,
+                                            const facebook::jsi::ArrayBuffer &buffer,
+                                            size_t byteOffset, std::optional<size_t> length)
+  {
+    size_t size = buffer.size(rt);
+    size_t n = length ? *length : (byteOffset <= size ? (size - byteOffset) / sizeof(T) : 0);
+    checkRange<T>(rt, size, byteOffset, n);
+
+    const uint8_t *bytes = buffer.data(rt) + byteOffset;
+    if (reinterpret_cast<uintptr_t>(bytes) % alignof(T) == 0)
+    {
+      const T *first = reinterpret_cast<const T *>(bytes);
+      return std::make_shared<TypedVectorHostObject>(VectorType(first, first + n));
+    }
+
+    // ArrayBuffer storage is normally malloc-aligned; copy out if it is not
+    std::vector<T> aligned(n);
+    std::memcpy(aligned.data(), bytes, n * sizeof(T));
+    return std::make_shared<TypedVectorHostObject>(VectorType(aligned.begin(), aligned.end()));
+  }
+
+  template <typename T>
+  facebook::jsi::Value TypedVectorHostObject<T>::get(facebook::jsi::Runtime &rt,
+                                                     const facebook::jsi::PropNameID &name)
+  {
+    return MethodTable<TypedVectorHostObject>::forRuntime(rt).get(rt, *this, name);
+  }
+
+  template <typename T>
+  std::vector<facebook::jsi::PropNameID>
+  TypedVectorHostObject<T>::getPropertyNames(facebook::jsi::Runtime &rt)
+  {
+    return MethodTable<TypedVectorHostObject>::forRuntime(rt).names(rt);
+  }
+
+  template <typename T>
+  size_t TypedVectorHostObject<T>::count() const { return vec_.size(); }
+
+  template <typename T>
+  facebook::jsi::Value TypedVectorHostObject<T>::nth(facebook::jsi::Runtime &rt,
+                                                     size_t index) const
+  {
+    if (index >= vec_.size())
+    {
+      std::ostringstream msg;
+      msg << "Index " << index << " out of bounds for vector of size "
+          << vec_.size();
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    return facebook::jsi::Value(static_cast<double>(vec_[index]));
+  }
+
+  template <typename T>
+  std::shared_ptr<TypedVectorHostObject<T>>
+  TypedVectorHostObject<T>::conj(facebook::jsi::Runtime &rt,
+                                 const facebook::jsi::Value &value) const
+  {
+    return std::make_shared<TypedVectorHostObject>(vec_.push_back(convertElement<T>(rt, value)));
+  }
+
+  template <typename T>
+  std::shared_ptr<TypedVectorHostObject<T>>
+  TypedVectorHostObject<T>::assoc(facebook::jsi::Runtime &rt, size_t index,
+                                  const facebook::jsi::Value &value) const
+  {
+    if (index >= vec_.size())
+    {
+      std::ostringstream msg;
+      msg << "Index " << index << " out of bounds for vector of size "
+          << vec_.size();
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    return std::make_shared<TypedVectorHostObject>(vec_.set(index, convertElement<T>(rt, value)));
+  }
+
+  template <typename T>
+  std::shared_ptr<TypedVectorHostObject<T>> TypedVectorHostObject<T>::pop() const
+  {
+    if (vec_.empty())
+    {
+      return std::make_shared<TypedVectorHostObject>(vec_);
+    }
+    return std::make_shared<TypedVectorHostObject>(vec_.take(vec_.size() - 1));
+  }
+
+  template <typename T>
+  std::shared_ptr<TypedVectorHostObject<T>>
+  TypedVectorHostObject<T>::slice(facebook::jsi::Runtime &rt, size_t start, size_t end) const
+  {
+    if (start > end || end > vec_.size())
+    {
+      std::ostringstream msg;
+      msg << "Slice [" << start << ", " << end
+          << ") out of bounds for vector of size " << vec_.size();
+      throw facebook::jsi::JSError(rt, msg.str());
+    }
+    return std::make_shared<TypedVectorHostObject>(vec_.take(end).drop(start));
+  }
+
+  template <typename T>
+  std::shared_ptr<TypedVectorHostObject<T>>
+  TypedVectorHostObject<T>::concat(const TypedVectorHostObject &other) const
+  {
+    return std::make_shared<TypedVectorHostObject>(vec_ + other.vec_);
+  }
+
+  template <typename T>
+  bool TypedVectorHostObject<T>::equiv(const TypedVectorHostObject &other) const
+  {
+    // Numeric equality, so NaN is never equal to itself, as with cljs =
+    return vec_.size() == other.vec_.size() &&
+           std::equal(vec_.begin(), vec_.end(), other.vec_.begin());
+  }
+
+  template <typename T>
+  int32_t TypedVectorHostObject<T>::hashOrdered() const
+  {
+    if (!hash_)
+    {
+      uint32_t acc = 1;
+      immer::for_each_chunk(vec_, [&](const T *first, const T *last)
+                            {
+        for (; first != last; ++first)
+        {
+          acc = hash::orderedStep(acc, hash::hashNumber(static_cast<double>(*first)));
+        } });
+      hash_ = hash::mixCollectionHash(acc, static_cast<uint32_t>(vec_.size()));
+    }
+    return *hash_;
+  }
+
+  template <typename T>
+  facebook::jsi::Array TypedVectorHostObject<T>::toArray(facebook::jsi::Runtime &rt) const
+  {
+    facebook::jsi::Array result(rt, vec_.size());
+    size_t i = 0;
+    immer::for_each_chunk(vec_, [&](const T *first, const T *last)
+                          {
+      for (; first != last; ++first)
+      {
+        result.setValueAtIndex(rt, i++, static_cast<double>(*first));
+      } });
+    return result;
+  }
+
+  template <typename T>
+  size_t TypedVectorHostObject<T>::copyInto(facebook::jsi::Runtime &rt,
+                                            const facebook::jsi::ArrayBuffer &buffer,
+                                            size_t byteOffset) const
+  {
+    checkRange<T>(rt, buffer.size(rt), byteOffset, vec_.size());
+
+    uint8_t *out = buffer.data(rt) + byteOffset;
+    immer::for_each_chunk(vec_, [&](const T *first, const T *last)
+                          {
+      size_t bytes = static_cast<size_t>(last - first) * sizeof(T);
+      std::memcpy(out, first, bytes);
+      out += bytes; });
+    return vec_.size();
+  }
+
+  template <typename T>
+  TypedChunkIteratorHostObject<T>::TypedChunkIteratorHostObject(
+      typename TypedVectorHostObject<T>::VectorType vec, size_t start)
+      : vec_(std::move(vec)), pos_(start) {}
+
+  template <typename T>
+  facebook::jsi::Value TypedChunkIteratorHostObject<T>::get(facebook::jsi::Runtime &rt,
+                                                            const facebook::jsi::PropNameID &name)
+  {
+    return MethodTable<TypedChunkIteratorHostObject>::forRuntime(rt).get(rt, *this, name);
+  }
+
+  template <typename T>
+  facebook::jsi::Value TypedChunkIteratorHostObject<T>::nextChunk(facebook::jsi::Runtime &rt)
+  {
+    if (pos_ >= vec_.size())
+    {
+      return facebook::jsi::Value::undefined();
+    }
+
+    // Hand out the rest of the leaf containing pos_
+    facebook::jsi::Value result;
+    immer::for_each_chunk_p(
+        vec_.begin() + pos_, vec_.end(),
+        [&](const T *first, const T *last)
+        {
+          size_t n = static_cast<size_t>(last - first);
+          facebook::jsi::Array chunk(rt, n);
+          for (size_t i = 0; i < n; ++i)
+          {
+            chunk.setValueAtIndex(rt, i, static_cast<double>(first[i]));
+          }
+          pos_ += n;
+          result = std::move(chunk);
+          return false;
+        });
+    return result;
+  }
+
+  template class TypedVectorHostObject<double>;
+  template class TypedVectorHostObject<int32_t>;
+  template class TypedChunkIteratorHostObject<double>;
+  template class TypedChunkIteratorHostObject<int32_t>;
+
+  namespace
+  {
+    template <typename T>
+    std::shared_ptr<TypedVectorHostObject<T>> vectorArg(facebook::jsi::Runtime &rt,
+                                                        const facebook::jsi::Value *args,
+                                                        size_t count, size_t i)
+    {
+      if (i < count && args[i].isObject())
+      {
+        auto obj = args[i].getObject(rt);
+        if (obj.isHostObject<TypedVectorHostObject<T>>(rt))
+        {
+          return obj.getHostObject<TypedVectorHostObject<T>>(rt);
+        }
+      }
+      throw facebook::jsi::JSError(
+          rt, std::string(TypedElement<T>::name) + " instance is invalid");
+    }
+
+    std::optional<facebook::jsi::ArrayBuffer> arrayBufferArg(facebook::jsi::Runtime &rt,
+                                                             const facebook::jsi::Value &value)
+    {
+      if (value.isObject())
+      {
+        auto obj = value.getObject(rt);
+        if (obj.isArrayBuffer(rt))
+        {
+          return obj.getArrayBuffer(rt);
+        }
+      }
+      return std::nullopt;
+    }
+
+    template <typename T>
+    facebook::jsi::Value wrap(facebook::jsi::Runtime &rt,
+                              std::shared_ptr<TypedVectorHostObject<T>> vec)
+    {
+      return createHostObject(rt, std::move(vec));
+    }
+
+    // v.nth(i), v.conj(x), ... - The instance-first factory operations as
+    // methods, hottest first
+    template <typename T>
+    void installTypedMethods(facebook::jsi::Runtime &rt)
+    {
+      using facebook::jsi::Runtime;
+      using facebook::jsi::Value;
+      using HostObject = TypedVectorHostObject<T>;
+
+      auto &methods = MethodTable<HostObject>::forRuntime(rt);
+      methods.setTypeName(TypedElement<T>::name);
+      methods.getter(rt, "count", [](Runtime &, HostObject &self)
+                     { return Value(static_cast<double>(self.count())); });
+      methods.getter(rt, "length", [](Runtime &, HostObject &self)
+                     { return Value(static_cast<double>(self.count())); });
+      methods.getter(rt, "byteLength", [](Runtime &, HostObject &self)
+                     { return Value(static_cast<double>(self.count() * sizeof(T))); });
+      methods.method(rt, "nth", 1, [](Runtime &runtime, HostObject &self, const Value *args, size_t count)
+                     { return self.nth(runtime, indexArg(runtime, args, count, 0, "nth")); });
+      methods.method(rt, "conj", 1, [](Runtime &runtime, HostObject &self, const Value *args, size_t count)
+                     {
+                       if (count < 1)
+                       {
+                         throw facebook::jsi::JSError(runtime, "conj requires the value to add");
+                       }
+                       return wrap<T>(runtime, self.conj(runtime, args[0])); });
+      methods.method(rt, "assoc", 2, [](Runtime &runtime, HostObject &self, const Value *args, size_t count)
+                     {
+                       size_t index = indexArg(runtime, args, count, 0, "assoc");
+                       if (count < 2)
+                       {
+                         throw facebook::jsi::JSError(runtime, "assoc requires an index and value");
+                       }
+                       return wrap<T>(runtime, self.assoc(runtime, index, args[1])); });
+      methods.method(rt, "pop", 0, [](Runtime &runtime, HostObject &self, const Value *, size_t)
+                     { return wrap<T>(runtime, self.pop()); });
+      methods.method(rt, "equiv", 1, [](Runtime &runtime, HostObject &self, const Value *args, size_t count)
+                     {
+                       if (count < 1 || !args[0].isObject())
+                       {
+                         return Value(false);
+                       }
+                       auto other = args[0].getObject(runtime);
+                       if (!other.isHostObject<HostObject>(runtime))
+                       {
+                         return Value(false);
+                       }
+                       return Value(self.equiv(*other.getHostObject<HostObject>(runtime))); });
+      methods.method(rt, "hashOrdered", 0, [](Runtime &, HostObject &self, const Value *, size_t)
+                     { return Value(self.hashOrdered()); });
+      methods.method(rt, "iterator", 1, [](Runtime &runtime, HostObject &self, const Value *args, size_t count)
+                     {
+                       size_t start = count > 0 && !args[0].isUndefined() ? indexArg(runtime, args, count, 0, "iterator") : 0;
+                       auto it = std::make_shared<TypedChunkIteratorHostObject<T>>(self.getVector(), start);
+                       return Value(runtime, createHostObject(runtime, it)); });
+      methods.method(rt, "toArray", 0, [](Runtime &runtime, HostObject &self, const Value *, size_t)
+                     { return Value(runtime, self.toArray(runtime)); });
+      methods.method(rt, "slice", 2, [](Runtime &runtime, HostObject &self, const Value *args, size_t count)
+                     {
+                       size_t start = indexArg(runtime, args, count, 0, "slice");
+                       size_t end = count > 1 && !args[1].isUndefined()
+                                        ? indexArg(runtime, args, count, 1, "slice")
+                                        : self.count();
+                       return wrap<T>(runtime, self.slice(runtime, start, end)); });
+      methods.method(rt, "concat", 1, [](Runtime &runtime, HostObject &self, const Value *args, size_t count)
+                     { return wrap<T>(runtime, self.concat(*vectorArg<T>(runtime, args, count, 0))); });
+      methods.method(rt, "copyInto", 2, [](Runtime &runtime, HostObject &self, const Value *args, size_t count)
+                     {
+                       auto buffer = count > 0 ? arrayBufferArg(runtime, args[0]) : std::nullopt;
+                       if (!buffer)
+                       {
+                         throw facebook::jsi::JSError(runtime, "copyInto requires an ArrayBuffer argument");
+                       }
+                       size_t byteOffset = count > 1 && !args[1].isUndefined()
+                                               ? indexArg(runtime, args, count, 1, "copyInto")
+                                               : 0;
+                       return Value(static_cast<double>(self.copyInto(runtime, *buffer, byteOffset))); });
+
+      auto &iteratorMethods = MethodTable<TypedChunkIteratorHostObject<T>>::forRuntime(rt);
+      iteratorMethods.setTypeName(std::string(TypedElement<T>::name) + " iterator");
+      iteratorMethods.method(rt, "nextChunk", 0, [](Runtime &runtime, TypedChunkIteratorHostObject<T> &self, const Value *, size_t)
+                             { return self.nextChunk(runtime); });
+    }
+
+    template <typename T>
+    facebook::jsi::Object createTypedFactory(facebook::jsi::Runtime &rt)
+    {
+      using HostObject = TypedVectorHostObject<T>;
+      installTypedMethods<T>(rt);
+
+      facebook::jsi::Object factory(rt);
+
+      // empty() - Create an empty typed vector
+      factory.setProperty(
+          rt, "empty",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "empty"), 0,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *,
+                 size_t) -> facebook::jsi::Value
+              {
+                return wrap<T>(runtime, std::make_shared<HostObject>(typename HostObject::VectorType{}));
+              }));
+
+      // from(array) - Create a typed vector from a JavaScript array of numbers
+      factory.setProperty(
+          rt, "from",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "from"), 1,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                if (count < 1 || !args[0].isObject() || !args[0].getObject(runtime).isArray(runtime))
+                {
+                  throw facebook::jsi::JSError(
+                      runtime, std::string(TypedElement<T>::name) + ".from requires an array argument");
+                }
+                return wrap<T>(runtime, HostObject::fromArray(runtime, args[0].getObject(runtime).getArray(runtime)));
+              }));
+
+      // fromArrayBuffer(buffer, byteOffset?, length?) - Copy elements out of
+      // an ArrayBuffer; length defaults to the rest of the buffer
+      factory.setProperty(
+          rt, "fromArrayBuffer",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "fromArrayBuffer"), 3,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                auto buffer = count > 0 ? arrayBufferArg(runtime, args[0]) : std::nullopt;
+                if (!buffer)
+                {
+                  throw facebook::jsi::JSError(runtime,
+                                               "fromArrayBuffer requires an ArrayBuffer argument");
+                }
+                size_t byteOffset = count > 1 && !args[1].isUndefined()
+                                        ? indexArg(runtime, args, count, 1, "fromArrayBuffer")
+                                        : 0;
+                std::optional<size_t> length;
+                if (count > 2 && !args[2].isUndefined())
+                {
+                  length = indexArg(runtime, args, count, 2, "fromArrayBuffer");
+                }
+                return wrap<T>(runtime, HostObject::fromArrayBuffer(runtime, *buffer, byteOffset, length));
+              }));
+
+      // copyInto(vector, buffer, byteOffset?) - memcpy each leaf into buffer,
+      // returns the number of elements written
+      factory.setProperty(
+          rt, "copyInto",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "copyInto"), 3,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                auto vec = vectorArg<T>(runtime, args, count, 0);
+                auto buffer = count > 1 ? arrayBufferArg(runtime, args[1]) : std::nullopt;
+                if (!buffer)
+                {
+                  throw facebook::jsi::JSError(runtime,
+                                               "copyInto requires an ArrayBuffer argument");
+                }
+                size_t byteOffset = count > 2 && !args[2].isUndefined()
+                                        ? indexArg(runtime, args, count, 2, "copyInto")
+                                        : 0;
+                return facebook::jsi::Value(static_cast<double>(vec->copyInto(runtime, *buffer, byteOffset)));
+              }));
+
+      factory.setProperty(
+          rt, "count",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "count"), 1,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                return facebook::jsi::Value(static_cast<double>(vectorArg<T>(runtime, args, count, 0)->count()));
+              }));
+
+      factory.setProperty(
+          rt, "nth",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "nth"), 2,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                auto vec = vectorArg<T>(runtime, args, count, 0);
+                return vec->nth(runtime, indexArg(runtime, args, count, 1, "nth"));
+              }));
+
+      factory.setProperty(
+          rt, "conj",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "conj"), 2,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                auto vec = vectorArg<T>(runtime, args, count, 0);
+                if (count < 2)
+                {
+                  throw facebook::jsi::JSError(runtime,
+                                               "conj requires two arguments: the vector and the value to add");
+                }
+                return wrap<T>(runtime, vec->conj(runtime, args[1]));
+              }));
+
+      factory.setProperty(
+          rt, "assoc",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "assoc"), 3,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                auto vec = vectorArg<T>(runtime, args, count, 0);
+                size_t index = indexArg(runtime, args, count, 1, "assoc");
+                if (count < 3)
+                {
+                  throw facebook::jsi::JSError(runtime,
+                                               "assoc requires three arguments: the vector, index and value");
+                }
+                return wrap<T>(runtime, vec->assoc(runtime, index, args[2]));
+              }));
+
+      factory.setProperty(
+          rt, "pop",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "pop"), 1,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                return wrap<T>(runtime, vectorArg<T>(runtime, args, count, 0)->pop());
+              }));
+
+      // slice(vector, start, end?) - Structure-sharing subvector
+      factory.setProperty(
+          rt, "slice",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "slice"), 3,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                auto vec = vectorArg<T>(runtime, args, count, 0);
+                size_t start = indexArg(runtime, args, count, 1, "slice");
+                size_t end = count > 2 && !args[2].isUndefined()
+                                 ? indexArg(runtime, args, count, 2, "slice")
+                                 : vec->count();
+                return wrap<T>(runtime, vec->slice(runtime, start, end));
+              }));
+
+      factory.setProperty(
+          rt, "concat",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "concat"), 2,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                auto a = vectorArg<T>(runtime, args, count, 0);
+                auto b = vectorArg<T>(runtime, args, count, 1);
+                return wrap<T>(runtime, a->concat(*b));
+              }));
+
+      factory.setProperty(
+          rt, "equiv",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "equiv"), 2,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                auto vec = vectorArg<T>(runtime, args, count, 0);
+                if (count < 2 || !args[1].isObject())
+                {
+                  return facebook::jsi::Value(false);
+                }
+                auto other = args[1].getObject(runtime);
+                if (!other.isHostObject<HostObject>(runtime))
+                {
+                  return facebook::jsi::Value(false);
+                }
+                return facebook::jsi::Value(vec->equiv(*other.getHostObject<HostObject>(runtime)));
+              }));
+
+      // hashOrdered(vector) - cljs-compatible hash, cached
+      factory.setProperty(
+          rt, "hashOrdered",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "hashOrdered"), 1,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                return facebook::jsi::Value(vectorArg<T>(runtime, args, count, 0)->hashOrdered());
+              }));
+
+      factory.setProperty(
+          rt, "toArray",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "toArray"), 1,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                return vectorArg<T>(runtime, args, count, 0)->toArray(runtime);
+              }));
+
+      // iterator(vector, start?) / nextChunk(iterator) - One leaf per call
+      factory.setProperty(
+          rt, "iterator",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "iterator"), 2,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                auto vec = vectorArg<T>(runtime, args, count, 0);
+                size_t start = count > 1 && !args[1].isUndefined() ? indexArg(runtime, args, count, 1, "iterator") : 0;
+                auto it = std::make_shared<TypedChunkIteratorHostObject<T>>(vec->getVector(), start);
+                return createHostObject(runtime, it);
+              }));
+
+      factory.setProperty(
+          rt, "nextChunk",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "nextChunk"), 1,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                if (count < 1 || !args[0].isObject() ||
+                    !args[0].getObject(runtime).isHostObject<TypedChunkIteratorHostObject<T>>(runtime))
+                {
+                  throw facebook::jsi::JSError(
+                      runtime, std::string(TypedElement<T>::name) + " iterator is invalid");
+                }
+                return args[0].getObject(runtime).getHostObject<TypedChunkIteratorHostObject<T>>(runtime)->nextChunk(runtime);
+              }));
+
+      // sum, mean, variance, min, max, countWhere, argmin, argmax
+      installVectorReductions(rt, factory, TypedElement<T>::reductions);
+
+      return factory;
+    }
+  } // namespace
+
+  void installTypedVectors(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory)
+  {
+    factory.setProperty(rt, "float64", createTypedFactory<double>(rt));
+    factory.setProperty(rt, "int32", createTypedFactory<int32_t>(rt));
+  }
+
+} // namespace cljs
@@ -0,0 +1,127 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <hermes/hermes.h>
+#include <jsi/jsi.h>
+
+#include <immer/flex_vector.hpp>
+#include <immer/algorithm.hpp>
+
+#include "MemoryPolicy.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace cljs
+{
+
+  /**
+   * TypedVectorHostObject<T> is a persistent vector of unboxed numbers,
+   * backed by an immer::flex_vector<T>. It is exposed as
+   * PersistentVector.float64 (T = double) and PersistentVector.int32
+   * (T = int32_t).
+   *
+   * Elements are stored as plain numbers instead of StoredValues, so a
+   * leaf is a contiguous array of T and bulk transfer is a memcpy per leaf:
+   * - copyInto(buffer, byteOffset) - Copy all elements into an ArrayBuffer
+   * - fromArrayBuffer(buffer, byteOffset, length) - Build a vector from the
+   *   native-endian contents of an ArrayBuffer
+   *
+   * Numbers stored in an int32 vector are converted like JavaScript's
+   * ToInt32 (truncate, wrap modulo 2^32). Byte offsets must be a multiple of
+   * the element size, as for Float64Array/Int32Array views.
+   */
+  // JavaScript ToInt32, the conversion of numbers stored as int32
+  int32_t toInt32(double d);
+
+  template <typename T>
+  class TypedVectorHostObject : public facebook::jsi::HostObject
+  {
+  public:
+    using VectorType = immer::flex_vector<T, NativeMemoryPolicy>;
+
+    explicit TypedVectorHostObject(VectorType vec);
+
+    // Factory methods
+    static std::shared_ptr<TypedVectorHostObject> fromArray(facebook::jsi::Runtime &rt,
+                                                            const facebook::jsi::Array &arr);
+    static std::shared_ptr<TypedVectorHostObject>
+    fromArrayBuffer(facebook::jsi::Runtime &rt, const facebook::jsi::ArrayBuffer &buffer,
+                    size_t byteOffset, std::optional<size_t> length);
+
+    // HostObject interface
+    facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                             const facebook::jsi::PropNameID &name) override;
+    std::vector<facebook::jsi::PropNameID>
+    getPropertyNames(facebook::jsi::Runtime &rt) override;
+
+    // Vector operations
+    size_t count() const;
+    facebook::jsi::Value nth(facebook::jsi::Runtime &rt, size_t index) const;
+    std::shared_ptr<TypedVectorHostObject> conj(facebook::jsi::Runtime &rt,
+                                                const facebook::jsi::Value &value) const;
+    std::shared_ptr<TypedVectorHostObject> assoc(facebook::jsi::Runtime &rt, size_t index,
+                                                 const facebook::jsi::Value &value) const;
+    std::shared_ptr<TypedVectorHostObject> pop() const;
+    std::shared_ptr<TypedVectorHostObject> slice(facebook::jsi::Runtime &rt, size_t start,
+                                                 size_t end) const;
+    std::shared_ptr<TypedVectorHostObject> concat(const TypedVectorHostObject &other) const;
+    bool equiv(const TypedVectorHostObject &other) const;
+    int32_t hashOrdered() const;
+
+    // Bulk conversion
+    facebook::jsi::Array toArray(facebook::jsi::Runtime &rt) const;
+
+    // Copies every element into buffer starting at byteOffset and returns
+    // the number of elements written
+    size_t copyInto(facebook::jsi::Runtime &rt, const facebook::jsi::ArrayBuffer &buffer,
+                    size_t byteOffset) const;
+
+    // Get the underlying immer vector (for internal use)
+    const VectorType &getVector() const { return vec_; }
+
+  private:
+    VectorType vec_;
+    mutable std::optional<int32_t> hash_;
+  };
+
+  // Hands out one leaf at a time as a JS array, like VectorChunkIteratorHostObject
+  template <typename T>
+  class TypedChunkIteratorHostObject : public facebook::jsi::HostObject
+  {
+  public:
+    TypedChunkIteratorHostObject(typename TypedVectorHostObject<T>::VectorType vec,
+                                 size_t start);
+
+    // HostObject interface
+    facebook::jsi::Value get(facebook::jsi::Runtime &rt,
+                             const facebook::jsi::PropNameID &name) override;
+
+    facebook::jsi::Value nextChunk(facebook::jsi::Runtime &rt);
+
+  private:
+    typename TypedVectorHostObject<T>::VectorType vec_;
+    size_t pos_;
+  };
+
+  using Float64VectorHostObject = TypedVectorHostObject<double>;
+  using Int32VectorHostObject = TypedVectorHostObject<int32_t>;
+
+  extern template class TypedVectorHostObject<double>;
+  extern template class TypedVectorHostObject<int32_t>;
+  extern template class TypedChunkIteratorHostObject<double>;
+  extern template class TypedChunkIteratorHostObject<int32_t>;
+
+  /**
+   * Install the float64 and int32 factory objects on the PersistentVector
+   * factory (PersistentVector.float64.from([...]), etc.). Typed vectors also
+   * answer count/length/byteLength and their operations as methods
+   * (v.nth(0), v.conj(1.5)).
+   */
+  void installTypedVectors(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory);
+
+} // namespace cljs
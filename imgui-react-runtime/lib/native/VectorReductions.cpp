@@ -0,0 +1,598 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#include "VectorReductions.h"
+#include "HostArgs.h"
+#include "NumericKernels.h"
+#include "PersistentVector.h"
+#include "ThreadPool.h"
+#include "TypedVector.h"
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cljs
+{
+
+  namespace
+  {
+    // Elements that are not stored as doubles are converted into blocks of
+    // this many before running a kernel
+    constexpr size_t kBlockSize = 64;
+
+    // Default number of elements per parallelReduce task
+    constexpr size_t kDefaultParallelChunk = 1 << 16;
+
+    // Thrown by conversions; turned into a JSError or a rejected Promise
+    struct NotANumber
+    {
+      size_t index;
+
+      std::string message() const
+      {
+        std::ostringstream msg;
+        msg << "Element " << index << " is not a number";
+        return msg.str();
+      }
+    };
+
+    inline double toNumber(const StoredValue &value, size_t index)
+    {
+      if (value.type() != StoredValue::NUMBER)
+      {
+        throw NotANumber{index};
+      }
+      return value.asNumber();
+    }
+
+    inline double toNumber(int32_t value, size_t) { return static_cast<double>(value); }
+
+    // Kernel block source over a sequence of leaves of Element. leaves(fn)
+    // calls fn(first, last) for each leaf in order; firstIndex is the
+    // vector index of the first element (for error messages).
+    template <typename Element, typename Leaves>
+    struct BlockSource
+    {
+      Leaves leaves;
+      size_t firstIndex = 0;
+
+      template <typename Fn>
+      void operator()(Fn &&fn) const
+      {
+        if constexpr (std::is_same_v<Element, double>)
+        {
+          // Leaves are already arrays of doubles
+          leaves(fn);
+        }
+        else
+        {
+          double block[kBlockSize];
+          size_t n = 0;
+          size_t index = firstIndex;
+          leaves([&](const Element *first, const Element *last)
+                 {
+            for (; first != last; ++first)
+            {
+              block[n++] = toNumber(*first, index++);
+              if (n == kBlockSize)
+              {
+                fn(static_cast<const double *>(block), static_cast<const double *>(block + n));
+                n = 0;
+              }
+            } });
+          if (n > 0)
+          {
+            fn(static_cast<const double *>(block), static_cast<const double *>(block + n));
+          }
+        }
+      }
+    };
+
+    template <typename Element, typename Leaves>
+    BlockSource<Element, Leaves> blockSource(Leaves leaves, size_t firstIndex = 0)
+    {
+      return BlockSource<Element, Leaves>{std::move(leaves), firstIndex};
+    }
+
+    template <typename Host>
+    struct Reducible;
+
+    template <>
+    struct Reducible<PersistentVectorHostObject>
+    {
+      static constexpr const char *name = "PersistentVector";
+      using Element = StoredValue;
+    };
+
+    template <>
+    struct Reducible<Float64VectorHostObject>
+    {
+      static constexpr const char *name = "PersistentVector.float64";
+      using Element = double;
+    };
+
+    template <>
+    struct Reducible<Int32VectorHostObject>
+    {
+      static constexpr const char *name = "PersistentVector.int32";
+      using Element = int32_t;
+    };
+
+    template <typename Host>
+    auto wholeVector(const Host &host)
+    {
+      using Element = typename Reducible<Host>::Element;
+      const auto &vec = host.getVector();
+      return blockSource<Element>([&vec](auto &&fn)
+                                  { immer::for_each_chunk(vec, fn); });
+    }
+
+    template <typename Host>
+    std::shared_ptr<Host> hostArg(facebook::jsi::Runtime &rt, const facebook::jsi::Value *args,
+                                  size_t count)
+    {
+      if (count > 0 && args[0].isObject())
+      {
+        auto obj = args[0].getObject(rt);
+        if (obj.isHostObject<Host>(rt))
+        {
+          return obj.getHostObject<Host>(rt);
+        }
+      }
+      throw facebook::jsi::JSError(
+          rt, std::string(Reducible<Host>::name) + " instance is invalid");
+    }
+
+    bool strictArg(const facebook::jsi::Value *args, size_t count)
+    {
+      return count > 1 && args[1].isBool() && args[1].getBool();
+    }
+
+    facebook::jsi::Value optionalNumber(std::optional<double> x)
+    {
+      return x ? facebook::jsi::Value(*x) : facebook::jsi::Value::undefined();
+    }
+
+    facebook::jsi::Value optionalIndex(std::optional<size_t> i)
+    {
+      return facebook::jsi::Value(i ? static_cast<double>(*i) : -1.0);
+    }
+
+    // Installs name(v, ...) calling kernel(runtime, source, args, count)
+    template <typename Host, typename Kernel>
+    void installKernel(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory,
+                       const char *name, unsigned int arity, Kernel kernel)
+    {
+      factory.setProperty(
+          rt, name,
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, name), arity,
+              [kernel](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                       const facebook::jsi::Value *args,
+                       size_t count) -> facebook::jsi::Value
+              {
+                auto host = hostArg<Host>(runtime, args, count);
+                try
+                {
+                  return kernel(runtime, wholeVector(*host), args, count);
+                }
+                catch (const NotANumber &e)
+                {
+                  throw facebook::jsi::JSError(runtime, e.message());
+                }
+              }));
+    }
+
+    // --- parallelReduce ---
+
+    enum class ParallelKernel
+    {
+      Sum,
+      Mean,
+      Variance,
+      Min,
+      Max,
+      ArgMin,
+      ArgMax
+    };
+
+    std::optional<ParallelKernel> parseParallelKernel(const std::string &name)
+    {
+      if (name == "sum")
+        return ParallelKernel::Sum;
+      if (name == "mean")
+        return ParallelKernel::Mean;
+      if (name == "variance")
+        return ParallelKernel::Variance;
+      if (name == "min")
+        return ParallelKernel::Min;
+      if (name == "max")
+        return ParallelKernel::Max;
+      if (name == "argmin")
+        return ParallelKernel::ArgMin;
+      if (name == "argmax")
+        return ParallelKernel::ArgMax;
+      return std::nullopt;
+    }
+
+    // Result of one task over a run of whole leaves
+    struct Partial
+    {
+      size_t count = 0;
+      // Sum; mean (variance); min/max; the element at index (argmin/argmax)
+      std::optional<double> value;
+      // Sum of squared deviations from the mean (variance)
+      double m2 = 0;
+      std::optional<size_t> index;
+    };
+
+    // Shared with the workers, so it holds plain data only
+    struct ParallelJob
+    {
+      ParallelKernel kernel;
+      std::vector<Partial> partials;
+      std::atomic<size_t> remaining{0};
+      std::mutex errorMutex;
+      std::optional<NotANumber> error;
+      uint64_t ticket = 0;
+    };
+
+    template <typename Source>
+    double valueAt(const Source &source, size_t index)
+    {
+      double result = 0;
+      size_t offset = 0;
+      source([&](const double *first, const double *last)
+             {
+        size_t n = static_cast<size_t>(last - first);
+        if (index >= offset && index < offset + n)
+        {
+          result = first[index - offset];
+        }
+        offset += n; });
+      return result;
+    }
+
+    template <typename Source>
+    Partial computePartial(ParallelKernel kernel, const Source &source, size_t count)
+    {
+      Partial partial;
+      partial.count = count;
+      switch (kernel)
+      {
+      case ParallelKernel::Sum:
+      case ParallelKernel::Mean:
+        partial.value = kernels::sum(source, false);
+        break;
+      case ParallelKernel::Variance:
+        partial.value = kernels::mean(source, false);
+        partial.m2 = kernels::variance(source, false) * static_cast<double>(count);
+        break;
+      case ParallelKernel::Min:
+        partial.value = kernels::min(source);
+        break;
+      case ParallelKernel::Max:
+        partial.value = kernels::max(source);
+        break;
+      case ParallelKernel::ArgMin:
+      case ParallelKernel::ArgMax:
+        partial.index = kernel == ParallelKernel::ArgMin ? kernels::argmin(source)
+                                                         : kernels::argmax(source);
+        if (partial.index)
+        {
+          partial.value = valueAt(source, *partial.index);
+        }
+        break;
+      }
+      return partial;
+    }
+
+    // Combines the partials in task order on the JS thread
+    facebook::jsi::Value combinePartials(const ParallelJob &job)
+    {
+      const auto &partials = job.partials;
+      size_t total = 0;
+      for (const auto &p : partials)
+      {
+        total += p.count;
+      }
+
+      switch (job.kernel)
+      {
+      case ParallelKernel::Sum:
+      case ParallelKernel::Mean:
+      {
+        double sum = 0;
+        for (const auto &p : partials)
+        {
+          if (p.count > 0)
+            sum += *p.value;
+        }
+        if (job.kernel == ParallelKernel::Sum)
+        {
+          return facebook::jsi::Value(sum);
+        }
+        return facebook::jsi::Value(total == 0 ? std::numeric_limits<double>::quiet_NaN()
+                                               : sum / static_cast<double>(total));
+      }
+      case ParallelKernel::Variance:
+      {
+        // Chan et al. pairwise update of (count, mean, M2)
+        double n = 0, mean = 0, m2 = 0;
+        for (const auto &p : partials)
+        {
+          if (p.count == 0)
+            continue;
+          double nb = static_cast<double>(p.count);
+          double delta = *p.value - mean;
+          double combined = n + nb;
+          mean += delta * nb / combined;
+          m2 += p.m2 + delta * delta * n * nb / combined;
+          n = combined;
+        }
+        return facebook::jsi::Value(n == 0 ? std::numeric_limits<double>::quiet_NaN() : m2 / n);
+      }
+      case ParallelKernel::Min:
+      case ParallelKernel::Max:
+      {
+        // The same kernel over the partial results keeps Math.min/max
+        // semantics for NaN and signed zeros
+        std::vector<double> values;
+        for (const auto &p : partials)
+        {
+          if (p.value)
+            values.push_back(*p.value);
+        }
+        auto source = [&values](auto &&fn)
+        { fn(static_cast<const double *>(values.data()),
+             static_cast<const double *>(values.data() + values.size())); };
+        return optionalNumber(job.kernel == ParallelKernel::Min ? kernels::min(source)
+                                                                : kernels::max(source));
+      }
+      case ParallelKernel::ArgMin:
+      case ParallelKernel::ArgMax:
+      {
+        // The first partial holding the best value wins, as in one pass
+        std::optional<size_t> best;
+        double bestValue = 0;
+        size_t offset = 0;
+        for (const auto &p : partials)
+        {
+          if (p.index && (!best || (job.kernel == ParallelKernel::ArgMin ? *p.value < bestValue
+                                                                         : *p.value > bestValue)))
+          {
+            best = offset + *p.index;
+            bestValue = *p.value;
+          }
+          offset += p.count;
+        }
+        return optionalIndex(best);
+      }
+      }
+      return facebook::jsi::Value::undefined();
+    }
+
+    // Creates a Promise and hands its resolve/reject functions to the caller
+    facebook::jsi::Value createPromise(
+        facebook::jsi::Runtime &rt,
+        std::shared_ptr<facebook::jsi::Function> &resolve,
+        std::shared_ptr<facebook::jsi::Function> &reject)
+    {
+      auto executor = facebook::jsi::Function::createFromHostFunction(
+          rt, facebook::jsi::PropNameID::forAscii(rt, "executor"), 2,
+          [&](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+              const facebook::jsi::Value *args, size_t) -> facebook::jsi::Value
+          {
+            resolve = std::make_shared<facebook::jsi::Function>(args[0].getObject(runtime).getFunction(runtime));
+            reject = std::make_shared<facebook::jsi::Function>(args[1].getObject(runtime).getFunction(runtime));
+            return facebook::jsi::Value::undefined();
+          });
+      return rt.global().getPropertyAsFunction(rt, "Promise").callAsConstructor(rt, executor);
+    }
+
+    template <typename Host>
+    facebook::jsi::Value parallelReduce(facebook::jsi::Runtime &rt, std::shared_ptr<Host> host,
+                                        ParallelKernel kernel, size_t chunkSize)
+    {
+      using Element = typename Reducible<Host>::Element;
+      using Leaf = std::pair<const Element *, const Element *>;
+
+      // Leaf pointers are taken here; workers only read through them
+      auto leaves = std::make_shared<std::vector<Leaf>>();
+      immer::for_each_chunk(host->getVector(), [&](const Element *first, const Element *last)
+                            { leaves->emplace_back(first, last); });
+
+      // Whole leaves per task, about chunkSize elements each
+      struct Task
+      {
+        size_t leafBegin, leafEnd, firstIndex, count;
+      };
+      std::vector<Task> tasks;
+      size_t index = 0;
+      for (size_t i = 0; i < leaves->size();)
+      {
+        Task task{i, i, index, 0};
+        while (task.leafEnd < leaves->size() && (task.count == 0 || task.count < chunkSize))
+        {
+          task.count += static_cast<size_t>((*leaves)[task.leafEnd].second - (*leaves)[task.leafEnd].first);
+          ++task.leafEnd;
+        }
+        tasks.push_back(task);
+        index += task.count;
+        i = task.leafEnd;
+      }
+
+      auto job = std::make_shared<ParallelJob>();
+      job->kernel = kernel;
+      job->partials.resize(tasks.size());
+      job->remaining = tasks.size();
+
+      std::shared_ptr<facebook::jsi::Function> resolve, reject;
+      auto promise = createPromise(rt, resolve, reject);
+
+      auto &pool = ThreadPool::shared();
+      // Runs on the JS thread; also keeps the vector alive until then
+      job->ticket = pool.defer(
+          rt, [job, host, resolve, reject](facebook::jsi::Runtime &runtime)
+          {
+            if (job->error)
+            {
+              auto ctor = runtime.global().getPropertyAsFunction(runtime, "Error");
+              reject->call(runtime, ctor.callAsConstructor(
+                                        runtime, facebook::jsi::String::createFromUtf8(runtime, job->error->message())));
+              return;
+            }
+            resolve->call(runtime, combinePartials(*job)); });
+
+      if (tasks.empty())
+      {
+        pool.complete(job->ticket);
+        return promise;
+      }
+
+      for (size_t t = 0; t < tasks.size(); ++t)
+      {
+        pool.submit([job, leaves, task = tasks[t], t]
+                    {
+          auto source = blockSource<Element>(
+              [&](auto &&fn)
+              {
+                for (size_t i = task.leafBegin; i < task.leafEnd; ++i)
+                  fn((*leaves)[i].first, (*leaves)[i].second);
+              },
+              task.firstIndex);
+          try
+          {
+            job->partials[t] = computePartial(job->kernel, source, task.count);
+          }
+          catch (const NotANumber &e)
+          {
+            std::lock_guard<std::mutex> lock(job->errorMutex);
+            if (!job->error || e.index < job->error->index)
+              job->error = e;
+          }
+          if (job->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+          {
+            ThreadPool::shared().complete(job->ticket);
+          } });
+      }
+      return promise;
+    }
+
+    template <typename Host>
+    void installReductions(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory)
+    {
+      installKernel<Host>(rt, factory, "sum", 2,
+                          [](facebook::jsi::Runtime &, const auto &source,
+                             const facebook::jsi::Value *args, size_t count)
+                          { return facebook::jsi::Value(kernels::sum(source, strictArg(args, count))); });
+
+      installKernel<Host>(rt, factory, "mean", 2,
+                          [](facebook::jsi::Runtime &, const auto &source,
+                             const facebook::jsi::Value *args, size_t count)
+                          { return facebook::jsi::Value(kernels::mean(source, strictArg(args, count))); });
+
+      installKernel<Host>(rt, factory, "variance", 2,
+                          [](facebook::jsi::Runtime &, const auto &source,
+                             const facebook::jsi::Value *args, size_t count)
+                          { return facebook::jsi::Value(kernels::variance(source, strictArg(args, count))); });
+
+      installKernel<Host>(rt, factory, "min", 1,
+                          [](facebook::jsi::Runtime &, const auto &source,
+                             const facebook::jsi::Value *, size_t)
+                          { return optionalNumber(kernels::min(source)); });
+
+      installKernel<Host>(rt, factory, "max", 1,
+                          [](facebook::jsi::Runtime &, const auto &source,
+                             const facebook::jsi::Value *, size_t)
+                          { return optionalNumber(kernels::max(source)); });
+
+      installKernel<Host>(rt, factory, "argmin", 1,
+                          [](facebook::jsi::Runtime &, const auto &source,
+                             const facebook::jsi::Value *, size_t)
+                          { return optionalIndex(kernels::argmin(source)); });
+
+      installKernel<Host>(rt, factory, "argmax", 1,
+                          [](facebook::jsi::Runtime &, const auto &source,
+                             const facebook::jsi::Value *, size_t)
+                          { return optionalIndex(kernels::argmax(source)); });
+
+      installKernel<Host>(rt, factory, "countWhere", 3,
+                          [](facebook::jsi::Runtime &runtime, const auto &source,
+                             const facebook::jsi::Value *args, size_t count)
+                          {
+                            std::optional<kernels::CompareOp> op;
+                            if (count > 1 && args[1].isString())
+                            {
+                              op = kernels::parseCompareOp(args[1].getString(runtime).utf8(runtime));
+                            }
+                            if (!op || count < 3 || !args[2].isNumber())
+                            {
+                              throw facebook::jsi::JSError(
+                                  runtime, "countWhere requires an operator (<, <=, >, >=, ==, !=) and a number");
+                            }
+                            return facebook::jsi::Value(
+                                static_cast<double>(kernels::countWhere(source, *op, args[2].getNumber())));
+                          });
+
+      // parallelReduce(v, kernel, chunkSize?) - Promise of the kernel result
+      factory.setProperty(
+          rt, "parallelReduce",
+          facebook::jsi::Function::createFromHostFunction(
+              rt, facebook::jsi::PropNameID::forAscii(rt, "parallelReduce"), 3,
+              [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                 const facebook::jsi::Value *args,
+                 size_t count) -> facebook::jsi::Value
+              {
+                auto host = hostArg<Host>(runtime, args, count);
+                std::optional<ParallelKernel> kernel;
+                if (count > 1 && args[1].isString())
+                {
+                  kernel = parseParallelKernel(args[1].getString(runtime).utf8(runtime));
+                }
+                if (!kernel)
+                {
+                  throw facebook::jsi::JSError(
+                      runtime, "parallelReduce kernel must be one of sum, mean, variance, min, max, argmin, argmax");
+                }
+                size_t chunkSize = kDefaultParallelChunk;
+                if (count > 2 && !args[2].isUndefined())
+                {
+                  chunkSize = indexArg(runtime, args, count, 2, "parallelReduce");
+                  if (chunkSize < 1)
+                  {
+                    throw facebook::jsi::JSError(runtime, "parallelReduce chunkSize must be a positive number");
+                  }
+                }
+                return parallelReduce(runtime, std::move(host), *kernel, chunkSize);
+              }));
+    }
+  } // namespace
+
+  void installVectorReductions(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory,
+                               ReductionTarget target)
+  {
+    switch (target)
+    {
+    case ReductionTarget::Vector:
+      installReductions<PersistentVectorHostObject>(rt, factory);
+      break;
+    case ReductionTarget::Float64:
+      installReductions<Float64VectorHostObject>(rt, factory);
+      break;
+    case ReductionTarget::Int32:
+      installReductions<Int32VectorHostObject>(rt, factory);
+      break;
+    }
+  }
+
+} // namespace cljs
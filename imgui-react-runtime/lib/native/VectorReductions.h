@@ -0,0 +1,41 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+#pragma once
+
+#include <hermes/hermes.h>
+#include <jsi/jsi.h>
+
+namespace cljs
+{
+
+  enum class ReductionTarget
+  {
+    Vector,
+    Float64,
+    Int32
+  };
+
+  /**
+   * Install native numeric reductions (NumericKernels.h) on a vector
+   * factory object. They run over immer leaves with no JS callbacks:
+   *
+   * - sum(v, strict?), mean(v, strict?), variance(v, strict?)
+   * - min(v), max(v) - Like Math.min/Math.max; undefined when empty
+   * - countWhere(v, op, x) - Elements e with (e op x), op one of
+   *   "<", "<=", ">", ">=", "==", "!="
+   * - argmin(v), argmax(v) - Index of the first smallest/largest element,
+   *   ignoring NaN; -1 when there is none
+   * - parallelReduce(v, kernel, chunkSize?) - Promise of sum, mean,
+   *   variance, min, max, argmin or argmax computed on ThreadPool workers,
+   *   about chunkSize (default 65536) elements per task; settles when the
+   *   host calls pumpNativeTasks
+   *
+   * strict adds left to right, bit-exact with (reduce + v). Elements of a
+   * PersistentVector must all be numbers.
+   */
+  void installVectorReductions(facebook::jsi::Runtime &rt, facebook::jsi::Object &factory,
+                               ReductionTarget target);
+
+} // namespace cljs
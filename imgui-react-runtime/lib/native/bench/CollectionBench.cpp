@@ -0,0 +1,418 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+// Headless Hermes host for the native vs cljs.core collection benchmarks.
+// The cases live in ClojureScript (src/hermes/collection_bench.cljs, compiled
+// with `npx shadow-cljs release collection-bench`) so both sides are driven
+// through the same cljs protocols. This host installs the native
+// collections, hands the bundle its parameters through globalThis.NativeBench
+// and writes what it records as JSON:
+//
+//   {"schema": 1, "timestamp": ..., "build": {...}, "sizes": [...],
+//    "results": [{"collection": "vector", "op": "nth", "impl": "native",
+//                 "size": 1000, "ops": ..., "nsPerOp": ...,
+//                 "allocationsPerOp": ..., "nativeBytesPerOp": ...,
+//                 "jsBytesPerOp": ..., "rssBytes": ..., "rssDeltaBytes": ...}]}
+//
+// allocations/nativeBytes count C++ operator new calls in this process (immer
+// nodes, boxed strings, jsi handles); jsBytes is Hermes' own allocation
+// counter, which covers the cljs.core collections and the JS wrappers.
+
+#include <hermes/hermes.h>
+#include <jsi/jsi.h>
+
+#include "PersistentMap.h"
+#include "PersistentSet.h"
+#include "PersistentSortedMap.h"
+#include "PersistentVector.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+#ifndef NATIVE_CLJS_BENCH_BUNDLE
+#define NATIVE_CLJS_BENCH_BUNDLE "collection-bench/main.js"
+#endif
+
+#ifndef NATIVE_CLJS_BENCH_BUILD_TYPE
+#define NATIVE_CLJS_BENCH_BUILD_TYPE "unknown"
+#endif
+
+namespace
+{
+    std::atomic<uint64_t> g_allocations{0};
+    std::atomic<uint64_t> g_allocatedBytes{0};
+
+    void *countedAlloc(std::size_t size)
+    {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        if (void *p = std::malloc(size ? size : 1))
+        {
+            return p;
+        }
+        throw std::bad_alloc();
+    }
+} // namespace
+
+// Counts every C++ heap allocation in the process, including immer's
+void *operator new(std::size_t size) { return countedAlloc(size); }
+void *operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+namespace
+{
+#if CLJS_NATIVE_SINGLE_THREADED
+    constexpr bool kSingleThreaded = true;
+#else
+    constexpr bool kSingleThreaded = false;
+#endif
+
+    struct Options
+    {
+        std::string bundlePath = NATIVE_CLJS_BENCH_BUNDLE;
+        std::string outPath = "native-cljs-bench.json";
+        std::vector<double> sizes = {10, 100, 1000, 10000, 100000, 1000000, 10000000};
+        double minTimeMs = 200;
+        std::string filter;
+    };
+
+    // Current resident set size, or 0 where unsupported
+    uint64_t residentBytes()
+    {
+#if defined(__APPLE__)
+        mach_task_basic_info info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+        if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                      reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+        {
+            return info.resident_size;
+        }
+        return 0;
+#elif defined(__linux__)
+        std::ifstream statm("/proc/self/statm");
+        uint64_t pages = 0, resident = 0;
+        if (statm >> pages >> resident)
+        {
+            return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        }
+        return 0;
+#else
+        return 0;
+#endif
+    }
+
+    // Hermes' running total of bytes allocated in the JS heap
+    double jsAllocatedBytes(facebook::jsi::Runtime &rt)
+    {
+        auto info = rt.instrumentation().getHeapInfo(false);
+        auto it = info.find("hermes_totalAllocatedBytes");
+        if (it == info.end())
+        {
+            it = info.find("hermes_allocatedBytes");
+        }
+        return it == info.end() ? 0 : static_cast<double>(it->second);
+    }
+
+    void printUsage(const char *programName)
+    {
+        std::cout << "Usage: " << programName << " [options] [bundle.js]\n"
+                  << "\n"
+                  << "Options:\n"
+                  << "  --out FILE        JSON results (default native-cljs-bench.json)\n"
+                  << "  --sizes N,N,...   Collection sizes (default 10,100,...,10000000)\n"
+                  << "  --min-time MS     Minimum measured time per case (default 200)\n"
+                  << "  --filter TEXT     Only cases whose collection/op contains TEXT\n"
+                  << "  --help, -h        Show this help message\n"
+                  << "\n"
+                  << "The bundle defaults to " << NATIVE_CLJS_BENCH_BUNDLE << "\n"
+                  << "(npx shadow-cljs release collection-bench).\n";
+    }
+
+    bool parseSizes(const std::string &text, std::vector<double> &sizes)
+    {
+        sizes.clear();
+        std::istringstream in(text);
+        std::string item;
+        while (std::getline(in, item, ','))
+        {
+            char *end = nullptr;
+            double n = std::strtod(item.c_str(), &end);
+            if (item.empty() || *end != '\0' || n < 1)
+            {
+                return false;
+            }
+            sizes.push_back(n);
+        }
+        return !sizes.empty();
+    }
+
+    std::string readFile(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    }
+
+    std::string isoTimestamp()
+    {
+        std::time_t now = std::time(nullptr);
+        char text[32];
+        std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        return text;
+    }
+
+    // console.log for cljs println and diagnostics
+    void installConsole(facebook::jsi::Runtime &rt)
+    {
+        facebook::jsi::Object console(rt);
+        console.setProperty(
+            rt, "log",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "log"), 0,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *args,
+                   size_t count) -> facebook::jsi::Value
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        std::cerr << (i > 0 ? " " : "") << args[i].toString(runtime).utf8(runtime);
+                    }
+                    std::cerr << std::endl;
+                    return facebook::jsi::Value::undefined();
+                }));
+        rt.global().setProperty(rt, "console", console);
+    }
+
+    void installPerformance(facebook::jsi::Runtime &rt)
+    {
+        facebook::jsi::Object performance(rt);
+        performance.setProperty(
+            rt, "now",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "now"), 0,
+                [](facebook::jsi::Runtime &, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *,
+                   size_t) -> facebook::jsi::Value
+                {
+                    auto now = std::chrono::steady_clock::now().time_since_epoch();
+                    return facebook::jsi::Value(std::chrono::duration<double, std::milli>(now).count());
+                }));
+        rt.global().setProperty(rt, "performance", performance);
+    }
+
+    // globalThis.NativeBench: the run parameters, counters and result sink
+    void installBenchHost(facebook::jsi::Runtime &rt, const Options &options,
+                          std::vector<std::string> &results)
+    {
+        facebook::jsi::Object bench(rt);
+
+        facebook::jsi::Array sizes(rt, options.sizes.size());
+        for (size_t i = 0; i < options.sizes.size(); ++i)
+        {
+            sizes.setValueAtIndex(rt, i, options.sizes[i]);
+        }
+        bench.setProperty(rt, "sizes", sizes);
+        bench.setProperty(rt, "minTimeMs", options.minTimeMs);
+        bench.setProperty(rt, "filter", facebook::jsi::String::createFromUtf8(rt, options.filter));
+
+        // NativeBench.sample() - {allocations, allocatedBytes, jsAllocatedBytes, rss}
+        bench.setProperty(
+            rt, "sample",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "sample"), 0,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *,
+                   size_t) -> facebook::jsi::Value
+                {
+                    // Read the counters first: building the result allocates
+                    double allocations = static_cast<double>(g_allocations.load());
+                    double allocatedBytes = static_cast<double>(g_allocatedBytes.load());
+                    double rss = static_cast<double>(residentBytes());
+                    facebook::jsi::Object sample(runtime);
+                    sample.setProperty(runtime, "allocations", allocations);
+                    sample.setProperty(runtime, "allocatedBytes", allocatedBytes);
+                    sample.setProperty(runtime, "jsAllocatedBytes", jsAllocatedBytes(runtime));
+                    sample.setProperty(runtime, "rss", rss);
+                    return sample;
+                }));
+
+        // NativeBench.collectGarbage() - Full GC so cases start from a clean heap
+        bench.setProperty(
+            rt, "collectGarbage",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "collectGarbage"), 0,
+                [](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                   const facebook::jsi::Value *,
+                   size_t) -> facebook::jsi::Value
+                {
+                    runtime.instrumentation().collectGarbage("native-cljs-bench");
+                    return facebook::jsi::Value::undefined();
+                }));
+
+        // NativeBench.record(result) - Append one result object to the output
+        bench.setProperty(
+            rt, "record",
+            facebook::jsi::Function::createFromHostFunction(
+                rt, facebook::jsi::PropNameID::forAscii(rt, "record"), 1,
+                [&results](facebook::jsi::Runtime &runtime, const facebook::jsi::Value &,
+                           const facebook::jsi::Value *args,
+                           size_t count) -> facebook::jsi::Value
+                {
+                    if (count < 1 || !args[0].isObject())
+                    {
+                        throw facebook::jsi::JSError(runtime, "record requires a result object");
+                    }
+                    auto stringify = runtime.global()
+                                         .getPropertyAsObject(runtime, "JSON")
+                                         .getPropertyAsFunction(runtime, "stringify");
+                    results.push_back(stringify.call(runtime, args[0]).getString(runtime).utf8(runtime));
+
+                    auto result = args[0].getObject(runtime);
+                    auto text = [&](const char *name)
+                    { return result.getProperty(runtime, name).toString(runtime).utf8(runtime); };
+                    std::fprintf(stderr, "%-7s %-7s %-10s %9.0f %12.1f ns/op %10.2f allocs/op\n",
+                                 text("collection").c_str(), text("op").c_str(), text("impl").c_str(),
+                                 result.getProperty(runtime, "size").asNumber(),
+                                 result.getProperty(runtime, "nsPerOp").asNumber(),
+                                 result.getProperty(runtime, "allocationsPerOp").asNumber());
+                    return facebook::jsi::Value::undefined();
+                }));
+
+        rt.global().setProperty(rt, "NativeBench", bench);
+    }
+
+    void writeResults(const Options &options, const std::vector<std::string> &results)
+    {
+        std::ofstream out(options.outPath);
+        if (!out.is_open())
+        {
+            throw std::runtime_error("Failed to open output file: " + options.outPath);
+        }
+        out << "{\n  \"schema\": 1,\n"
+            << "  \"timestamp\": \"" << isoTimestamp() << "\",\n"
+            << "  \"build\": {\"type\": \"" << NATIVE_CLJS_BENCH_BUILD_TYPE << "\", "
+            << "\"singleThreaded\": " << (kSingleThreaded ? "true" : "false") << "},\n"
+            << "  \"minTimeMs\": " << options.minTimeMs << ",\n"
+            << "  \"sizes\": [";
+        for (size_t i = 0; i < options.sizes.size(); ++i)
+        {
+            out << (i > 0 ? ", " : "") << static_cast<uint64_t>(options.sizes[i]);
+        }
+        out << "],\n  \"results\": [";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            out << (i > 0 ? ",\n    " : "\n    ") << results[i];
+        }
+        out << "\n  ]\n}\n";
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    bool bundleGiven = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "--out" && hasValue)
+        {
+            options.outPath = argv[++i];
+        }
+        else if (arg == "--sizes" && hasValue)
+        {
+            if (!parseSizes(argv[++i], options.sizes))
+            {
+                std::cerr << "Invalid --sizes: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--min-time" && hasValue)
+        {
+            options.minTimeMs = std::atof(argv[++i]);
+        }
+        else if (arg == "--filter" && hasValue)
+        {
+            options.filter = argv[++i];
+        }
+        else if (arg[0] != '-' && !bundleGiven)
+        {
+            options.bundlePath = arg;
+            bundleGiven = true;
+        }
+        else
+        {
+            std::cerr << "Unknown or incomplete option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Outlives the runtime, whose record function appends to it
+    std::vector<std::string> results;
+    auto runtimeConfig = ::hermes::vm::RuntimeConfig::Builder()
+                             .withES6BlockScoping(true)
+                             .build();
+    auto runtime = facebook::hermes::makeHermesRuntime(runtimeConfig);
+
+    installConsole(*runtime);
+    installPerformance(*runtime);
+    installBenchHost(*runtime, options, results);
+    cljs::installPersistentVector(*runtime);
+    cljs::installPersistentMap(*runtime);
+    cljs::installPersistentSet(*runtime);
+    cljs::installPersistentSortedMap(*runtime);
+
+    try
+    {
+        std::string bundle = readFile(options.bundlePath);
+        runtime->evaluateJavaScript(std::make_shared<facebook::jsi::StringBuffer>(bundle),
+                                    options.bundlePath);
+        writeResults(options, results);
+    }
+    catch (const facebook::jsi::JSError &e)
+    {
+        std::cerr << "JavaScript error: " << e.getStack() << std::endl;
+        return 1;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cerr << results.size() << " results written to " << options.outPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,156 @@
+// Copyright (c) Tzvetan Mikov and contributors
+// SPDX-License-Identifier: MIT
+// See LICENSE file for full license text
+
+// Compares immer's default (thread-safe) memory policy with the
+// single-threaded policy selected by NATIVE_CLJS_SINGLE_THREADED. Both run in
+// one binary, so the delta is visible without rebuilding. Elements are
+// refcounted handles like StoredValue strings/objects, since path copying a
+// leaf copies (and retains) all of its elements.
+
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <random>
+
+namespace
+{
+    using SafePolicy = immer::default_memory_policy;
+    using UnsafePolicy =
+        immer::memory_policy<immer::unsafe_free_list_heap_policy<immer::cpp_heap>,
+                             immer::unsafe_refcount_policy,
+                             immer::no_lock_policy>;
+
+    struct AtomicCount
+    {
+        std::atomic<uint32_t> count{1};
+        void increment() { count.fetch_add(1, std::memory_order_relaxed); }
+        bool decrement() { return count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+    };
+
+    struct PlainCount
+    {
+        uint32_t count = 1;
+        void increment() { ++count; }
+        bool decrement() { return --count == 0; }
+    };
+
+    // Minimal stand-in for a StoredValue holding a string/object cell
+    template <typename Count>
+    class Handle
+    {
+    public:
+        Handle() : cell_(new Cell{}) {}
+        explicit Handle(double v) : cell_(new Cell{}) { cell_->value = v; }
+        Handle(const Handle &other) : cell_(other.cell_) { cell_->refs.increment(); }
+        Handle &operator=(const Handle &other)
+        {
+            other.cell_->refs.increment();
+            release();
+            cell_ = other.cell_;
+            return *this;
+        }
+        ~Handle() { release(); }
+
+        double value() const { return cell_->value; }
+
+    private:
+        struct Cell
+        {
+            Count refs;
+            double value = 0;
+        };
+
+        void release()
+        {
+            if (cell_->refs.decrement())
+                delete cell_;
+        }
+
+        Cell *cell_;
+    };
+
+    constexpr size_t kSize = 100000;
+    constexpr size_t kUpdates = 1000000;
+
+    template <typename F>
+    double timeMs(F &&f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    template <typename Policy, typename Count>
+    double vectorAssoc()
+    {
+        using Vec = immer::flex_vector<Handle<Count>, Policy>;
+        auto t = Vec{}.transient();
+        for (size_t i = 0; i < kSize; ++i)
+            t.push_back(Handle<Count>(i));
+        Vec v = t.persistent();
+
+        std::mt19937 rng(42);
+        Handle<Count> x(1.0);
+        return timeMs([&]
+                      {
+            for (size_t i = 0; i < kUpdates; ++i)
+                v = v.set(rng() % kSize, x); });
+    }
+
+    template <typename Policy, typename Count>
+    double vectorConj()
+    {
+        using Vec = immer::flex_vector<Handle<Count>, Policy>;
+        Handle<Count> x(1.0);
+        return timeMs([&]
+                      {
+            Vec v;
+            for (size_t i = 0; i < kUpdates; ++i)
+                v = v.push_back(x); });
+    }
+
+    template <typename Policy, typename Count>
+    double mapAssoc()
+    {
+        using Map = immer::map<double, Handle<Count>, std::hash<double>,
+                               std::equal_to<double>, Policy>;
+        auto t = Map{}.transient();
+        for (size_t i = 0; i < kSize; ++i)
+            t.set(static_cast<double>(i), Handle<Count>(i));
+        Map m = t.persistent();
+
+        std::mt19937 rng(42);
+        Handle<Count> x(1.0);
+        return timeMs([&]
+                      {
+            for (size_t i = 0; i < kUpdates; ++i)
+                m = m.set(static_cast<double>(rng() % kSize), x); });
+    }
+
+    void report(const char *name, double safe, double unsafe)
+    {
+        std::printf("%-14s %10.1f ms %10.1f ms %8.2fx\n", name, safe, unsafe, safe / unsafe);
+    }
+} // namespace
+
+int main()
+{
+    std::printf("%zu updates on %zu elements\n", kUpdates, kSize);
+    std::printf("%-14s %13s %13s %9s\n", "", "thread-safe", "single-thr.", "speedup");
+    report("vector assoc", vectorAssoc<SafePolicy, AtomicCount>(),
+           vectorAssoc<UnsafePolicy, PlainCount>());
+    report("vector conj", vectorConj<SafePolicy, AtomicCount>(),
+           vectorConj<UnsafePolicy, PlainCount>());
+    report("map assoc", mapAssoc<SafePolicy, AtomicCount>(),
+           mapAssoc<UnsafePolicy, PlainCount>());
+    return 0;
+}